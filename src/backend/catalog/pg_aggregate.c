@@ -48,8 +48,11 @@ AggregateCreate(const char *aggName,
 				int numArgs,
 				List *aggtransfnName,
 				List *aggfinalfnName,
+				List *agginvtransfnName,
+				List *aggcombinefnName,
 				List *aggsortopName,
 				Oid aggTransType,
+				int32 aggTransSpace,
 				const char *agginitval)
 {
 	Relation	aggdesc;
@@ -59,7 +62,10 @@ AggregateCreate(const char *aggName,
 	Form_pg_proc proc;
 	Oid			transfn;
 	Oid			finalfn = InvalidOid;	/* can be omitted */
+	Oid			invtransfn = InvalidOid;	/* can be omitted */
+	Oid			combinefn = InvalidOid; /* can be omitted */
 	Oid			sortop = InvalidOid;	/* can be omitted */
+	bool		transIsStrict;
 	bool		hasPolyArg;
 	bool		hasInternalArg;
 	Oid			rettype;
@@ -129,6 +135,7 @@ AggregateCreate(const char *aggName,
 	if (!HeapTupleIsValid(tup))
 		elog(ERROR, "cache lookup failed for function %u", transfn);
 	proc = (Form_pg_proc) GETSTRUCT(tup);
+	transIsStrict = proc->proisstrict;
 
 	/*
 	 * If the transfn is strict and the initval is NULL, make sure first input
@@ -145,6 +152,65 @@ AggregateCreate(const char *aggName,
 	}
 	ReleaseSysCache(tup);
 
+	/*
+	 * handle invtransfn, if supplied.  It takes the same arguments as the
+	 * transfn and must likewise return the transition type.
+	 */
+	if (agginvtransfnName)
+	{
+		invtransfn = lookup_agg_function(agginvtransfnName, nargs_transfn,
+										 fnArgs, &rettype);
+		if (rettype != aggTransType)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("return type of inverse transition function %s is not %s",
+							NameListToString(agginvtransfnName),
+							format_type_be(aggTransType))));
+
+		/*
+		 * The window executor leaves rows with a null argument out of the
+		 * moving state if either function is strict.  A strict inverse may
+		 * go with a non-strict transfn that ignores null inputs, as in the
+		 * built-in sums of integers, but a strict transfn never shows the
+		 * inverse those rows, so it must be strict too.
+		 */
+		tup = SearchSysCache1(PROCOID, ObjectIdGetDatum(invtransfn));
+		if (!HeapTupleIsValid(tup))
+			elog(ERROR, "cache lookup failed for function %u", invtransfn);
+		proc = (Form_pg_proc) GETSTRUCT(tup);
+		if (transIsStrict && !proc->proisstrict)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_FUNCTION_DEFINITION),
+					 errmsg("inverse transition function %s must be strict if the transition function is",
+							NameListToString(agginvtransfnName))));
+		ReleaseSysCache(tup);
+	}
+
+	/*
+	 * handle combinefn, if supplied.  It merges two transition states, so it
+	 * takes (transtype, transtype) and returns the transition type.
+	 */
+	if (aggcombinefnName)
+	{
+		Oid			combineArgs[2];
+
+		combineArgs[0] = aggTransType;
+		combineArgs[1] = aggTransType;
+		combinefn = lookup_agg_function(aggcombinefnName, 2,
+										combineArgs, &rettype);
+		if (rettype != aggTransType)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("return type of combine function %s is not %s",
+							NameListToString(aggcombinefnName),
+							format_type_be(aggTransType))));
+	}
+
+	if (aggTransSpace < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("aggregate transition space must not be negative")));
+
 	/* handle finalfn, if supplied */
 	if (aggfinalfnName)
 	{
@@ -244,8 +310,11 @@ AggregateCreate(const char *aggName,
 	values[Anum_pg_aggregate_aggfnoid - 1] = ObjectIdGetDatum(procOid);
 	values[Anum_pg_aggregate_aggtransfn - 1] = ObjectIdGetDatum(transfn);
 	values[Anum_pg_aggregate_aggfinalfn - 1] = ObjectIdGetDatum(finalfn);
+	values[Anum_pg_aggregate_agginvtransfn - 1] = ObjectIdGetDatum(invtransfn);
+	values[Anum_pg_aggregate_aggcombinefn - 1] = ObjectIdGetDatum(combinefn);
 	values[Anum_pg_aggregate_aggsortop - 1] = ObjectIdGetDatum(sortop);
 	values[Anum_pg_aggregate_aggtranstype - 1] = ObjectIdGetDatum(aggTransType);
+	values[Anum_pg_aggregate_aggtransspace - 1] = Int32GetDatum(aggTransSpace);
 	if (agginitval)
 		values[Anum_pg_aggregate_agginitval - 1] = CStringGetTextDatum(agginitval);
 	else
@@ -285,6 +354,24 @@ AggregateCreate(const char *aggName,
 		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
 	}
 
+	/* Depends on inverse transition function, if any */
+	if (OidIsValid(invtransfn))
+	{
+		referenced.classId = ProcedureRelationId;
+		referenced.objectId = invtransfn;
+		referenced.objectSubId = 0;
+		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+	}
+
+	/* Depends on combine function, if any */
+	if (OidIsValid(combinefn))
+	{
+		referenced.classId = ProcedureRelationId;
+		referenced.objectId = combinefn;
+		referenced.objectSubId = 0;
+		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+	}
+
 	/* Depends on sort operator, if any */
 	if (OidIsValid(sortop))
 	{
@@ -296,7 +383,8 @@ AggregateCreate(const char *aggName,
 }
 
 /*
- * lookup_agg_function -- common code for finding both transfn and finalfn
+ * lookup_agg_function -- common code for finding transfn, invtransfn,
+ * combinefn and finalfn
  */
 static Oid
 lookup_agg_function(List *fnName,
@@ -53,9 +53,12 @@ DefineAggregate(List *name, List *args, bool oldstyle, List *parameters)
 	AclResult	aclresult;
 	List	   *transfuncName = NIL;
 	List	   *finalfuncName = NIL;
+	List	   *invfuncName = NIL;
+	List	   *combinefuncName = NIL;
 	List	   *sortoperatorName = NIL;
 	TypeName   *baseType = NULL;
 	TypeName   *transType = NULL;
+	int32		transSpace = 0;
 	char	   *initval = NULL;
 	Oid		   *aggArgTypes;
 	int			numArgs;
@@ -85,6 +88,10 @@ DefineAggregate(List *name, List *args, bool oldstyle, List *parameters)
 			transfuncName = defGetQualifiedName(defel);
 		else if (pg_strcasecmp(defel->defname, "finalfunc") == 0)
 			finalfuncName = defGetQualifiedName(defel);
+		else if (pg_strcasecmp(defel->defname, "invfunc") == 0)
+			invfuncName = defGetQualifiedName(defel);
+		else if (pg_strcasecmp(defel->defname, "combinefunc") == 0)
+			combinefuncName = defGetQualifiedName(defel);
 		else if (pg_strcasecmp(defel->defname, "sortop") == 0)
 			sortoperatorName = defGetQualifiedName(defel);
 		else if (pg_strcasecmp(defel->defname, "basetype") == 0)
@@ -93,6 +100,8 @@ DefineAggregate(List *name, List *args, bool oldstyle, List *parameters)
 			transType = defGetTypeName(defel);
 		else if (pg_strcasecmp(defel->defname, "stype1") == 0)
 			transType = defGetTypeName(defel);
+		else if (pg_strcasecmp(defel->defname, "sspace") == 0)
+			transSpace = (int32) defGetInt64(defel);
 		else if (pg_strcasecmp(defel->defname, "initcond") == 0)
 			initval = defGetString(defel);
 		else if (pg_strcasecmp(defel->defname, "initcond1") == 0)
@@ -201,8 +210,11 @@ DefineAggregate(List *name, List *args, bool oldstyle, List *parameters)
 					numArgs,
 					transfuncName,		/* step function name */
 					finalfuncName,		/* final function name */
+					invfuncName,	/* inverse step function name */
+					combinefuncName,	/* combine function name */
 					sortoperatorName,	/* sort operator name */
 					transTypeId,	/* transition data type */
+					transSpace,		/* transition space */
 					initval);	/* initial condition */
 }
 
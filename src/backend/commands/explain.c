@@ -76,11 +76,13 @@ static void show_sort_keys(SortState *sortstate, List *ancestors,
 			   ExplainState *es);
 static void show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 					   ExplainState *es);
-static void show_sort_keys_common(PlanState *planstate,
+static void show_sort_keys_common(PlanState *planstate, const char *qlabel,
 					  int nkeys, AttrNumber *keycols,
 					  List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_windowagg_info(WindowAggState *winstate, ExplainState *es);
+static void show_agg_info(AggState *aggstate, ExplainState *es);
 static void show_foreignscan_info(ForeignScanState *fsstate, ExplainState *es);
 static const char *explain_get_index_name(Oid indexId);
 static void ExplainScanTarget(Scan *plan, ExplainState *es);
@@ -693,7 +695,14 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			pname = sname = "Materialize";
 			break;
 		case T_Sort:
-			pname = sname = "Sort";
+			sname = "Sort";
+			if (((SortState *) planstate)->incremental)
+			{
+				pname = "Incremental Sort";
+				strategy = "Incremental";
+			}
+			else
+				pname = "Sort";
 			break;
 		case T_Group:
 			pname = sname = "Group";
@@ -1069,6 +1078,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
 			break;
 		case T_Agg:
+			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
+			show_agg_info((AggState *) planstate, es);
+			break;
 		case T_Group:
 			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
 			break;
@@ -1088,6 +1100,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Hash:
 			show_hash_info((HashState *) planstate, es);
 			break;
+		case T_WindowAgg:
+			show_windowagg_info((WindowAggState *) planstate, es);
+			break;
 		default:
 			break;
 	}
@@ -1382,9 +1397,13 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 {
 	Sort	   *plan = (Sort *) sortstate->ss.ps.plan;
 
-	show_sort_keys_common((PlanState *) sortstate,
+	show_sort_keys_common((PlanState *) sortstate, "Sort Key",
 						  plan->numCols, plan->sortColIdx,
 						  ancestors, es);
+	if (sortstate->incremental)
+		show_sort_keys_common((PlanState *) sortstate, "Presorted Key",
+							  plan->numPresorted, plan->sortColIdx,
+							  ancestors, es);
 }
 
 /*
@@ -1396,13 +1415,14 @@ show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 {
 	MergeAppend *plan = (MergeAppend *) mstate->ps.plan;
 
-	show_sort_keys_common((PlanState *) mstate,
+	show_sort_keys_common((PlanState *) mstate, "Sort Key",
 						  plan->numCols, plan->sortColIdx,
 						  ancestors, es);
 }
 
 static void
-show_sort_keys_common(PlanState *planstate, int nkeys, AttrNumber *keycols,
+show_sort_keys_common(PlanState *planstate, const char *qlabel,
+					  int nkeys, AttrNumber *keycols,
 					  List *ancestors, ExplainState *es)
 {
 	Plan	   *plan = planstate->plan;
@@ -1436,7 +1456,7 @@ show_sort_keys_common(PlanState *planstate, int nkeys, AttrNumber *keycols,
 		result = lappend(result, exprstr);
 	}
 
-	ExplainPropertyList("Sort Key", result, es);
+	ExplainPropertyList(qlabel, result, es);
 }
 
 /*
@@ -1446,7 +1466,28 @@ static void
 show_sort_info(SortState *sortstate, ExplainState *es)
 {
 	Assert(IsA(sortstate, SortState));
-	if (es->analyze && sortstate->sort_Done &&
+	if (es->analyze && sortstate->incremental &&
+		sortstate->groupSortMethod != NULL)
+	{
+		/* a group-at-a-time sort shows the group that took most space */
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Sort Groups: %ld  Sort Method: %s  %s: %ldkB\n",
+							 sortstate->numGroups,
+							 sortstate->groupSortMethod,
+							 sortstate->groupSpaceType,
+							 sortstate->groupSpaceUsed);
+		}
+		else
+		{
+			ExplainPropertyLong("Sort Groups", sortstate->numGroups, es);
+			ExplainPropertyText("Sort Method", sortstate->groupSortMethod, es);
+			ExplainPropertyLong("Sort Space Used", sortstate->groupSpaceUsed, es);
+			ExplainPropertyText("Sort Space Type", sortstate->groupSpaceType, es);
+		}
+	}
+	else if (es->analyze && sortstate->sort_Done &&
 		sortstate->tuplesortstate != NULL)
 	{
 		Tuplesortstate *state = (Tuplesortstate *) sortstate->tuplesortstate;
@@ -1513,6 +1554,145 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * If it's EXPLAIN ANALYZE, show the spill stats of a hashed Agg node
+ */
+static void
+show_agg_info(AggState *aggstate, ExplainState *es)
+{
+	long		peakKb = (long) ((aggstate->instr_peak_mem + 1023) / 1024);
+	long		readKb = (long) ((aggstate->instr_temp_read + 1023) / 1024);
+	long		writtenKb = (long) ((aggstate->instr_temp_written + 1023) / 1024);
+
+	Assert(IsA(aggstate, AggState));
+
+	if (!es->analyze || aggstate->hash_spill == NULL)
+		return;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		if (aggstate->instr_spill_batches > 0)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Batches: %ld  Spill Depth: %d  Memory Usage: %ldkB\n",
+							 aggstate->instr_spill_batches,
+							 aggstate->instr_spill_depth,
+							 peakKb);
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Temp Read: %ldkB  Written: %ldkB\n",
+							 readKb, writtenKb);
+		}
+	}
+	else
+	{
+		ExplainPropertyLong("Spill Batches", aggstate->instr_spill_batches, es);
+		ExplainPropertyLong("Spill Depth", aggstate->instr_spill_depth, es);
+		ExplainPropertyLong("Peak Memory Usage", peakKb, es);
+		ExplainPropertyLong("Temp Read", readKb, es);
+		ExplainPropertyLong("Temp Written", writtenKb, es);
+	}
+}
+
+/*
+ * Show the run condition of a WindowAgg node, and if it's EXPLAIN ANALYZE,
+ * its partition, recompute and temp file stats
+ */
+static void
+show_windowagg_info(WindowAggState *winstate, ExplainState *es)
+{
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	int64		recomputed = winstate->instr_rows_recomputed;
+	long		readKb = (long) ((winstate->instr_temp_read + 1023) / 1024);
+	long		writtenKb = (long) ((winstate->instr_temp_written + 1023) / 1024);
+	int			i;
+
+	Assert(IsA(winstate, WindowAggState));
+
+	if (OidIsValid(node->runFnOid))
+	{
+		StringInfoData runcond;
+
+		initStringInfo(&runcond);
+		appendStringInfo(&runcond, "%s() <= %d",
+						 get_func_name(node->runFnOid), node->runLimit);
+		ExplainPropertyText("Run Condition", runcond.data, es);
+		pfree(runcond.data);
+	}
+
+	if (!es->analyze)
+		return;
+
+	/* the further frames count their own recomputation */
+	for (i = 0; i < winstate->numframes; i++)
+		recomputed += winstate->frames[i]->instr_rows_recomputed;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "Partitions: %ld  Spilled: %ld  Rows Recomputed: " INT64_FORMAT "\n",
+						 winstate->instr_partitions,
+						 winstate->instr_spilled_partitions,
+						 recomputed);
+		if (OidIsValid(node->runFnOid))
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Rows Skipped: " INT64_FORMAT "\n",
+							 winstate->instr_rows_skipped);
+		}
+		if (winstate->instr_spilled_partitions > 0)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Temp Read: %ldkB  Written: %ldkB\n",
+							 readKb, writtenKb);
+		}
+		if (winstate->instr_locateheadpos_part != NULL)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Frame Head Time: %.3f ms  Recompute Time: %.3f ms\n",
+							 INSTR_TIME_GET_MILLISEC(winstate->instr_locateheadpos_part->counter),
+							 INSTR_TIME_GET_MILLISEC(winstate->instr_recompute_part->counter));
+			if (winstate->instr_spilled_partitions > 0)
+			{
+				appendStringInfoSpaces(es->str, es->indent * 2);
+				appendStringInfo(es->str, "Temp I/O Time: read=%.3f write=%.3f head=%.3f ms\n",
+								 INSTR_TIME_GET_MILLISEC(winstate->instr_disk_read->counter),
+								 INSTR_TIME_GET_MILLISEC(winstate->instr_disk_write->counter),
+								 INSTR_TIME_GET_MILLISEC(winstate->instr_locateheadpos_io->counter));
+			}
+		}
+	}
+	else
+	{
+		ExplainPropertyLong("Partitions", winstate->instr_partitions, es);
+		ExplainPropertyLong("Spilled Partitions",
+							winstate->instr_spilled_partitions, es);
+		ExplainPropertyLong("Rows Recomputed", (long) recomputed, es);
+		if (OidIsValid(node->runFnOid))
+			ExplainPropertyLong("Rows Skipped",
+								(long) winstate->instr_rows_skipped, es);
+		ExplainPropertyLong("Temp Read", readKb, es);
+		ExplainPropertyLong("Temp Written", writtenKb, es);
+		if (winstate->instr_locateheadpos_part != NULL)
+		{
+			ExplainPropertyFloat("Frame Head Time",
+				INSTR_TIME_GET_MILLISEC(winstate->instr_locateheadpos_part->counter),
+								 3, es);
+			ExplainPropertyFloat("Recompute Time",
+				INSTR_TIME_GET_MILLISEC(winstate->instr_recompute_part->counter),
+								 3, es);
+			ExplainPropertyFloat("Temp Read Time",
+				INSTR_TIME_GET_MILLISEC(winstate->instr_disk_read->counter),
+								 3, es);
+			ExplainPropertyFloat("Temp Write Time",
+				INSTR_TIME_GET_MILLISEC(winstate->instr_disk_write->counter),
+								 3, es);
+			ExplainPropertyFloat("Frame Head Read Time",
+				INSTR_TIME_GET_MILLISEC(winstate->instr_locateheadpos_io->counter),
+								 3, es);
+		}
+	}
+}
+
 /*
  * Show extra information for a ForeignScan node.
  */
@@ -66,6 +66,12 @@
  *	  AggState is available as context in earlier releases (back to 8.1),
  *	  but direct examination of the node is needed to use it before 9.0.
  *
+ *	  In AGG_HASHED mode with enable_hashaggspill, the hash table
+ *	  is kept within work_mem by writing the input tuples of the groups it
+ *	  has no room for to temp files, partitioned by hash value, and
+ *	  aggregating each partition after the table has been returned; see
+ *	  agg_fill_hash_table.
+ *
  *
  * Portions Copyright (c) 1996-2011, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -86,9 +92,11 @@
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
+#include "optimizer/cost.h"
 #include "optimizer/tlist.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "storage/buffile.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -251,6 +259,51 @@ typedef struct AggHashEntryData
 	AggStatePerGroupData pergroup[1];	/* VARIABLE LENGTH ARRAY */
 }	AggHashEntryData;	/* VARIABLE LENGTH STRUCT */
 
+/*
+ * State for spilling a hashed aggregation to disk.
+ *
+ * Once the memory of the hash table exceeds work_mem, the table is marked
+ * full: input tuples of the groups already in it are still aggregated, but
+ * those of any other group are written, with their hash value, to one of
+ * HASHAGG_SPILL_BATCHES batch files chosen by the next HASHAGG_SPILL_BITS
+ * bits of the hash value (from the top down, since the hash table itself
+ * uses the low bits).  After the table has been returned, each batch is
+ * aggregated in turn as if it were the input, and split again by the next
+ * bits if it overflows too.  A batch whose hash bits are used up is
+ * aggregated in memory regardless of work_mem, as its groups can't be told
+ * apart any further.
+ *
+ * Measuring the memory walks the contexts under aggcontext, which may be one
+ * per group, so it is done only once the number of groups has grown by
+ * 1/HASHAGG_CHECK_FRACTION since the last check: the table may overshoot
+ * work_mem by that much, and the checks cost linear time in all.
+ */
+#define HASHAGG_CHECK_FRACTION	8
+
+typedef struct AggSpillBatch
+{
+	BufFile    *file;			/* spilled input tuples, with hash values */
+	int			depth;			/* number of times they have been spilled */
+} AggSpillBatch;
+
+typedef struct AggSpillStateData
+{
+	Size		memLimit;		/* work_mem, in bytes */
+	bool		tableFull;		/* true if new groups must be spilled */
+	long		numGroups;		/* groups in the hash table */
+	long		nextCheck;		/* numGroups at which to check the memory */
+	bool		spilled;		/* has this scan spilled anything? */
+	int			depth;			/* spill depth of the current input */
+	BufFile    *input;			/* batch being aggregated, or NULL if the
+								 * outer plan is */
+	BufFile   **files;			/* batches of the current pass, or NULL */
+	List	   *pending;		/* AggSpillBatch's still to be aggregated */
+	TupleTableSlot *slot;		/* holds the tuples read from a batch */
+	List	   *needed;			/* input columns that are worth writing */
+	Datum	   *values;			/* workspace for forming spilled tuples */
+	bool	   *isnull;
+}	AggSpillStateData;
+
 
 static void initialize_aggregates(AggState *aggstate,
 					  AggStatePerAgg peragg,
@@ -272,12 +325,22 @@ static void finalize_aggregate(AggState *aggstate,
 				   Datum *resultVal, bool *resultIsNull);
 static Bitmapset *find_unaggregated_cols(AggState *aggstate);
 static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
+static List *find_spill_columns(AggState *aggstate);
+static bool find_spill_columns_walker(Node *node, Bitmapset **colnos);
 static void build_hash_table(AggState *aggstate);
 static AggHashEntry lookup_hash_entry(AggState *aggstate,
 				  TupleTableSlot *inputslot);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
+static void agg_check_hash_memory(AggState *aggstate);
+static uint32 agg_hash_tuple(AggState *aggstate, TupleTableSlot *slot);
+static void agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot,
+				uint32 hashvalue);
+static TupleTableSlot *agg_read_spilled_tuple(AggState *aggstate,
+					   uint32 *hashvalue);
+static bool agg_next_spilled_batch(AggState *aggstate);
+static void agg_spill_cleanup(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 
 
@@ -818,6 +881,56 @@ find_unaggregated_cols_walker(Node *node, Bitmapset **colnos)
 								  (void *) colnos);
 }
 
+/*
+ * Create a list of the input columns a spilled tuple must keep:
+ * those of find_unaggregated_cols, the grouping columns and the columns
+ * used to compute the aggregate functions.  As for the hashtable entries,
+ * the others are set to NULL in the tuples written to the batch files,
+ * which saves writing the junk columns of a physical-tlist scan.
+ */
+static List *
+find_spill_columns(AggState *aggstate)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	Bitmapset  *colnos;
+	List	   *collist;
+	int			i;
+
+	colnos = NULL;
+	(void) find_spill_columns_walker((Node *) node->plan.targetlist,
+									 &colnos);
+	(void) find_spill_columns_walker((Node *) node->plan.qual,
+									 &colnos);
+	for (i = 0; i < node->numCols; i++)
+		colnos = bms_add_member(colnos, node->grpColIdx[i]);
+	collist = NIL;
+	while ((i = bms_first_member(colnos)) >= 0)
+		collist = lappend_int(collist, i);
+	bms_free(colnos);
+
+	return collist;
+}
+
+static bool
+find_spill_columns_walker(Node *node, Bitmapset **colnos)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		/* setrefs.c should have set the varno to OUTER */
+		Assert(var->varno == OUTER);
+		Assert(var->varlevelsup == 0);
+		*colnos = bms_add_member(*colnos, var->varattno);
+		return false;
+	}
+	/* unlike find_unaggregated_cols_walker, descend into aggregate exprs */
+	return expression_tree_walker(node, find_spill_columns_walker,
+								  (void *) colnos);
+}
+
 /*
  * Initialize the hash table to empty.
  *
@@ -829,6 +942,7 @@ build_hash_table(AggState *aggstate)
 	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
 	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
 	Size		entrysize;
+	long		nbuckets;
 
 	Assert(node->aggstrategy == AGG_HASHED);
 	Assert(node->numGroups > 0);
@@ -836,14 +950,31 @@ build_hash_table(AggState *aggstate)
 	entrysize = sizeof(AggHashEntryData) +
 		(aggstate->numaggs - 1) * sizeof(AggStatePerGroupData);
 
+	/*
+	 * If the table may spill, don't let its initial buckets take
+	 * up a good part of work_mem (or all of it, for a table that's expected
+	 * not to fit); the table grows as groups are added.
+	 */
+	nbuckets = node->numGroups;
+	if (aggstate->hash_spill != NULL)
+		nbuckets = Min(nbuckets,
+					   Max(aggstate->hash_spill->memLimit /
+						   (16 * sizeof(void *)), 1));
+
 	aggstate->hashtable = BuildTupleHashTable(node->numCols,
 											  node->grpColIdx,
 											  aggstate->eqfunctions,
 											  aggstate->hashfunctions,
-											  node->numGroups,
+											  nbuckets,
 											  entrysize,
 											  aggstate->aggcontext,
 											  tmpmem);
+
+	if (aggstate->hash_spill != NULL)
+	{
+		aggstate->hash_spill->numGroups = 0;
+		aggstate->hash_spill->nextCheck = 1;
+	}
 }
 
 /*
@@ -917,6 +1048,9 @@ hash_agg_entry_size(int numAggs)
  * Find or create a hashtable entry for the tuple group containing the
  * given tuple.
  *
+ * If the hash table is full (see AggSpillStateData), no entry is
+ * created, and NULL is returned if the group isn't in the table already.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static AggHashEntry
@@ -945,6 +1079,12 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 		hashslot->tts_isnull[varNumber] = inputslot->tts_isnull[varNumber];
 	}
 
+	/* only look for the group if the table is full */
+	if (aggstate->hash_spill != NULL && aggstate->hash_spill->tableFull)
+		return (AggHashEntry) LookupTupleHashEntry(aggstate->hashtable,
+												   hashslot,
+												   NULL);
+
 	/* find or create the hashtable entry using the filtered tuple */
 	entry = (AggHashEntry) LookupTupleHashEntry(aggstate->hashtable,
 												hashslot,
@@ -954,6 +1094,12 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 	{
 		/* initialize aggregates for new tuple group */
 		initialize_aggregates(aggstate, aggstate->peragg, entry->pergroup);
+
+		/* the table grows mostly by new groups; check it here */
+		if (aggstate->hash_spill != NULL &&
+			++aggstate->hash_spill->numGroups >=
+			aggstate->hash_spill->nextCheck)
+			agg_check_hash_memory(aggstate);
 	}
 
 	return entry;
@@ -1220,6 +1366,9 @@ agg_fill_hash_table(AggState *aggstate)
 	ExprContext *tmpcontext;
 	AggHashEntry entry;
 	TupleTableSlot *outerslot;
+	AggSpillState spill;
+	bool		fromBatch;
+	uint32		hashvalue = 0;
 
 	/*
 	 * get state info from node
@@ -1227,6 +1376,9 @@ agg_fill_hash_table(AggState *aggstate)
 	outerPlan = outerPlanState(aggstate);
 	/* tmpcontext is the per-input-tuple expression context */
 	tmpcontext = aggstate->tmpcontext;
+	spill = aggstate->hash_spill;
+	/* after a spill the input is one of the batches */
+	fromBatch = (spill != NULL && spill->input != NULL);
 
 	/*
 	 * Process each outer-plan tuple, and then fetch the next one, until we
@@ -1234,7 +1386,10 @@ agg_fill_hash_table(AggState *aggstate)
 	 */
 	for (;;)
 	{
-		outerslot = ExecProcNode(outerPlan);
+		if (fromBatch)
+			outerslot = agg_read_spilled_tuple(aggstate, &hashvalue);
+		else
+			outerslot = ExecProcNode(outerPlan);
 		if (TupIsNull(outerslot))
 			break;
 		/* set up for advance_aggregates call */
@@ -1243,13 +1398,27 @@ agg_fill_hash_table(AggState *aggstate)
 		/* Find or build hashtable entry for this tuple's group */
 		entry = lookup_hash_entry(aggstate, outerslot);
 
-		/* Advance the aggregates */
-		advance_aggregates(aggstate, entry->pergroup);
+		if (entry != NULL)
+		{
+			/* Advance the aggregates */
+			advance_aggregates(aggstate, entry->pergroup);
+		}
+		else
+		{
+			/* no room for the group; save the tuple for later */
+			if (!fromBatch)
+				hashvalue = agg_hash_tuple(aggstate, outerslot);
+			agg_spill_tuple(aggstate, outerslot, hashvalue);
+		}
 
 		/* Reset per-input-tuple context after each tuple */
 		ResetExprContext(tmpcontext);
 	}
 
+	/* the table is at its largest now; note its memory once more */
+	if (spill != NULL)
+		agg_check_hash_memory(aggstate);
+
 	aggstate->table_filled = true;
 	/* Initialize to walk the hash table */
 	ResetTupleHashIterator(aggstate->hashtable, &aggstate->hashiter);
@@ -1292,6 +1461,14 @@ agg_retrieve_hash_table(AggState *aggstate)
 		entry = (AggHashEntry) ScanTupleHashTable(&aggstate->hashiter);
 		if (entry == NULL)
 		{
+			/* go on with the next spilled batch, if any */
+			if (aggstate->hash_spill != NULL &&
+				agg_next_spilled_batch(aggstate))
+			{
+				agg_fill_hash_table(aggstate);
+				continue;
+			}
+
 			/* No more entries in hashtable, so done */
 			aggstate->agg_done = TRUE;
 			return NULL;
@@ -1360,6 +1537,276 @@ agg_retrieve_hash_table(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * Note the memory of the hash table, and mark the table full if
+ * it has outgrown work_mem, unless the current input can't be split any
+ * further.  All of the aggcontext is counted, including the contexts that
+ * some transition functions create under it for their state.
+ */
+static void
+agg_check_hash_memory(AggState *aggstate)
+{
+	AggSpillState spill = aggstate->hash_spill;
+	Size		used;
+
+	used = MemoryContextMemAllocated(aggstate->aggcontext, true);
+	if (used > aggstate->instr_peak_mem)
+		aggstate->instr_peak_mem = used;
+
+	if (used > spill->memLimit &&
+		(spill->depth + 1) * HASHAGG_SPILL_BITS <= 32)
+		spill->tableFull = true;
+
+	spill->nextCheck = spill->numGroups +
+		Max(spill->numGroups / HASHAGG_CHECK_FRACTION, 1);
+}
+
+/*
+ * Compute the hash value of the grouping columns of an input
+ * tuple, the same way the TupleHashTable does.
+ */
+static uint32
+agg_hash_tuple(AggState *aggstate, TupleTableSlot *slot)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	MemoryContext oldcontext;
+	uint32		hashkey = 0;
+	int			i;
+
+	/* the hash functions run in the per-input-tuple context */
+	oldcontext =
+		MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < node->numCols; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, node->grpColIdx[i], &isNull);
+
+		if (!isNull)			/* treat nulls as having hash key 0 */
+			hashkey ^= DatumGetUInt32(FunctionCall1(&aggstate->hashfunctions[i],
+													attr));
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return hashkey;
+}
+
+/*
+ * Write an input tuple whose group has no room in the hash table
+ * to the batch file its hash value selects at the current depth.  The file
+ * format is that of hash join batches: the hash value, then the tuple.
+ */
+static void
+agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot, uint32 hashvalue)
+{
+	AggSpillState spill = aggstate->hash_spill;
+	TupleDesc	tupdesc = slot->tts_tupleDescriptor;
+	int			batchno;
+	BufFile    *file;
+	MinimalTuple tuple;
+	MemoryContext oldcontext;
+	ListCell   *l;
+	size_t		written;
+
+	/* the batches are read back through a slot like the input's */
+	if (spill->slot->tts_tupleDescriptor == NULL)
+	{
+		ExecSetSlotDescriptor(spill->slot, tupdesc);
+		spill->values = (Datum *) palloc(tupdesc->natts * sizeof(Datum));
+		spill->isnull = (bool *) palloc(tupdesc->natts * sizeof(bool));
+	}
+
+	if (spill->files == NULL)
+		spill->files = (BufFile **)
+			palloc0(HASHAGG_SPILL_BATCHES * sizeof(BufFile *));
+
+	batchno = (hashvalue >> (32 - (spill->depth + 1) * HASHAGG_SPILL_BITS)) &
+		(HASHAGG_SPILL_BATCHES - 1);
+	file = spill->files[batchno];
+	if (file == NULL)
+	{
+		/* First write to this batch file, so open it. */
+		file = BufFileCreateTemp(false);
+		if (enable_tempcompress)
+			opt_BufFileCompress(file);
+		spill->files[batchno] = file;
+		spill->spilled = true;
+		aggstate->instr_spill_batches++;
+	}
+
+	/* form the tuple to write with just the needed columns */
+	slot_getallattrs(slot);
+	memset(spill->isnull, true, tupdesc->natts * sizeof(bool));
+	foreach(l, spill->needed)
+	{
+		int			varNumber = lfirst_int(l) - 1;
+
+		spill->values[varNumber] = slot->tts_values[varNumber];
+		spill->isnull[varNumber] = slot->tts_isnull[varNumber];
+	}
+	oldcontext =
+		MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+	tuple = heap_form_minimal_tuple(tupdesc, spill->values, spill->isnull);
+	MemoryContextSwitchTo(oldcontext);
+
+	written = BufFileWrite(file, (void *) &hashvalue, sizeof(uint32));
+	if (written != sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	written = BufFileWrite(file, (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+}
+
+/*
+ * Read the next tuple of the batch being aggregated, or return
+ * NULL at its end.  *hashvalue is set to the tuple's hash value.
+ */
+static TupleTableSlot *
+agg_read_spilled_tuple(AggState *aggstate, uint32 *hashvalue)
+{
+	AggSpillState spill = aggstate->hash_spill;
+	uint32		header[2];
+	size_t		nread;
+	MinimalTuple tuple;
+
+	/* the hash value and the tuple's length word are read together */
+	nread = BufFileRead(spill->input, (void *) header, sizeof(header));
+	if (nread == 0)				/* end of file */
+	{
+		ExecClearTuple(spill->slot);
+		return NULL;
+	}
+	if (nread != sizeof(header))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	*hashvalue = header[0];
+	tuple = (MinimalTuple) palloc(header[1]);
+	tuple->t_len = header[1];
+	nread = BufFileRead(spill->input,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						header[1] - sizeof(uint32));
+	if (nread != header[1] - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	return ExecStoreMinimalTuple(tuple, spill->slot, true);
+}
+
+/*
+ * Called when the hash table has been returned: queue the
+ * batches spilled while filling it, release the batch it was filled from,
+ * and set up an empty table to aggregate the next pending batch.  Returns
+ * false if there is none.
+ *
+ * The new batches go to the front of the queue, so that a batch is split
+ * all the way down before its siblings are read; that bounds the number of
+ * open batch files by the depth times HASHAGG_SPILL_BATCHES.
+ */
+static bool
+agg_next_spilled_batch(AggState *aggstate)
+{
+	AggSpillState spill = aggstate->hash_spill;
+	AggSpillBatch *batch;
+	int			i;
+
+	if (spill->files != NULL)
+	{
+		for (i = HASHAGG_SPILL_BATCHES - 1; i >= 0; i--)
+		{
+			if (spill->files[i] == NULL)
+				continue;
+			if (BufFileSeek(spill->files[i], 0, 0L, SEEK_SET) != 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not rewind hash-aggregate temporary file: %m")));
+			batch = (AggSpillBatch *) palloc(sizeof(AggSpillBatch));
+			batch->file = spill->files[i];
+			batch->depth = spill->depth + 1;
+			spill->pending = lcons(batch, spill->pending);
+		}
+		pfree(spill->files);
+		spill->files = NULL;
+		aggstate->instr_spill_depth = Max(aggstate->instr_spill_depth,
+										  spill->depth + 1);
+	}
+
+	if (spill->input != NULL)
+	{
+		opt_BufFileGetStats(spill->input, &aggstate->instr_temp_read,
+							&aggstate->instr_temp_written);
+		BufFileClose(spill->input);
+		spill->input = NULL;
+	}
+	spill->tableFull = false;
+
+	if (spill->pending == NIL)
+		return false;
+
+	batch = (AggSpillBatch *) linitial(spill->pending);
+	spill->pending = list_delete_first(spill->pending);
+	spill->input = batch->file;
+	spill->depth = batch->depth;
+	pfree(batch);
+
+	/* the last group returned points into the old table; forget it */
+	ExecClearTuple(aggstate->ss.ss_ScanTupleSlot);
+	MemoryContextResetAndDeleteChildren(aggstate->aggcontext);
+	build_hash_table(aggstate);
+
+	return true;
+}
+
+/*
+ * Close all the batch files of a hashed aggregation, at the end
+ * of the node or of a scan.
+ */
+static void
+agg_spill_cleanup(AggState *aggstate)
+{
+	AggSpillState spill = aggstate->hash_spill;
+	ListCell   *l;
+	int			i;
+
+	if (spill->files != NULL)
+	{
+		for (i = 0; i < HASHAGG_SPILL_BATCHES; i++)
+		{
+			if (spill->files[i] != NULL)
+				BufFileClose(spill->files[i]);
+		}
+		pfree(spill->files);
+		spill->files = NULL;
+	}
+	foreach(l, spill->pending)
+	{
+		AggSpillBatch *batch = (AggSpillBatch *) lfirst(l);
+
+		BufFileClose(batch->file);
+	}
+	list_free_deep(spill->pending);
+	spill->pending = NIL;
+	if (spill->input != NULL)
+	{
+		BufFileClose(spill->input);
+		spill->input = NULL;
+	}
+	spill->tableFull = false;
+	spill->spilled = false;
+	spill->depth = 0;
+}
+
 /* -----------------
  * ExecInitAgg
  *
@@ -1397,6 +1844,7 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	aggstate->pergroup = NULL;
 	aggstate->grp_firstTuple = NULL;
 	aggstate->hashtable = NULL;
+	aggstate->hash_spill = NULL;
 
 	/*
 	 * Create expression contexts.	We need two, one for per-input-tuple
@@ -1517,6 +1965,16 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 
 	if (node->aggstrategy == AGG_HASHED)
 	{
+		/* set up to spill the table if it outgrows work_mem */
+		if (enable_hashaggspill)
+		{
+			aggstate->hash_spill = (AggSpillState)
+				palloc0(sizeof(AggSpillStateData));
+			aggstate->hash_spill->memLimit = work_mem * 1024L;
+			aggstate->hash_spill->slot = ExecInitExtraTupleSlot(estate);
+			aggstate->hash_spill->needed = find_spill_columns(aggstate);
+		}
+
 		build_hash_table(aggstate);
 		aggstate->table_filled = false;
 		/* Compute the columns we actually need to hash on */
@@ -1885,6 +2343,10 @@ ExecEndAgg(AggState *node)
 			tuplesort_end(peraggstate->sortstate);
 	}
 
+	/* and any spilled batches */
+	if (node->hash_spill != NULL)
+		agg_spill_cleanup(node);
+
 	/*
 	 * Free both the expr contexts.
 	 */
@@ -1925,13 +2387,19 @@ ExecReScanAgg(AggState *node)
 		/*
 		 * If we do have the hash table and the subplan does not have any
 		 * parameter changes, then we can just rescan the existing hash table;
-		 * no need to build it again.
+		 * no need to build it again.  (Unless the table spilled:
+		 * it then holds just the groups of the last batch.)
 		 */
-		if (node->ss.ps.lefttree->chgParam == NULL)
+		if (node->ss.ps.lefttree->chgParam == NULL &&
+			(node->hash_spill == NULL || !node->hash_spill->spilled))
 		{
 			ResetTupleHashIterator(node->hashtable, &node->hashiter);
 			return;
 		}
+
+		/* drop what's left of the spilled batches */
+		if (node->hash_spill != NULL)
+			agg_spill_cleanup(node);
 	}
 
 	/* Make sure we have closed any open tuplesorts */
@@ -18,9 +18,24 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/tuplesort.h"
 
 
+/*
+ * A group-at-a-time sort sorts groups smaller than this together, so that
+ * it doesn't set up a tuplesort for every few tuples of the input.
+ */
+#define INCREMENTAL_MIN_GROUP_SIZE	32
+
+static TupleTableSlot *ExecSortIncremental(SortState *node);
+static Tuplesortstate *begin_group_sort(SortState *node, bool allKeys);
+static void sort_large_group(SortState *node, TupleTableSlot *slot);
+static void read_group(SortState *node, Tuplesortstate *tuplesortstate);
+static void end_group_sort(SortState *node);
+
+
 /* ----------------------------------------------------------------
  *		ExecSort
  *
@@ -49,6 +64,9 @@ ExecSort(SortState *node)
 	SO1_printf("ExecSort: %s\n",
 			   "entering routine");
 
+	if (node->incremental)
+		return ExecSortIncremental(node);
+
 	estate = node->ss.ps.state;
 	dir = estate->es_direction;
 	tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
@@ -141,6 +159,233 @@ ExecSort(SortState *node)
 	return slot;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSortIncremental
+ *
+ *		Sorts an input that is already sorted by the leading
+ *		numPresorted sort keys.  The groups of input tuples that are
+ *		equal in those keys are sorted together by all the keys until
+ *		there are INCREMENTAL_MIN_GROUP_SIZE tuples, and returned before
+ *		the next groups are read.  A group that has that many tuples by
+ *		itself is sorted alone, by the remaining keys.  So the sort needs
+ *		only as much memory as the largest group and starts returning
+ *		tuples as soon as the first groups are complete.
+ *
+ *		Only forward scans are supported; ExecInitSort does a full sort
+ *		when random access is needed.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecSortIncremental(SortState *node)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+	TupleTableSlot *pivot = node->group_pivot;
+	int			presorted = plannode->numPresorted;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *outerslot;
+	long		ntuples;
+	long		ngrouptuples;
+
+	node->sort_Done = true;
+
+	for (;;)
+	{
+		/* Return the next tuple of the current sort, if any */
+		tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+		if (tuplesortstate != NULL)
+		{
+			if (tuplesort_gettupleslot(tuplesortstate, true, slot))
+			{
+				/*
+				 * A sort that stopped in a large group ends with the tuples
+				 * of that group read so far; sort them with the rest of it.
+				 */
+				if (!node->group_Split ||
+					!execTuplesMatch(slot, pivot,
+									 presorted,
+									 plannode->sortColIdx,
+									 node->presortedEqfunctions,
+									 node->tempContext))
+					return slot;
+				sort_large_group(node, slot);
+				continue;
+			}
+			end_group_sort(node);
+		}
+
+		if (node->outer_Done)
+			return ExecClearTuple(slot);
+
+		/* The first time through, there's no pivot tuple yet */
+		if (TupIsNull(pivot))
+		{
+			outerslot = ExecProcNode(outerNode);
+			if (TupIsNull(outerslot))
+			{
+				node->outer_Done = true;
+				return ExecClearTuple(slot);
+			}
+			ExecCopySlot(pivot, outerslot);
+		}
+
+		/*
+		 * Collect the groups from the one that starts with the pivot tuple
+		 * on, until there are enough tuples, and sort them by all the keys.
+		 * The first tuple of the next group becomes the new pivot.  If a
+		 * group reaches that size by itself, stop in it, keeping its first
+		 * tuple as the pivot; it's probably large, and sort_large_group
+		 * will sort it by the keys that aren't presorted.
+		 */
+		tuplesortstate = begin_group_sort(node, true);
+		node->tuplesortstate = (void *) tuplesortstate;
+		tuplesort_puttupleslot(tuplesortstate, pivot);
+		ntuples = 1;
+		ngrouptuples = 1;
+
+		for (;;)
+		{
+			outerslot = ExecProcNode(outerNode);
+			if (TupIsNull(outerslot))
+			{
+				node->outer_Done = true;
+				ExecClearTuple(pivot);
+				break;
+			}
+			if (!execTuplesMatch(outerslot, pivot,
+								 presorted,
+								 plannode->sortColIdx,
+								 node->presortedEqfunctions,
+								 node->tempContext))
+			{
+				ExecCopySlot(pivot, outerslot);
+				if (ntuples >= INCREMENTAL_MIN_GROUP_SIZE)
+					break;
+				ngrouptuples = 0;
+			}
+			tuplesort_puttupleslot(tuplesortstate, outerslot);
+			ntuples++;
+			if (++ngrouptuples >= INCREMENTAL_MIN_GROUP_SIZE)
+			{
+				node->group_Split = true;
+				break;
+			}
+		}
+
+		tuplesort_performsort(tuplesortstate);
+		node->numGroups++;
+	}
+}
+
+/*
+ * begin_group_sort
+ *		Start a sort of some groups of the input, by all the sort keys,
+ *		or of a single group, by the keys that aren't presorted.
+ */
+static Tuplesortstate *
+begin_group_sort(SortState *node, bool allKeys)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	int			skip = allKeys ? 0 : plannode->numPresorted;
+
+	return tuplesort_begin_heap(ExecGetResultType(outerPlanState(node)),
+								plannode->numCols - skip,
+								plannode->sortColIdx + skip,
+								plannode->sortOperators + skip,
+								plannode->collations + skip,
+								plannode->nullsFirst + skip,
+								work_mem,
+								false);
+}
+
+/*
+ * sort_large_group
+ *		Move slot, the first tuple of the large group the current sort
+ *		stopped in, and the tuples after it, which are the rest of the
+ *		group read so far, to a sort of their own; then read the rest
+ *		of the group into it.
+ */
+static void
+sort_large_group(SortState *node, TupleTableSlot *slot)
+{
+	Tuplesortstate *tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+	Tuplesortstate *groupsort = begin_group_sort(node, false);
+
+	do
+	{
+		tuplesort_puttupleslot(groupsort, slot);
+	} while (tuplesort_gettupleslot(tuplesortstate, true, slot));
+	ExecClearTuple(slot);
+	end_group_sort(node);
+
+	node->tuplesortstate = (void *) groupsort;
+	node->group_Split = false;
+	read_group(node, groupsort);
+	tuplesort_performsort(groupsort);
+	node->numGroups++;
+}
+
+/*
+ * read_group
+ *		Read the tuples of the group of the pivot tuple from the outer plan
+ *		into tuplesortstate, up to the first tuple of the next group, which
+ *		becomes the pivot.
+ */
+static void
+read_group(SortState *node, Tuplesortstate *tuplesortstate)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	TupleTableSlot *pivot = node->group_pivot;
+	TupleTableSlot *outerslot;
+
+	for (;;)
+	{
+		outerslot = ExecProcNode(outerPlanState(node));
+		if (TupIsNull(outerslot))
+		{
+			node->outer_Done = true;
+			ExecClearTuple(pivot);
+			break;
+		}
+		if (!execTuplesMatch(outerslot, pivot,
+							 plannode->numPresorted,
+							 plannode->sortColIdx,
+							 node->presortedEqfunctions,
+							 node->tempContext))
+		{
+			ExecCopySlot(pivot, outerslot);
+			break;
+		}
+		tuplesort_puttupleslot(tuplesortstate, outerslot);
+	}
+}
+
+/*
+ * end_group_sort
+ *		Release the current sort of groups, keeping its stats for EXPLAIN
+ *		ANALYZE if it took the most space so far.
+ */
+static void
+end_group_sort(SortState *node)
+{
+	Tuplesortstate *tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+	const char *sortMethod;
+	const char *spaceType;
+	long		spaceUsed;
+
+	tuplesort_get_stats(tuplesortstate, &sortMethod, &spaceType, &spaceUsed);
+	if (node->groupSortMethod == NULL || spaceUsed > node->groupSpaceUsed)
+	{
+		node->groupSortMethod = sortMethod;
+		node->groupSpaceType = spaceType;
+		node->groupSpaceUsed = spaceUsed;
+	}
+
+	tuplesort_end(tuplesortstate);
+	node->tuplesortstate = NULL;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitSort
  *
@@ -176,6 +421,19 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
 
+	/*
+	 * If the input is already sorted by some leading keys, we can sort one
+	 * group of it at a time, unless the output has to be read more than once.
+	 */
+	sortstate->incremental = (node->numPresorted > 0 &&
+							  !sortstate->randomAccess);
+	sortstate->outer_Done = false;
+	sortstate->group_Split = false;
+	sortstate->numGroups = 0;
+	sortstate->groupSortMethod = NULL;
+	sortstate->groupSpaceType = NULL;
+	sortstate->groupSpaceUsed = 0;
+
 	/*
 	 * Miscellaneous initialization
 	 *
@@ -209,6 +467,38 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	ExecAssignScanTypeFromOuterPlan(&sortstate->ss);
 	sortstate->ss.ps.ps_ProjInfo = NULL;
 
+	if (sortstate->incremental)
+	{
+		Oid		   *eqOperators;
+		int			i;
+
+		/* a short-term memory context for execTuplesMatch */
+		sortstate->tempContext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "Sort",
+								  ALLOCSET_DEFAULT_MINSIZE,
+								  ALLOCSET_DEFAULT_INITSIZE,
+								  ALLOCSET_DEFAULT_MAXSIZE);
+
+		sortstate->group_pivot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(sortstate->group_pivot,
+							  ExecGetResultType(outerPlanState(sortstate)));
+
+		/* Group boundaries are found with the sort operators' equalities */
+		eqOperators = (Oid *) palloc(node->numPresorted * sizeof(Oid));
+		for (i = 0; i < node->numPresorted; i++)
+		{
+			eqOperators[i] = get_equality_op_for_ordering_op(node->sortOperators[i],
+															 NULL);
+			if (!OidIsValid(eqOperators[i]))
+				elog(ERROR, "could not find equality operator for ordering operator %u",
+					 node->sortOperators[i]);
+		}
+		sortstate->presortedEqfunctions =
+			execTuplesMatchPrepare(node->numPresorted, eqOperators);
+		pfree(eqOperators);
+	}
+
 	SO1_printf("ExecInitSort: %s\n",
 			   "sort node initialized");
 
@@ -239,6 +529,12 @@ ExecEndSort(SortState *node)
 		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
 	node->tuplesortstate = NULL;
 
+	if (node->incremental)
+	{
+		ExecClearTuple(node->group_pivot);
+		MemoryContextDelete(node->tempContext);
+	}
+
 	/*
 	 * shut down the subplan
 	 */
@@ -301,6 +597,21 @@ ExecReScanSort(SortState *node)
 	/* must drop pointer to sort result tuple */
 	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 
+	/* A group-at-a-time sort always has to start over */
+	if (node->incremental)
+	{
+		node->sort_Done = false;
+		if (node->tuplesortstate != NULL)
+			tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		node->tuplesortstate = NULL;
+		ExecClearTuple(node->group_pivot);
+		node->outer_Done = false;
+		node->group_Split = false;
+		if (node->ss.ps.lefttree->chgParam == NULL)
+			ExecReScan(node->ss.ps.lefttree);
+		return;
+	}
+
 	/*
 	 * If subnode is to be rescanned then we forget previous sort results; we
 	 * have to re-read the subplan and re-sort.  Also must re-sort if the
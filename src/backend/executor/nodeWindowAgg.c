@@ -33,21 +33,30 @@
  */
 #include "postgres.h"
 
+#include <limits.h>
+#include <math.h>
+
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "executor/executor.h"
 #include "executor/nodeWindowAgg.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
+#include "optimizer/cost.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
+#include "utils/date.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/numeric.h"
 #include "utils/syscache.h"
 #include "windowapi.h"
 
@@ -61,8 +70,31 @@ bool enable_winfunopt = false;
 bool enable_locate = true;
 bool enable_recompute = true;
 bool enable_reusebuffer = false;
-int recompute_k = 100;
-int recompute_num = 1;
+bool enable_inversetrans = true;
+bool enable_segtree = true;
+bool enable_columnbuffer = true;
+bool enable_batchadvance = true;
+bool enable_argring = true;
+bool enable_aggshare = true;
+
+/* rows an argument ring keeps beyond what the constant offsets call for */
+#define WINDOW_ARGRING_SLACK	64
+
+/* as SAMESIGN in int8.c, for the RANGE offset overflow checks */
+#define RANGE_SAMESIGN(a,b)	(((a) < 0) == ((b) < 0))
+
+/*
+ * A new row is in tmpcontext's outer tuple: arguments evaluated
+ * for the last one are no longer good
+ */
+#define WINAGG_SET_ARGPOS(winstate, pos) \
+	((winstate)->opt_argpos = (pos), (winstate)->opt_argepoch++)
+
+/* the instruments are only there under EXPLAIN ANALYZE */
+#define WINAGG_INSTR_START(instr) \
+	do { if ((instr) != NULL) InstrStartNode(instr); } while (0)
+#define WINAGG_INSTR_STOP(instr) \
+	do { if ((instr) != NULL) InstrStopNode((instr), 0); } while (0)
 
 /*
  * All the window function APIs are called with this object, which is passed
@@ -89,14 +121,38 @@ typedef struct WindowObjectData
 	int64		opt_frameheadpos;
 
 	/*
-	 * to locate the temporary transition value's end position efficiently,
-	 * only for window aggregation currently.
-	 * will never be active!
+	 * to locate the temporary transition values' end position efficiently,
+	 * only for window aggregation currently.  All the temporary transition
+	 * values that have started are advanced together, so they share one
+	 * end pointer; opt_tempTransEndPos[i] is -1 until value i has started.
+	 * The arrays have opt_tempTransValue_max entries.
+	 */
+	int			opt_tempTransEndPtr;
+	int64	   *opt_tempTransEndPos;
+
+	int64	   *opt_tempStartPos;	/* the start position of the temporary transition value, for checking where to jump */
+
+	/*
+	 * forward-only read pointer for the rows leaving the frame, when they
+	 * are removed by inverse transition functions.
 	 */
-	int			opt_tempTransEndPtr[16];
-	int64		opt_tempTransEndPos[16];
+	int			opt_invtransptr;
+	int64		opt_invtranspos;	/* row that opt_invtransptr is positioned on */
 
-	int64		opt_tempStartPos[16];	/* the start position of the temporary transition value, for checking where to jump */
+	/*
+	 * Ring of the first argument's values on recent rows, for
+	 * lead, lag and the frame value functions when that argument is a plain
+	 * column.  Row pos lives in slot pos % opt_ringsize, which remembers
+	 * the row it holds, -1 if none.  Rows are added as they are spooled, or
+	 * when they had to be fetched.  opt_ringsize is 0 if there is no ring.
+	 */
+	int64		opt_ringsize;
+	AttrNumber	opt_ringattno;	/* column of the outer tuple */
+	int16		opt_ringlen;
+	bool		opt_ringbyval;
+	int64	   *opt_ringpos;
+	Datum	   *opt_ringvalues;
+	bool	   *opt_ringnulls;
 
 	//bool		opt_needTempTransValue;
 	//bool		opt_frameheadeverchanged;
@@ -135,6 +191,36 @@ typedef struct WindowStatePerFuncData
 
 }	WindowStatePerFuncData;
 
+/*
+ * Built-in transition functions that advance_windowaggregate_batch
+ * runs over a run of rows of the column buffer without going through fmgr
+ */
+typedef enum WindowBatchKind
+{
+	WINBATCH_NONE,				/* must go through the transfn */
+	WINBATCH_COUNT_STAR,		/* int8inc */
+	WINBATCH_COUNT,				/* int8inc_any */
+	WINBATCH_SUM_INT,			/* int2_sum, int4_sum */
+	WINBATCH_SUM_FLOAT8,		/* float8pl */
+	WINBATCH_MAX_INT,			/* int2larger, int4larger, int8larger */
+	WINBATCH_MIN_INT,			/* int2smaller, int4smaller, int8smaller */
+	WINBATCH_MAX_FLOAT8,		/* float8larger */
+	WINBATCH_MIN_FLOAT8,		/* float8smaller */
+	WINBATCH_AVG_INT,			/* int2_avg_accum, int4_avg_accum */
+	WINBATCH_ACCUM_FLOAT8		/* float8_accum */
+} WindowBatchKind;
+
+/*
+ * How an aggregate keeping no transition value of its own gets
+ * its result from the one it shares
+ */
+typedef enum WindowShareKind
+{
+	WINSHARE_FINAL,				/* same transition, its own final function */
+	WINSHARE_SUM_FROM_AVG,		/* int2/int4 sum from {count, sum} */
+	WINSHARE_COUNT_FROM_AVG		/* count(x) from {count, sum} */
+} WindowShareKind;
+
 /*
  * For plain aggregate window functions, we also have one of these.
  */
@@ -142,6 +228,8 @@ typedef struct WindowStatePerAggData
 {
 	/* Oids of transfer functions */
 	Oid			transfn_oid;
+	Oid			invtransfn_oid; /* may be InvalidOid */
+	Oid			combinefn_oid;	/* may be InvalidOid */
 	Oid			finalfn_oid;	/* may be InvalidOid */
 
 	/*
@@ -150,6 +238,8 @@ typedef struct WindowStatePerAggData
 	 * flags are kept here.
 	 */
 	FmgrInfo	transfn;
+	FmgrInfo	invtransfn;
+	FmgrInfo	combinefn;
 	FmgrInfo	finalfn;
 
 	/*
@@ -174,6 +264,7 @@ typedef struct WindowStatePerAggData
 	bool		inputtypeByVal,
 				resulttypeByVal,
 				transtypeByVal;
+	Oid			transtype;		/* resolved transition data type */
 
 	int			wfuncno;		/* index of associated PerFuncData */
 
@@ -183,41 +274,161 @@ typedef struct WindowStatePerAggData
 
 	bool		noTransValue;	/* true if transValue not set yet */
 
+	/*
+	 * true if rows having a null argument are left out of transValue: a
+	 * strict transfn leaves them out, and a strict inverse means a
+	 * non-strict transfn ignores them (see AggregateCreate).
+	 */
+	bool		skipNullRows;
+
+	/*
+	 * number of rows aggregated into transValue, not counting the rows
+	 * skipped per skipNullRows; the inverse transition function is called
+	 * for each of them as it leaves the frame.
+	 */
+	int64		transValueCount;
+
+	/*
+	 * segment tree nodes, indexed like a binary heap: node i combines nodes
+	 * 2i and 2i+1, and the leaves start at opt_segtree_size.
+	 */
+	Datum	   *segtree_values;
+	bool	   *segtree_nulls;
+
+	/* by cywang, for reducing recompute, opt_tempTransValue_max entries */
+	Datum	   *opt_temp_transValue;	/* the temporary value to reduce recompute*/
+	bool	   *opt_temp_transValueIsNull;
+	bool	   *opt_temp_noTransValue;
+
+	/*
+	 * The column buffer: the evaluated arguments of the first
+	 * opt_colrows rows of the partition, numArguments per row, so that rows
+	 * aggregated again need not be fetched apart.  Only for by-value
+	 * arguments that are not volatile.
+	 */
+	bool		opt_columnar;	/* keep a column buffer? */
+	Datum	   *opt_colvalues;
+	bool	   *opt_colnulls;
+	int64		opt_colrows;	/* rows filled */
+	int64		opt_colsize;	/* rows allocated */
+
+	/* how to advance over a run of the column buffer */
+	WindowBatchKind opt_batchkind;
+	int16		opt_batchlen;	/* typlen of an integer argument */
+
+	/*
+	 * The first aggregate of the frame with the same arguments,
+	 * or NULL.  Its column buffer, and the arguments it last evaluated (for
+	 * row opt_argepoch of the frame), serve this one too.
+	 */
+	struct WindowStatePerAggData *opt_argsource;
+	bool		opt_argshared;	/* other aggregates use our arguments */
+	int64		opt_argepoch;
+	Datum	   *opt_argvalues;
+	bool	   *opt_argnulls;
 
-	/* by cywang, for reducing recompute*/
-	Datum		opt_temp_transValue[16];	/* the temporary value to reduce recompute*/
-	bool		opt_temp_transValueIsNull[16];
-	bool		opt_temp_noTransValue[16];
+	/*
+	 * For an aggregate in winstate->opt_shareagg: the aggregate
+	 * whose transition value it is finalized from, and how
+	 */
+	struct WindowStatePerAggData *opt_statesource;
+	WindowShareKind opt_sharekind;
 } WindowStatePerAggData;
 
+/* the aggregate whose column buffer has this one's arguments */
+#define WINAGG_ARGSOURCE(peraggstate) \
+	((peraggstate)->opt_argsource != NULL ? \
+	 (peraggstate)->opt_argsource : (peraggstate))
+
 static void initialize_windowaggregate(WindowAggState *winstate,
 						   WindowStatePerFunc perfuncstate,
 						   WindowStatePerAgg peraggstate);
+static void eval_windowaggregate_args(WindowAggState *winstate,
+						  WindowStatePerFunc perfuncstate,
+						  WindowStatePerAgg peraggstate,
+						  FunctionCallInfo fcinfo);
+static bool columnbuffer_reserve(WindowAggState *winstate,
+					 WindowStatePerAgg peraggstate, int numArguments);
 static void advance_windowaggregate(WindowAggState *winstate,
 						WindowStatePerFunc perfuncstate,
 						WindowStatePerAgg peraggstate);
+static WindowBatchKind windowaggregate_batchkind(WindowStatePerFunc perfuncstate,
+						  WindowStatePerAgg peraggstate);
+static int64 batch_advance_limit(WindowAggState *winstate);
+static void advance_windowaggregates_batch(WindowAggState *winstate,
+							   int64 from, int64 to);
+static void advance_windowaggregate_batch(WindowAggState *winstate,
+							  WindowStatePerFunc perfuncstate,
+							  WindowStatePerAgg peraggstate,
+							  int64 from, int64 n);
+static bool retreat_windowaggregate(WindowAggState *winstate,
+						WindowStatePerFunc perfuncstate,
+						WindowStatePerAgg peraggstate);
+static bool retreat_windowaggregates(WindowAggState *winstate);
+static TupleTableSlot *invtrans_gettupleslot(WindowObject winobj, int64 pos);
+static void combine_windowaggregate(WindowAggState *winstate,
+						WindowStatePerFunc perfuncstate,
+						WindowStatePerAgg peraggstate,
+						Datum value, bool isnull);
+static void build_segtree(WindowAggState *winstate);
+static void segtree_advance_rows(WindowAggState *winstate, WindowObject winobj,
+					 int64 from, int64 to);
+static TupleTableSlot *segtree_gettupleslot(WindowObject winobj, int64 pos);
 static void finalize_windowaggregate(WindowAggState *winstate,
 						 WindowStatePerFunc perfuncstate,
 						 WindowStatePerAgg peraggstate,
 						 Datum *result, bool *isnull);
 
 static void eval_windowaggregates(WindowAggState *winstate);
+static void eval_windowaggregates_segtree(WindowAggState *winstate);
+static void save_windowaggregate_results(WindowAggState *winstate);
 static void eval_windowfunction(WindowAggState *winstate,
 					WindowStatePerFunc perfuncstate,
 					Datum *result, bool *isnull);
 
 static void begin_partition(WindowAggState *winstate);
+static void begin_partition_frame(WindowAggState *winstate);
 static void spool_tuples(WindowAggState *winstate, int64 pos);
 static void release_partition(WindowAggState *winstate);
+static void enter_frame(WindowAggState *winstate, WindowAggState *frame);
+static void leave_frame(WindowAggState *winstate, WindowAggState *frame);
+static void compute_frame_offsets(WindowAggState *winstate);
 
 static bool row_is_in_frame(WindowAggState *winstate, int64 pos,
 				TupleTableSlot *slot);
 static void update_frameheadpos(WindowObject winobj, TupleTableSlot *slot);
 static void update_frametailpos(WindowObject winobj, TupleTableSlot *slot);
+static int64 range_frame_bound(WindowObject winobj, bool isStart, int64 lo,
+				  TupleTableSlot *slot, TupleTableSlot *opt_slot,
+				  bool reuse);
+static bool range_frame_offset(FmgrInfo *func, Datum cur, Datum offset,
+				   Datum *bound);
+static bool range_frame_past(WindowObject winobj, bool isStart, int64 pos,
+				 bool curisnull, Datum bound, int boundside,
+				 TupleTableSlot *slot, TupleTableSlot *opt_slot,
+				 bool reuse);
 
 static WindowStatePerAggData *initialize_peragg(WindowAggState *winstate,
 				  WindowFunc *wfunc,
 				  WindowStatePerAgg peraggstate);
+static bool windowaggregate_shares(WindowAggState *winstate,
+					   WindowStatePerAgg peraggstate,
+					   WindowStatePerAgg source, bool derive,
+					   WindowShareKind *kind);
+static void share_windowaggregates(WindowAggState *winstate, int numframes,
+					   int *frameaggs, int *frameshares);
+static void initialize_frame_aggregates(WindowAggState *winstate);
+static WindowAggState *initialize_frame(WindowAggState *winstate, int frameno,
+				 WindowStatePerAgg peragg, int numaggs);
+static int	window_frameno(WindowAgg *node, Index winref);
+static void initialize_argrings(WindowAggState *winstate);
+static void argring_note(WindowAggState *winstate, TupleTableSlot *slot,
+			 int64 pos);
+static void argring_store(WindowObject winobj, int64 pos, Datum value,
+			  bool isnull);
+static bool argring_get(WindowObject winobj, int64 pos, Datum *value,
+			bool *isnull);
+static bool frame_check_by_pos(WindowAggState *winstate, int64 pos);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 
 static bool are_peers(WindowAggState *winstate, TupleTableSlot *slot1,
@@ -226,7 +437,7 @@ static bool window_gettupleslot(WindowObject winobj, int64 pos,
 					TupleTableSlot *slot);
 
 //#ifdef WIN_FUN_OPT
-static AttrNumber addNumber(AttrNumber *array, AttrNumber num);
+static Node *opt_map_useful_vars(Node *node, AttrNumber *init2useful);
 static bool opt_window_gettupleslot(WindowObject winobj, int64 pos, TupleTableSlot *slot, TupleTableSlot *opt_slot);
 static void opt_update_frameheadpos(WindowObject winobj, TupleTableSlot *slot, TupleTableSlot *opt_slot);
 static void opt_update_frametailpos(WindowObject winobj, TupleTableSlot *slot, TupleTableSlot *opt_slot);
@@ -242,6 +453,9 @@ static void opt_temp_initialize_windowaggregate(WindowAggState *winstate,
 						   WindowStatePerAgg peraggstate,
 						   int target);
 static void opt_eval_tempTransEnd(WindowAggState *winstate);
+static Size estimate_transvalue_space(WindowAggState *winstate);
+static void opt_tune_recompute(WindowAggState *winstate, int64 framesize);
+static void opt_reserve_tempTransValues(WindowAggState *winstate, int num);
 static void opt_copy_transValue_from_tempTransValue(WindowAggState *winstate,
 		   WindowStatePerFunc perfuncstate,
 		   WindowStatePerAgg peraggstate,
@@ -273,9 +487,151 @@ initialize_windowaggregate(WindowAggState *winstate,
 	}
 	peraggstate->transValueIsNull = peraggstate->initValueIsNull;
 	peraggstate->noTransValue = peraggstate->initValueIsNull;
+	peraggstate->transValueCount = 0;
 	peraggstate->resultValueIsNull = true;
 }
 
+/*
+ * eval_windowaggregate_args
+ * evaluate the aggregate's arguments for the row in tmpcontext's outer
+ * tuple into fcinfo->arg[1..], taking them from the column buffer if the
+ * row is there already, and adding it if it is the next one
+ *
+ * Aggregates with the same arguments share the column buffer of the first
+ * of them, and take the arguments another one has just evaluated for the
+ * same row.
+ */
+static void
+eval_windowaggregate_args(WindowAggState *winstate,
+						  WindowStatePerFunc perfuncstate,
+						  WindowStatePerAgg peraggstate,
+						  FunctionCallInfo fcinfo)
+{
+	WindowFuncExprState *wfuncstate = perfuncstate->wfuncstate;
+	int			numArguments = perfuncstate->numArguments;
+	int64		pos = winstate->opt_argpos;
+	ExprContext *econtext = winstate->tmpcontext;
+	ListCell   *arg;
+	List	   *args;
+	int			i;
+
+	peraggstate = WINAGG_ARGSOURCE(peraggstate);
+
+	if (peraggstate->opt_columnar && pos >= 0 && pos < peraggstate->opt_colrows)
+	{
+		Datum	   *values = peraggstate->opt_colvalues + pos * numArguments;
+		bool	   *nulls = peraggstate->opt_colnulls + pos * numArguments;
+
+		for (i = 0; i < numArguments; i++)
+		{
+			fcinfo->arg[i + 1] = values[i];
+			fcinfo->argnull[i + 1] = nulls[i];
+		}
+		return;
+	}
+
+	if (peraggstate->opt_argshared &&
+		peraggstate->opt_argepoch == winstate->opt_argepoch)
+	{
+		for (i = 0; i < numArguments; i++)
+		{
+			fcinfo->arg[i + 1] = peraggstate->opt_argvalues[i];
+			fcinfo->argnull[i + 1] = peraggstate->opt_argnulls[i];
+		}
+		return;
+	}
+
+	/* a useful tuple on tape has its own attribute numbers */
+	if (enable_winfunopt && !tuplestore_in_memory(winstate->buffer))
+		args = wfuncstate->opt_args;
+	else
+		args = wfuncstate->args;
+
+	/* We start from 1, since the 0th arg will be the transition value */
+	i = 1;
+	foreach(arg, args)
+	{
+		ExprState  *argstate = (ExprState *) lfirst(arg);
+
+		fcinfo->arg[i] = ExecEvalExpr(argstate, econtext,
+									  &fcinfo->argnull[i], NULL);
+		i++;
+	}
+
+	if (peraggstate->opt_argshared)
+	{
+		for (i = 0; i < numArguments; i++)
+		{
+			peraggstate->opt_argvalues[i] = fcinfo->arg[i + 1];
+			peraggstate->opt_argnulls[i] = fcinfo->argnull[i + 1];
+		}
+		peraggstate->opt_argepoch = winstate->opt_argepoch;
+	}
+
+	if (peraggstate->opt_columnar && pos >= 0 &&
+		pos == peraggstate->opt_colrows &&
+		columnbuffer_reserve(winstate, peraggstate, numArguments))
+	{
+		Datum	   *values = peraggstate->opt_colvalues + pos * numArguments;
+		bool	   *nulls = peraggstate->opt_colnulls + pos * numArguments;
+
+		for (i = 0; i < numArguments; i++)
+		{
+			values[i] = fcinfo->arg[i + 1];
+			nulls[i] = fcinfo->argnull[i + 1];
+		}
+		peraggstate->opt_colrows++;
+	}
+}
+
+/*
+ * columnbuffer_reserve
+ * make room in the aggregate's column buffer for one more row
+ *
+ * The buffers of all the aggregates together stay within work_mem; once
+ * they are full, later rows are just not kept.
+ */
+static bool
+columnbuffer_reserve(WindowAggState *winstate, WindowStatePerAgg peraggstate,
+					 int numArguments)
+{
+	int64		newsize;
+	Size		rowspace = numArguments * (sizeof(Datum) + sizeof(bool));
+	MemoryContext oldContext;
+
+	if (peraggstate->opt_colrows < peraggstate->opt_colsize)
+		return true;
+
+	newsize = Max(peraggstate->opt_colsize * 2, 1024);
+	if (winstate->opt_colspace + (newsize - peraggstate->opt_colsize) * rowspace >
+		work_mem * 1024L ||
+		newsize * numArguments * sizeof(Datum) >= MaxAllocSize)
+		return false;
+
+	oldContext = MemoryContextSwitchTo(winstate->partcontext);
+	if (peraggstate->opt_colvalues == NULL)
+	{
+		peraggstate->opt_colvalues = (Datum *)
+			palloc(newsize * numArguments * sizeof(Datum));
+		peraggstate->opt_colnulls = (bool *)
+			palloc(newsize * numArguments * sizeof(bool));
+	}
+	else
+	{
+		peraggstate->opt_colvalues = (Datum *)
+			repalloc(peraggstate->opt_colvalues,
+					 newsize * numArguments * sizeof(Datum));
+		peraggstate->opt_colnulls = (bool *)
+			repalloc(peraggstate->opt_colnulls,
+					 newsize * numArguments * sizeof(bool));
+	}
+	MemoryContextSwitchTo(oldContext);
+
+	winstate->opt_colspace += (newsize - peraggstate->opt_colsize) * rowspace;
+	peraggstate->opt_colsize = newsize;
+	return true;
+}
+
 /*
  * advance_windowaggregate
  * parallel to advance_aggregates in nodeAgg.c
@@ -285,42 +641,26 @@ advance_windowaggregate(WindowAggState *winstate,
 						WindowStatePerFunc perfuncstate,
 						WindowStatePerAgg peraggstate)
 {
-	WindowFuncExprState *wfuncstate = perfuncstate->wfuncstate;
 	int			numArguments = perfuncstate->numArguments;
 	FunctionCallInfoData fcinfodata;
 	FunctionCallInfo fcinfo = &fcinfodata;
 	Datum		newVal;
-	ListCell   *arg;
 	int			i;
 	MemoryContext oldContext;
 	ExprContext *econtext = winstate->tmpcontext;
 
 	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
 
-	/* We start from 1, since the 0th arg will be the transition value */
-	i = 1;
-//#ifdef WIN_FUN_OPT
-	if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-		foreach(arg, wfuncstate->opt_args){
-			ExprState  *argstate = (ExprState *) lfirst(arg);
-
-			fcinfo->arg[i] = ExecEvalExpr(argstate, econtext,
-										  &fcinfo->argnull[i], NULL);
-			i++;
-		}
-	}else{
-//#endif
-		foreach(arg, wfuncstate->args)
-		{
-			ExprState  *argstate = (ExprState *) lfirst(arg);
+	eval_windowaggregate_args(winstate, perfuncstate, peraggstate, fcinfo);
 
-			fcinfo->arg[i] = ExecEvalExpr(argstate, econtext,
-										  &fcinfo->argnull[i], NULL);
-			i++;
-		}
-//#ifdef WIN_FUN_OPT
+	/* count rows that retreat_windowaggregate will have to remove */
+	for (i = 1; i <= numArguments && peraggstate->skipNullRows; i++)
+	{
+		if (fcinfo->argnull[i])
+			break;
 	}
-//#endif
+	if (i > numArguments || !peraggstate->skipNullRows)
+		peraggstate->transValueCount++;
 
 	if (peraggstate->transfn.fn_strict)
 	{
@@ -405,2067 +745,4926 @@ advance_windowaggregate(WindowAggState *winstate,
 }
 
 /*
- * finalize_windowaggregate
- * parallel to finalize_aggregate in nodeAgg.c
+ * windowaggregate_batchkind
+ * tell whether the aggregate's transition function is one that
+ * advance_windowaggregate_batch knows how to run without fmgr
+ *
+ * The arguments must come from the column buffer (count(*) has none), and
+ * the transition value must be passed by value, except for the avg arrays
+ * that the transfn would update in place anyway.
  */
-static void
-finalize_windowaggregate(WindowAggState *winstate,
-						 WindowStatePerFunc perfuncstate,
-						 WindowStatePerAgg peraggstate,
-						 Datum *result, bool *isnull)
+static WindowBatchKind
+windowaggregate_batchkind(WindowStatePerFunc perfuncstate,
+						  WindowStatePerAgg peraggstate)
 {
-	MemoryContext oldContext;
+	WindowBatchKind kind;
+
+	peraggstate->opt_batchlen = 0;
+	if (!enable_batchadvance)
+		return WINBATCH_NONE;
+	if (perfuncstate->numArguments == 0)
+		return (peraggstate->transfn_oid == F_INT8INC &&
+				peraggstate->transtypeByVal) ? WINBATCH_COUNT_STAR : WINBATCH_NONE;
+	if (!peraggstate->opt_columnar || perfuncstate->numArguments != 1)
+		return WINBATCH_NONE;
+
+	switch (peraggstate->transfn_oid)
+	{
+		case F_INT8INC_ANY:
+			kind = WINBATCH_COUNT;
+			break;
+		case F_INT2_SUM:
+			peraggstate->opt_batchlen = sizeof(int16);
+			kind = WINBATCH_SUM_INT;
+			break;
+		case F_INT4_SUM:
+			peraggstate->opt_batchlen = sizeof(int32);
+			kind = WINBATCH_SUM_INT;
+			break;
+		case F_FLOAT8PL:
+			kind = WINBATCH_SUM_FLOAT8;
+			break;
+		case F_INT2LARGER:
+		case F_INT2SMALLER:
+			peraggstate->opt_batchlen = sizeof(int16);
+			kind = (peraggstate->transfn_oid == F_INT2LARGER) ?
+				WINBATCH_MAX_INT : WINBATCH_MIN_INT;
+			break;
+		case F_INT4LARGER:
+		case F_INT4SMALLER:
+			peraggstate->opt_batchlen = sizeof(int32);
+			kind = (peraggstate->transfn_oid == F_INT4LARGER) ?
+				WINBATCH_MAX_INT : WINBATCH_MIN_INT;
+			break;
+		case F_INT8LARGER:
+		case F_INT8SMALLER:
+			peraggstate->opt_batchlen = sizeof(int64);
+			kind = (peraggstate->transfn_oid == F_INT8LARGER) ?
+				WINBATCH_MAX_INT : WINBATCH_MIN_INT;
+			break;
+		case F_FLOAT8LARGER:
+			kind = WINBATCH_MAX_FLOAT8;
+			break;
+		case F_FLOAT8SMALLER:
+			kind = WINBATCH_MIN_FLOAT8;
+			break;
+		case F_INT2_AVG_ACCUM:
+			peraggstate->opt_batchlen = sizeof(int16);
+			return WINBATCH_AVG_INT;
+		case F_INT4_AVG_ACCUM:
+			peraggstate->opt_batchlen = sizeof(int32);
+			return WINBATCH_AVG_INT;
+		case F_FLOAT8_ACCUM:
+			return WINBATCH_ACCUM_FLOAT8;
+		default:
+			return WINBATCH_NONE;
+	}
 
-	oldContext = MemoryContextSwitchTo(winstate->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
+	/* int8 and float8 states are by value only on 64-bit builds */
+	if (!peraggstate->transtypeByVal)
+		return WINBATCH_NONE;
+	return kind;
+}
 
-	/*
-	 * Apply the agg's finalfn if one is provided, else return transValue.
-	 */
-	if (OidIsValid(peraggstate->finalfn_oid))
-	{
-		FunctionCallInfoData fcinfo;
+/*
+ * batch_advance_limit
+ * the row before which every row from aggregatedupto on is known to be in
+ * the frame and to have its arguments in all the column buffers
+ *
+ * Only frame ends that can be told from the position alone are handled.
+ */
+static int64
+batch_advance_limit(WindowAggState *winstate)
+{
+	int			frameOptions = winstate->frameOptions;
+	int64		end = winstate->spooled_rows;
+	int			i;
 
-		InitFunctionCallInfoData(fcinfo, &(peraggstate->finalfn), 1,
-								 perfuncstate->winCollation,
-								 (void *) winstate, NULL);
-		fcinfo.arg[0] = peraggstate->transValue;
-		fcinfo.argnull[0] = peraggstate->transValueIsNull;
-		if (fcinfo.flinfo->fn_strict && peraggstate->transValueIsNull)
-		{
-			/* don't call a strict function with NULL inputs */
-			*result = (Datum) 0;
-			*isnull = true;
-		}
-		else
+	if (!(frameOptions & FRAMEOPTION_END_UNBOUNDED_FOLLOWING))
+	{
+		if (!(frameOptions & FRAMEOPTION_ROWS))
+			return winstate->aggregatedupto;
+
+		if (frameOptions & FRAMEOPTION_END_CURRENT_ROW)
+			end = Min(end, winstate->currentpos + 1);
+		else if (frameOptions & FRAMEOPTION_END_VALUE_PRECEDING)
+			end = Min(end, winstate->currentpos -
+					  DatumGetInt64(winstate->endOffsetValue) + 1);
+		else if (frameOptions & FRAMEOPTION_END_VALUE_FOLLOWING)
 		{
-			*result = FunctionCallInvoke(&fcinfo);
-			*isnull = fcinfo.isnull;
+			int64		offset = DatumGetInt64(winstate->endOffsetValue);
+
+			/* beware of overflow with a huge offset */
+			if (offset < end - winstate->currentpos)
+				end = winstate->currentpos + offset + 1;
 		}
 	}
-	else
+
+	for (i = 0; i < winstate->numaggs; i++)
 	{
-		*result = peraggstate->transValue;
-		*isnull = peraggstate->transValueIsNull;
-	}
+		WindowStatePerAgg peraggstate = &winstate->peragg[i];
 
-	/*
-	 * If result is pass-by-ref, make sure it is in the right context.
-	 */
-	if (!peraggstate->resulttypeByVal && !*isnull &&
-		!MemoryContextContains(CurrentMemoryContext,
-							   DatumGetPointer(*result)))
-		*result = datumCopy(*result,
-							peraggstate->resulttypeByVal,
-							peraggstate->resulttypeLen);
-	MemoryContextSwitchTo(oldContext);
+		if (peraggstate->opt_batchkind != WINBATCH_COUNT_STAR)
+			end = Min(end, WINAGG_ARGSOURCE(peraggstate)->opt_colrows);
+	}
+	return end;
 }
 
 /*
- * eval_windowaggregates
- * evaluate plain aggregates being used as window functions
- *
- * Much of this is duplicated from nodeAgg.c.  But NOTE that we expect to be
- * able to call aggregate final functions repeatedly after aggregating more
- * data onto the same transition value.  This is not a behavior required by
- * nodeAgg.c.
+ * advance_windowaggregates_batch
+ * accumulate the rows from 'from' up to, but not including, 'to' into all
+ * the aggregates from their column buffers
  */
 static void
-eval_windowaggregates(WindowAggState *winstate)
+advance_windowaggregates_batch(WindowAggState *winstate, int64 from, int64 to)
 {
 	WindowStatePerAgg peraggstate;
-	int			wfuncno,
-				numaggs;
 	int			i;
-	MemoryContext oldContext;
-	ExprContext *econtext;
-	WindowObject agg_winobj;
-	TupleTableSlot *agg_row_slot;
 
-//#ifdef WIN_FUN_OPT
-	TupleTableSlot	*opt_agg_row_slot = winstate->opt_agg_row_slot;
+	for (i = 0; i < winstate->numaggs; i++)
+	{
+		peraggstate = &winstate->peragg[i];
+		advance_windowaggregate_batch(winstate,
+									  &winstate->perfunc[peraggstate->wfuncno],
+									  peraggstate, from, to - from);
+	}
+}
 
-	/* the following is some flags for computing the time cost */
-	bool			recompute_cpu_started = false;	/* a flag for instr_recompute_part */
-	bool			recompute_part_stoped = true;
-	bool			framehead_updated = false;
-	bool			stillinframe = true;
-	bool			cpu_afterspooled_started = false;
-	int64			pre_upto = winstate->aggregatedupto;
-	bool			io_afterspooled_started = false;
+/*
+ * Tight loops over a run of the column buffer.  Null arguments are skipped
+ * without a branch where the compiler can turn the loop into vector code;
+ * the float8 sums are added strictly in row order, as the transfn would.
+ */
+#define BATCH_SUM_LOOP(getter) \
+	for (; i < n; i++) \
+	{ \
+		sum += nulls[i] ? 0 : (int64) getter(values[i]); \
+		count += !nulls[i]; \
+	}
 
-	/* the following is for reducing recompute */
-	bool			need_compute_temp_trans = false;
-	int64 			previous_frame_size = 0;
-	//bool			need_combine = false;
-//#endif
+#define BATCH_MINMAX_LOOP(type, getter, op) \
+	do { \
+		type		m = getter(peraggstate->transValue); \
+		\
+		for (; i < n; i++) \
+		{ \
+			type		v = getter(values[i]); \
+			\
+			m = (!nulls[i] && v op m) ? v : m; \
+			count += !nulls[i]; \
+		} \
+		result = (int64) m; \
+	} while (0)
 
-	numaggs = winstate->numaggs;
-	if (numaggs == 0)
-		return;					/* nothing to do */
+/*
+ * advance_windowaggregate_batch
+ * accumulate n rows of the column buffer, starting with row 'from', into
+ * the aggregate, giving the same transition value as n calls of
+ * advance_windowaggregate
+ *
+ * Anything the loops don't handle -- a float8 overflow, which must raise the
+ * transfn's own error, or a state the transfn left null -- sends the rest
+ * of the rows down the fmgr path, which finds their arguments in the column
+ * buffer.
+ */
+static void
+advance_windowaggregate_batch(WindowAggState *winstate,
+							  WindowStatePerFunc perfuncstate,
+							  WindowStatePerAgg peraggstate,
+							  int64 from, int64 n)
+{
+	WindowBatchKind kind = peraggstate->opt_batchkind;
+	int16		len = peraggstate->opt_batchlen;
+	Datum	   *values;
+	bool	   *nulls;
+	int64		i = 0;
+	int64		count = 0;
+	int64		sum = 0;
+	int64		result;
+
+	/* count(*) counts every row, and has no column buffer */
+	if (kind == WINBATCH_COUNT_STAR && !peraggstate->transValueIsNull)
+	{
+		peraggstate->transValue =
+			Int64GetDatum(DatumGetInt64(peraggstate->transValue) + n);
+		peraggstate->transValueCount += n;
+		return;
+	}
 
-	/* final output execution is in ps_ExprContext */
-	econtext = winstate->ss.ps.ps_ExprContext;
-	agg_winobj = winstate->agg_winobj;
-	agg_row_slot = winstate->agg_row_slot;
+	values = WINAGG_ARGSOURCE(peraggstate)->opt_colvalues + from;
+	nulls = WINAGG_ARGSOURCE(peraggstate)->opt_colnulls + from;
+
+	if (kind == WINBATCH_COUNT_STAR ||
+		(peraggstate->transValueIsNull && !peraggstate->noTransValue))
+		goto fallback;
 
 	/*
-	 * Currently, we support only a subset of the SQL-standard window framing
-	 * rules.
-	 *
-	 * If the frame start is UNBOUNDED_PRECEDING, the window frame consists of
-	 * a contiguous group of rows extending forward from the start of the
-	 * partition, and rows only enter the frame, never exit it, as the current
-	 * row advances forward.  This makes it possible to use an incremental
-	 * strategy for evaluating aggregates: we run the transition function for
-	 * each row added to the frame, and run the final function whenever we
-	 * need the current aggregate value.  This is considerably more efficient
-	 * than the naive approach of re-running the entire aggregate calculation
-	 * for each current row.  It does assume that the final function doesn't
-	 * damage the running transition value, but we have the same assumption in
-	 * nodeAgg.c too (when it rescans an existing hash table).
-	 *
-	 * For other frame start rules, we discard the aggregate state and re-run
-	 * the aggregates whenever the frame head row moves.  We can still
-	 * optimize as above whenever successive rows share the same frame head.
-	 *
-	 * In many common cases, multiple rows share the same frame and hence the
-	 * same aggregate value. (In particular, if there's no ORDER BY in a RANGE
-	 * window, then all rows are peers and so they all have window frame equal
-	 * to the whole partition.)  We optimize such cases by calculating the
-	 * aggregate value once when we reach the first row of a peer group, and
-	 * then returning the saved value for all subsequent rows.
-	 *
-	 * 'aggregatedupto' keeps track of the first row that has not yet been
-	 * accumulated into the aggregate transition values.  Whenever we start a
-	 * new peer group, we accumulate forward to the end of the peer group.
-	 *
-	 * TODO: Rerunning aggregates from the frame start can be pretty slow. For
-	 * some aggregates like SUM and COUNT we could avoid that by implementing
-	 * a "negative transition function" that would be called for each row as
-	 * it exits the frame.	We'd have to think about avoiding recalculation of
-	 * volatile arguments of aggregate functions, too.
-	 */
-
-
-	/*
-	 * First, update the frame head position.
-	 */
-//#ifdef WIN_FUN_OPT
-	if(enable_winfunopt)
-		opt_update_frameheadpos(agg_winobj, winstate->temp_slot_1, winstate->opt_temp_slot_1);
-//#else
-	else if(enable_reusebuffer)
-		reuse_update_frameheadpos(agg_winobj, winstate->temp_slot_1);
-	else
-		update_frameheadpos(agg_winobj, winstate->temp_slot_1);
-//#endif
-
-
-	/*
-	 * Initialize aggregates on first call for partition, or if the frame head
-	 * position moved since last time.
+	 * The first non-null argument becomes the transition value, as it does
+	 * for a strict transfn with a null initial value, and as int2_sum and
+	 * int4_sum do by themselves.
 	 */
-	if (winstate->currentpos == 0 ||
-		winstate->frameheadpos != winstate->aggregatedbase)
+	if (peraggstate->transValueIsNull)
 	{
+		if (kind == WINBATCH_COUNT || kind == WINBATCH_AVG_INT ||
+			kind == WINBATCH_ACCUM_FLOAT8)
+			goto fallback;
 
+		while (i < n && nulls[i])
+			i++;
+		if (i == n)
+			return;
+		if (kind != WINBATCH_SUM_INT)
+			peraggstate->transValue = values[i];
+		else if (len == sizeof(int16))
+			peraggstate->transValue = Int64GetDatum((int64) DatumGetInt16(values[i]));
+		else
+			peraggstate->transValue = Int64GetDatum((int64) DatumGetInt32(values[i]));
+		peraggstate->transValueIsNull = false;
+		peraggstate->noTransValue = false;
+		peraggstate->transValueCount++;
+		i++;
+	}
 
-		/*
-		 * Discard transient aggregate values
-		 */
-		/*
-		 * moved by cywang
-		 *
-		 * because this discard process will discard the temporary transition value too.
-		 */
-		//MemoryContextResetAndDeleteChildren(winstate->aggcontext);
-
-		/*
-		 * by cywang, moved backward
-		 */
-		/*
-		for (i = 0; i < numaggs; i++)
-		{
-			peraggstate = &winstate->peragg[i];
-			wfuncno = peraggstate->wfuncno;
-			initialize_windowaggregate(winstate,
-									   &winstate->perfunc[wfuncno],
-									   peraggstate);
-		}
-		*/
+	switch (kind)
+	{
+		case WINBATCH_COUNT:
+			for (; i < n; i++)
+				count += !nulls[i];
+			peraggstate->transValue =
+				Int64GetDatum(DatumGetInt64(peraggstate->transValue) + count);
+			break;
 
-		/*
-		 * If we created a mark pointer for aggregates, keep it pushed up to
-		 * frame head, so that tuplestore can discard unnecessary rows.
-		 */
-		if (agg_winobj->markptr >= 0)
-			WinSetMarkPosition(agg_winobj, winstate->frameheadpos);
+		case WINBATCH_SUM_INT:
+			if (len == sizeof(int16))
+				BATCH_SUM_LOOP(DatumGetInt16)
+			else
+				BATCH_SUM_LOOP(DatumGetInt32)
+			peraggstate->transValue =
+				Int64GetDatum(DatumGetInt64(peraggstate->transValue) + sum);
+			break;
 
-		/* by cywang, for locate*/
-		if(enable_locate){
-			if(agg_winobj->opt_frameheadptr >= 0 && winstate->currentpos!=0){
-				/* first update opt_frameheadptr */
-				opt_update_frameheadptr(agg_winobj, winstate->frameheadpos);
-				/* then copy opt_frameheadptr to readptr */
-				opt_copy_frameheadptr(agg_winobj);
+		case WINBATCH_MAX_INT:
+		case WINBATCH_MIN_INT:
+			if (len == sizeof(int16))
+			{
+				if (kind == WINBATCH_MAX_INT)
+					BATCH_MINMAX_LOOP(int16, DatumGetInt16, >);
+				else
+					BATCH_MINMAX_LOOP(int16, DatumGetInt16, <);
+				peraggstate->transValue = Int16GetDatum((int16) result);
 			}
-
-			if(enable_reusebuffer && !tuplestore_in_memory(winstate->buffer)){
-				copy_reuseptr(agg_winobj);
+			else if (len == sizeof(int32))
+			{
+				if (kind == WINBATCH_MAX_INT)
+					BATCH_MINMAX_LOOP(int32, DatumGetInt32, >);
+				else
+					BATCH_MINMAX_LOOP(int32, DatumGetInt32, <);
+				peraggstate->transValue = Int32GetDatum((int32) result);
 			}
-		}
-
-		if(enable_reusebuffer){
-			reuse_tuplestore_trim(winstate->buffer, winstate->frameheadpos);
-		}
-//#ifdef WIN_FUN_OPT
-		/*
-		 * Initialize for loop below
-		 */
-		if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-			ExecClearTuple(opt_agg_row_slot);
-		}else{
-//#endif
-			ExecClearTuple(agg_row_slot);
-//#ifdef WIN_FUN_OPT
-		}
-//#endif
-
-		/* by cywang */
-		framehead_updated = true;
-
-		if(winstate->currentpos == 0){
-			for(i=0; i<winstate->opt_tempTransValue_num; i++)
-				agg_winobj->opt_tempStartPos[i] = 0;
-		}
-
-		previous_frame_size = winstate->aggregatedupto - winstate->aggregatedbase +1;
+			else
+			{
+				if (kind == WINBATCH_MAX_INT)
+					BATCH_MINMAX_LOOP(int64, DatumGetInt64, >);
+				else
+					BATCH_MINMAX_LOOP(int64, DatumGetInt64, <);
+				peraggstate->transValue = Int64GetDatum(result);
+			}
+			break;
 
-		/*
-		 * In the last step when need_compute_temp_trans is true, no temporary transition value is produced,
-		 * which means recompute_k is bigger than the frame size
-		 */
-		//if(agg_winobj->opt_needTempTransValue && agg_winobj->opt_frameheadeverchanged && agg_winobj->opt_tempTransEndPos==-1)
-		//	agg_winobj->opt_needTempTransValue = false;
+		case WINBATCH_SUM_FLOAT8:
+			{
+				float8		s = DatumGetFloat8(peraggstate->transValue);
 
-		//if(enable_recompute && agg_winobj->opt_needTempTransValue){
-		if(enable_recompute && previous_frame_size>4){
-			winstate->opt_active_tempTransValue = -1;
-			for(i=0; i<winstate->opt_tempTransValue_num; i++){
-				if(winstate->frameheadpos <= agg_winobj->opt_tempStartPos[i] && agg_winobj->opt_tempTransEndPos[i]>=0){
-					winstate->opt_active_tempTransValue = i;
-					break;
+				for (; i < n; i++)
+				{
+					float8		v = DatumGetFloat8(values[i]);
+					float8		r = s + v;
+
+					if (nulls[i])
+						continue;
+					/* float8pl's CHECKFLOATVAL */
+					if (isinf(r) && !isinf(s) && !isinf(v))
+						break;
+					s = r;
+					count++;
 				}
+				peraggstate->transValue = Float8GetDatum(s);
 			}
+			break;
 
-			/* no temporary transition value is proper */
-			if(winstate->opt_active_tempTransValue  < 0){
-				int target;
-				MemoryContextResetAndDeleteChildren(winstate->aggcontext);
-				for(target=0; target<winstate->opt_tempTransValue_num; target++){
-					for (i = 0; i < numaggs; i++)
-					{
-						peraggstate = &winstate->peragg[i];
-						wfuncno = peraggstate->wfuncno;
-						/* the pointer of temporary transition value is automatically freed */
-						opt_temp_initialize_windowaggregate(winstate,
-												   &winstate->perfunc[wfuncno],
-												   peraggstate,
-												   target);
-						/*
-						 * We don't use a fixed size for the tempTransValue,
-						 * because the frame size may changes.
-						 *
-						 * However, we have an assumption that the size of two adjacent frames doesn't vary much.
-						 * So currently, the size of tempTransValue comes from the previous frame.
-						 *
-						 * In addition, only when frame size is bigger than 4, we import recompute.
-						 * Which means the size of the tempTransValue is bigger than 2.
-						 */
-						if(winstate->currentpos != 0)
-							agg_winobj->opt_tempStartPos[target] = winstate->frameheadpos + (target+1)*(int64)sqrt(previous_frame_size);
-						else
-							agg_winobj->opt_tempStartPos[target] = winstate->frameheadpos + (target+1)*recompute_k;
+		case WINBATCH_MAX_FLOAT8:
+		case WINBATCH_MIN_FLOAT8:
+			{
+				float8		m = DatumGetFloat8(peraggstate->transValue);
 
-						agg_winobj->opt_tempTransEndPos[target] = -1;
+				/* NaN sorts above everything else, as in float8_cmp_internal */
+				for (; i < n; i++)
+				{
+					float8		v = DatumGetFloat8(values[i]);
+
+					if (nulls[i])
+						continue;
+					count++;
+					if (kind == WINBATCH_MAX_FLOAT8)
+					{
+						if (!isnan(m) && (isnan(v) || !(m > v)))
+							m = v;
+					}
+					else
+					{
+						if (isnan(m) || (!isnan(v) && !(m < v)))
+							m = v;
 					}
 				}
-				need_compute_temp_trans = true;
+				peraggstate->transValue = Float8GetDatum(m);
+			}
+			break;
 
-				for (i = 0; i < numaggs; i++)
-				{
-					peraggstate = &winstate->peragg[i];
-					wfuncno = peraggstate->wfuncno;
-					initialize_windowaggregate(winstate,
-											   &winstate->perfunc[wfuncno],
-											   peraggstate);
-				}
-			}else{
-				/* a temporary transition value can still be used */
-				for (i = 0; i < numaggs; i++)
-				{
-					peraggstate = &winstate->peragg[i];
-					wfuncno = peraggstate->wfuncno;
-					opt_copy_transValue_from_tempTransValue(winstate,
-												&winstate->perfunc[wfuncno],
-												peraggstate,
-												winstate->opt_active_tempTransValue);
-				}
+		case WINBATCH_AVG_INT:
+			{
+				ArrayType  *transarray;
+				int64	   *transdata;
+
+				/* the same checks int4_avg_accum makes, and no detoasting */
+				if (VARATT_IS_EXTENDED(DatumGetPointer(peraggstate->transValue)))
+					goto fallback;
+				transarray = (ArrayType *) DatumGetPointer(peraggstate->transValue);
+				if (ARR_HASNULL(transarray) ||
+					ARR_SIZE(transarray) != ARR_OVERHEAD_NONULLS(1) + 2 * sizeof(int64))
+					goto fallback;
+
+				if (len == sizeof(int16))
+					BATCH_SUM_LOOP(DatumGetInt16)
+				else
+					BATCH_SUM_LOOP(DatumGetInt32)
+				transdata = (int64 *) ARR_DATA_PTR(transarray);
+				transdata[0] += count;
+				transdata[1] += sum;
 			}
-		}else{
-			MemoryContextResetAndDeleteChildren(winstate->aggcontext);
-			for (i = 0; i < numaggs; i++)
+			break;
+
+		case WINBATCH_ACCUM_FLOAT8:
 			{
-				peraggstate = &winstate->peragg[i];
-				wfuncno = peraggstate->wfuncno;
-				initialize_windowaggregate(winstate,
-										   &winstate->perfunc[wfuncno],
-										   peraggstate);
+				ArrayType  *transarray;
+				float8	   *transvalues;
+				float8		N,
+							sumX,
+							sumX2;
+
+				/* the same checks float8_accum makes, and no detoasting */
+				if (VARATT_IS_EXTENDED(DatumGetPointer(peraggstate->transValue)))
+					goto fallback;
+				transarray = (ArrayType *) DatumGetPointer(peraggstate->transValue);
+				if (ARR_NDIM(transarray) != 1 ||
+					ARR_DIMS(transarray)[0] != 3 ||
+					ARR_HASNULL(transarray) ||
+					ARR_ELEMTYPE(transarray) != FLOAT8OID)
+					goto fallback;
+
+				transvalues = (float8 *) ARR_DATA_PTR(transarray);
+				N = transvalues[0];
+				sumX = transvalues[1];
+				sumX2 = transvalues[2];
+				for (; i < n; i++)
+				{
+					float8		v = DatumGetFloat8(values[i]);
+					float8		newX = sumX + v;
+					float8		newX2 = sumX2 + v * v;
+
+					if (nulls[i])
+						continue;
+					/* float8_accum's CHECKFLOATVALs */
+					if ((isinf(newX) && !isinf(sumX) && !isinf(v)) ||
+						(isinf(newX2) && !isinf(sumX2) && !isinf(v)))
+						break;
+					N += 1.0;
+					sumX = newX;
+					sumX2 = newX2;
+					count++;
+				}
+				transvalues[0] = N;
+				transvalues[1] = sumX;
+				transvalues[2] = sumX2;
 			}
-		}
-		//if(winstate->currentpos != 0)
-			//agg_winobj->opt_frameheadeverchanged = true;
+			break;
 
-		winstate->aggregatedbase = winstate->frameheadpos;
-		winstate->aggregatedupto = winstate->frameheadpos;
+		default:
+			elog(ERROR, "unrecognized window aggregate batch kind: %d", (int) kind);
+			break;
 	}
+	peraggstate->transValueCount += count;
+	if (i == n)
+		return;
 
-	/*
-	 * In UNBOUNDED_FOLLOWING mode, we don't have to recalculate aggregates
-	 * except when the frame head moves.  In END_CURRENT_ROW mode, we only
-	 * have to recalculate when the frame head moves or currentpos has
-	 * advanced past the place we'd aggregated up to.  Check for these cases
-	 * and if so, reuse the saved result values.
-	 */
-	if ((winstate->frameOptions & (FRAMEOPTION_END_UNBOUNDED_FOLLOWING |
-								   FRAMEOPTION_END_CURRENT_ROW)) &&
-		winstate->aggregatedbase <= winstate->currentpos &&
-		winstate->aggregatedupto > winstate->currentpos)
+fallback:
+	for (; i < n; i++)
 	{
-		for (i = 0; i < numaggs; i++)
+		WINAGG_SET_ARGPOS(winstate, from + i);
+		advance_windowaggregate(winstate, perfuncstate, peraggstate);
+		ResetExprContext(winstate->tmpcontext);
+	}
+}
+
+/*
+ * retreat_windowaggregate
+ * remove the row in tmpcontext->ecxt_outertuple from the transition value,
+ * using the aggregate's inverse transition function
+ *
+ * Rows having a null argument are skipped if the aggregate skipped them on
+ * the way in (see skipNullRows); otherwise every row is passed to the
+ * inverse.  Returns false if the row could not be removed; the caller must
+ * then restart the aggregate from the frame head.
+ */
+static bool
+retreat_windowaggregate(WindowAggState *winstate,
+						WindowStatePerFunc perfuncstate,
+						WindowStatePerAgg peraggstate)
+{
+	int			numArguments = perfuncstate->numArguments;
+	FunctionCallInfoData fcinfodata;
+	FunctionCallInfo fcinfo = &fcinfodata;
+	Datum		newVal;
+	int			i;
+	MemoryContext oldContext;
+	ExprContext *econtext = winstate->tmpcontext;
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	eval_windowaggregate_args(winstate, perfuncstate, peraggstate, fcinfo);
+
+	for (i = 1; i <= numArguments && peraggstate->skipNullRows; i++)
+	{
+		if (fcinfo->argnull[i])
 		{
-			peraggstate = &winstate->peragg[i];
-			wfuncno = peraggstate->wfuncno;
-			econtext->ecxt_aggvalues[wfuncno] = peraggstate->resultValue;
-			econtext->ecxt_aggnulls[wfuncno] = peraggstate->resultValueIsNull;
+			/* the row was not counted on the way in, nothing to remove */
+			MemoryContextSwitchTo(oldContext);
+			return true;
 		}
-		return;
 	}
 
+	Assert(peraggstate->transValueCount > 0);
+
 	/*
-	 * by cywang
-	 *
-	 * only when the frame head is changed and
+	 * If this was the last row aggregated, just go back to the initial state.
+	 * That is cheaper than the inverse, and gets a strict transfn's "first
+	 * input becomes the transValue" rule right.  An INTERNAL transValue may
+	 * own memory we can't free, so leave that to the restart.
 	 */
-	if(framehead_updated && pre_upto > winstate->aggregatedupto){
-		//recompute_started = true;
-		recompute_part_stoped = false;
-		InstrStartNode(winstate->instr_recompute_part);
-	}
+	if (peraggstate->transValueCount == 1)
+	{
+		MemoryContextSwitchTo(oldContext);
+		if (peraggstate->transtype == INTERNALOID)
+			return false;
+		if (!peraggstate->transtypeByVal && !peraggstate->transValueIsNull)
+			pfree(DatumGetPointer(peraggstate->transValue));
 
-
-	/*
-	 * Advance until we reach a row not in frame (or end of partition).
-	 *
-	 * Note the loop invariant: agg_row_slot is either empty or holds the row
-	 * at position aggregatedupto.	We advance aggregatedupto after processing
-	 * a row.
-	 */
-	for (;;)
-	{
-		if(!recompute_part_stoped && winstate->aggregatedupto>=pre_upto){
-			//recompute_started = false;
-			recompute_part_stoped = true;
-			InstrStopNode(winstate->instr_recompute_part, 0);
+		if (peraggstate->initValueIsNull)
+			peraggstate->transValue = peraggstate->initValue;
+		else
+		{
+			oldContext = MemoryContextSwitchTo(winstate->aggcontext);
+			peraggstate->transValue = datumCopy(peraggstate->initValue,
+												peraggstate->transtypeByVal,
+												peraggstate->transtypeLen);
+			MemoryContextSwitchTo(oldContext);
 		}
+		peraggstate->transValueIsNull = peraggstate->initValueIsNull;
+		peraggstate->noTransValue = peraggstate->initValueIsNull;
+		peraggstate->transValueCount = 0;
+		return true;
+	}
 
-		if(framehead_updated){
-			opt_tuplestore_set_locateheadpos(winstate->buffer, true);	/* for locate IO */
-			InstrStartNode(winstate->instr_locateheadpos_part);	/* for locate the head position */
-		}
+	/* Don't call a strict function with NULL inputs */
+	if (peraggstate->invtransfn.fn_strict && peraggstate->transValueIsNull)
+	{
+		MemoryContextSwitchTo(oldContext);
+		return false;
+	}
 
-		if(winstate->partition_spooled && !framehead_updated){
-			InstrStartNode(winstate->instr_io_afterspooled);
-			io_afterspooled_started = true;
-		}
+	InitFunctionCallInfoData(*fcinfo, &(peraggstate->invtransfn),
+							 numArguments + 1,
+							 perfuncstate->winCollation,
+							 (void *) winstate, NULL);
+	fcinfo->arg[0] = peraggstate->transValue;
+	fcinfo->argnull[0] = peraggstate->transValueIsNull;
+	newVal = FunctionCallInvoke(fcinfo);
 
-//#ifdef WIN_FUN_OPT
-		if(enable_winfunopt){
-			/*
-			 * opt_window_gettupleslot may change the status
-			 */
-			if(!tuplestore_in_memory(winstate->buffer)){
-				if (TupIsNull(opt_agg_row_slot)){
-					if (!opt_window_gettupleslot(agg_winobj, winstate->aggregatedupto, agg_row_slot, opt_agg_row_slot))
-						break;			/* must be end of partition */
-				}
-			}else{
-				if (TupIsNull(agg_row_slot))
-				{
-					if (!opt_window_gettupleslot(agg_winobj, winstate->aggregatedupto, agg_row_slot, opt_agg_row_slot))
-						break;			/* must be end of partition */
-				}
-				/*
-				 * this is the situation that the buffer status switch from memory to tape,
-				 * as the follow-up computing will for opt, we need to converted it to an opt tuple.
-				 */
-				if(!tuplestore_in_memory(winstate->buffer)){
-					//tuplestore_convert_to_opt(winstate->buffer, agg_row_slot, opt_agg_row_slot);
-					/* the initial tuple slot is will not be used in the computation of current row */
-					if(agg_row_slot)
-						ExecClearTuple(agg_row_slot);
-				}
-			}
-		}else{
-//#else
-			/* Fetch next row if we didn't already */
-			if (TupIsNull(agg_row_slot))
-			{
-				if(enable_reusebuffer){
-					if (!reuse_window_gettupleslot(agg_winobj, winstate->aggregatedupto,
-											 agg_row_slot))
-						break;			/* must be end of partition */
-				}else{
-					if (!window_gettupleslot(agg_winobj, winstate->aggregatedupto,
-											 agg_row_slot))
-						break;			/* must be end of partition */
-				}
-			}
-		}
-//#endif
+	/* a NULL result means the inverse can't remove this row */
+	if (fcinfo->isnull)
+	{
+		MemoryContextSwitchTo(oldContext);
+		return false;
+	}
 
-		if(io_afterspooled_started){
-			InstrStopNode(winstate->instr_io_afterspooled, 0);	/* must before framehead_updated is changed */
-			io_afterspooled_started = false;
-		}
+	/* same copying rules as advance_windowaggregate */
+	if (!peraggstate->transtypeByVal &&
+		DatumGetPointer(newVal) != DatumGetPointer(peraggstate->transValue))
+	{
+		MemoryContextSwitchTo(winstate->aggcontext);
+		newVal = datumCopy(newVal,
+						   peraggstate->transtypeByVal,
+						   peraggstate->transtypeLen);
+		if (!peraggstate->transValueIsNull)
+			pfree(DatumGetPointer(peraggstate->transValue));
+	}
 
-		if(framehead_updated){
-			framehead_updated = false;
-			opt_tuplestore_set_locateheadpos(winstate->buffer, false);
-			InstrStopNode(winstate->instr_locateheadpos_part, 0);
-		}
+	MemoryContextSwitchTo(oldContext);
+	peraggstate->transValue = newVal;
+	peraggstate->transValueIsNull = false;
+	peraggstate->transValueCount--;
 
-		if(winstate->partition_spooled){
-			InstrStartNode(winstate->instr_cpu_afterspooled);
-			cpu_afterspooled_started = true;
-		}
+	return true;
+}
 
-		/* Exit loop (for now) if not in frame */
-		//InstrStartNode(winstate->instr_checkinframe_part);
-//#ifdef WIN_FUN_OPT
-		if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-			if (!row_is_in_frame(winstate, winstate->aggregatedupto, opt_agg_row_slot)){
-				stillinframe = false;	/* for instr_checkinframe_part*/
-				break;
-			}
-			/* Set tuple context for evaluation of aggregate arguments */
-			winstate->tmpcontext->ecxt_outertuple = opt_agg_row_slot;
-		}else{
-//#endif
-			if (!row_is_in_frame(winstate, winstate->aggregatedupto, agg_row_slot)){
-				stillinframe = false;
-				break;
-			}
-			/* Set tuple context for evaluation of aggregate arguments */
-			winstate->tmpcontext->ecxt_outertuple = agg_row_slot;
-//#ifdef WIN_FUN_OPT
-		}
-//#endif
-		//InstrStopNode(winstate->instr_checkinframe_part,0);
+/*
+ * retreat_windowaggregates
+ * remove the rows from aggregatedbase up to the new frame head from all the
+ * aggregates
+ *
+ * Returns false if some aggregate could not remove a row, in which case the
+ * transition values are garbage and must be rebuilt from the frame head.
+ */
+static bool
+retreat_windowaggregates(WindowAggState *winstate)
+{
+	WindowObject agg_winobj = winstate->agg_winobj;
+	WindowStatePerAgg peraggstate;
+	int64		pos;
+	int			i;
 
-		if(!recompute_part_stoped){
-			recompute_cpu_started = true;
-			InstrStartNode(winstate->instr_recompute_cpu);
-		}
+	for (pos = winstate->aggregatedbase; pos < winstate->frameheadpos; pos++)
+	{
+		winstate->tmpcontext->ecxt_outertuple =
+			invtrans_gettupleslot(agg_winobj, pos);
+		WINAGG_SET_ARGPOS(winstate, pos);
 
-		/*
-		 * For single temporary transition value.
-		 */
-		if(enable_recompute && previous_frame_size>4 && winstate->frameheadpos != 0){
-			if(winstate->opt_active_tempTransValue>=0
-					&& winstate->aggregatedupto < agg_winobj->opt_tempStartPos[winstate->opt_active_tempTransValue])
+		for (i = 0; i < winstate->numaggs; i++)
+		{
+			peraggstate = &winstate->peragg[i];
+			if (!retreat_windowaggregate(winstate,
+										 &winstate->perfunc[peraggstate->wfuncno],
+										 peraggstate))
 			{
-				/* Accumulate row into the aggregates */
-				for (i = 0; i < numaggs; i++)
-				{
-					peraggstate = &winstate->peragg[i];
-					wfuncno = peraggstate->wfuncno;
-					advance_windowaggregate(winstate,
-											&winstate->perfunc[wfuncno],
-											peraggstate);
-				}
-			}else if(winstate->opt_active_tempTransValue<0){
-				int target;
-				/* for currentpos's use */
-				for (i = 0; i < numaggs; i++)
-				{
-					peraggstate = &winstate->peragg[i];
-					wfuncno = peraggstate->wfuncno;
-					advance_windowaggregate(winstate,
-											&winstate->perfunc[wfuncno],
-											peraggstate);
-				}
-				/* for future use */
-				for(target=0; target<winstate->opt_tempTransValue_num; target++){
-					if(winstate->aggregatedupto >= agg_winobj->opt_tempStartPos[target]){
-						for (i = 0; i < numaggs; i++)
-						{
-							peraggstate = &winstate->peragg[i];
-							wfuncno = peraggstate->wfuncno;
-							opt_temp_advance_windowaggregate(winstate,
-													&winstate->perfunc[wfuncno],
-													peraggstate,
-													target);
-						}
-						/*
-						 * save opt_tempTransEndPtr
-						 *
-						 * we can't do this out this loop,
-						 * because at that time the position is not the end position for temporary transition value.
-						 */
-						opt_tuplestore_copy_ptr(winstate->buffer, agg_winobj->opt_tempTransEndPtr[target], agg_winobj->readptr);
-						agg_winobj->opt_tempTransEndPos[target] = agg_winobj->seekpos; /* we must copy the seek position */
-						/*
-						 * if not in memory, we need to set the bufFile's offset to opt_tempTransEndPtr.
-						 *
-						 * NOTE: not just for on tape, but also for memory, or the answer will contains error
-						 */
-						opt_tuplestore_tell_ptr(winstate->buffer, agg_winobj->opt_tempTransEndPtr[target]);
-					}else{
-						break;	/* opt_tempStartPos[i+1] > opt_tempStartPos[i] */
-					}
-				}
-			}else{
 				ResetExprContext(winstate->tmpcontext);
-				if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-					ExecClearTuple(opt_agg_row_slot);
-				}else{
-					ExecClearTuple(agg_row_slot);
-				}
-				break;
-			}
-		}else{
-			for (i = 0; i < numaggs; i++)
-			{
-				peraggstate = &winstate->peragg[i];
-				wfuncno = peraggstate->wfuncno;
-				advance_windowaggregate(winstate,
-										&winstate->perfunc[wfuncno],
-										peraggstate);
+				winstate->opt_argepoch++;
+				return false;
 			}
 		}
 
 		/* Reset per-input-tuple context after each tuple */
 		ResetExprContext(winstate->tmpcontext);
+	}
 
-		/* And advance the aggregated-row state */
-		winstate->aggregatedupto++;
+	return true;
+}
 
-//#ifdef WIN_FUN_OPT
-		if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-			ExecClearTuple(opt_agg_row_slot);
-		}else{
-//#endif
-			ExecClearTuple(agg_row_slot);
-//#ifdef WIN_FUN_OPT
-		}
-//#endif
-		if(recompute_cpu_started){
-			InstrStopNode(winstate->instr_recompute_cpu, 0);
-			recompute_cpu_started = false;
-		}
+/*
+ * invtrans_gettupleslot
+ * fetch the row at pos for retreat_windowaggregates
+ *
+ * The rows leaving the frame are fetched strictly in order, so a forward-only
+ * read pointer that trails the frame head is enough, and a removal costs a
+ * single step instead of a seek back from aggregatedupto.
+ */
+static TupleTableSlot *
+invtrans_gettupleslot(WindowObject winobj, int64 pos)
+{
+	WindowAggState *winstate = winobj->winstate;
+	TupleTableSlot *slot;
+	MemoryContext oldcontext;
+	bool		found;
 
-		if(cpu_afterspooled_started){
-			InstrStopNode(winstate->instr_cpu_afterspooled, 0);
-			cpu_afterspooled_started = false;
-		}
+	/* rows leaving the frame have certainly been spooled already */
+	Assert(pos > winobj->opt_invtranspos && pos < winstate->spooled_rows);
+
+	oldcontext = MemoryContextSwitchTo(winstate->ss.ps.ps_ExprContext->ecxt_per_query_memory);
+
+	if (enable_winfunopt && !tuplestore_in_memory(winstate->buffer))
+	{
+		slot = winstate->opt_temp_slot_2;
+		opt_tuplestore_select_read_pointer(winstate->buffer, winobj->opt_invtransptr);
+	}
+	else
+	{
+		slot = winstate->temp_slot_2;
+		tuplestore_select_read_pointer(winstate->buffer, winobj->opt_invtransptr);
 	}
 
-	//if(enable_recompute && agg_winobj->opt_needTempTransValue){
-	if(enable_recompute && previous_frame_size>4){
-		/*
-		 * NOTE:
-		 * if winstate->opt_active_tempTransValue<0, means aggregatedupto already up to date.
-		 * if opt_tempTransEndPos==-1, means no temporary transition value to use.
-		 */
-		if(winstate->opt_active_tempTransValue>=0
-				&& winstate->agg_winobj->opt_tempTransEndPos[winstate->opt_active_tempTransValue] != -1)
-		{
-			/* copy the readptr from opt_tempTransEndPtr */
-			opt_copy_tempTransEndPtr(agg_winobj, winstate->opt_active_tempTransValue);
-			/*
-			 * After combine the transition values, we need to set the aggregatedupto value.
-			 *
-			 * NOTE: here must +1, aggregatedupto means the position of the next tuple to aggregate,
-			 * while opt_tempTransEndPos comes from seekpos, that is the position of the last tuple.
-			 */
-			//winstate->aggregatedupto = agg_winobj->opt_tempTransEndPos;
-			winstate->aggregatedupto = agg_winobj->opt_tempTransEndPos[winstate->opt_active_tempTransValue]+1;
-			/* Compute the tuples after opt_tempTransEndPos */
-			opt_eval_tempTransEnd(winstate);
-		}
+	/* skip over rows that went away with a restart */
+	while (winobj->opt_invtranspos < pos - 1)
+	{
+		if (enable_winfunopt)
+			found = opt_tuplestore_advance(winstate->buffer, true);
+		else
+			found = tuplestore_advance(winstate->buffer, true);
+		if (!found)
+			elog(ERROR, "unexpected end of tuplestore");
+		winobj->opt_invtranspos++;
 	}
 
-	/*
-	 * by cywang
-	 *
-	 * the instruments may no stop in the upper for loop,
-	 * need to check here.
-	 */
-	if(io_afterspooled_started){
-		InstrStopNode(winstate->instr_io_afterspooled, 0);
-		io_afterspooled_started = false;
-	}
-	if(framehead_updated){
-		framehead_updated = false;
-		opt_tuplestore_set_locateheadpos(winstate->buffer, false);
-		InstrStopNode(winstate->instr_locateheadpos_part, 0);
-	}
-	if(!recompute_part_stoped){
-		recompute_part_stoped = true;
-		InstrStopNode(winstate->instr_recompute_part, 0);
-	}
-	if(!stillinframe){
-		//InstrStopNode(winstate->instr_checkinframe_part, 0);
-	}
-	if(cpu_afterspooled_started){
-		InstrStopNode(winstate->instr_cpu_afterspooled, 0);
-		cpu_afterspooled_started = false;
-	}
-
-	/*
-	 * finalize aggregates and fill result/isnull fields.
-	 */
-	for (i = 0; i < numaggs; i++)
-	{
-		Datum	   *result;
-		bool	   *isnull;
-
-		peraggstate = &winstate->peragg[i];
-		wfuncno = peraggstate->wfuncno;
-		result = &econtext->ecxt_aggvalues[wfuncno];
-		isnull = &econtext->ecxt_aggnulls[wfuncno];
-		finalize_windowaggregate(winstate,
-								 &winstate->perfunc[wfuncno],
-								 peraggstate,
-								 result, isnull);
-
-		/*
-		 * save the result in case next row shares the same frame.
-		 *
-		 * XXX in some framing modes, eg ROWS/END_CURRENT_ROW, we can know in
-		 * advance that the next row can't possibly share the same frame. Is
-		 * it worth detecting that and skipping this code?
-		 */
-		if (!peraggstate->resulttypeByVal)
-		{
-			/*
-			 * clear old resultValue in order not to leak memory.  (Note: the
-			 * new result can't possibly be the same datum as old resultValue,
-			 * because we never passed it to the trans function.)
-			 */
-			if (!peraggstate->resultValueIsNull)
-				pfree(DatumGetPointer(peraggstate->resultValue));
+	if (enable_winfunopt && !tuplestore_in_memory(winstate->buffer))
+		found = opt_tuplestore_gettupleslot(winstate->buffer, true, true, slot);
+	else
+		found = tuplestore_gettupleslot(winstate->buffer, true, true, slot);
+	if (!found)
+		elog(ERROR, "unexpected end of tuplestore");
+	winobj->opt_invtranspos++;
 
-			/*
-			 * If pass-by-ref, copy it into our aggregate context.
-			 */
-			if (!*isnull)
-			{
-				oldContext = MemoryContextSwitchTo(winstate->aggcontext);
-				peraggstate->resultValue =
-					datumCopy(*result,
-							  peraggstate->resulttypeByVal,
-							  peraggstate->resulttypeLen);
-				MemoryContextSwitchTo(oldContext);
-			}
-		}
-		else
-		{
-			peraggstate->resultValue = *result;
-		}
-		peraggstate->resultValueIsNull = *isnull;
-	}
+	MemoryContextSwitchTo(oldcontext);
 
+	return slot;
 }
 
 /*
- * eval_windowfunction
+ * combine_windowaggregate
+ * merge a partial transition value, computed over rows that follow those
+ * already aggregated, into the aggregate's transition value
  *
- * Arguments of window functions are not evaluated here, because a window
- * function can need random access to arbitrary rows in the partition.
- * The window function uses the special WinGetFuncArgInPartition and
- * WinGetFuncArgInFrame functions to evaluate the arguments for the rows
- * it wants.
+ * A strict combine function is not called with a NULL on either side; a NULL
+ * partial value means no rows were aggregated into it.  The combine function
+ * may scribble on its first argument, which is always our own transValue,
+ * but never on the second.
  */
 static void
-eval_windowfunction(WindowAggState *winstate, WindowStatePerFunc perfuncstate,
-					Datum *result, bool *isnull)
+combine_windowaggregate(WindowAggState *winstate,
+						WindowStatePerFunc perfuncstate,
+						WindowStatePerAgg peraggstate,
+						Datum value, bool isnull)
 {
 	FunctionCallInfoData fcinfo;
+	Datum		newVal;
 	MemoryContext oldContext;
 
-	oldContext = MemoryContextSwitchTo(winstate->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
+	if (peraggstate->combinefn.fn_strict)
+	{
+		if (isnull)
+			return;
+		if (peraggstate->transValueIsNull)
+		{
+			oldContext = MemoryContextSwitchTo(winstate->aggcontext);
+			peraggstate->transValue = datumCopy(value,
+												peraggstate->transtypeByVal,
+												peraggstate->transtypeLen);
+			MemoryContextSwitchTo(oldContext);
+			peraggstate->transValueIsNull = false;
+			peraggstate->noTransValue = false;
+			return;
+		}
+	}
 
-	/*
-	 * We don't pass any normal arguments to a window function, but we do pass
-	 * it the number of arguments, in order to permit window function
-	 * implementations to support varying numbers of arguments.  The real info
-	 * goes through the WindowObject, which is passed via fcinfo->context.
-	 */
-	InitFunctionCallInfoData(fcinfo, &(perfuncstate->flinfo),
-							 perfuncstate->numArguments,
-							 perfuncstate->winCollation,
-							 (void *) perfuncstate->winobj, NULL);
-	/* Just in case, make all the regular argument slots be null */
-	memset(fcinfo.argnull, true, perfuncstate->numArguments);
+	oldContext = MemoryContextSwitchTo(winstate->tmpcontext->ecxt_per_tuple_memory);
 
-	*result = FunctionCallInvoke(&fcinfo);
-	*isnull = fcinfo.isnull;
+	InitFunctionCallInfoData(fcinfo, &(peraggstate->combinefn), 2,
+							 perfuncstate->winCollation,
+							 (void *) winstate, NULL);
+	fcinfo.arg[0] = peraggstate->transValue;
+	fcinfo.argnull[0] = peraggstate->transValueIsNull;
+	fcinfo.arg[1] = value;
+	fcinfo.argnull[1] = isnull;
+	newVal = FunctionCallInvoke(&fcinfo);
 
 	/*
-	 * Make sure pass-by-ref data is allocated in the appropriate context. (We
-	 * need this in case the function returns a pointer into some short-lived
-	 * tuple, as is entirely possible.)
+	 * same copying rules as advance_windowaggregate; note the result may be
+	 * the second argument, which belongs to the segment tree.
 	 */
-	if (!perfuncstate->resulttypeByVal && !fcinfo.isnull &&
-		!MemoryContextContains(CurrentMemoryContext,
-							   DatumGetPointer(*result)))
-		*result = datumCopy(*result,
-							perfuncstate->resulttypeByVal,
-							perfuncstate->resulttypeLen);
+	if (!peraggstate->transtypeByVal &&
+		DatumGetPointer(newVal) != DatumGetPointer(peraggstate->transValue))
+	{
+		if (!fcinfo.isnull)
+		{
+			MemoryContextSwitchTo(winstate->aggcontext);
+			newVal = datumCopy(newVal,
+							   peraggstate->transtypeByVal,
+							   peraggstate->transtypeLen);
+		}
+		if (!peraggstate->transValueIsNull)
+			pfree(DatumGetPointer(peraggstate->transValue));
+	}
 
 	MemoryContextSwitchTo(oldContext);
+	peraggstate->transValue = newVal;
+	peraggstate->transValueIsNull = fcinfo.isnull;
+	peraggstate->noTransValue = fcinfo.isnull;
 }
 
 /*
- * begin_partition
- * Start buffering rows of the next partition.
+ * segtree_gettupleslot
+ * fetch the row at pos into the aggregate row slot, and return the slot the
+ * aggregate arguments are to be evaluated against
  */
-static void
-begin_partition(WindowAggState *winstate)
+static TupleTableSlot *
+segtree_gettupleslot(WindowObject winobj, int64 pos)
 {
-	PlanState  *outerPlan = outerPlanState(winstate);
-	int			numfuncs = winstate->numfuncs;
-	int			i;
+	WindowAggState *winstate = winobj->winstate;
 
+	if (enable_winfunopt)
+	{
+		if (!opt_window_gettupleslot(winobj, pos, winstate->agg_row_slot,
+									 winstate->opt_agg_row_slot))
+			elog(ERROR, "unexpected end of tuplestore");
+		if (!tuplestore_in_memory(winstate->buffer))
+			return winstate->opt_agg_row_slot;
+	}
+	else if (!window_gettupleslot(winobj, pos, winstate->agg_row_slot))
+		elog(ERROR, "unexpected end of tuplestore");
 
-	winstate->partition_spooled = false;
-	winstate->framehead_valid = false;
-	winstate->frametail_valid = false;
-	winstate->spooled_rows = 0;
-	winstate->currentpos = 0;
-	winstate->frameheadpos = 0;
-	winstate->frametailpos = -1;
-	ExecClearTuple(winstate->agg_row_slot);
+	return winstate->agg_row_slot;
+}
 
-	/*
-	 * If this is the very first partition, we need to fetch the first input
-	 * row to store in first_part_slot.
-	 */
-	if (TupIsNull(winstate->first_part_slot))
+/*
+ * segtree_advance_rows
+ * accumulate the rows from 'from' up to, but not including, 'to' into all
+ * the aggregates, reading them through winobj
+ */
+static void
+segtree_advance_rows(WindowAggState *winstate, WindowObject winobj,
+					 int64 from, int64 to)
+{
+	WindowStatePerAgg peraggstate;
+	int64		pos;
+	int			i;
+
+	if (winstate->opt_use_batch)
 	{
-		TupleTableSlot *outerslot;
+		int64		end = to;
 
-		InstrStartNode(winstate->instr_total_part);
+		/* the rows are in the frame; take those in all the column buffers */
+		for (i = 0; i < winstate->numaggs; i++)
+		{
+			peraggstate = &winstate->peragg[i];
+			if (peraggstate->opt_batchkind != WINBATCH_COUNT_STAR)
+				end = Min(end, WINAGG_ARGSOURCE(peraggstate)->opt_colrows);
+		}
+		if (end > from)
+		{
+			advance_windowaggregates_batch(winstate, from, end);
+			from = end;
+		}
+	}
 
-		outerslot = ExecProcNode(outerPlan);
+	for (pos = from; pos < to; pos++)
+	{
+		winstate->tmpcontext->ecxt_outertuple = segtree_gettupleslot(winobj, pos);
+		WINAGG_SET_ARGPOS(winstate, pos);
 
-		if (!TupIsNull(outerslot))
-			ExecCopySlot(winstate->first_part_slot, outerslot);
-		else
+		for (i = 0; i < winstate->numaggs; i++)
 		{
-			/* outer plan is empty, so we have nothing to do */
-			winstate->partition_spooled = true;
-			winstate->more_partitions = false;
-			return;
+			peraggstate = &winstate->peragg[i];
+			advance_windowaggregate(winstate,
+									&winstate->perfunc[peraggstate->wfuncno],
+									peraggstate);
 		}
 
-		InstrStopNode(winstate->instr_total_part, 0);
-		printf("sort: %f seconds \n", INSTR_TIME_GET_DOUBLE(winstate->instr_total_part->counter));
-		INSTR_TIME_SET_ZERO(winstate->instr_total_part->counter);
+		/* Reset per-input-tuple context after each tuple */
+		ResetExprContext(winstate->tmpcontext);
 	}
+}
 
-	printf("\n#####begin partition:\n");
-	InstrStartNode(winstate->instr_total_part);
+/*
+ * estimate_transvalue_space
+ * estimate the space of one transition value of every aggregate
+ */
+static Size
+estimate_transvalue_space(WindowAggState *winstate)
+{
+	WindowStatePerAgg peraggstate;
+	Size		space = 0;
+	int			j;
 
-	/* Create new tuplestore for this partition */
-	winstate->buffer = tuplestore_begin_heap(false, false, work_mem);
+	for (j = 0; j < winstate->numaggs; j++)
+	{
+		peraggstate = &winstate->peragg[j];
+		space += sizeof(Datum) + sizeof(bool);
+		if (!peraggstate->transtypeByVal)
+		{
+			if (peraggstate->transtypeLen > 0)
+				space += MAXALIGN(peraggstate->transtypeLen);
+			else
+				space += MAXALIGN(get_typavgwidth(peraggstate->transtype, -1));
+			/* allow for the palloc chunk header */
+			space += 2 * sizeof(void *);
+		}
+	}
+	return space;
+}
 
-//#ifdef WIN_FUN_OPT
-	if(enable_winfunopt){
-		/*
-		 * set the attribute of the buffer that its functions can only access in its own scope
-		 */
-		//tuplestore_set_opt(winstate->buffer, winstate);
-		tuplestore_init_opt(winstate->buffer, winstate->opt_tupdesc, winstate->useful2init, winstate->opt_maxPos, winstate->buffer_slot);
+/*
+ * segtree_store_node
+ * save the aggregates' current transition values as node i of the tree
+ *
+ * If replace is true, the node may already hold values, which are freed.
+ */
+static void
+segtree_store_node(WindowAggState *winstate, int64 i, bool replace)
+{
+	WindowStatePerAgg peraggstate;
+	MemoryContext oldContext;
+	int			j;
 
-		tuplestore_convert_to_opt(winstate->buffer, winstate->first_part_slot, winstate->opt_first_part_slot);
+	oldContext = MemoryContextSwitchTo(winstate->partcontext);
+	for (j = 0; j < winstate->numaggs; j++)
+	{
+		peraggstate = &winstate->peragg[j];
+		if (replace && !winstate->opt_segtree_empty[i] &&
+			!peraggstate->transtypeByVal && !peraggstate->segtree_nulls[i])
+			pfree(DatumGetPointer(peraggstate->segtree_values[i]));
+
+		peraggstate->segtree_nulls[i] = peraggstate->transValueIsNull;
+		if (peraggstate->transValueIsNull)
+			peraggstate->segtree_values[i] = (Datum) 0;
+		else
+			peraggstate->segtree_values[i] =
+				datumCopy(peraggstate->transValue,
+						  peraggstate->transtypeByVal,
+						  peraggstate->transtypeLen);
 	}
-//#endif
-	/*
-	 * Set up read pointers for the tuplestore.  The current pointer doesn't
-	 * need BACKWARD capability, but the per-window-function read pointers do,
-	 * and the aggregate pointer does if frame start is movable.
-	 */
-	winstate->current_ptr = 0;	/* read pointer 0 is pre-allocated */
+	MemoryContextSwitchTo(oldContext);
+	winstate->opt_segtree_empty[i] = false;
+}
 
-	/* reset default REWIND capability bit for current ptr */
-	tuplestore_set_eflags(winstate->buffer, 0);
+/*
+ * segtree_update_node
+ * recompute inner node i of the tree as the combination of its children
+ *
+ * A node whose left child is empty is empty; one whose right child is empty
+ * is a copy of its left child.
+ */
+static void
+segtree_update_node(WindowAggState *winstate, int64 i, bool replace)
+{
+	WindowStatePerAgg peraggstate;
+	MemoryContext oldContext;
+	int			j;
 
-	/* create read pointers for aggregates, if needed */
-	if (winstate->numaggs > 0)
+	if (winstate->opt_segtree_empty[2 * i])
 	{
-		WindowObject agg_winobj = winstate->agg_winobj;
-		int			readptr_flags = 0;
+		Assert(!replace || winstate->opt_segtree_empty[i]);
+		winstate->opt_segtree_empty[i] = true;
+		return;
+	}
 
-		/* If the frame head is potentially movable ... */
-		if (!(winstate->frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING))
+	MemoryContextResetAndDeleteChildren(winstate->aggcontext);
+	for (j = 0; j < winstate->numaggs; j++)
+	{
+		peraggstate = &winstate->peragg[j];
+
+		/* start from a private copy of the left child ... */
+		peraggstate->transValueIsNull = peraggstate->segtree_nulls[2 * i];
+		peraggstate->noTransValue = peraggstate->transValueIsNull;
+		if (peraggstate->transValueIsNull)
+			peraggstate->transValue = (Datum) 0;
+		else
 		{
-			/* ... create a mark pointer to track the frame head */
-			agg_winobj->markptr = tuplestore_alloc_read_pointer(winstate->buffer, 0);
-			/* and the read pointer will need BACKWARD capability */
-			readptr_flags |= EXEC_FLAG_BACKWARD;
+			oldContext = MemoryContextSwitchTo(winstate->aggcontext);
+			peraggstate->transValue =
+				datumCopy(peraggstate->segtree_values[2 * i],
+						  peraggstate->transtypeByVal,
+						  peraggstate->transtypeLen);
+			MemoryContextSwitchTo(oldContext);
 		}
 
-		agg_winobj->readptr = tuplestore_alloc_read_pointer(winstate->buffer,
-															readptr_flags);
-		agg_winobj->markpos = -1;
-		agg_winobj->seekpos = -1;
-
-		/* Also reset the row counters for aggregates */
-		winstate->aggregatedbase = 0;
-		winstate->aggregatedupto = 0;
-
-		/*
-		 * by cywang
-		 * the frame head read pointer is pro-allocated
-		 *
-		 * NOTE: currently, only one for aggregates,
-		 * if window function needs, we can allocate one for each window object
-		 */
-		if(enable_locate){
-			agg_winobj->opt_frameheadptr = tuplestore_alloc_read_pointer(winstate->buffer, 0);	/* only need forward */
-			agg_winobj->opt_frameheadpos = -1;
-		}
-		/*
-		 * by cywang
-		 *
-		 * for temporary transition value's end position
-		 */
-		if(enable_recompute){
-			for(i=0; i<winstate->opt_tempTransValue_num; i++){
-				agg_winobj->opt_tempTransEndPtr[i] = tuplestore_alloc_read_pointer(winstate->buffer, 0);
-				agg_winobj->opt_tempTransEndPos[i] = -1;
-			}
-		}
+		/* ... and merge the right child into it */
+		if (!winstate->opt_segtree_empty[2 * i + 1])
+			combine_windowaggregate(winstate,
+									&winstate->perfunc[peraggstate->wfuncno],
+									peraggstate,
+									peraggstate->segtree_values[2 * i + 1],
+									peraggstate->segtree_nulls[2 * i + 1]);
+		ResetExprContext(winstate->tmpcontext);
 	}
 
-	/* create mark and read pointers for each real window function */
-	for (i = 0; i < numfuncs; i++)
-	{
-		WindowStatePerFunc perfuncstate = &(winstate->perfunc[i]);
+	segtree_store_node(winstate, i, replace);
+}
 
-		if (!perfuncstate->plain_agg)
-		{
-			WindowObject winobj = perfuncstate->winobj;
+/*
+ * segtree_cover
+ * append to nodes[] the tree nodes that exactly cover leaves [l, r), in
+ * leaf order
+ */
+static void
+segtree_cover(int64 size, int64 l, int64 r, int64 *nodes, int *nnodes)
+{
+	int64		right[64];
+	int			nright = 0;
 
-			winobj->markptr = tuplestore_alloc_read_pointer(winstate->buffer,
-															0);
-			winobj->readptr = tuplestore_alloc_read_pointer(winstate->buffer,
-														 EXEC_FLAG_BACKWARD);
-			winobj->markpos = -1;
-			winobj->seekpos = -1;
-		}
+	l += size;
+	r += size;
+	while (l < r)
+	{
+		if (l & 1)
+			nodes[(*nnodes)++] = l++;
+		if (r & 1)
+			right[nright++] = --r;
+		l >>= 1;
+		r >>= 1;
 	}
+	while (nright > 0)
+		nodes[(*nnodes)++] = right[--nright];
+}
 
-	/*
-	 * Store the first tuple into the tuplestore (it's always available now;
-	 * we either read it above, or saved it at the end of previous partition)
-	 */
-//#ifdef WIN_FUN_OPT
-	if(enable_winfunopt){
-		opt_tuplestore_puttupleslot(winstate->buffer, winstate->first_part_slot);
-		/* just in case */
-		if(!tuplestore_in_memory(winstate->buffer))
-			opt_tuplestore_updatewritepos(winstate->buffer);
-	}else{
-//#else
-		tuplestore_puttupleslot(winstate->buffer, winstate->first_part_slot);
+/*
+ * segtree_ring_size
+ * decide whether the tree can be a ring over the frame's rows only
+ *
+ * That is possible for a ROWS frame whose both ends are a fixed number of
+ * rows away from the current row: then no frame is wider than the distance
+ * between the two offsets, and the tree needs just that many leaves, reused
+ * in turn as the frame moves on.  Returns the number of leaves, a power of
+ * 2, or 0 if the frame is not bounded that way or the ring would not fit in
+ * work_mem.
+ */
+static int64
+segtree_ring_size(WindowAggState *winstate, Size nodespace)
+{
+	int			frameOptions = winstate->frameOptions;
+	double		head;
+	double		tail;
+	int64		size;
+
+	if (!(frameOptions & FRAMEOPTION_ROWS) ||
+		(frameOptions & (FRAMEOPTION_START_UNBOUNDED_PRECEDING |
+						 FRAMEOPTION_END_UNBOUNDED_FOLLOWING)))
+		return 0;
+
+	/* the frame ends relative to the current row */
+	head = tail = 0;
+	if (frameOptions & FRAMEOPTION_START_VALUE)
+	{
+		head = (double) DatumGetInt64(winstate->startOffsetValue);
+		if (frameOptions & FRAMEOPTION_START_VALUE_PRECEDING)
+			head = -head;
+	}
+	if (frameOptions & FRAMEOPTION_END_VALUE)
+	{
+		tail = (double) DatumGetInt64(winstate->endOffsetValue);
+		if (frameOptions & FRAMEOPTION_END_VALUE_PRECEDING)
+			tail = -tail;
 	}
-//#endif
 
-	winstate->spooled_rows++;
+	/* check the width before it could overflow an int64 */
+	if ((tail - head + 1) * 2 * nodespace > (double) work_mem * 1024L)
+		return 0;
+
+	size = 1;
+	while (size < tail - head + 1)
+		size *= 2;
+	if ((double) 2 * size * nodespace > (double) work_mem * 1024L)
+		return 0;
+	return size;
 }
 
 /*
- * Read tuples from the outer node, up to and including position 'pos', and
- * store them into the tuplestore. If pos is -1, reads the whole partition.
+ * segtree_ring_fill
+ * add the rows up to, but not including, 'frameend' to the ring
+ *
+ * Each row replaces the leaf of the row 'size' rows before it, which is
+ * already behind the frame head, and the leaf's ancestors are recomputed.
  */
 static void
-spool_tuples(WindowAggState *winstate, int64 pos)
+segtree_ring_fill(WindowAggState *winstate, int64 frameend)
 {
-	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
-	PlanState  *outerPlan;
-	TupleTableSlot *outerslot;
-	MemoryContext oldcontext;
-
-	if (!winstate->buffer)
-		return;					/* just a safety check */
-	if (winstate->partition_spooled)
-		return;					/* whole partition done already */
-
-	/*
-	 * If the tuplestore has spilled to disk, alternate reading and writing
-	 * becomes quite expensive due to frequent buffer flushes.	It's cheaper
-	 * to force the entire partition to get spooled in one go.
-	 *
-	 * XXX this is a horrid kluge --- it'd be better to fix the performance
-	 * problem inside tuplestore.  FIXME
-	 */
-	if (!tuplestore_in_memory(winstate->buffer))
-		pos = -1;
-
-	outerPlan = outerPlanState(winstate);
+	WindowStatePerAgg peraggstate;
+	int64		size = winstate->opt_segtree_size;
+	int64		pos;
+	int64		i;
+	int			j;
 
-	/* Must be in query context to call outerplan */
-	oldcontext = MemoryContextSwitchTo(winstate->ss.ps.ps_ExprContext->ecxt_per_query_memory);
+	/* rows that left the frame before they entered the ring */
+	if (winstate->opt_segtree_ringupto < frameend - size)
+		winstate->opt_segtree_ringupto = frameend - size;
 
-	while (winstate->spooled_rows <= pos || pos == -1)
+	for (pos = winstate->opt_segtree_ringupto; pos < frameend; pos++)
 	{
-		outerslot = ExecProcNode(outerPlan);
-		if (TupIsNull(outerslot))
-		{
-			/* reached the end of the last partition */
-			winstate->partition_spooled = true;
-			winstate->more_partitions = false;
-			break;
-		}
-
-		if (node->partNumCols > 0)
+		MemoryContextResetAndDeleteChildren(winstate->aggcontext);
+		for (j = 0; j < winstate->numaggs; j++)
 		{
-			/* Check if this tuple still belongs to the current partition */
-			if (!execTuplesMatch(winstate->first_part_slot,
-								 outerslot,
-								 node->partNumCols, node->partColIdx,
-								 winstate->partEqfunctions,
-								 winstate->tmpcontext->ecxt_per_tuple_memory))
-			{
-				/*
-				 * end of partition; copy the tuple for the next cycle.
-				 */
-				ExecCopySlot(winstate->first_part_slot, outerslot);
-				winstate->partition_spooled = true;
-				winstate->more_partitions = true;
-				break;
-			}
+			peraggstate = &winstate->peragg[j];
+			initialize_windowaggregate(winstate,
+									   &winstate->perfunc[peraggstate->wfuncno],
+									   peraggstate);
 		}
+		segtree_advance_rows(winstate, winstate->opt_segtree_winobj,
+							 pos, pos + 1);
 
-		/* Still in partition, so save it into the tuplestore */
-//#ifdef WIN_FUN_OPT
-		if(enable_winfunopt)
-			opt_tuplestore_puttupleslot(winstate->buffer, outerslot);
-//#else
-		else
-			tuplestore_puttupleslot(winstate->buffer, outerslot);
-//#endif
-		winstate->spooled_rows++;
-	}
-
-	if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-		opt_tuplestore_updatewritepos(winstate->buffer);
+		i = size + pos % size;
+		segtree_store_node(winstate, i, true);
+		for (i >>= 1; i >= 1; i >>= 1)
+			segtree_update_node(winstate, i, true);
 	}
-	MemoryContextSwitchTo(oldcontext);
+	winstate->opt_segtree_ringupto = Max(winstate->opt_segtree_ringupto,
+										 frameend);
 }
 
 /*
- * release_partition
- * clear information kept within a partition, including
- * tuplestore and aggregate results.
+ * build_segtree
+ * build the segment tree of transition values for the partition
+ *
+ * Each leaf holds the transition value of a block of consecutive rows, and
+ * each inner node the combination of its two children.  If the frame is
+ * bounded by row offsets on both ends, the tree is a ring holding only the
+ * rows of the latest frames, filled as the frame moves on, so the partition
+ * is read no further ahead than the frame tail; see segtree_ring_size().
+ * Otherwise it covers the whole partition.  The blocks are then one row
+ * each, unless the tree would not fit in work_mem; then the block size is
+ * doubled until it does, and the rows of a frame that only partly cover a
+ * block are aggregated one by one.  The tree lives in partcontext, so it
+ * goes away with the partition.
  */
 static void
-release_partition(WindowAggState *winstate)
+build_segtree(WindowAggState *winstate)
 {
-	int			i;
-
-	for (i = 0; i < winstate->numfuncs; i++)
+	WindowStatePerAgg peraggstate;
+	MemoryContext oldContext;
+	int64		nrows;
+	int64		blocksize;
+	int64		nleaves;
+	int64		size;
+	Size		nodespace;
+	int64		i;
+	int			j;
+
+	/* the space of one node, over all the aggregates */
+	nodespace = sizeof(bool) + estimate_transvalue_space(winstate);
+	nrows = 0;
+
+	size = segtree_ring_size(winstate, nodespace);
+	winstate->opt_segtree_ring = (size > 0);
+	if (winstate->opt_segtree_ring)
 	{
-		WindowStatePerFunc perfuncstate = &(winstate->perfunc[i]);
-
-		/* Release any partition-local state of this window function */
-		if (perfuncstate->winobj)
-			perfuncstate->winobj->localmem = NULL;
+		/* the leaves are filled in as the frame tail reaches them */
+		blocksize = 1;
+		nleaves = size;
+		winstate->opt_segtree_ringupto = 0;
 	}
+	else
+	{
+		/* the tree covers the whole partition */
+		spool_tuples(winstate, -1);
+		nrows = winstate->spooled_rows;
 
-	/*
-	 * Release all partition-local memory (in particular, any partition-local
-	 * state that we might have trashed our pointers to in the above loop, and
-	 * any aggregate temp data).  We don't rely on retail pfree because some
-	 * aggregates might have allocated data we don't have direct pointers to.
-	 */
-	MemoryContextResetAndDeleteChildren(winstate->partcontext);
-	MemoryContextResetAndDeleteChildren(winstate->aggcontext);
-
-	if (winstate->buffer){
-		/* by cywang */
-		opt_tuplestore_instr_BufFile(winstate->buffer);
-		opt_tuplestore_instr_TupleStore(winstate->buffer);
-
-		if(enable_reusebuffer)
-			reuse_tuplestore_clear(winstate->buffer);
-
-//#ifdef WIN_FUN_OPT
-		if(enable_winfunopt)
-			opt_tuplestore_end(winstate->buffer);
-//#else
-		else
-			tuplestore_end(winstate->buffer);
-//#endif
+		blocksize = 1;
+		for (;;)
+		{
+			nleaves = (nrows + blocksize - 1) / blocksize;
+			size = 1;
+			while (size < nleaves)
+				size *= 2;
+			if (blocksize >= nrows ||
+				(double) 2 * size * nodespace <= (double) work_mem * 1024L)
+				break;
+			blocksize *= 2;
+		}
 	}
 
-	/*
-	 * output the time cost, and reset the time's counter
-	 */
-	//printf("WindowAgg, checking in frame: %f seconds \n", INSTR_TIME_GET_DOUBLE(winstate->instr_checkinframe_part->counter));
-	//INSTR_TIME_SET_ZERO(winstate->instr_checkinframe_part->counter);
+	winstate->opt_segtree_blocksize = blocksize;
+	winstate->opt_segtree_nleaves = nleaves;
+	winstate->opt_segtree_size = size;
 
-	printf("WindowAgg, locating the head position: %f seconds \n", INSTR_TIME_GET_DOUBLE(winstate->instr_locateheadpos_part->counter));
-	INSTR_TIME_SET_ZERO(winstate->instr_locateheadpos_part->counter);
+	oldContext = MemoryContextSwitchTo(winstate->partcontext);
+	winstate->opt_segtree_empty = (bool *) palloc0(2 * size * sizeof(bool));
+	for (j = 0; j < winstate->numaggs; j++)
+	{
+		peraggstate = &winstate->peragg[j];
+		peraggstate->segtree_values = (Datum *) palloc(2 * size * sizeof(Datum));
+		peraggstate->segtree_nulls = (bool *) palloc(2 * size * sizeof(bool));
+	}
+	MemoryContextSwitchTo(oldContext);
 
-	printf("WindowAgg, CPU cost of computing after spooled: %f seconds \n", INSTR_TIME_GET_DOUBLE(winstate->instr_cpu_afterspooled->counter));
-	INSTR_TIME_SET_ZERO(winstate->instr_cpu_afterspooled->counter);
+	if (winstate->opt_segtree_ring)
+		memset(winstate->opt_segtree_empty, true, 2 * size * sizeof(bool));
 
-	printf("WindowAgg, IO cost of computing after spooled: %f seconds \n", INSTR_TIME_GET_DOUBLE(winstate->instr_io_afterspooled->counter));
-	INSTR_TIME_SET_ZERO(winstate->instr_io_afterspooled->counter);
+	/* the leaves; rows are read in order through the frame tail reader */
+	for (i = 0; i < size && !winstate->opt_segtree_ring; i++)
+	{
+		if (i >= nleaves)
+		{
+			winstate->opt_segtree_empty[size + i] = true;
+			continue;
+		}
 
-	printf("WindowAgg, recomputing during a partition: %f seconds \n", INSTR_TIME_GET_DOUBLE(winstate->instr_recompute_part->counter));
-	INSTR_TIME_SET_ZERO(winstate->instr_recompute_part->counter);
+		MemoryContextResetAndDeleteChildren(winstate->aggcontext);
+		for (j = 0; j < winstate->numaggs; j++)
+		{
+			peraggstate = &winstate->peragg[j];
+			initialize_windowaggregate(winstate,
+									   &winstate->perfunc[peraggstate->wfuncno],
+									   peraggstate);
+		}
 
-	//printf("WindowAgg, setting mark position: %f seconds \n", INSTR_TIME_GET_DOUBLE(winstate->instr_setmarkpos_part->counter));
-	//INSTR_TIME_SET_ZERO(winstate->instr_setmarkpos_part->counter);
+		segtree_advance_rows(winstate, winstate->opt_segtree_winobj,
+							 i * blocksize,
+							 Min((i + 1) * blocksize, nrows));
 
-	printf("WindowAgg, CPU cost of recomputing: %f seconds \n", INSTR_TIME_GET_DOUBLE(winstate->instr_recompute_cpu->counter));
-	INSTR_TIME_SET_ZERO(winstate->instr_recompute_cpu->counter);
+		segtree_store_node(winstate, size + i, false);
+	}
 
-	InstrStopNode(winstate->instr_total_part, 0);
-	printf("WindowAgg, execution time of partition: %f seconds \n", INSTR_TIME_GET_DOUBLE(winstate->instr_total_part->counter));
-	INSTR_TIME_SET_ZERO(winstate->instr_total_part->counter);
+	/* the inner nodes, bottom up */
+	for (i = size - 1; i >= 1 && !winstate->opt_segtree_ring; i--)
+		segtree_update_node(winstate, i, false);
 
-	printf("#####release partition\n");
+	/* transValue and resultValue went away with aggcontext */
+	MemoryContextResetAndDeleteChildren(winstate->aggcontext);
+	for (j = 0; j < winstate->numaggs; j++)
+		winstate->peragg[j].resultValueIsNull = true;
 
-	winstate->buffer = NULL;
-	winstate->partition_spooled = false;
+	winstate->opt_segtree_built = true;
 }
 
 /*
- * row_is_in_frame
-		TupleTableSlot *outerslot = ExecProcNode(outerPlan);
- *
- * Determine whether a row is in the current row's window frame according
- * to our window framing rule
- *
- * The caller must have already determined that the row is in the partition
- * and fetched it into a slot.	This function just encapsulates the framing
- * rules.
+ * finalize_windowaggregate
+ * parallel to finalize_aggregate in nodeAgg.c
  */
-static bool
-row_is_in_frame(WindowAggState *winstate, int64 pos, TupleTableSlot *slot)
+static void
+finalize_windowaggregate(WindowAggState *winstate,
+						 WindowStatePerFunc perfuncstate,
+						 WindowStatePerAgg peraggstate,
+						 Datum *result, bool *isnull)
 {
-	int			frameOptions = winstate->frameOptions;
+	MemoryContext oldContext;
+	Datum		transValue = peraggstate->transValue;
+	bool		transValueIsNull = peraggstate->transValueIsNull;
 
-	Assert(pos >= 0);			/* else caller error */
+	oldContext = MemoryContextSwitchTo(winstate->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
 
-	/* First, check frame starting conditions */
-	if (frameOptions & FRAMEOPTION_START_CURRENT_ROW)
+	/* a shared aggregate has its source's transition value */
+	if (peraggstate->opt_statesource != NULL)
 	{
-		if (frameOptions & FRAMEOPTION_ROWS)
+		transValue = peraggstate->opt_statesource->transValue;
+		transValueIsNull = peraggstate->opt_statesource->transValueIsNull;
+	}
+
+	if (peraggstate->opt_statesource != NULL &&
+		peraggstate->opt_sharekind != WINSHARE_FINAL)
+	{
+		ArrayType  *transarray;
+		int64	   *transdata;
+
+		/* the {count, sum} of int2_avg_accum and int4_avg_accum */
+		transarray = DatumGetArrayTypeP(transValue);
+		if (ARR_HASNULL(transarray) ||
+			ARR_SIZE(transarray) != ARR_OVERHEAD_NONULLS(1) + 2 * sizeof(int64))
+			elog(ERROR, "expected 2-element int8 array");
+		transdata = (int64 *) ARR_DATA_PTR(transarray);
+
+		if (peraggstate->opt_sharekind == WINSHARE_COUNT_FROM_AVG)
 		{
-			/* rows before current row are out of frame */
-			if (pos < winstate->currentpos)
-				return false;
+			*result = Int64GetDatum(transdata[0]);
+			*isnull = false;
 		}
-		else if (frameOptions & FRAMEOPTION_RANGE)
+		else if (transdata[0] == 0)
 		{
-			/* preceding row that is not peer is out of frame */
-//#ifdef WIN_FUN_OPT
-			if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-				if (pos < winstate->currentpos &&
-					!are_peers(winstate, slot, winstate->opt_scantupslot))
-					return false;
-			}else{
-//#endif
-				if (pos < winstate->currentpos &&
-					!are_peers(winstate, slot, winstate->ss.ss_ScanTupleSlot))
-					return false;
-//#ifdef WIN_FUN_OPT
-			}
-//#endif
+			/* SQL defines SUM of no values to be NULL */
+			*result = (Datum) 0;
+			*isnull = true;
 		}
 		else
-			Assert(false);
+		{
+			*result = Int64GetDatum(transdata[1]);
+			*isnull = false;
+		}
 	}
-	else if (frameOptions & FRAMEOPTION_START_VALUE)
+	/*
+	 * Apply the agg's finalfn if one is provided, else return transValue.
+	 */
+	else if (OidIsValid(peraggstate->finalfn_oid))
 	{
-		if (frameOptions & FRAMEOPTION_ROWS)
-		{
-			int64		offset = DatumGetInt64(winstate->startOffsetValue);
-
-			/* rows before current row + offset are out of frame */
-			if (frameOptions & FRAMEOPTION_START_VALUE_PRECEDING)
-				offset = -offset;
+		FunctionCallInfoData fcinfo;
 
-			if (pos < winstate->currentpos + offset)
-				return false;
-		}
-		else if (frameOptions & FRAMEOPTION_RANGE)
+		InitFunctionCallInfoData(fcinfo, &(peraggstate->finalfn), 1,
+								 perfuncstate->winCollation,
+								 (void *) winstate, NULL);
+		fcinfo.arg[0] = transValue;
+		fcinfo.argnull[0] = transValueIsNull;
+		if (fcinfo.flinfo->fn_strict && transValueIsNull)
 		{
-			/* parser should have rejected this */
-			elog(ERROR, "window frame with value offset is not implemented");
+			/* don't call a strict function with NULL inputs */
+			*result = (Datum) 0;
+			*isnull = true;
 		}
 		else
-			Assert(false);
-	}
-
-	/* Okay so far, now check frame ending conditions */
-	if (frameOptions & FRAMEOPTION_END_CURRENT_ROW)
-	{
-		if (frameOptions & FRAMEOPTION_ROWS)
-		{
-			/* rows after current row are out of frame */
-			if (pos > winstate->currentpos)
-				return false;
-		}
-		else if (frameOptions & FRAMEOPTION_RANGE)
 		{
-			/* following row that is not peer is out of frame */
-//#ifdef WIN_FUN_OPT
-			if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-				if (pos > winstate->currentpos &&
-					!are_peers(winstate, slot, winstate->opt_scantupslot))
-					return false;
-			}else{
-//#endif
-				if (pos > winstate->currentpos &&
-					!are_peers(winstate, slot, winstate->ss.ss_ScanTupleSlot))
-					return false;
-//#ifdef WIN_FUN_OPT
-			}
-//#endif
+			*result = FunctionCallInvoke(&fcinfo);
+			*isnull = fcinfo.isnull;
 		}
-		else
-			Assert(false);
 	}
-	else if (frameOptions & FRAMEOPTION_END_VALUE)
+	else
 	{
-		if (frameOptions & FRAMEOPTION_ROWS)
-		{
-			int64		offset = DatumGetInt64(winstate->endOffsetValue);
-
-			/* rows after current row + offset are out of frame */
-			if (frameOptions & FRAMEOPTION_END_VALUE_PRECEDING)
-				offset = -offset;
-
-			if (pos > winstate->currentpos + offset)
-				return false;
-		}
-		else if (frameOptions & FRAMEOPTION_RANGE)
-		{
-			/* parser should have rejected this */
-			elog(ERROR, "window frame with value offset is not implemented");
-		}
-		else
-			Assert(false);
+		*result = transValue;
+		*isnull = transValueIsNull;
 	}
 
-	/* If we get here, it's in frame */
-	return true;
+	/*
+	 * If result is pass-by-ref, make sure it is in the right context.
+	 */
+	if (!peraggstate->resulttypeByVal && !*isnull &&
+		!MemoryContextContains(CurrentMemoryContext,
+							   DatumGetPointer(*result)))
+		*result = datumCopy(*result,
+							peraggstate->resulttypeByVal,
+							peraggstate->resulttypeLen);
+	MemoryContextSwitchTo(oldContext);
 }
 
 /*
- * update_frameheadpos
- * make frameheadpos valid for the current row
+ * eval_windowaggregates
+ * evaluate plain aggregates being used as window functions
  *
- * Uses the winobj's read pointer for any required fetches; hence, if the
- * frame mode is one that requires row comparisons, the winobj's mark must
- * not be past the currently known frame head.	Also uses the specified slot
- * for any required fetches.
+ * Much of this is duplicated from nodeAgg.c.  But NOTE that we expect to be
+ * able to call aggregate final functions repeatedly after aggregating more
+ * data onto the same transition value.  This is not a behavior required by
+ * nodeAgg.c.
  */
 static void
-update_frameheadpos(WindowObject winobj, TupleTableSlot *slot)
+eval_windowaggregates(WindowAggState *winstate)
 {
-	WindowAggState *winstate = winobj->winstate;
-	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
-	int			frameOptions = winstate->frameOptions;
+	WindowStatePerAgg peraggstate;
+	int			wfuncno,
+				numaggs;
+	int			i;
+	ExprContext *econtext;
+	WindowObject agg_winobj;
+	TupleTableSlot *agg_row_slot;
 
-	if (winstate->framehead_valid)
-		return;					/* already known for current row */
+//#ifdef WIN_FUN_OPT
+	TupleTableSlot	*opt_agg_row_slot = winstate->opt_agg_row_slot;
 
-	if (frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING)
+	/* the following is some flags for computing the time cost */
+	bool			recompute_part_stoped = true;
+	bool			framehead_updated = false;
+	bool			stillinframe = true;
+	int64			pre_upto = winstate->aggregatedupto;
+
+	/* the following is for reducing recompute */
+	bool			need_compute_temp_trans = false;
+	int64 			previous_frame_size = 0;
+	//bool			need_combine = false;
+//#endif
+	bool			rows_removed = false;
+
+	numaggs = winstate->numaggs;
+	if (numaggs == 0)
+		return;					/* nothing to do */
+
+	if (winstate->opt_use_segtree)
 	{
-		/* In UNBOUNDED PRECEDING mode, frame head is always row 0 */
-		winstate->frameheadpos = 0;
-		winstate->framehead_valid = true;
+		eval_windowaggregates_segtree(winstate);
+		return;
 	}
-	else if (frameOptions & FRAMEOPTION_START_CURRENT_ROW)
-	{
-		if (frameOptions & FRAMEOPTION_ROWS)
-		{
-			/* In ROWS mode, frame head is the same as current */
-			winstate->frameheadpos = winstate->currentpos;
-			winstate->framehead_valid = true;
-		}
-		else if (frameOptions & FRAMEOPTION_RANGE)
-		{
-			int64		fhprev;
 
-			/* If no ORDER BY, all rows are peers with each other */
-			if (node->ordNumCols == 0)
-			{
-				winstate->frameheadpos = 0;
-				winstate->framehead_valid = true;
-				return;
-			}
+	/* final output execution is in ps_ExprContext */
+	econtext = winstate->ss.ps.ps_ExprContext;
+	agg_winobj = winstate->agg_winobj;
+	agg_row_slot = winstate->agg_row_slot;
 
-			/*
-			 * In RANGE START_CURRENT mode, frame head is the first row that
-			 * is a peer of current row.  We search backwards from current,
-			 * which could be a bit inefficient if peer sets are large. Might
-			 * be better to have a separate read pointer that moves forward
-			 * tracking the frame head.
-			 */
-			fhprev = winstate->currentpos - 1;
-			for (;;)
-			{
-				/* assume the frame head can't go backwards */
-				if (fhprev < winstate->frameheadpos)
-					break;
-				if (!window_gettupleslot(winobj, fhprev, slot))
-					break;		/* start of partition */
-				if (!are_peers(winstate, slot, winstate->ss.ss_ScanTupleSlot))
-					break;		/* not peer of current row */
-				fhprev--;
-			}
-			winstate->frameheadpos = fhprev + 1;
-			winstate->framehead_valid = true;
-		}
-		else
-			Assert(false);
-	}
-	else if (frameOptions & FRAMEOPTION_START_VALUE)
+	/*
+	 * If the buffer went to tape since we last ran (another frame of this
+	 * node, or a window function, may have spooled it), the look-ahead row
+	 * still sits in the in-memory slot.  Move it over to the tape slot so we
+	 * don't have to read it again, which could mean reading backward.
+	 */
+	if (enable_winfunopt && !tuplestore_in_memory(winstate->buffer) &&
+		!TupIsNull(agg_row_slot) && TupIsNull(opt_agg_row_slot))
 	{
-		if (frameOptions & FRAMEOPTION_ROWS)
-		{
-			/* In ROWS mode, bound is physically n before/after current */
-			int64		offset = DatumGetInt64(winstate->startOffsetValue);
-
-			if (frameOptions & FRAMEOPTION_START_VALUE_PRECEDING)
-				offset = -offset;
+		MemoryContext oldcontext;
 
-			winstate->frameheadpos = winstate->currentpos + offset;
-			/* frame head can't go before first row */
-			if (winstate->frameheadpos < 0)
-				winstate->frameheadpos = 0;
-			else if (winstate->frameheadpos > winstate->currentpos)
-			{
-				/* make sure frameheadpos is not past end of partition */
-				spool_tuples(winstate, winstate->frameheadpos - 1);
-				if (winstate->frameheadpos > winstate->spooled_rows)
-					winstate->frameheadpos = winstate->spooled_rows;
-			}
-			winstate->framehead_valid = true;
-		}
-		else if (frameOptions & FRAMEOPTION_RANGE)
-		{
-			/* parser should have rejected this */
-			elog(ERROR, "window frame with value offset is not implemented");
-		}
-		else
-			Assert(false);
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_query_memory);
+		tuplestore_convert_to_opt(winstate->buffer, agg_row_slot, opt_agg_row_slot);
+		MemoryContextSwitchTo(oldcontext);
+		ExecClearTuple(agg_row_slot);
 	}
-	else
-		Assert(false);
-}
 
-/*
- * update_frametailpos
- * make frametailpos valid for the current row
- *
- * Uses the winobj's read pointer for any required fetches; hence, if the
- * frame mode is one that requires row comparisons, the winobj's mark must
- * not be past the currently known frame tail.	Also uses the specified slot
- * for any required fetches.
- */
-static void
-update_frametailpos(WindowObject winobj, TupleTableSlot *slot)
-{
-	WindowAggState *winstate = winobj->winstate;
-	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
-	int			frameOptions = winstate->frameOptions;
+	/*
+	 * Currently, we support only a subset of the SQL-standard window framing
+	 * rules.
+	 *
+	 * If the frame start is UNBOUNDED_PRECEDING, the window frame consists of
+	 * a contiguous group of rows extending forward from the start of the
+	 * partition, and rows only enter the frame, never exit it, as the current
+	 * row advances forward.  This makes it possible to use an incremental
+	 * strategy for evaluating aggregates: we run the transition function for
+	 * each row added to the frame, and run the final function whenever we
+	 * need the current aggregate value.  This is considerably more efficient
+	 * than the naive approach of re-running the entire aggregate calculation
+	 * for each current row.  It does assume that the final function doesn't
+	 * damage the running transition value, but we have the same assumption in
+	 * nodeAgg.c too (when it rescans an existing hash table).
+	 *
+	 * For other frame start rules, we discard the aggregate state and re-run
+	 * the aggregates whenever the frame head row moves.  We can still
+	 * optimize as above whenever successive rows share the same frame head.
+	 *
+	 * In many common cases, multiple rows share the same frame and hence the
+	 * same aggregate value. (In particular, if there's no ORDER BY in a RANGE
+	 * window, then all rows are peers and so they all have window frame equal
+	 * to the whole partition.)  We optimize such cases by calculating the
+	 * aggregate value once when we reach the first row of a peer group, and
+	 * then returning the saved value for all subsequent rows.
+	 *
+	 * 'aggregatedupto' keeps track of the first row that has not yet been
+	 * accumulated into the aggregate transition values.  Whenever we start a
+	 * new peer group, we accumulate forward to the end of the peer group.
+	 *
+	 * Rerunning aggregates from the frame start can be pretty slow, so if
+	 * every aggregate has an inverse transition function (pg_aggregate's
+	 * agginvtransfn), we instead call it for each row as it exits the frame,
+	 * and then carry on accumulating from aggregatedupto.  An inverse may
+	 * decline to remove a row by returning NULL, in which case we restart as
+	 * above.  We don't do this when an argument is volatile, since the value
+	 * removed might not be the value that was added.
+	 *
+	 * Failing that, if every aggregate has a combine function (pg_aggregate's
+	 * aggcombinefn), eval_windowaggregates_segtree answers each frame from a
+	 * segment tree of partial transition values instead.
+	 */
 
-	if (winstate->frametail_valid)
-		return;					/* already known for current row */
 
-	if (frameOptions & FRAMEOPTION_END_UNBOUNDED_FOLLOWING)
-	{
-		/* In UNBOUNDED FOLLOWING mode, all partition rows are in frame */
-		spool_tuples(winstate, -1);
-		winstate->frametailpos = winstate->spooled_rows - 1;
-		winstate->frametail_valid = true;
+	/*
+	 * First, update the frame head position.
+	 */
+//#ifdef WIN_FUN_OPT
+	if(enable_winfunopt)
+		opt_update_frameheadpos(agg_winobj, winstate->temp_slot_1, winstate->opt_temp_slot_1);
+//#else
+	else if(enable_reusebuffer)
+		reuse_update_frameheadpos(agg_winobj, winstate->temp_slot_1);
+	else
+		update_frameheadpos(agg_winobj, winstate->temp_slot_1);
+//#endif
+
+	/*
+	 * A RANGE frame ending at a value offset can't tell its rows
+	 * from the current row's peers; row_is_in_frame needs the frame tail.
+	 */
+	if ((winstate->frameOptions & FRAMEOPTION_RANGE) &&
+		(winstate->frameOptions & FRAMEOPTION_END_VALUE))
+	{
+		if (enable_winfunopt)
+			opt_update_frametailpos(agg_winobj, winstate->temp_slot_1,
+									winstate->opt_temp_slot_1);
+		else
+			update_frametailpos(agg_winobj, winstate->temp_slot_1);
 	}
-	else if (frameOptions & FRAMEOPTION_END_CURRENT_ROW)
+
+
+	/*
+	 * If the frame head moved forward but not past the rows aggregated so
+	 * far, try removing the rows that left the frame.
+	 */
+	if (winstate->opt_use_invtrans &&
+		winstate->currentpos != 0 &&
+		winstate->frameheadpos > winstate->aggregatedbase &&
+		winstate->frameheadpos <= winstate->aggregatedupto &&
+		retreat_windowaggregates(winstate))
 	{
-		if (frameOptions & FRAMEOPTION_ROWS)
+		/*
+		 * Keep the mark pointer, and the frame head pointer if any, pushed up
+		 * to frame head as below, so that tuplestore can discard rows.
+		 */
+		if (agg_winobj->markptr >= 0)
+			WinSetMarkPosition(agg_winobj, winstate->frameheadpos);
+		if (enable_locate && agg_winobj->opt_frameheadptr >= 0)
+			opt_update_frameheadptr(agg_winobj, winstate->frameheadpos);
+		winstate->aggregatedbase = winstate->frameheadpos;
+		rows_removed = true;
+	}
+
+	/*
+	 * Initialize aggregates on first call for partition, or if the frame head
+	 * position moved since last time.
+	 */
+	if (winstate->currentpos == 0 ||
+		winstate->frameheadpos != winstate->aggregatedbase)
+	{
+
+
+		/*
+		 * Discard transient aggregate values
+		 */
+		/*
+		 * moved by cywang
+		 *
+		 * because this discard process will discard the temporary transition value too.
+		 */
+		//MemoryContextResetAndDeleteChildren(winstate->aggcontext);
+
+		/*
+		 * by cywang, moved backward
+		 */
+		/*
+		for (i = 0; i < numaggs; i++)
 		{
-			/* In ROWS mode, exactly the rows up to current are in frame */
-			winstate->frametailpos = winstate->currentpos;
-			winstate->frametail_valid = true;
+			peraggstate = &winstate->peragg[i];
+			wfuncno = peraggstate->wfuncno;
+			initialize_windowaggregate(winstate,
+									   &winstate->perfunc[wfuncno],
+									   peraggstate);
 		}
-		else if (frameOptions & FRAMEOPTION_RANGE)
-		{
-			int64		ftnext;
+		*/
 
-			/* If no ORDER BY, all rows are peers with each other */
-			if (node->ordNumCols == 0)
+		/*
+		 * If we created a mark pointer for aggregates, keep it pushed up to
+		 * frame head, so that tuplestore can discard unnecessary rows.
+		 */
+		if (agg_winobj->markptr >= 0)
+			WinSetMarkPosition(agg_winobj, winstate->frameheadpos);
+
+		/* by cywang, for locate*/
+		if(enable_locate){
+			if(agg_winobj->opt_frameheadptr >= 0 && winstate->currentpos!=0){
+				/* first update opt_frameheadptr */
+				opt_update_frameheadptr(agg_winobj, winstate->frameheadpos);
+				/* then copy opt_frameheadptr to readptr */
+				opt_copy_frameheadptr(agg_winobj);
+			}
+
+			if(enable_reusebuffer && !tuplestore_in_memory(winstate->buffer)){
+				copy_reuseptr(agg_winobj);
+			}
+		}
+
+		if(enable_reusebuffer){
+			reuse_tuplestore_trim(winstate->buffer, winstate->frameheadpos);
+		}
+//#ifdef WIN_FUN_OPT
+		/*
+		 * Initialize for loop below
+		 */
+		if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
+			ExecClearTuple(opt_agg_row_slot);
+		}else{
+//#endif
+			ExecClearTuple(agg_row_slot);
+//#ifdef WIN_FUN_OPT
+		}
+//#endif
+
+		/* by cywang */
+		framehead_updated = true;
+
+		if(winstate->currentpos == 0){
+			for(i=0; i<winstate->opt_tempTransValue_num; i++)
+				agg_winobj->opt_tempStartPos[i] = 0;
+		}
+
+		previous_frame_size = winstate->aggregatedupto - winstate->aggregatedbase +1;
+
+		/*
+		 * In the last step when need_compute_temp_trans is true, no temporary transition value is produced,
+		 * which means the spacing is bigger than the frame size
+		 */
+		//if(agg_winobj->opt_needTempTransValue && agg_winobj->opt_frameheadeverchanged && agg_winobj->opt_tempTransEndPos==-1)
+		//	agg_winobj->opt_needTempTransValue = false;
+
+		//if(enable_recompute && agg_winobj->opt_needTempTransValue){
+		if(enable_recompute && previous_frame_size>4){
+			winstate->opt_active_tempTransValue = -1;
+			for(i=0; i<winstate->opt_tempTransValue_num; i++){
+				if(winstate->frameheadpos <= agg_winobj->opt_tempStartPos[i] && agg_winobj->opt_tempTransEndPos[i]>=0){
+					winstate->opt_active_tempTransValue = i;
+					break;
+				}
+			}
+
+			/* no temporary transition value is proper */
+			if(winstate->opt_active_tempTransValue  < 0){
+				int target;
+
+				/*
+				 * Pick the number and spacing of the temporary transition
+				 * values on the first restart of the partition, and again
+				 * whenever the frame size has drifted or the partition has
+				 * been spilled since.
+				 */
+				if(winstate->opt_use_recompute &&
+				   (winstate->opt_recompute_framesize == 0 ||
+					previous_frame_size > 2 * winstate->opt_recompute_framesize ||
+					2 * previous_frame_size < winstate->opt_recompute_framesize ||
+					winstate->opt_recompute_spilled != !tuplestore_in_memory(winstate->buffer)))
+					opt_tune_recompute(winstate, previous_frame_size);
+
+				MemoryContextResetAndDeleteChildren(winstate->aggcontext);
+				for(target=0; target<winstate->opt_tempTransValue_num; target++){
+					for (i = 0; i < numaggs; i++)
+					{
+						peraggstate = &winstate->peragg[i];
+						wfuncno = peraggstate->wfuncno;
+						/* the pointer of temporary transition value is automatically freed */
+						opt_temp_initialize_windowaggregate(winstate,
+												   &winstate->perfunc[wfuncno],
+												   peraggstate,
+												   target);
+						/*
+						 * The spacing comes from opt_tune_recompute, which
+						 * assumes the size of two adjacent frames doesn't vary
+						 * much, so it is tuned to the previous frame.
+						 *
+						 * In addition, only when frame size is bigger than 4, we import recompute.
+						 */
+						agg_winobj->opt_tempStartPos[target] = winstate->frameheadpos + (target+1)*winstate->opt_recompute_spacing;
+
+						agg_winobj->opt_tempTransEndPos[target] = -1;
+					}
+				}
+				need_compute_temp_trans = true;
+
+				for (i = 0; i < numaggs; i++)
+				{
+					peraggstate = &winstate->peragg[i];
+					wfuncno = peraggstate->wfuncno;
+					initialize_windowaggregate(winstate,
+											   &winstate->perfunc[wfuncno],
+											   peraggstate);
+				}
+			}else{
+				/* a temporary transition value can still be used */
+				for (i = 0; i < numaggs; i++)
+				{
+					peraggstate = &winstate->peragg[i];
+					wfuncno = peraggstate->wfuncno;
+					opt_copy_transValue_from_tempTransValue(winstate,
+												&winstate->perfunc[wfuncno],
+												peraggstate,
+												winstate->opt_active_tempTransValue);
+				}
+			}
+		}else{
+			MemoryContextResetAndDeleteChildren(winstate->aggcontext);
+			for (i = 0; i < numaggs; i++)
 			{
-				spool_tuples(winstate, -1);
-				winstate->frametailpos = winstate->spooled_rows - 1;
-				winstate->frametail_valid = true;
-				return;
+				peraggstate = &winstate->peragg[i];
+				wfuncno = peraggstate->wfuncno;
+				initialize_windowaggregate(winstate,
+										   &winstate->perfunc[wfuncno],
+										   peraggstate);
+			}
+		}
+		//if(winstate->currentpos != 0)
+			//agg_winobj->opt_frameheadeverchanged = true;
+
+		winstate->aggregatedbase = winstate->frameheadpos;
+		winstate->aggregatedupto = winstate->frameheadpos;
+	}
+
+	/*
+	 * In UNBOUNDED_FOLLOWING mode, we don't have to recalculate aggregates
+	 * except when the frame head moves.  In END_CURRENT_ROW mode, we only
+	 * have to recalculate when the frame head moves or currentpos has
+	 * advanced past the place we'd aggregated up to.  Check for these cases
+	 * and if so, reuse the saved result values.  (Not if rows were just
+	 * removed, of course.)
+	 */
+	if (!rows_removed &&
+		(winstate->frameOptions & (FRAMEOPTION_END_UNBOUNDED_FOLLOWING |
+								   FRAMEOPTION_END_CURRENT_ROW)) &&
+		winstate->aggregatedbase <= winstate->currentpos &&
+		winstate->aggregatedupto > winstate->currentpos)
+	{
+		for (i = 0; i < numaggs + winstate->opt_numshareaggs; i++)
+		{
+			peraggstate = (i < numaggs ? &winstate->peragg[i] :
+						   &winstate->opt_shareagg[i - numaggs]);
+			wfuncno = peraggstate->wfuncno;
+			econtext->ecxt_aggvalues[wfuncno] = peraggstate->resultValue;
+			econtext->ecxt_aggnulls[wfuncno] = peraggstate->resultValueIsNull;
+		}
+		return;
+	}
+
+	/*
+	 * by cywang
+	 *
+	 * only when the frame head is changed and
+	 */
+	if(framehead_updated && pre_upto > winstate->aggregatedupto){
+		//recompute_started = true;
+		recompute_part_stoped = false;
+		WINAGG_INSTR_START(winstate->instr_recompute_part);
+	}
+
+
+	/*
+	 * Advance until we reach a row not in frame (or end of partition).
+	 *
+	 * Note the loop invariant: agg_row_slot is either empty or holds the row
+	 * at position aggregatedupto.	We advance aggregatedupto after processing
+	 * a row.
+	 */
+	for (;;)
+	{
+		if(!recompute_part_stoped && winstate->aggregatedupto>=pre_upto){
+			//recompute_started = false;
+			recompute_part_stoped = true;
+			WINAGG_INSTR_STOP(winstate->instr_recompute_part);
+		}
+
+		/*
+		 * The rows that are surely in frame and whose arguments are all in
+		 * the column buffers are advanced in one go, without fetching them.
+		 * With temporary transition values, only the rows before the next
+		 * temporary start position just advance the aggregates.
+		 */
+		if(winstate->opt_use_batch){
+			int64	end = batch_advance_limit(winstate);
+
+			if(enable_recompute && previous_frame_size>4 && winstate->frameheadpos != 0){
+				if(winstate->opt_active_tempTransValue >= 0)
+					end = Min(end, agg_winobj->opt_tempStartPos[winstate->opt_active_tempTransValue]);
+				else if(winstate->opt_tempTransValue_num > 0)
+					end = Min(end, agg_winobj->opt_tempStartPos[0]);
 			}
+			if(end > winstate->aggregatedupto){
+				if(!recompute_part_stoped)
+					winstate->instr_rows_recomputed += Min(end, pre_upto) - winstate->aggregatedupto;
+				advance_windowaggregates_batch(winstate, winstate->aggregatedupto, end);
+				winstate->aggregatedupto = end;
+				/* the look-ahead row, if any, is behind us now */
+				if(agg_row_slot)
+					ExecClearTuple(agg_row_slot);
+				if(opt_agg_row_slot)
+					ExecClearTuple(opt_agg_row_slot);
+				continue;
+			}
+		}
+
+		if(framehead_updated){
+			opt_tuplestore_set_locateheadpos(winstate->buffer, true);	/* for locate IO */
+			WINAGG_INSTR_START(winstate->instr_locateheadpos_part);	/* for locate the head position */
+		}
+
+//#ifdef WIN_FUN_OPT
+		if(enable_winfunopt){
+			/*
+			 * opt_window_gettupleslot may change the status
+			 */
+			if(!tuplestore_in_memory(winstate->buffer)){
+				if (TupIsNull(opt_agg_row_slot)){
+					if (!opt_window_gettupleslot(agg_winobj, winstate->aggregatedupto, agg_row_slot, opt_agg_row_slot))
+						break;			/* must be end of partition */
+				}
+			}else{
+				if (TupIsNull(agg_row_slot))
+				{
+					if (!opt_window_gettupleslot(agg_winobj, winstate->aggregatedupto, agg_row_slot, opt_agg_row_slot))
+						break;			/* must be end of partition */
+				}
+				/*
+				 * this is the situation that the buffer status switch from memory to tape,
+				 * as the follow-up computing will for opt, we need to converted it to an opt tuple.
+				 */
+				if(!tuplestore_in_memory(winstate->buffer)){
+					//tuplestore_convert_to_opt(winstate->buffer, agg_row_slot, opt_agg_row_slot);
+					/* the initial tuple slot is will not be used in the computation of current row */
+					if(agg_row_slot)
+						ExecClearTuple(agg_row_slot);
+				}
+			}
+		}else{
+//#else
+			/* Fetch next row if we didn't already */
+			if (TupIsNull(agg_row_slot))
+			{
+				if(enable_reusebuffer){
+					if (!reuse_window_gettupleslot(agg_winobj, winstate->aggregatedupto,
+											 agg_row_slot))
+						break;			/* must be end of partition */
+				}else{
+					if (!window_gettupleslot(agg_winobj, winstate->aggregatedupto,
+											 agg_row_slot))
+						break;			/* must be end of partition */
+				}
+			}
+		}
+//#endif
+
+		if(framehead_updated){
+			framehead_updated = false;
+			opt_tuplestore_set_locateheadpos(winstate->buffer, false);
+			WINAGG_INSTR_STOP(winstate->instr_locateheadpos_part);
+		}
+
+		/* Exit loop (for now) if not in frame */
+		//InstrStartNode(winstate->instr_checkinframe_part);
+//#ifdef WIN_FUN_OPT
+		if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
+			if (!row_is_in_frame(winstate, winstate->aggregatedupto, opt_agg_row_slot)){
+				stillinframe = false;	/* for instr_checkinframe_part*/
+				break;
+			}
+			/* Set tuple context for evaluation of aggregate arguments */
+			winstate->tmpcontext->ecxt_outertuple = opt_agg_row_slot;
+			WINAGG_SET_ARGPOS(winstate, winstate->aggregatedupto);
+		}else{
+//#endif
+			if (!row_is_in_frame(winstate, winstate->aggregatedupto, agg_row_slot)){
+				stillinframe = false;
+				break;
+			}
+			/* Set tuple context for evaluation of aggregate arguments */
+			winstate->tmpcontext->ecxt_outertuple = agg_row_slot;
+			WINAGG_SET_ARGPOS(winstate, winstate->aggregatedupto);
+//#ifdef WIN_FUN_OPT
+		}
+//#endif
+		//InstrStopNode(winstate->instr_checkinframe_part,0);
+
+		if(!recompute_part_stoped)
+			winstate->instr_rows_recomputed++;
+
+		/*
+		 * For single temporary transition value.
+		 */
+		if(enable_recompute && previous_frame_size>4 && winstate->frameheadpos != 0){
+			if(winstate->opt_active_tempTransValue>=0
+					&& winstate->aggregatedupto < agg_winobj->opt_tempStartPos[winstate->opt_active_tempTransValue])
+			{
+				/* Accumulate row into the aggregates */
+				for (i = 0; i < numaggs; i++)
+				{
+					peraggstate = &winstate->peragg[i];
+					wfuncno = peraggstate->wfuncno;
+					advance_windowaggregate(winstate,
+											&winstate->perfunc[wfuncno],
+											peraggstate);
+				}
+			}else if(winstate->opt_active_tempTransValue<0){
+				int target;
+				/* for currentpos's use */
+				for (i = 0; i < numaggs; i++)
+				{
+					peraggstate = &winstate->peragg[i];
+					wfuncno = peraggstate->wfuncno;
+					advance_windowaggregate(winstate,
+											&winstate->perfunc[wfuncno],
+											peraggstate);
+				}
+				/* for future use */
+				for(target=0; target<winstate->opt_tempTransValue_num; target++){
+					if(winstate->aggregatedupto >= agg_winobj->opt_tempStartPos[target]){
+						for (i = 0; i < numaggs; i++)
+						{
+							peraggstate = &winstate->peragg[i];
+							wfuncno = peraggstate->wfuncno;
+							opt_temp_advance_windowaggregate(winstate,
+													&winstate->perfunc[wfuncno],
+													peraggstate,
+													target);
+						}
+						agg_winobj->opt_tempTransEndPos[target] = agg_winobj->seekpos; /* we must copy the seek position */
+					}else{
+						break;	/* opt_tempStartPos[i+1] > opt_tempStartPos[i] */
+					}
+				}
+				/*
+				 * save opt_tempTransEndPtr
+				 *
+				 * we can't do this out this loop,
+				 * because at that time the position is not the end position for temporary transition value.
+				 */
+				if(target > 0){
+					opt_tuplestore_copy_ptr(winstate->buffer, agg_winobj->opt_tempTransEndPtr, agg_winobj->readptr);
+					/*
+					 * if not in memory, we need to set the bufFile's offset to opt_tempTransEndPtr.
+					 *
+					 * NOTE: not just for on tape, but also for memory, or the answer will contains error
+					 */
+					opt_tuplestore_tell_ptr(winstate->buffer, agg_winobj->opt_tempTransEndPtr);
+				}
+			}else{
+				ResetExprContext(winstate->tmpcontext);
+				if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
+					ExecClearTuple(opt_agg_row_slot);
+				}else{
+					ExecClearTuple(agg_row_slot);
+				}
+				break;
+			}
+		}else{
+			for (i = 0; i < numaggs; i++)
+			{
+				peraggstate = &winstate->peragg[i];
+				wfuncno = peraggstate->wfuncno;
+				advance_windowaggregate(winstate,
+										&winstate->perfunc[wfuncno],
+										peraggstate);
+			}
+		}
+
+		/* Reset per-input-tuple context after each tuple */
+		ResetExprContext(winstate->tmpcontext);
+
+		/* And advance the aggregated-row state */
+		winstate->aggregatedupto++;
+
+//#ifdef WIN_FUN_OPT
+		if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
+			ExecClearTuple(opt_agg_row_slot);
+		}else{
+//#endif
+			ExecClearTuple(agg_row_slot);
+//#ifdef WIN_FUN_OPT
+		}
+//#endif
+	}
+
+	//if(enable_recompute && agg_winobj->opt_needTempTransValue){
+	if(enable_recompute && previous_frame_size>4){
+		/*
+		 * NOTE:
+		 * if winstate->opt_active_tempTransValue<0, means aggregatedupto already up to date.
+		 * if opt_tempTransEndPos==-1, means no temporary transition value to use.
+		 */
+		if(winstate->opt_active_tempTransValue>=0
+				&& winstate->agg_winobj->opt_tempTransEndPos[winstate->opt_active_tempTransValue] != -1)
+		{
+			/* copy the readptr from opt_tempTransEndPtr */
+			opt_copy_tempTransEndPtr(agg_winobj, winstate->opt_active_tempTransValue);
+			/*
+			 * After combine the transition values, we need to set the aggregatedupto value.
+			 *
+			 * NOTE: here must +1, aggregatedupto means the position of the next tuple to aggregate,
+			 * while opt_tempTransEndPos comes from seekpos, that is the position of the last tuple.
+			 */
+			//winstate->aggregatedupto = agg_winobj->opt_tempTransEndPos;
+			winstate->aggregatedupto = agg_winobj->opt_tempTransEndPos[winstate->opt_active_tempTransValue]+1;
+			/* Compute the tuples after opt_tempTransEndPos */
+			opt_eval_tempTransEnd(winstate);
+		}
+	}
+
+	/*
+	 * by cywang
+	 *
+	 * the instruments may no stop in the upper for loop,
+	 * need to check here.
+	 */
+	if(framehead_updated){
+		framehead_updated = false;
+		opt_tuplestore_set_locateheadpos(winstate->buffer, false);
+		WINAGG_INSTR_STOP(winstate->instr_locateheadpos_part);
+	}
+	if(!recompute_part_stoped){
+		recompute_part_stoped = true;
+		WINAGG_INSTR_STOP(winstate->instr_recompute_part);
+	}
+	if(!stillinframe){
+		//InstrStopNode(winstate->instr_checkinframe_part, 0);
+	}
+
+	/*
+	 * finalize aggregates and fill result/isnull fields.
+	 */
+	save_windowaggregate_results(winstate);
+}
+
+/*
+ * eval_windowaggregates_segtree
+ * evaluate plain aggregates over a moving frame using the segment tree
+ *
+ * The frame [frameheadpos, frametailpos] is aggregated by running the
+ * transition function over the rows of the blocks it only partly covers, and
+ * combining the O(log n) tree nodes that exactly cover the blocks in between.
+ * Both ends of the frame only move forward, so the head rows are read through
+ * agg_winobj and the tail rows through opt_segtree_winobj, and neither has to
+ * seek across the frame.  In ring mode the frame's rows are all in the ring
+ * and are covered by at most two runs of leaves, the second one wrapping
+ * around to the start of the ring.  Rows go in strictly in partition order,
+ * so the combine function need not be commutative.
+ */
+static void
+eval_windowaggregates_segtree(WindowAggState *winstate)
+{
+	WindowStatePerAgg peraggstate;
+	WindowObject agg_winobj = winstate->agg_winobj;
+	ExprContext *econtext = winstate->ss.ps.ps_ExprContext;
+	int64		nodes[256];
+	int			nnodes;
+	int64		frameend;
+	int64		blocksize;
+	int64		firstleaf,
+				endleaf;
+	int			i,
+				n;
+
+	if (enable_winfunopt)
+		opt_update_frameheadpos(agg_winobj, winstate->temp_slot_1, winstate->opt_temp_slot_1);
+	else
+		update_frameheadpos(agg_winobj, winstate->temp_slot_1);
+
+	if (!winstate->opt_segtree_built)
+		build_segtree(winstate);
+
+	if (enable_winfunopt)
+		opt_update_frametailpos(winstate->opt_segtree_winobj,
+								winstate->temp_slot_2, winstate->opt_temp_slot_2);
+	else
+		update_frametailpos(winstate->opt_segtree_winobj, winstate->temp_slot_2);
+
+	frameend = Min(winstate->frametailpos + 1, winstate->spooled_rows);
+	if (frameend < winstate->frameheadpos)
+		frameend = winstate->frameheadpos;
+
+	/* the rows before frame head are never needed again */
+	if (agg_winobj->markptr >= 0)
+		WinSetMarkPosition(agg_winobj, winstate->frameheadpos);
+	if (enable_locate && agg_winobj->opt_frameheadptr >= 0)
+		opt_update_frameheadptr(agg_winobj, winstate->frameheadpos);
+
+	/* peers in RANGE mode share the frame, and hence the result */
+	if (winstate->currentpos != 0 &&
+		winstate->aggregatedbase == winstate->frameheadpos &&
+		winstate->aggregatedupto == frameend)
+	{
+		for (i = 0; i < winstate->numaggs + winstate->opt_numshareaggs; i++)
+		{
+			peraggstate = (i < winstate->numaggs ? &winstate->peragg[i] :
+						   &winstate->opt_shareagg[i - winstate->numaggs]);
+			econtext->ecxt_aggvalues[peraggstate->wfuncno] = peraggstate->resultValue;
+			econtext->ecxt_aggnulls[peraggstate->wfuncno] = peraggstate->resultValueIsNull;
+		}
+		return;
+	}
+
+	/* the rows that entered the frame go into the ring */
+	if (winstate->opt_segtree_ring)
+		segtree_ring_fill(winstate, frameend);
+
+	MemoryContextResetAndDeleteChildren(winstate->aggcontext);
+	for (i = 0; i < winstate->numaggs; i++)
+	{
+		peraggstate = &winstate->peragg[i];
+		initialize_windowaggregate(winstate,
+								   &winstate->perfunc[peraggstate->wfuncno],
+								   peraggstate);
+	}
+
+	if (winstate->opt_segtree_ring)
+	{
+		int64		size = winstate->opt_segtree_size;
+
+		nnodes = 0;
+		if (frameend > winstate->frameheadpos)
+		{
+			int64		first = winstate->frameheadpos % size;
+			int64		last = (frameend - 1) % size;
+
+			if (first <= last)
+				segtree_cover(size, first, last + 1, nodes, &nnodes);
+			else
+			{
+				segtree_cover(size, first, size, nodes, &nnodes);
+				segtree_cover(size, 0, last + 1, nodes, &nnodes);
+			}
+		}
+
+		for (i = 0; i < winstate->numaggs; i++)
+		{
+			peraggstate = &winstate->peragg[i];
+			for (n = 0; n < nnodes; n++)
+				combine_windowaggregate(winstate,
+										&winstate->perfunc[peraggstate->wfuncno],
+										peraggstate,
+										peraggstate->segtree_values[nodes[n]],
+										peraggstate->segtree_nulls[nodes[n]]);
+		}
+		ResetExprContext(winstate->tmpcontext);
+
+		winstate->aggregatedbase = winstate->frameheadpos;
+		winstate->aggregatedupto = frameend;
+
+		save_windowaggregate_results(winstate);
+		return;
+	}
+
+	/* the blocks wholly inside the frame; the last one may be short */
+	blocksize = winstate->opt_segtree_blocksize;
+	firstleaf = (winstate->frameheadpos + blocksize - 1) / blocksize;
+	if (frameend == winstate->spooled_rows)
+		endleaf = winstate->opt_segtree_nleaves;
+	else
+		endleaf = frameend / blocksize;
+
+	if (firstleaf >= endleaf)
+	{
+		/* the frame is inside one or two blocks */
+		segtree_advance_rows(winstate, agg_winobj,
+							 winstate->frameheadpos, frameend);
+	}
+	else
+	{
+		segtree_advance_rows(winstate, agg_winobj,
+							 winstate->frameheadpos, firstleaf * blocksize);
+
+		/* collect the covering nodes in row order */
+		nnodes = 0;
+		segtree_cover(winstate->opt_segtree_size, firstleaf, endleaf,
+					  nodes, &nnodes);
+
+		for (i = 0; i < winstate->numaggs; i++)
+		{
+			peraggstate = &winstate->peragg[i];
+			for (n = 0; n < nnodes; n++)
+				combine_windowaggregate(winstate,
+										&winstate->perfunc[peraggstate->wfuncno],
+										peraggstate,
+										peraggstate->segtree_values[nodes[n]],
+										peraggstate->segtree_nulls[nodes[n]]);
+		}
+		ResetExprContext(winstate->tmpcontext);
+
+		segtree_advance_rows(winstate, winstate->opt_segtree_winobj,
+							 Min(endleaf * blocksize, frameend), frameend);
+	}
+
+	winstate->aggregatedbase = winstate->frameheadpos;
+	winstate->aggregatedupto = frameend;
+
+	save_windowaggregate_results(winstate);
+}
+
+/*
+ * save_windowaggregate_results
+ * finalize aggregates and fill result/isnull fields, keeping a copy of each
+ * result in case the next row shares the same frame
+ *
+ * The aggregates sharing another's transition value come last.  Their
+ * copies are kept in the per-query context, which is never reset under
+ * them.
+ */
+static void
+save_windowaggregate_results(WindowAggState *winstate)
+{
+	WindowStatePerAgg peraggstate;
+	ExprContext *econtext = winstate->ss.ps.ps_ExprContext;
+	MemoryContext oldContext;
+	MemoryContext resultcontext;
+	int			wfuncno;
+	int			i;
+
+	for (i = 0; i < winstate->numaggs + winstate->opt_numshareaggs; i++)
+	{
+		Datum	   *result;
+		bool	   *isnull;
+
+		if (i < winstate->numaggs)
+		{
+			peraggstate = &winstate->peragg[i];
+			resultcontext = winstate->aggcontext;
+		}
+		else
+		{
+			peraggstate = &winstate->opt_shareagg[i - winstate->numaggs];
+			resultcontext = econtext->ecxt_per_query_memory;
+		}
+		wfuncno = peraggstate->wfuncno;
+		result = &econtext->ecxt_aggvalues[wfuncno];
+		isnull = &econtext->ecxt_aggnulls[wfuncno];
+		finalize_windowaggregate(winstate,
+								 &winstate->perfunc[wfuncno],
+								 peraggstate,
+								 result, isnull);
+
+		/*
+		 * save the result in case next row shares the same frame.
+		 *
+		 * XXX in some framing modes, eg ROWS/END_CURRENT_ROW, we can know in
+		 * advance that the next row can't possibly share the same frame. Is
+		 * it worth detecting that and skipping this code?
+		 */
+		if (!peraggstate->resulttypeByVal)
+		{
+			/*
+			 * clear old resultValue in order not to leak memory.  (Note: the
+			 * new result can't possibly be the same datum as old resultValue,
+			 * because we never passed it to the trans function.)
+			 */
+			if (!peraggstate->resultValueIsNull)
+				pfree(DatumGetPointer(peraggstate->resultValue));
+
+			/*
+			 * If pass-by-ref, copy it into our aggregate context.
+			 */
+			if (!*isnull)
+			{
+				oldContext = MemoryContextSwitchTo(resultcontext);
+				peraggstate->resultValue =
+					datumCopy(*result,
+							  peraggstate->resulttypeByVal,
+							  peraggstate->resulttypeLen);
+				MemoryContextSwitchTo(oldContext);
+			}
+		}
+		else
+		{
+			peraggstate->resultValue = *result;
+		}
+		peraggstate->resultValueIsNull = *isnull;
+	}
+}
+
+/*
+ * eval_windowfunction
+ *
+ * Arguments of window functions are not evaluated here, because a window
+ * function can need random access to arbitrary rows in the partition.
+ * The window function uses the special WinGetFuncArgInPartition and
+ * WinGetFuncArgInFrame functions to evaluate the arguments for the rows
+ * it wants.
+ */
+static void
+eval_windowfunction(WindowAggState *winstate, WindowStatePerFunc perfuncstate,
+					Datum *result, bool *isnull)
+{
+	FunctionCallInfoData fcinfo;
+	MemoryContext oldContext;
+
+	oldContext = MemoryContextSwitchTo(winstate->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
+
+	/*
+	 * We don't pass any normal arguments to a window function, but we do pass
+	 * it the number of arguments, in order to permit window function
+	 * implementations to support varying numbers of arguments.  The real info
+	 * goes through the WindowObject, which is passed via fcinfo->context.
+	 */
+	InitFunctionCallInfoData(fcinfo, &(perfuncstate->flinfo),
+							 perfuncstate->numArguments,
+							 perfuncstate->winCollation,
+							 (void *) perfuncstate->winobj, NULL);
+	/* Just in case, make all the regular argument slots be null */
+	memset(fcinfo.argnull, true, perfuncstate->numArguments);
+
+	*result = FunctionCallInvoke(&fcinfo);
+	*isnull = fcinfo.isnull;
+
+	/*
+	 * Make sure pass-by-ref data is allocated in the appropriate context. (We
+	 * need this in case the function returns a pointer into some short-lived
+	 * tuple, as is entirely possible.)
+	 */
+	if (!perfuncstate->resulttypeByVal && !fcinfo.isnull &&
+		!MemoryContextContains(CurrentMemoryContext,
+							   DatumGetPointer(*result)))
+		*result = datumCopy(*result,
+							perfuncstate->resulttypeByVal,
+							perfuncstate->resulttypeLen);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * begin_partition
+ * Start buffering rows of the next partition.
+ */
+static void
+begin_partition(WindowAggState *winstate)
+{
+	PlanState  *outerPlan = outerPlanState(winstate);
+	int			numfuncs = winstate->numfuncs;
+	int			i;
+
+
+	winstate->partition_spooled = false;
+	winstate->spooled_rows = 0;
+	winstate->currentpos = 0;
+
+	/*
+	 * If this is the very first partition, we need to fetch the first input
+	 * row to store in first_part_slot.
+	 */
+	if (TupIsNull(winstate->first_part_slot))
+	{
+		TupleTableSlot *outerslot;
+
+		outerslot = ExecProcNode(outerPlan);
+
+		if (!TupIsNull(outerslot))
+			ExecCopySlot(winstate->first_part_slot, outerslot);
+		else
+		{
+			/* outer plan is empty, so we have nothing to do */
+			winstate->partition_spooled = true;
+			winstate->more_partitions = false;
+			return;
+		}
+	}
+
+	/* Create new tuplestore for this partition */
+	winstate->buffer = tuplestore_begin_heap(false, false, work_mem);
+	if (!enable_reusebuffer)
+		opt_tuplestore_enable_rowindex(winstate->buffer);
+	winstate->instr_partitions++;
+	opt_tuplestore_set_instrument(winstate->buffer, winstate->instr_disk_read,
+								  winstate->instr_disk_write,
+								  winstate->instr_locateheadpos_io);
+
+//#ifdef WIN_FUN_OPT
+	if(enable_winfunopt){
+		/*
+		 * set the attribute of the buffer that its functions can only access in its own scope
+		 */
+		//tuplestore_set_opt(winstate->buffer, winstate);
+		tuplestore_init_opt(winstate->buffer, winstate->opt_tupdesc, winstate->useful2init, winstate->opt_maxPos, winstate->buffer_slot);
+
+		tuplestore_convert_to_opt(winstate->buffer, winstate->first_part_slot, winstate->opt_first_part_slot);
+	}
+//#endif
+	/*
+	 * Set up read pointers for the tuplestore.  The current pointer doesn't
+	 * need BACKWARD capability, but the per-window-function read pointers do,
+	 * and the aggregate pointer does if frame start is movable.
+	 */
+	winstate->current_ptr = 0;	/* read pointer 0 is pre-allocated */
+
+	/* reset default REWIND capability bit for current ptr */
+	tuplestore_set_eflags(winstate->buffer, 0);
+
+	/* reset the frames, and create read pointers for their aggregates */
+	begin_partition_frame(winstate);
+	for (i = 0; i < winstate->numframes; i++)
+	{
+		enter_frame(winstate, winstate->frames[i]);
+		begin_partition_frame(winstate->frames[i]);
+	}
+
+	/* create mark and read pointers for each real window function */
+	for (i = 0; i < numfuncs; i++)
+	{
+		WindowStatePerFunc perfuncstate = &(winstate->perfunc[i]);
+
+		if (!perfuncstate->plain_agg)
+		{
+			WindowObject winobj = perfuncstate->winobj;
+
+			winobj->markptr = tuplestore_alloc_read_pointer(winstate->buffer,
+															0);
+			winobj->readptr = tuplestore_alloc_read_pointer(winstate->buffer,
+														 EXEC_FLAG_BACKWARD);
+			winobj->markpos = -1;
+			winobj->seekpos = -1;
+
+			/* the ring's values went with the last partition's partcontext */
+			if (winobj->opt_ringsize > 0)
+			{
+				int64		j;
+
+				for (j = 0; j < winobj->opt_ringsize; j++)
+					winobj->opt_ringpos[j] = -1;
+			}
+		}
+	}
+
+	/*
+	 * Store the first tuple into the tuplestore (it's always available now;
+	 * we either read it above, or saved it at the end of previous partition)
+	 */
+//#ifdef WIN_FUN_OPT
+	if(enable_winfunopt){
+		opt_tuplestore_puttupleslot(winstate->buffer, winstate->first_part_slot);
+		/* just in case */
+		if(!tuplestore_in_memory(winstate->buffer))
+			opt_tuplestore_updatewritepos(winstate->buffer);
+	}else{
+//#else
+		tuplestore_puttupleslot(winstate->buffer, winstate->first_part_slot);
+	}
+//#endif
+
+	if (winstate->opt_use_argring)
+		argring_note(winstate, winstate->first_part_slot, winstate->spooled_rows);
+	winstate->spooled_rows++;
+}
+
+/*
+ * begin_partition_frame
+ * Reset the frame of winstate, or of one of its further frames, for a new
+ * partition, and create the read pointers its aggregates need.
+ */
+static void
+begin_partition_frame(WindowAggState *winstate)
+{
+	int			i;
+
+	winstate->framehead_valid = false;
+	winstate->frametail_valid = false;
+	winstate->frameheadpos = 0;
+	winstate->frametailpos = -1;
+	ExecClearTuple(winstate->agg_row_slot);
+
+	/* create read pointers for aggregates, if needed */
+	if (winstate->numaggs > 0)
+	{
+		WindowObject agg_winobj = winstate->agg_winobj;
+		int			readptr_flags = 0;
+
+		/* If the frame head is potentially movable ... */
+		if (!(winstate->frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING))
+		{
+			/* ... create a mark pointer to track the frame head */
+			agg_winobj->markptr = tuplestore_alloc_read_pointer(winstate->buffer, 0);
+			/* and the read pointer will need BACKWARD capability */
+			readptr_flags |= EXEC_FLAG_BACKWARD;
+		}
+		/* so will the search for a RANGE frame tail */
+		if ((winstate->frameOptions & FRAMEOPTION_RANGE) &&
+			(winstate->frameOptions & FRAMEOPTION_END_VALUE))
+			readptr_flags |= EXEC_FLAG_BACKWARD;
+
+		agg_winobj->readptr = tuplestore_alloc_read_pointer(winstate->buffer,
+															readptr_flags);
+		agg_winobj->markpos = -1;
+		agg_winobj->seekpos = -1;
+
+		/* Also reset the row counters for aggregates */
+		winstate->aggregatedbase = 0;
+		winstate->aggregatedupto = 0;
+
+		/* the column buffers went with the last partition's partcontext */
+		for (i = 0; i < winstate->numaggs; i++)
+		{
+			WindowStatePerAgg peraggstate = &winstate->peragg[i];
+
+			peraggstate->opt_colvalues = NULL;
+			peraggstate->opt_colnulls = NULL;
+			peraggstate->opt_colrows = 0;
+			peraggstate->opt_colsize = 0;
+		}
+		winstate->opt_colspace = 0;
+
+		/*
+		 * by cywang
+		 * the frame head read pointer is pro-allocated
+		 *
+		 * NOTE: currently, only one for aggregates,
+		 * if window function needs, we can allocate one for each window object
+		 */
+		if(enable_locate){
+			agg_winobj->opt_frameheadptr = tuplestore_alloc_read_pointer(winstate->buffer, 0);	/* only need forward */
+			agg_winobj->opt_frameheadpos = -1;
+		}
+		/*
+		 * by cywang
+		 *
+		 * for temporary transition value's end position
+		 */
+		if(winstate->opt_use_recompute){
+			agg_winobj->opt_tempTransEndPtr = tuplestore_alloc_read_pointer(winstate->buffer, 0);
+			for(i=0; i<winstate->opt_tempTransValue_max; i++)
+				agg_winobj->opt_tempTransEndPos[i] = -1;
+
+			/* tuned again on the first restart */
+			winstate->opt_tempTransValue_num = 0;
+			winstate->opt_recompute_framesize = 0;
+		}
+
+		/* rows leaving the frame are read once, in order */
+		if (winstate->opt_use_invtrans)
+		{
+			agg_winobj->opt_invtransptr = tuplestore_alloc_read_pointer(winstate->buffer, 0);
+			agg_winobj->opt_invtranspos = -1;
+		}
+
+		/* the segment tree is built on the first row of the partition */
+		if (winstate->opt_use_segtree)
+		{
+			WindowObject segtree_winobj = winstate->opt_segtree_winobj;
+
+			segtree_winobj->readptr =
+				tuplestore_alloc_read_pointer(winstate->buffer,
+											  EXEC_FLAG_BACKWARD);
+			segtree_winobj->markpos = -1;
+			segtree_winobj->seekpos = -1;
+			winstate->opt_segtree_built = false;
+		}
+	}
+}
+
+/*
+ * Read tuples from the outer node, up to and including position 'pos', and
+ * store them into the tuplestore. If pos is -1, reads the whole partition.
+ */
+static void
+spool_tuples(WindowAggState *winstate, int64 pos)
+{
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	PlanState  *outerPlan;
+	TupleTableSlot *outerslot;
+	MemoryContext oldcontext;
+
+	if (!winstate->buffer)
+		return;					/* just a safety check */
+	if (winstate->partition_spooled)
+		return;					/* whole partition done already */
+
+	/*
+	 * Even once the tuplestore has spilled to disk, we spool only as far as
+	 * asked: its temp files keep a separate buffer for appended tuples, so
+	 * alternating reads and writes doesn't flush buffers.
+	 */
+
+	outerPlan = outerPlanState(winstate);
+
+	/* Must be in query context to call outerplan */
+	oldcontext = MemoryContextSwitchTo(winstate->ss.ps.ps_ExprContext->ecxt_per_query_memory);
+
+	while (winstate->spooled_rows <= pos || pos == -1)
+	{
+		outerslot = ExecProcNode(outerPlan);
+		if (TupIsNull(outerslot))
+		{
+			/* reached the end of the last partition */
+			winstate->partition_spooled = true;
+			winstate->more_partitions = false;
+			break;
+		}
+
+		if (node->partNumCols > 0)
+		{
+			/* Check if this tuple still belongs to the current partition */
+			if (!execTuplesMatch(winstate->first_part_slot,
+								 outerslot,
+								 node->partNumCols, node->partColIdx,
+								 winstate->partEqfunctions,
+								 winstate->tmpcontext->ecxt_per_tuple_memory))
+			{
+				/*
+				 * end of partition; copy the tuple for the next cycle.
+				 */
+				ExecCopySlot(winstate->first_part_slot, outerslot);
+				winstate->partition_spooled = true;
+				winstate->more_partitions = true;
+				break;
+			}
+		}
+
+		/* Still in partition, so save it into the tuplestore */
+//#ifdef WIN_FUN_OPT
+		if(enable_winfunopt)
+			opt_tuplestore_puttupleslot(winstate->buffer, outerslot);
+//#else
+		else
+			tuplestore_puttupleslot(winstate->buffer, outerslot);
+//#endif
+		if (winstate->opt_use_argring)
+			argring_note(winstate, outerslot, winstate->spooled_rows);
+		winstate->spooled_rows++;
+	}
+
+	if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
+		opt_tuplestore_updatewritepos(winstate->buffer);
+	}
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * skip_partition_frame
+ * Invalidate the frame of winstate, or of one of its further frames, when
+ * the rest of its partition is skipped.
+ */
+static void
+skip_partition_frame(WindowAggState *winstate)
+{
+	WindowObject agg_winobj = winstate->agg_winobj;
+
+	winstate->framehead_valid = false;
+	winstate->frametail_valid = false;
+	winstate->frameheadpos = 0;
+	winstate->frametailpos = -1;
+	winstate->aggregatedbase = 0;
+	winstate->aggregatedupto = 0;
+	if (agg_winobj != NULL)
+	{
+		agg_winobj->markpos = -1;
+		agg_winobj->seekpos = -1;
+		agg_winobj->opt_frameheadpos = -1;
+		agg_winobj->opt_invtranspos = -1;
+	}
+	winstate->opt_segtree_built = false;
+}
+
+/*
+ * skip_partition
+ * drop the rest of the current partition once its run condition
+ * has failed.  The outer rows not spooled yet are read past without going
+ * into the tuplestore; without partitioning the rest of the input is not
+ * read at all.  The current row becomes the last one of the partition.
+ */
+static void
+skip_partition(WindowAggState *winstate)
+{
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	PlanState  *outerPlan;
+	TupleTableSlot *outerslot;
+	MemoryContext oldcontext;
+	int			i;
+
+	winstate->instr_rows_skipped += winstate->spooled_rows - winstate->currentpos;
+	winstate->currentpos = winstate->spooled_rows - 1;
+
+	/*
+	 * None of the frames is evaluated again in this partition, so forget
+	 * their positions and aggregated rows: the next partition must start
+	 * aggregating each of them from its first row.
+	 */
+	skip_partition_frame(winstate);
+	for (i = 0; i < winstate->numframes; i++)
+		skip_partition_frame(winstate->frames[i]);
+
+	if (winstate->partition_spooled)
+		return;
+	if (node->partNumCols == 0)
+	{
+		winstate->partition_spooled = true;
+		winstate->more_partitions = false;
+		return;
+	}
+
+	outerPlan = outerPlanState(winstate);
+
+	/* Must be in query context to call outerplan */
+	oldcontext = MemoryContextSwitchTo(winstate->ss.ps.ps_ExprContext->ecxt_per_query_memory);
+
+	for (;;)
+	{
+		outerslot = ExecProcNode(outerPlan);
+		if (TupIsNull(outerslot))
+		{
+			winstate->partition_spooled = true;
+			winstate->more_partitions = false;
+			break;
+		}
+		if (!execTuplesMatch(winstate->first_part_slot,
+							 outerslot,
+							 node->partNumCols, node->partColIdx,
+							 winstate->partEqfunctions,
+							 winstate->tmpcontext->ecxt_per_tuple_memory))
+		{
+			ExecCopySlot(winstate->first_part_slot, outerslot);
+			winstate->partition_spooled = true;
+			winstate->more_partitions = true;
+			break;
+		}
+		winstate->instr_rows_skipped++;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * release_partition
+ * clear information kept within a partition, including
+ * tuplestore and aggregate results.
+ */
+static void
+release_partition(WindowAggState *winstate)
+{
+	int			i;
+
+	for (i = 0; i < winstate->numfuncs; i++)
+	{
+		WindowStatePerFunc perfuncstate = &(winstate->perfunc[i]);
+
+		/* Release any partition-local state of this window function */
+		if (perfuncstate->winobj)
+			perfuncstate->winobj->localmem = NULL;
+	}
+
+	/*
+	 * Release all partition-local memory (in particular, any partition-local
+	 * state that we might have trashed our pointers to in the above loop, and
+	 * any aggregate temp data).  We don't rely on retail pfree because some
+	 * aggregates might have allocated data we don't have direct pointers to.
+	 */
+	MemoryContextResetAndDeleteChildren(winstate->partcontext);
+	MemoryContextResetAndDeleteChildren(winstate->aggcontext);
+	for (i = 0; i < winstate->numframes; i++)
+	{
+		WindowAggState *frame = winstate->frames[i];
+
+		MemoryContextResetAndDeleteChildren(frame->partcontext);
+		MemoryContextResetAndDeleteChildren(frame->aggcontext);
+		frame->buffer = NULL;
+	}
+
+	if (winstate->buffer){
+		/* collect the temp file traffic for EXPLAIN ANALYZE */
+		if (opt_tuplestore_get_stats(winstate->buffer, &winstate->instr_temp_read,
+									 &winstate->instr_temp_written))
+			winstate->instr_spilled_partitions++;
+
+		if(enable_reusebuffer)
+			reuse_tuplestore_clear(winstate->buffer);
+
+//#ifdef WIN_FUN_OPT
+		if(enable_winfunopt)
+			opt_tuplestore_end(winstate->buffer);
+//#else
+		else
+			tuplestore_end(winstate->buffer);
+//#endif
+	}
+
+	winstate->buffer = NULL;
+	winstate->partition_spooled = false;
+}
+
+/*
+ * enter_frame
+ * Make one of winstate's further frames current before evaluating its
+ * functions.  The frames share the buffer, the current row and the
+ * spooling state, so copy them in.
+ */
+static void
+enter_frame(WindowAggState *winstate, WindowAggState *frame)
+{
+	frame->buffer = winstate->buffer;
+	frame->spooled_rows = winstate->spooled_rows;
+	frame->currentpos = winstate->currentpos;
+	frame->partition_spooled = winstate->partition_spooled;
+	frame->more_partitions = winstate->more_partitions;
+}
+
+/*
+ * leave_frame
+ * Copy back the spooling state after evaluating a frame's functions, which
+ * may have read further rows of the partition.
+ */
+static void
+leave_frame(WindowAggState *winstate, WindowAggState *frame)
+{
+	winstate->spooled_rows = frame->spooled_rows;
+	winstate->partition_spooled = frame->partition_spooled;
+	winstate->more_partitions = frame->more_partitions;
+}
+
+/*
+ * row_is_in_frame
+		TupleTableSlot *outerslot = ExecProcNode(outerPlan);
+ *
+ * Determine whether a row is in the current row's window frame according
+ * to our window framing rule
+ *
+ * The caller must have already determined that the row is in the partition
+ * and fetched it into a slot.	This function just encapsulates the framing
+ * rules.
+ */
+static bool
+row_is_in_frame(WindowAggState *winstate, int64 pos, TupleTableSlot *slot)
+{
+	int			frameOptions = winstate->frameOptions;
+
+	Assert(pos >= 0);			/* else caller error */
+
+	/* First, check frame starting conditions */
+	if (frameOptions & FRAMEOPTION_START_CURRENT_ROW)
+	{
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			/* rows before current row are out of frame */
+			if (pos < winstate->currentpos)
+				return false;
+		}
+		else if (frameOptions & FRAMEOPTION_RANGE)
+		{
+			/* preceding row that is not peer is out of frame */
+//#ifdef WIN_FUN_OPT
+			if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
+				if (pos < winstate->currentpos &&
+					!are_peers(winstate, slot, winstate->opt_scantupslot))
+					return false;
+			}else{
+//#endif
+				if (pos < winstate->currentpos &&
+					!are_peers(winstate, slot, winstate->ss.ss_ScanTupleSlot))
+					return false;
+//#ifdef WIN_FUN_OPT
+			}
+//#endif
+		}
+		else
+			Assert(false);
+	}
+	else if (frameOptions & FRAMEOPTION_START_VALUE)
+	{
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			int64		offset = DatumGetInt64(winstate->startOffsetValue);
+
+			/* rows before current row + offset are out of frame */
+			if (frameOptions & FRAMEOPTION_START_VALUE_PRECEDING)
+				offset = -offset;
+
+			if (pos < winstate->currentpos + offset)
+				return false;
+		}
+		else if (frameOptions & FRAMEOPTION_RANGE)
+		{
+			/* rows before the frame head are out of frame */
+			Assert(winstate->framehead_valid);
+			if (pos < winstate->frameheadpos)
+				return false;
+		}
+		else
+			Assert(false);
+	}
+
+	/* Okay so far, now check frame ending conditions */
+	if (frameOptions & FRAMEOPTION_END_CURRENT_ROW)
+	{
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			/* rows after current row are out of frame */
+			if (pos > winstate->currentpos)
+				return false;
+		}
+		else if (frameOptions & FRAMEOPTION_RANGE)
+		{
+			/* following row that is not peer is out of frame */
+//#ifdef WIN_FUN_OPT
+			if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
+				if (pos > winstate->currentpos &&
+					!are_peers(winstate, slot, winstate->opt_scantupslot))
+					return false;
+			}else{
+//#endif
+				if (pos > winstate->currentpos &&
+					!are_peers(winstate, slot, winstate->ss.ss_ScanTupleSlot))
+					return false;
+//#ifdef WIN_FUN_OPT
+			}
+//#endif
+		}
+		else
+			Assert(false);
+	}
+	else if (frameOptions & FRAMEOPTION_END_VALUE)
+	{
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			int64		offset = DatumGetInt64(winstate->endOffsetValue);
+
+			/* rows after current row + offset are out of frame */
+			if (frameOptions & FRAMEOPTION_END_VALUE_PRECEDING)
+				offset = -offset;
+
+			if (pos > winstate->currentpos + offset)
+				return false;
+		}
+		else if (frameOptions & FRAMEOPTION_RANGE)
+		{
+			/* rows after the frame tail are out of frame */
+			Assert(winstate->frametail_valid);
+			if (pos > winstate->frametailpos)
+				return false;
+		}
+		else
+			Assert(false);
+	}
+
+	/* If we get here, it's in frame */
+	return true;
+}
+
+/*
+ * update_frameheadpos
+ * make frameheadpos valid for the current row
+ *
+ * Uses the winobj's read pointer for any required fetches; hence, if the
+ * frame mode is one that requires row comparisons, the winobj's mark must
+ * not be past the currently known frame head.	Also uses the specified slot
+ * for any required fetches.
+ */
+static void
+update_frameheadpos(WindowObject winobj, TupleTableSlot *slot)
+{
+	WindowAggState *winstate = winobj->winstate;
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	int			frameOptions = winstate->frameOptions;
+
+	if (winstate->framehead_valid)
+		return;					/* already known for current row */
+
+	if (frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING)
+	{
+		/* In UNBOUNDED PRECEDING mode, frame head is always row 0 */
+		winstate->frameheadpos = 0;
+		winstate->framehead_valid = true;
+	}
+	else if (frameOptions & FRAMEOPTION_START_CURRENT_ROW)
+	{
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			/* In ROWS mode, frame head is the same as current */
+			winstate->frameheadpos = winstate->currentpos;
+			winstate->framehead_valid = true;
+		}
+		else if (frameOptions & FRAMEOPTION_RANGE)
+		{
+			int64		fhprev;
+
+			/* If no ORDER BY, all rows are peers with each other */
+			if (node->ordNumCols == 0)
+			{
+				winstate->frameheadpos = 0;
+				winstate->framehead_valid = true;
+				return;
+			}
+
+			/*
+			 * In RANGE START_CURRENT mode, frame head is the first row that
+			 * is a peer of current row.  We search backwards from current,
+			 * which could be a bit inefficient if peer sets are large. Might
+			 * be better to have a separate read pointer that moves forward
+			 * tracking the frame head.
+			 */
+			fhprev = winstate->currentpos - 1;
+			for (;;)
+			{
+				/* assume the frame head can't go backwards */
+				if (fhprev < winstate->frameheadpos)
+					break;
+				if (!window_gettupleslot(winobj, fhprev, slot))
+					break;		/* start of partition */
+				if (!are_peers(winstate, slot, winstate->ss.ss_ScanTupleSlot))
+					break;		/* not peer of current row */
+				fhprev--;
+			}
+			winstate->frameheadpos = fhprev + 1;
+			winstate->framehead_valid = true;
+		}
+		else
+			Assert(false);
+	}
+	else if (frameOptions & FRAMEOPTION_START_VALUE)
+	{
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			/* In ROWS mode, bound is physically n before/after current */
+			int64		offset = DatumGetInt64(winstate->startOffsetValue);
+
+			if (frameOptions & FRAMEOPTION_START_VALUE_PRECEDING)
+				offset = -offset;
+
+			winstate->frameheadpos = winstate->currentpos + offset;
+			/* frame head can't go before first row */
+			if (winstate->frameheadpos < 0)
+				winstate->frameheadpos = 0;
+			else if (winstate->frameheadpos > winstate->currentpos)
+			{
+				/* make sure frameheadpos is not past end of partition */
+				spool_tuples(winstate, winstate->frameheadpos - 1);
+				if (winstate->frameheadpos > winstate->spooled_rows)
+					winstate->frameheadpos = winstate->spooled_rows;
+			}
+			winstate->framehead_valid = true;
+		}
+		else if (frameOptions & FRAMEOPTION_RANGE)
+		{
+			/*
+			 * In RANGE mode, the first row whose value is not
+			 * before the current one plus or minus the offset; the frame
+			 * head can't go backwards
+			 */
+			winstate->frameheadpos =
+				range_frame_bound(winobj, true, winstate->frameheadpos,
+								  slot, NULL, false);
+			winstate->framehead_valid = true;
+		}
+		else
+			Assert(false);
+	}
+	else
+		Assert(false);
+}
+
+/*
+ * update_frametailpos
+ * make frametailpos valid for the current row
+ *
+ * Uses the winobj's read pointer for any required fetches; hence, if the
+ * frame mode is one that requires row comparisons, the winobj's mark must
+ * not be past the currently known frame tail.	Also uses the specified slot
+ * for any required fetches.
+ */
+static void
+update_frametailpos(WindowObject winobj, TupleTableSlot *slot)
+{
+	WindowAggState *winstate = winobj->winstate;
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	int			frameOptions = winstate->frameOptions;
+
+	if (winstate->frametail_valid)
+		return;					/* already known for current row */
+
+	if (frameOptions & FRAMEOPTION_END_UNBOUNDED_FOLLOWING)
+	{
+		/* In UNBOUNDED FOLLOWING mode, all partition rows are in frame */
+		spool_tuples(winstate, -1);
+		winstate->frametailpos = winstate->spooled_rows - 1;
+		winstate->frametail_valid = true;
+	}
+	else if (frameOptions & FRAMEOPTION_END_CURRENT_ROW)
+	{
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			/* In ROWS mode, exactly the rows up to current are in frame */
+			winstate->frametailpos = winstate->currentpos;
+			winstate->frametail_valid = true;
+		}
+		else if (frameOptions & FRAMEOPTION_RANGE)
+		{
+			int64		ftnext;
+
+			/* If no ORDER BY, all rows are peers with each other */
+			if (node->ordNumCols == 0)
+			{
+				spool_tuples(winstate, -1);
+				winstate->frametailpos = winstate->spooled_rows - 1;
+				winstate->frametail_valid = true;
+				return;
+			}
+
+			/*
+			 * Else we have to search for the first non-peer of the current
+			 * row.  We assume the current value of frametailpos is a lower
+			 * bound on the possible frame tail location, ie, frame tail never
+			 * goes backward, and that currentpos is also a lower bound, ie,
+			 * frame end always >= current row.
+			 */
+			ftnext = Max(winstate->frametailpos, winstate->currentpos) + 1;
+			for (;;)
+			{
+				if (!window_gettupleslot(winobj, ftnext, slot))
+					break;		/* end of partition */
+				if (!are_peers(winstate, slot, winstate->ss.ss_ScanTupleSlot))
+					break;		/* not peer of current row */
+				ftnext++;
+			}
+			winstate->frametailpos = ftnext - 1;
+			winstate->frametail_valid = true;
+		}
+		else
+			Assert(false);
+	}
+	else if (frameOptions & FRAMEOPTION_END_VALUE)
+	{
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			/* In ROWS mode, bound is physically n before/after current */
+			int64		offset = DatumGetInt64(winstate->endOffsetValue);
+
+			if (frameOptions & FRAMEOPTION_END_VALUE_PRECEDING)
+				offset = -offset;
+
+			winstate->frametailpos = winstate->currentpos + offset;
+			/* smallest allowable value of frametailpos is -1 */
+			if (winstate->frametailpos < 0)
+				winstate->frametailpos = -1;
+			else if (winstate->frametailpos > winstate->currentpos)
+			{
+				/* make sure frametailpos is not past last row of partition */
+				spool_tuples(winstate, winstate->frametailpos);
+				if (winstate->frametailpos >= winstate->spooled_rows)
+					winstate->frametailpos = winstate->spooled_rows - 1;
+			}
+			winstate->frametail_valid = true;
+		}
+		else if (frameOptions & FRAMEOPTION_RANGE)
+		{
+			int64		lo;
+
+			/*
+			 * In RANGE mode, the last row whose value is not past
+			 * the current one plus or minus the offset.  Neither the frame
+			 * tail nor the frame head go backwards, and a tail before the
+			 * head just means an empty frame, so the search starts at both.
+			 */
+			update_frameheadpos(winobj, slot);
+			lo = Max(winstate->frametailpos + 1, winstate->frameheadpos);
+			winstate->frametailpos =
+				range_frame_bound(winobj, false, lo, slot, NULL, false) - 1;
+			winstate->frametail_valid = true;
+		}
+		else
+			Assert(false);
+	}
+	else
+		Assert(false);
+}
+
+/*
+ * range_frame_bound
+ * locate a bound of a RANGE frame with a value offset
+ *
+ * Returns the first row at or after lo that is past the bound: for the
+ * frame head, the first row in or after the frame; for the tail, the first
+ * row after it.  The partition is sorted on the column, so rather than
+ * stepping from lo we gallop ahead in doubling steps and bisect the last
+ * one, which costs a number of fetches logarithmic in the distance the
+ * bound moves.  The rows from lo on must be fetchable through winobj.
+ *
+ * A bound that overflows the column type lies beyond every value on its
+ * side of the current row, as if the frame were unbounded on that side.
+ */
+static int64
+range_frame_bound(WindowObject winobj, bool isStart, int64 lo,
+				  TupleTableSlot *slot, TupleTableSlot *opt_slot, bool reuse)
+{
+	WindowAggState *winstate = winobj->winstate;
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	int			frameOptions = winstate->frameOptions;
+	TupleTableSlot *curslot = winstate->ss.ss_ScanTupleSlot;
+	AttrNumber	curattno = node->ordColIdx[0];
+	MemoryContext oldcontext;
+	Datum		cur;
+	bool		curisnull;
+	Datum		bound = (Datum) 0;
+	int			boundside = 0;
+	int64		hi;
+	int64		step;
+
+	if (enable_winfunopt && opt_slot != NULL &&
+		!tuplestore_in_memory(winstate->buffer))
+	{
+		curslot = winstate->opt_scantupslot;
+		curattno = node->opt_ordColIdx[0];
+	}
+
+	oldcontext = MemoryContextSwitchTo(winstate->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
+	cur = slot_getattr(curslot, curattno, &curisnull);
+	if (!curisnull)
+	{
+		FmgrInfo   *cmp;
+		bool		sub;
+		bool		inrange;
+		int32		c = 0;
+
+		/* the parser chose + or - by the direction of the bound */
+		if (isStart)
+		{
+			inrange = range_frame_offset(&winstate->startInRangeFunc, cur,
+										 winstate->startOffsetValue, &bound);
+			cmp = &winstate->startInRangeCmp;
+			sub = (frameOptions & FRAMEOPTION_START_VALUE_PRECEDING) != 0;
+		}
+		else
+		{
+			inrange = range_frame_offset(&winstate->endInRangeFunc, cur,
+										 winstate->endOffsetValue, &bound);
+			cmp = &winstate->endInRangeCmp;
+			sub = (frameOptions & FRAMEOPTION_END_VALUE_PRECEDING) != 0;
+		}
+		if (!winstate->inRangeAsc)
+			sub = !sub;
+
+		if (inrange)
+			c = DatumGetInt32(FunctionCall2Coll(cmp, winstate->inRangeColl,
+												cur, bound));
+		else if (sub == winstate->inRangeAsc)
+			boundside = -1;		/* below every value, ascending */
+		else
+			boundside = 1;
+
+		/* a negative offset puts the bound on the wrong side */
+		if (sub ? c < 0 : c > 0)
+		{
+			if (isStart)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				  errmsg("frame starting offset must not be negative")));
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("frame ending offset must not be negative")));
+		}
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	if (range_frame_past(winobj, isStart, lo, curisnull, bound, boundside,
+						 slot, opt_slot, reuse))
+		return lo;
+
+	/* gallop: lo is not past the bound ... */
+	step = 1;
+	for (;;)
+	{
+		hi = lo + step;
+		if (range_frame_past(winobj, isStart, hi, curisnull, bound, boundside,
+							 slot, opt_slot, reuse))
+			break;
+		lo = hi;
+		step *= 2;
+	}
+
+	/* ... and hi is, so bisect between them */
+	while (hi - lo > 1)
+	{
+		int64		mid = lo + (hi - lo) / 2;
+
+		if (range_frame_past(winobj, isStart, mid, curisnull, bound, boundside,
+							 slot, opt_slot, reuse))
+			hi = mid;
+		else
+			lo = mid;
+	}
+	return hi;
+}
+
+/*
+ * range_frame_offset
+ * add or subtract a RANGE offset to or from the current value.
+ *
+ * Returns false if the result would be out of the range of the type.  That
+ * is checked against the type's bounds before the call, and only for the
+ * built-in integer, float, numeric and datetime +/- functions; an error
+ * from any other function is raised as usual, since swallowing it would
+ * need a subtransaction.
+ */
+static bool
+range_frame_offset(FmgrInfo *func, Datum cur, Datum offset, Datum *bound)
+{
+	int64		a = 0;
+	int64		b = 0;
+	int64		min = 0;
+	int64		max = 0;
+	bool		sub = false;
+	bool		wide = false;
+
+	switch (func->fn_oid)
+	{
+		case F_INT2MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_INT2PL:
+			a = DatumGetInt16(cur);
+			b = DatumGetInt16(offset);
+			min = SHRT_MIN;
+			max = SHRT_MAX;
+			break;
+		case F_INT24MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_INT24PL:
+			a = DatumGetInt16(cur);
+			b = DatumGetInt32(offset);
+			min = INT_MIN;
+			max = INT_MAX;
+			break;
+		case F_INT42MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_INT42PL:
+			a = DatumGetInt32(cur);
+			b = DatumGetInt16(offset);
+			min = INT_MIN;
+			max = INT_MAX;
+			break;
+		case F_INT4MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_INT4PL:
+			a = DatumGetInt32(cur);
+			b = DatumGetInt32(offset);
+			min = INT_MIN;
+			max = INT_MAX;
+			break;
+		case F_DATE_MII:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_DATE_PLI:
+			/* these don't check, they would wrap around */
+			a = DatumGetDateADT(cur);
+			b = DatumGetInt32(offset);
+			min = INT_MIN;
+			max = INT_MAX;
+			break;
+		case F_INT8MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_INT8PL:
+			a = DatumGetInt64(cur);
+			b = DatumGetInt64(offset);
+			wide = true;
+			break;
+		case F_INT28MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_INT28PL:
+			a = DatumGetInt16(cur);
+			b = DatumGetInt64(offset);
+			wide = true;
+			break;
+		case F_INT82MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_INT82PL:
+			a = DatumGetInt64(cur);
+			b = DatumGetInt16(offset);
+			wide = true;
+			break;
+		case F_INT48MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_INT48PL:
+			a = DatumGetInt32(cur);
+			b = DatumGetInt64(offset);
+			wide = true;
+			break;
+		case F_INT84MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_INT84PL:
+			a = DatumGetInt64(cur);
+			b = DatumGetInt32(offset);
+			wide = true;
+			break;
+		case F_FLOAT4MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_FLOAT4PL:
+			{
+				float4		fa = DatumGetFloat4(cur);
+				float4		fb = DatumGetFloat4(offset);
+				float4		fr = sub ? fa - fb : fa + fb;
+
+				if (isinf(fr) && !isinf(fa) && !isinf(fb))
+					return false;
+				break;
+			}
+		case F_FLOAT8MI:
+		case F_FLOAT48MI:
+		case F_FLOAT84MI:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_FLOAT8PL:
+		case F_FLOAT48PL:
+		case F_FLOAT84PL:
+			{
+				float8		fa;
+				float8		fb;
+				float8		fr;
+
+				fa = (func->fn_oid == F_FLOAT48PL ||
+					  func->fn_oid == F_FLOAT48MI) ?
+					DatumGetFloat4(cur) : DatumGetFloat8(cur);
+				fb = (func->fn_oid == F_FLOAT84PL ||
+					  func->fn_oid == F_FLOAT84MI) ?
+					DatumGetFloat4(offset) : DatumGetFloat8(offset);
+				fr = sub ? fa - fb : fa + fb;
+				if (isinf(fr) && !isinf(fa) && !isinf(fb))
+					return false;
+				break;
+			}
+		case F_NUMERIC_ADD:
+		case F_NUMERIC_SUB:
+			{
+				bool		have_error = false;
+				Numeric		res;
+
+				if (func->fn_oid == F_NUMERIC_SUB)
+					res = numeric_sub_opt_error(DatumGetNumeric(cur),
+												DatumGetNumeric(offset),
+												&have_error);
+				else
+					res = numeric_add_opt_error(DatumGetNumeric(cur),
+												DatumGetNumeric(offset),
+												&have_error);
+				if (have_error)
+					return false;
+				*bound = NumericGetDatum(res);
+				return true;
+			}
+		case F_TIMESTAMP_MI_INTERVAL:
+		case F_TIMESTAMPTZ_MI_INTERVAL:
+		case F_DATE_MI_INTERVAL:
+			sub = true;
+			/* FALLTHROUGH */
+		case F_TIMESTAMP_PL_INTERVAL:
+		case F_TIMESTAMPTZ_PL_INTERVAL:
+		case F_DATE_PL_INTERVAL:
+			{
+				Interval	span = *DatumGetIntervalP(offset);
+				Timestamp	ts;
+				Timestamp	res;
+				bool		ok;
+
+				if (sub)
+				{
+					span.month = -span.month;
+					span.day = -span.day;
+					span.time = -span.time;
+				}
+				if (func->fn_oid == F_DATE_PL_INTERVAL ||
+					func->fn_oid == F_DATE_MI_INTERVAL)
+				{
+					if (!date2timestamp_opt_overflow(DatumGetDateADT(cur), &ts))
+						return false;
+				}
+				else
+					ts = DatumGetTimestamp(cur);
+				if (func->fn_oid == F_TIMESTAMPTZ_PL_INTERVAL ||
+					func->fn_oid == F_TIMESTAMPTZ_MI_INTERVAL)
+					ok = timestamptz_add_interval(ts, &span, &res);
+				else
+					ok = timestamp_add_interval(ts, &span, &res);
+				if (!ok)
+					return false;
+				*bound = TimestampGetDatum(res);
+				return true;
+			}
+		default:
+			break;
+	}
+
+	if (wide)
+	{
+		int64		r = sub ? a - b : a + b;
+
+		/* same test as int8pl and int8mi */
+		if ((sub ? !RANGE_SAMESIGN(a, b) : RANGE_SAMESIGN(a, b)) &&
+			!RANGE_SAMESIGN(r, a))
+			return false;
+	}
+	else if (max > min)
+	{
+		int64		r = sub ? a - b : a + b;
+
+		if (r < min || r > max)
+			return false;
+	}
+
+	*bound = FunctionCall2(func, cur, offset);
+	return true;
+}
+
+/*
+ * range_frame_past
+ * is the row at pos past the bound range_frame_bound looks for?
+ *
+ * Rows past the end of the partition are.  Nulls sort together at one end
+ * and are peers, whatever the offset: a null current row's frame is the
+ * nulls, and a null row is in no other row's frame.  A boundside of -1 or 1
+ * stands for a bound before or after every value in the ordering.
+ */
+static bool
+range_frame_past(WindowObject winobj, bool isStart, int64 pos,
+				 bool curisnull, Datum bound, int boundside,
+				 TupleTableSlot *slot, TupleTableSlot *opt_slot, bool reuse)
+{
+	WindowAggState *winstate = winobj->winstate;
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	TupleTableSlot *rowslot = slot;
+	AttrNumber	attno = node->ordColIdx[0];
+	Datum		value;
+	bool		isnull;
+	int32		c;
+
+	if (reuse)
+	{
+		if (!reuse_window_gettupleslot(winobj, pos, slot))
+			return true;
+	}
+	else if (enable_winfunopt && opt_slot != NULL)
+	{
+		if (!opt_window_gettupleslot(winobj, pos, slot, opt_slot))
+			return true;
+		/* slot or opt_slot has the row, depending on the status */
+		if (!tuplestore_in_memory(winstate->buffer))
+		{
+			rowslot = opt_slot;
+			attno = node->opt_ordColIdx[0];
+		}
+	}
+	else if (!window_gettupleslot(winobj, pos, slot))
+		return true;
+
+	value = slot_getattr(rowslot, attno, &isnull);
+	if (isnull || curisnull)
+	{
+		if (isnull && curisnull)
+			return isStart;
+		return isnull ? !winstate->inRangeNullsFirst :
+			winstate->inRangeNullsFirst;
+	}
+	if (boundside != 0)
+		return boundside < 0;
+
+	c = DatumGetInt32(FunctionCall2Coll(isStart ? &winstate->startInRangeCmp :
+										&winstate->endInRangeCmp,
+										winstate->inRangeColl,
+										value, bound));
+	if (isStart)
+		return winstate->inRangeAsc ? c >= 0 : c <= 0;
+	return winstate->inRangeAsc ? c > 0 : c < 0;
+}
+
+/*
+ * compute_frame_offsets
+ * Evaluate the frame offset expressions of winstate, if any.
+ */
+static void
+compute_frame_offsets(WindowAggState *winstate)
+{
+	int			frameOptions = winstate->frameOptions;
+	ExprContext *econtext = winstate->ss.ps.ps_ExprContext;
+	Datum		value;
+	bool		isnull;
+	int16		len;
+	bool		byval;
+
+	if (frameOptions & FRAMEOPTION_START_VALUE)
+	{
+		Assert(winstate->startOffset != NULL);
+		value = ExecEvalExprSwitchContext(winstate->startOffset,
+										  econtext,
+										  &isnull,
+										  NULL);
+		if (isnull)
+			ereport(ERROR,
+					(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+					 errmsg("frame starting offset must not be null")));
+		/* copy value into query-lifespan context */
+		get_typlenbyval(exprType((Node *) winstate->startOffset->expr),
+						&len, &byval);
+		winstate->startOffsetValue = datumCopy(value, byval, len);
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			/* value is known to be int8 */
+			int64		offset = DatumGetInt64(value);
+
+			if (offset < 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				  errmsg("frame starting offset must not be negative")));
+		}
+	}
+	if (frameOptions & FRAMEOPTION_END_VALUE)
+	{
+		Assert(winstate->endOffset != NULL);
+		value = ExecEvalExprSwitchContext(winstate->endOffset,
+										  econtext,
+										  &isnull,
+										  NULL);
+		if (isnull)
+			ereport(ERROR,
+					(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+					 errmsg("frame ending offset must not be null")));
+		/* copy value into query-lifespan context */
+		get_typlenbyval(exprType((Node *) winstate->endOffset->expr),
+						&len, &byval);
+		winstate->endOffsetValue = datumCopy(value, byval, len);
+		if (frameOptions & FRAMEOPTION_ROWS)
+		{
+			/* value is known to be int8 */
+			int64		offset = DatumGetInt64(value);
+
+			if (offset < 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("frame ending offset must not be negative")));
+		}
+	}
+}
+
+/* -----------------
+ * ExecWindowAgg
+ *
+ *	ExecWindowAgg receives tuples from its outer subplan and
+ *	stores them into a tuplestore, then processes window functions.
+ *	This node doesn't reduce nor qualify any row so the number of
+ *	returned rows is exactly the same as its outer subplan's result
+ *	(ignoring the case of SRFs in the targetlist, that is).
+ * -----------------
+ */
+TupleTableSlot *
+ExecWindowAgg(WindowAggState *winstate)
+{
+	TupleTableSlot *result;
+	ExprDoneCond isDone;
+	ExprContext *econtext;
+	int			i;
+	int			numfuncs;
+
+	if (winstate->all_done)
+		return NULL;
+
+	/*
+	 * Check to see if we're still projecting out tuples from a previous
+	 * output tuple (because there is a function-returning-set in the
+	 * projection expressions).  If so, try to project another one.
+	 */
+	if (winstate->ss.ps.ps_TupFromTlist)
+	{
+		TupleTableSlot *result;
+		ExprDoneCond isDone;
+
+		result = ExecProject(winstate->ss.ps.ps_ProjInfo, &isDone);
+		if (isDone == ExprMultipleResult)
+			return result;
+		/* Done with that source tuple... */
+		winstate->ss.ps.ps_TupFromTlist = false;
+	}
+
+	/*
+	 * Compute frame offset values, if any, during first call.
+	 */
+	if (winstate->all_first)
+	{
+		compute_frame_offsets(winstate);
+		for (i = 0; i < winstate->numframes; i++)
+			compute_frame_offsets(winstate->frames[i]);
+		winstate->all_first = false;
+	}
+
+restart:
+	if (winstate->buffer == NULL)
+	{
+		/* Initialize for first partition and set current row = 0 */
+		begin_partition(winstate);
+		/* If there are no input rows, we'll detect that and exit below */
+	}
+	else
+	{
+		/* Advance current row within partition */
+		winstate->currentpos++;
+		/* This might mean that the frame moves, too */
+		winstate->framehead_valid = false;
+		winstate->frametail_valid = false;
+		for (i = 0; i < winstate->numframes; i++)
+		{
+			winstate->frames[i]->framehead_valid = false;
+			winstate->frames[i]->frametail_valid = false;
+		}
+	}
+
+	/*
+	 * Spool all tuples up to and including the current row, if we haven't
+	 * already
+	 */
+	spool_tuples(winstate, winstate->currentpos);
+
+	/* Move to the next partition if we reached the end of this partition */
+	if (winstate->partition_spooled &&
+		winstate->currentpos >= winstate->spooled_rows)
+	{
+		release_partition(winstate);
+
+		if (winstate->more_partitions)
+		{
+			begin_partition(winstate);
+			Assert(winstate->spooled_rows > 0);
+		}
+		else
+		{
+			winstate->all_done = true;
+			return NULL;
+		}
+	}
+
+	//if(TupIsNull(winstate->ss.ss_ScanTupleSlot))
+	//	ExecClearTuple(winstate->ss.ss_ScanTupleSlot);
+
+	/* final output execution is in ps_ExprContext */
+	econtext = winstate->ss.ps.ps_ExprContext;
+
+	/* Clear the per-output-tuple context for current row */
+	ResetExprContext(econtext);
+
+	/*
+	 * Read the current row from the tuplestore, and save in ScanTupleSlot.
+	 * (We can't rely on the outerplan's output slot because we may have to
+	 * read beyond the current row.  Also, we have to actually copy the row
+	 * out of the tuplestore, since window function evaluation might cause the
+	 * tuplestore to dump its state to disk.)
+	 *
+	 * Current row must be in the tuplestore, since we spooled it above.
+	 */
+//#ifdef WIN_FUN_OPT
+	/*
+	 * When in memory, same as before
+	 * When on tape, scan forward on buffer.init_file to get the ScanTupleSlot
+	 */
+	if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
+		init_tuplestore_select_read_pointer(winstate->buffer, winstate->current_ptr);
+		//opt_tuplestore_gettupleslot(winstate->buffer, true, true, winstate->opt_scantupslot);
+		if (!init_tuplestore_gettupleslot(winstate->buffer, true, true,
+									 winstate->ss.ss_ScanTupleSlot))
+			elog(ERROR, "unexpected end of tuplestore");
+	}else{
+//#endif
+		tuplestore_select_read_pointer(winstate->buffer, winstate->current_ptr);
+		if (!tuplestore_gettupleslot(winstate->buffer, true, true,
+									 winstate->ss.ss_ScanTupleSlot))
+			elog(ERROR, "unexpected end of tuplestore");
+//#ifdef WIN_FUN_OPT
+	}
+//#endif
+
+//#ifdef WIN_FUN_OPT
+	/*
+	 * get the opt tuple slot of the scan tuple slot, for the operations follow-up
+	 */
+	if(enable_winfunopt)
+		tuplestore_convert_to_opt(winstate->buffer, winstate->ss.ss_ScanTupleSlot, winstate->opt_scantupslot);
+//#endif
+
+	/*
+	 * The function of the run condition goes first.  It never
+	 * decreases within the partition, so once it is past the limit no later
+	 * row passes the qual above us either, and we move on to the next
+	 * partition without computing anything else for them.
+	 */
+	if (winstate->opt_runfunc != NULL)
+	{
+		WindowStatePerFunc perfuncstate = winstate->opt_runfunc;
+		WindowAggState *frame = perfuncstate->winobj->winstate;
+		int			wfuncno = perfuncstate->wfuncstate->wfuncno;
+
+		if (frame != winstate)
+			enter_frame(winstate, frame);
+		eval_windowfunction(winstate, perfuncstate,
+							&(econtext->ecxt_aggvalues[wfuncno]),
+							&(econtext->ecxt_aggnulls[wfuncno]));
+		if (frame != winstate)
+			leave_frame(winstate, frame);
+		if (!econtext->ecxt_aggnulls[wfuncno] &&
+			DatumGetInt64(econtext->ecxt_aggvalues[wfuncno]) > winstate->opt_runlimit)
+		{
+//#ifdef WIN_FUN_OPT
+			if (enable_winfunopt)
+				ExecClearTuple(winstate->opt_scantupslot);
+//#endif
+			skip_partition(winstate);
+			goto restart;
+		}
+	}
+
+	/*
+	 * Evaluate true window functions
+	 */
+	numfuncs = winstate->numfuncs;
+	for (i = 0; i < numfuncs; i++)
+	{
+		WindowStatePerFunc perfuncstate = &(winstate->perfunc[i]);
+		WindowAggState *frame;
+
+		if (perfuncstate->plain_agg || perfuncstate == winstate->opt_runfunc)
+			continue;
+
+		/* the function's WindowObject belongs to the frame of its window */
+		frame = perfuncstate->winobj->winstate;
+		if (frame != winstate)
+			enter_frame(winstate, frame);
+		eval_windowfunction(winstate, perfuncstate,
+			  &(econtext->ecxt_aggvalues[perfuncstate->wfuncstate->wfuncno]),
+			  &(econtext->ecxt_aggnulls[perfuncstate->wfuncstate->wfuncno]));
+		if (frame != winstate)
+			leave_frame(winstate, frame);
+	}
+
+	/*
+	 * Evaluate aggregates
+	 */
+	if (winstate->numaggs > 0)
+		eval_windowaggregates(winstate);
+	for (i = 0; i < winstate->numframes; i++)
+	{
+		WindowAggState *frame = winstate->frames[i];
+
+		if (frame->numaggs > 0)
+		{
+			enter_frame(winstate, frame);
+			eval_windowaggregates(frame);
+			leave_frame(winstate, frame);
+		}
+	}
+
+	/*
+	 * Truncate any no-longer-needed rows from the tuplestore.
+	 */
+	tuplestore_trim(winstate->buffer);
+
+	/*
+	 * Form and return a projection tuple using the windowfunc results and the
+	 * current row.  Setting ecxt_outertuple arranges that any Vars will be
+	 * evaluated with respect to that row.
+	 */
+	econtext->ecxt_outertuple = winstate->ss.ss_ScanTupleSlot;
+	result = ExecProject(winstate->ss.ps.ps_ProjInfo, &isDone);
+
+//#ifdef WIN_FUN_OPT
+	if(enable_winfunopt)
+		ExecClearTuple(winstate->opt_scantupslot);
+//#endif
+
+	if (isDone == ExprEndResult)
+	{
+		/* SRF in tlist returned no rows, so advance to next input tuple */
+		goto restart;
+	}
+
+	winstate->ss.ps.ps_TupFromTlist =
+		(isDone == ExprMultipleResult);
+	return result;
+}
+
+/* -----------------
+ * ExecInitWindowAgg
+ *
+ *	Creates the run-time information for the WindowAgg node produced by the
+ *	planner and initializes its outer subtree
+ * -----------------
+ */
+WindowAggState *
+ExecInitWindowAgg(WindowAgg *node, EState *estate, int eflags)
+{
+	WindowAggState *winstate;
+	Plan	   *outerPlan;
+	ExprContext *econtext;
+	ExprContext *tmpcontext;
+	WindowStatePerFunc perfunc;
+	WindowStatePerAgg peragg;
+	int			numfuncs,
+				wfuncno,
+				numaggs,
+				aggno,
+				shareno;
+	int			numframes;
+	int		   *frameaggs;
+	int		   *frameshares;
+	ListCell   *l;
+
+//#ifdef WIN_FUN_OPT
+	int			i;
+	List		*opt_targetList = NIL;	/* NOTE: to initial a List, just set to NIL, do not use makeNode() */
+	TupleDesc	opt_tupdesc;
+	//int			usefulNum;
+	int			opt_maxPos;
+//#endif
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	winstate = makeNode(WindowAggState);
+	winstate->ss.ps.plan = (Plan *) node;
+	winstate->ss.ps.state = estate;
+
+	/*
+	 * Create expression contexts.	We need two, one for per-input-tuple
+	 * processing and one for per-output-tuple processing.	We cheat a little
+	 * by using ExecAssignExprContext() to build both.
+	 */
+	ExecAssignExprContext(estate, &winstate->ss.ps);
+	tmpcontext = winstate->ss.ps.ps_ExprContext;
+	winstate->tmpcontext = tmpcontext;
+	ExecAssignExprContext(estate, &winstate->ss.ps);
+
+	/* Create long-lived context for storage of partition-local memory etc */
+	winstate->partcontext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "WindowAgg_Partition",
+							  ALLOCSET_DEFAULT_MINSIZE,
+							  ALLOCSET_DEFAULT_INITSIZE,
+							  ALLOCSET_DEFAULT_MAXSIZE);
+
+	/* Create mid-lived context for aggregate trans values etc */
+	winstate->aggcontext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "WindowAgg_Aggregates",
+							  ALLOCSET_DEFAULT_MINSIZE,
+							  ALLOCSET_DEFAULT_INITSIZE,
+							  ALLOCSET_DEFAULT_MAXSIZE);
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitScanTupleSlot(estate, &winstate->ss);
+	ExecInitResultTupleSlot(estate, &winstate->ss.ps);
+	winstate->first_part_slot = ExecInitExtraTupleSlot(estate);
+	winstate->agg_row_slot = ExecInitExtraTupleSlot(estate);
+	winstate->temp_slot_1 = ExecInitExtraTupleSlot(estate);
+	winstate->temp_slot_2 = ExecInitExtraTupleSlot(estate);
+
+	winstate->ss.ps.targetlist = (List *)
+		ExecInitExpr((Expr *) node->plan.targetlist,
+					 (PlanState *) winstate);
+
+
+
+	/*
+	 * WindowAgg nodes never have quals, since they can only occur at the
+	 * logical top level of a query (ie, after any WHERE or HAVING filters)
+	 */
+	Assert(node->plan.qual == NIL);
+	winstate->ss.ps.qual = NIL;
+
+	/*
+	 * initialize child nodes
+	 */
+	outerPlan = outerPlan(node);
+	outerPlanState(winstate) = ExecInitNode(outerPlan, estate, eflags);
+
+	/*
+	 * initialize source tuple type (which is also the tuple type that we'll
+	 * store in the tuplestore and use in all our working slots).
+	 */
+	ExecAssignScanTypeFromOuterPlan(&winstate->ss);
+
+	ExecSetSlotDescriptor(winstate->first_part_slot,
+						  winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+	ExecSetSlotDescriptor(winstate->agg_row_slot,
+						  winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+	ExecSetSlotDescriptor(winstate->temp_slot_1,
+						  winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+	ExecSetSlotDescriptor(winstate->temp_slot_2,
+						  winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+
+	/*
+	 * Initialize result tuple type and projection info.
+	 */
+	ExecAssignResultTypeFromTL(&winstate->ss.ps);
+	ExecAssignProjectionInfo(&winstate->ss.ps, NULL);
+
+	winstate->ss.ps.ps_TupFromTlist = false;
+
+	/* Set up data for comparing tuples */
+	if (node->partNumCols > 0)
+		winstate->partEqfunctions = execTuplesMatchPrepare(node->partNumCols,
+														node->partOperators);
+	if (node->ordNumCols > 0)
+		winstate->ordEqfunctions = execTuplesMatchPrepare(node->ordNumCols,
+														  node->ordOperators);
+
+//#ifdef WIN_FUN_OPT
+	if(enable_winfunopt){
+		/*
+		 * the useful attributes are chosen by the planner, see
+		 * set_windowagg_spill_columns(); the order by columns come first,
+		 * and node->opt_ordColIdx gives their useful attribute numbers.
+		 */
+		winstate->useful2init = (AttrNumber*)palloc(sizeof(AttrNumber)*(node->spillNumCols+1)); /* start from 1, index 0 stores the number */
+		winstate->init2useful = (AttrNumber*)palloc(sizeof(AttrNumber)*(winstate->agg_row_slot->tts_tupleDescriptor->natts+1)); /* start from 1*/
+		memset(winstate->init2useful, -1, sizeof(AttrNumber)*(winstate->agg_row_slot->tts_tupleDescriptor->natts+1));
+
+		winstate->useful2init[0] = node->spillNumCols;
+		for(i=1; i<=node->spillNumCols; i++){
+			winstate->useful2init[i] = node->spillColIdx[i-1];
+			winstate->init2useful[node->spillColIdx[i-1]] = i;
+		}
+	}
+//#endif
+
+	/*
+	 * The functions of the further windows in node->extraWinrefs are
+	 * evaluated in frames of their own over the same buffer.  Order the
+	 * functions by frame, so that the aggregates of each frame are
+	 * contiguous in peragg.  Functions of unknown windows go last, to be
+	 * complained about below.
+	 */
+	numframes = list_length(node->extraWinrefs) + 1;
+	if (numframes > 1)
+	{
+		List	   *funcs = NIL;
+		int			frameno;
 
-			/*
-			 * Else we have to search for the first non-peer of the current
-			 * row.  We assume the current value of frametailpos is a lower
-			 * bound on the possible frame tail location, ie, frame tail never
-			 * goes backward, and that currentpos is also a lower bound, ie,
-			 * frame end always >= current row.
-			 */
-			ftnext = Max(winstate->frametailpos, winstate->currentpos) + 1;
-			for (;;)
+		for (frameno = 0; frameno <= numframes; frameno++)
+		{
+			foreach(l, winstate->funcs)
 			{
-				if (!window_gettupleslot(winobj, ftnext, slot))
-					break;		/* end of partition */
-				if (!are_peers(winstate, slot, winstate->ss.ss_ScanTupleSlot))
-					break;		/* not peer of current row */
-				ftnext++;
+				WindowFuncExprState *wfuncstate = (WindowFuncExprState *) lfirst(l);
+				WindowFunc *wfunc = (WindowFunc *) wfuncstate->xprstate.expr;
+				int			wframeno = window_frameno(node, wfunc->winref);
+
+				if (wframeno == (frameno < numframes ? frameno : -1))
+					funcs = lappend(funcs, wfuncstate);
 			}
-			winstate->frametailpos = ftnext - 1;
-			winstate->frametail_valid = true;
 		}
-		else
-			Assert(false);
+		winstate->funcs = funcs;
 	}
-	else if (frameOptions & FRAMEOPTION_END_VALUE)
+	frameaggs = (int *) palloc0(sizeof(int) * numframes);
+
+	/*
+	 * WindowAgg nodes use aggvalues and aggnulls as well as Agg nodes.
+	 */
+	numfuncs = winstate->numfuncs;
+	numaggs = winstate->numaggs;
+	econtext = winstate->ss.ps.ps_ExprContext;
+	econtext->ecxt_aggvalues = (Datum *) palloc0(sizeof(Datum) * numfuncs);
+	econtext->ecxt_aggnulls = (bool *) palloc0(sizeof(bool) * numfuncs);
+
+	/*
+	 * allocate per-wfunc/per-agg state information.
+	 */
+	perfunc = (WindowStatePerFunc) palloc0(sizeof(WindowStatePerFuncData) * numfuncs);
+	peragg = (WindowStatePerAgg) palloc0(sizeof(WindowStatePerAggData) * numaggs);
+	winstate->perfunc = perfunc;
+	winstate->peragg = peragg;
+
+	wfuncno = -1;
+	aggno = -1;
+	foreach(l, winstate->funcs)
 	{
-		if (frameOptions & FRAMEOPTION_ROWS)
-		{
-			/* In ROWS mode, bound is physically n before/after current */
-			int64		offset = DatumGetInt64(winstate->endOffsetValue);
+		WindowFuncExprState *wfuncstate = (WindowFuncExprState *) lfirst(l);
+		WindowFunc *wfunc = (WindowFunc *) wfuncstate->xprstate.expr;
+		WindowStatePerFunc perfuncstate;
+		AclResult	aclresult;
+		int			i;
 
-			if (frameOptions & FRAMEOPTION_END_VALUE_PRECEDING)
-				offset = -offset;
+		if (window_frameno(node, wfunc->winref) < 0)	/* planner screwed up? */
+			elog(ERROR, "WindowFunc with winref %u assigned to WindowAgg with winref %u",
+				 wfunc->winref, node->winref);
 
-			winstate->frametailpos = winstate->currentpos + offset;
-			/* smallest allowable value of frametailpos is -1 */
-			if (winstate->frametailpos < 0)
-				winstate->frametailpos = -1;
-			else if (winstate->frametailpos > winstate->currentpos)
-			{
-				/* make sure frametailpos is not past last row of partition */
-				spool_tuples(winstate, winstate->frametailpos);
-				if (winstate->frametailpos >= winstate->spooled_rows)
-					winstate->frametailpos = winstate->spooled_rows - 1;
-			}
-			winstate->frametail_valid = true;
+		/* Look for a previous duplicate window function */
+		for (i = 0; i <= wfuncno; i++)
+		{
+			if (equal(wfunc, perfunc[i].wfunc) &&
+				!contain_volatile_functions((Node *) wfunc))
+				break;
 		}
-		else if (frameOptions & FRAMEOPTION_RANGE)
+		if (i <= wfuncno)
 		{
-			/* parser should have rejected this */
-			elog(ERROR, "window frame with value offset is not implemented");
+			/* Found a match to an existing entry, so just mark it */
+			wfuncstate->wfuncno = i;
+			continue;
 		}
-		else
-			Assert(false);
-	}
-	else
-		Assert(false);
-}
 
+		/* Nope, so assign a new PerAgg record */
+		perfuncstate = &perfunc[++wfuncno];
 
-/* -----------------
- * ExecWindowAgg
- *
- *	ExecWindowAgg receives tuples from its outer subplan and
- *	stores them into a tuplestore, then processes window functions.
- *	This node doesn't reduce nor qualify any row so the number of
- *	returned rows is exactly the same as its outer subplan's result
- *	(ignoring the case of SRFs in the targetlist, that is).
- * -----------------
- */
-TupleTableSlot *
-ExecWindowAgg(WindowAggState *winstate)
-{
-	TupleTableSlot *result;
-	ExprDoneCond isDone;
-	ExprContext *econtext;
-	int			i;
-	int			numfuncs;
+		/* Mark WindowFunc state node with assigned index in the result array */
+		wfuncstate->wfuncno = wfuncno;
 
-	if (winstate->all_done)
-		return NULL;
+		/* Check permission to call window function */
+		aclresult = pg_proc_aclcheck(wfunc->winfnoid, GetUserId(),
+									 ACL_EXECUTE);
+		if (aclresult != ACLCHECK_OK)
+			aclcheck_error(aclresult, ACL_KIND_PROC,
+						   get_func_name(wfunc->winfnoid));
 
-	/*
-	 * Check to see if we're still projecting out tuples from a previous
-	 * output tuple (because there is a function-returning-set in the
-	 * projection expressions).  If so, try to project another one.
-	 */
-	if (winstate->ss.ps.ps_TupFromTlist)
-	{
-		TupleTableSlot *result;
-		ExprDoneCond isDone;
+		/* Fill in the perfuncstate data */
+		perfuncstate->wfuncstate = wfuncstate;
+		perfuncstate->wfunc = wfunc;
+		perfuncstate->numArguments = list_length(wfuncstate->args);
+
+		fmgr_info_cxt(wfunc->winfnoid, &perfuncstate->flinfo,
+					  econtext->ecxt_per_query_memory);
+		fmgr_info_set_expr((Node *) wfunc, &perfuncstate->flinfo);
+
+		perfuncstate->winCollation = wfunc->inputcollid;
+
+		get_typlenbyval(wfunc->wintype,
+						&perfuncstate->resulttypeLen,
+						&perfuncstate->resulttypeByVal);
+
+		/*
+		 * If it's really just a plain aggregate function, we'll emulate the
+		 * Agg environment for it.
+		 */
+		perfuncstate->plain_agg = wfunc->winagg;
+		if (wfunc->winagg)
+		{
+			WindowStatePerAgg peraggstate;
+
+			perfuncstate->aggno = ++aggno;
+			peraggstate = &winstate->peragg[aggno];
+			initialize_peragg(winstate, wfunc, peraggstate);
+			peraggstate->wfuncno = wfuncno;
+			frameaggs[window_frameno(node, wfunc->winref)]++;
+		}
+		else
+		{
+			WindowObject winobj = makeNode(WindowObjectData);
+
+			winobj->winstate = winstate;
+			winobj->argstates = wfuncstate->args;
+			winobj->localmem = NULL;
+			perfuncstate->winobj = winobj;
+		}
+
+		/* add by cywang */
+//#ifdef WIN_FUN_OPT
+		if(enable_winfunopt){
+			/*
+			 * initial the alternative arguments of a window function, WindowFuncExprState.opt_args
+			 * and add the attribute number to useful2init
+			 */
+			wfuncstate->opt_args = (List *)
+				ExecInitExpr((Expr *) opt_map_useful_vars((Node *) wfunc->args,
+														  winstate->init2useful),
+							 (PlanState *) winstate);
+
+			/* for window function */
+			if(!wfunc->winagg){
+				perfuncstate->winobj->opt_argstates = wfuncstate->opt_args;
+			}
+		}
+//#endif
 
-		result = ExecProject(winstate->ss.ps.ps_ProjInfo, &isDone);
-		if (isDone == ExprMultipleResult)
-			return result;
-		/* Done with that source tuple... */
-		winstate->ss.ps.ps_TupFromTlist = false;
 	}
 
 	/*
-	 * Compute frame offset values, if any, during first call.
+	 * Update numfuncs to match number of unique functions found; numaggs
+	 * counts just the aggregates of the node's own frame.
 	 */
-	if (winstate->all_first)
+	winstate->numfuncs = wfuncno + 1;
+	frameshares = (int *) palloc0(sizeof(int) * numframes);
+	share_windowaggregates(winstate, numframes, frameaggs, frameshares);
+	peragg = winstate->peragg;
+	winstate->numaggs = frameaggs[0];
+	winstate->opt_numshareaggs = frameshares[0];
+
+	/* copy frame options to state node for easy access */
+	winstate->frameOptions = node->frameOptions;
+
+	/* the bound functions of a RANGE frame with a value offset */
+	if (OidIsValid(node->startInRangeFunc))
 	{
-		int			frameOptions = winstate->frameOptions;
-		ExprContext *econtext = winstate->ss.ps.ps_ExprContext;
-		Datum		value;
-		bool		isnull;
-		int16		len;
-		bool		byval;
+		fmgr_info(node->startInRangeFunc, &winstate->startInRangeFunc);
+		fmgr_info(node->startInRangeCmp, &winstate->startInRangeCmp);
+	}
+	if (OidIsValid(node->endInRangeFunc))
+	{
+		fmgr_info(node->endInRangeFunc, &winstate->endInRangeFunc);
+		fmgr_info(node->endInRangeCmp, &winstate->endInRangeCmp);
+	}
+	winstate->inRangeColl = node->inRangeColl;
+	winstate->inRangeAsc = node->inRangeAsc;
+	winstate->inRangeNullsFirst = node->inRangeNullsFirst;
 
-		if (frameOptions & FRAMEOPTION_START_VALUE)
-		{
-			Assert(winstate->startOffset != NULL);
-			value = ExecEvalExprSwitchContext(winstate->startOffset,
-											  econtext,
-											  &isnull,
-											  NULL);
-			if (isnull)
-				ereport(ERROR,
-						(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-						 errmsg("frame starting offset must not be null")));
-			/* copy value into query-lifespan context */
-			get_typlenbyval(exprType((Node *) winstate->startOffset->expr),
-							&len, &byval);
-			winstate->startOffsetValue = datumCopy(value, byval, len);
-			if (frameOptions & FRAMEOPTION_ROWS)
-			{
-				/* value is known to be int8 */
-				int64		offset = DatumGetInt64(value);
+	initialize_frame_aggregates(winstate);
 
-				if (offset < 0)
-					ereport(ERROR,
-							(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-					  errmsg("frame starting offset must not be negative")));
-			}
+	/* initialize frame bound offset expressions */
+	winstate->startOffset = ExecInitExpr((Expr *) node->startOffset,
+										 (PlanState *) winstate);
+	winstate->endOffset = ExecInitExpr((Expr *) node->endOffset,
+									   (PlanState *) winstate);
+
+	winstate->all_first = true;
+	winstate->partition_spooled = false;
+	winstate->more_partitions = false;
+
+//#ifdef WIN_FUN_OPT
+	if(enable_winfunopt){
+		opt_maxPos = 0;
+		for(i=1; i<=winstate->useful2init[0]; i++){
+			if(winstate->useful2init[i]>opt_maxPos)
+				opt_maxPos = winstate->useful2init[i];
 		}
-		if (frameOptions & FRAMEOPTION_END_VALUE)
-		{
-			Assert(winstate->endOffset != NULL);
-			value = ExecEvalExprSwitchContext(winstate->endOffset,
-											  econtext,
-											  &isnull,
-											  NULL);
-			if (isnull)
-				ereport(ERROR,
-						(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-						 errmsg("frame ending offset must not be null")));
-			/* copy value into query-lifespan context */
-			get_typlenbyval(exprType((Node *) winstate->endOffset->expr),
-							&len, &byval);
-			winstate->endOffsetValue = datumCopy(value, byval, len);
-			if (frameOptions & FRAMEOPTION_ROWS)
-			{
-				/* value is known to be int8 */
-				int64		offset = DatumGetInt64(value);
+		winstate->opt_maxPos = opt_maxPos;
+
+		//opt_targetList = (List*)makeNode(List); /* NOTE: to initial a List, just set to NIL */
+
+		// make TargetEntry
+		for(i=1; i<=winstate->useful2init[0]; i++){
+			AttrNumber 	varattno = winstate->useful2init[i];
+			int temp = varattno-1;	/* attributes of a TupleDesc starts from 0, while varattno starts from 1 */
+			Index 	varno = winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->attrelid; /* to check */
+			Oid 	vartype = (Oid)winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->atttypid;
+			int32 	vartypmod = (int32)winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->atttypmod;
+			Oid 	varcollid = (Oid)winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->attcollation;
+			Index 	varlevelsup = 0;
+			Var *var = makeVar(varno, varattno, vartype, vartypmod, varcollid, varlevelsup); /* All the useful attributes will be Var */
+			TargetEntry *tle =
+					makeTargetEntry((Expr*) var, varattno,
+							pstrdup(NameStr(winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->attname)), false ); /* to check */
+			opt_targetList = lappend(opt_targetList, tle);
+		}
+		//winstate->opt_targetList = opt_targetList; /* no need */
+		// make TupleDesc by targetList
+		opt_tupdesc = ExecTypeFromTL(opt_targetList, false); /* can't use ExecCleanTypeFromTL() */
+		winstate->opt_tupdesc = opt_tupdesc;
+
+		// set tuple description
+		winstate->opt_agg_row_slot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(winstate->opt_agg_row_slot, winstate->opt_tupdesc);
+		winstate->buffer_slot = ExecInitExtraTupleSlot(estate); /* used to extract attributes from a initial MinimalTuple*/
+		ExecSetSlotDescriptor(winstate->buffer_slot, winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+		winstate->opt_first_part_slot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(winstate->opt_first_part_slot, winstate->opt_tupdesc);
+		winstate->opt_temp_slot_1 = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(winstate->opt_temp_slot_1, winstate->opt_tupdesc);
+		winstate->opt_temp_slot_2 = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(winstate->opt_temp_slot_2, winstate->opt_tupdesc);
+		winstate->opt_scantupslot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(winstate->opt_scantupslot, winstate->opt_tupdesc);
+		// make ProjectionInfo by TupleTableSlot, TupleDesc and targetList
+		//ProjectionInfo *projInfo = ExecBuildProjectionInfo(winstate->opt_targetList, winstate->ss.ps->ps_ExprContext, winstate->opt_agg_row_slot, NULL); /* no need */
+		//winstate->opt_projInfo = projInfo; /* no need */
+	}
+//#endif
 
-				if (offset < 0)
-					ereport(ERROR,
-							(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-						errmsg("frame ending offset must not be negative")));
-			}
+/*
+	if(enable_recompute){
+		winstate->opt_tempStartSlot = ExecInitExtraTupleSlot(estate);
+		winstate->opt_tempEndSlot = ExecInitExtraTupleSlot(estate);
+		if(enable_winfunopt){
+			ExecSetSlotDescriptor(winstate->opt_tempStartSlot, winstate->opt_tupdesc);
+			ExecSetSlotDescriptor(winstate->opt_tempEndSlot, winstate->opt_tupdesc);
+		}else{
+			ExecSetSlotDescriptor(winstate->opt_tempStartSlot, winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+			ExecSetSlotDescriptor(winstate->opt_tempEndSlot, winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
 		}
-		winstate->all_first = false;
 	}
+*/
 
-restart:
-	if (winstate->buffer == NULL)
-	{
-		/* Initialize for first partition and set current row = 0 */
-		begin_partition(winstate);
-		/* If there are no input rows, we'll detect that and exit below */
-	}
-	else
+	/*
+	 * init the instruments, only for EXPLAIN ANALYZE: reading the clock
+	 * around every row is not free.  The frames share them with us.
+	 */
+	if (estate->es_instrument & INSTRUMENT_TIMER)
 	{
-		/* Advance current row within partition */
-		winstate->currentpos++;
-		/* This might mean that the frame moves, too */
-		winstate->framehead_valid = false;
-		winstate->frametail_valid = false;
+		winstate->instr_locateheadpos_part = InstrAlloc(1,1);
+		winstate->instr_recompute_part = InstrAlloc(1,1);
+		winstate->instr_disk_read = InstrAlloc(1,1);
+		winstate->instr_disk_write = InstrAlloc(1,1);
+		winstate->instr_locateheadpos_io = InstrAlloc(1,1);
 	}
 
 	/*
-	 * Spool all tuples up to and including the current row, if we haven't
-	 * already
+	 * Set up the frames of the further windows, once the node's own state
+	 * is complete, and hand their window functions their frame.
 	 */
-	spool_tuples(winstate, winstate->currentpos);
-
-	/* Move to the next partition if we reached the end of this partition */
-	if (winstate->partition_spooled &&
-		winstate->currentpos >= winstate->spooled_rows)
+	winstate->numframes = numframes - 1;
+	if (winstate->numframes > 0)
 	{
-		release_partition(winstate);
-
-		if (winstate->more_partitions)
+		winstate->frames = (WindowAggState **)
+			palloc(sizeof(WindowAggState *) * winstate->numframes);
+		aggno = frameaggs[0];
+		shareno = frameshares[0];
+		for (i = 0; i < winstate->numframes; i++)
 		{
-			begin_partition(winstate);
-			Assert(winstate->spooled_rows > 0);
+			winstate->frames[i] = initialize_frame(winstate, i,
+												   &peragg[aggno],
+												   frameaggs[i + 1]);
+			aggno += frameaggs[i + 1];
+			winstate->frames[i]->opt_shareagg =
+				(frameshares[i + 1] > 0 ? &winstate->opt_shareagg[shareno] : NULL);
+			winstate->frames[i]->opt_numshareaggs = frameshares[i + 1];
+			shareno += frameshares[i + 1];
 		}
-		else
+
+		for (i = 0; i < winstate->numfuncs; i++)
 		{
-			winstate->all_done = true;
-			return NULL;
+			WindowStatePerFunc perfuncstate = &perfunc[i];
+			int			frameno;
+
+			if (perfuncstate->plain_agg)
+				continue;
+			frameno = window_frameno(node, perfuncstate->wfunc->winref);
+			if (frameno > 0)
+				perfuncstate->winobj->winstate = winstate->frames[frameno - 1];
 		}
 	}
+	pfree(frameaggs);
+	pfree(frameshares);
 
-	//if(TupIsNull(winstate->ss.ss_ScanTupleSlot))
-	//	ExecClearTuple(winstate->ss.ss_ScanTupleSlot);
-
-	/* final output execution is in ps_ExprContext */
-	econtext = winstate->ss.ps.ps_ExprContext;
-
-	/* Clear the per-output-tuple context for current row */
-	ResetExprContext(econtext);
-
-	/*
-	 * Read the current row from the tuplestore, and save in ScanTupleSlot.
-	 * (We can't rely on the outerplan's output slot because we may have to
-	 * read beyond the current row.  Also, we have to actually copy the row
-	 * out of the tuplestore, since window function evaluation might cause the
-	 * tuplestore to dump its state to disk.)
-	 *
-	 * Current row must be in the tuplestore, since we spooled it above.
-	 */
-//#ifdef WIN_FUN_OPT
-	/*
-	 * When in memory, same as before
-	 * When on tape, scan forward on buffer.init_file to get the ScanTupleSlot
-	 */
-	if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-		init_tuplestore_select_read_pointer(winstate->buffer, winstate->current_ptr);
-		//opt_tuplestore_gettupleslot(winstate->buffer, true, true, winstate->opt_scantupslot);
-		if (!init_tuplestore_gettupleslot(winstate->buffer, true, true,
-									 winstate->ss.ss_ScanTupleSlot))
-			elog(ERROR, "unexpected end of tuplestore");
-	}else{
-//#endif
-		tuplestore_select_read_pointer(winstate->buffer, winstate->current_ptr);
-		if (!tuplestore_gettupleslot(winstate->buffer, true, true,
-									 winstate->ss.ss_ScanTupleSlot))
-			elog(ERROR, "unexpected end of tuplestore");
-//#ifdef WIN_FUN_OPT
-	}
-//#endif
-
-//#ifdef WIN_FUN_OPT
-	/*
-	 * get the opt tuple slot of the scan tuple slot, for the operations follow-up
-	 */
-	if(enable_winfunopt)
-		tuplestore_convert_to_opt(winstate->buffer, winstate->ss.ss_ScanTupleSlot, winstate->opt_scantupslot);
-//#endif
+	initialize_argrings(winstate);
 
-	/*
-	 * Evaluate true window functions
-	 */
-	numfuncs = winstate->numfuncs;
-	for (i = 0; i < numfuncs; i++)
+	/* the function the planner bounded with a run condition */
+	if (OidIsValid(node->runFnOid))
 	{
-		WindowStatePerFunc perfuncstate = &(winstate->perfunc[i]);
+		for (i = 0; i < winstate->numfuncs; i++)
+		{
+			WindowStatePerFunc perfuncstate = &perfunc[i];
 
-		if (perfuncstate->plain_agg)
-			continue;
-		eval_windowfunction(winstate, perfuncstate,
-			  &(econtext->ecxt_aggvalues[perfuncstate->wfuncstate->wfuncno]),
-			  &(econtext->ecxt_aggnulls[perfuncstate->wfuncstate->wfuncno]));
+			if (!perfuncstate->plain_agg &&
+				perfuncstate->wfunc->winfnoid == node->runFnOid &&
+				perfuncstate->wfunc->winref == node->runWinref)
+			{
+				winstate->opt_runfunc = perfuncstate;
+				winstate->opt_runlimit = node->runLimit;
+				break;
+			}
+		}
 	}
 
-	/*
-	 * Evaluate aggregates
-	 */
-	if (winstate->numaggs > 0)
-		eval_windowaggregates(winstate);
-
-	/*
-	 * Truncate any no-longer-needed rows from the tuplestore.
-	 */
-	tuplestore_trim(winstate->buffer);
+	return winstate;
+}
 
-	/*
-	 * Form and return a projection tuple using the windowfunc results and the
-	 * current row.  Setting ecxt_outertuple arranges that any Vars will be
-	 * evaluated with respect to that row.
-	 */
-	econtext->ecxt_outertuple = winstate->ss.ss_ScanTupleSlot;
-	result = ExecProject(winstate->ss.ps.ps_ProjInfo, &isDone);
+/*
+ * windowaggregate_shares
+ *
+ * Can peraggstate be finalized from source's transition value?  Without
+ * derive, only if the two run the same transition from the same initial
+ * value over the same arguments; with it, only if peraggstate is an integer
+ * sum or count(x) and source the avg keeping that {count, sum}.
+ */
+static bool
+windowaggregate_shares(WindowAggState *winstate,
+					   WindowStatePerAgg peraggstate,
+					   WindowStatePerAgg source, bool derive,
+					   WindowShareKind *kind)
+{
+	WindowStatePerFunc perfuncstate = &winstate->perfunc[peraggstate->wfuncno];
+	WindowStatePerFunc sourcefunc = &winstate->perfunc[source->wfuncno];
 
-//#ifdef WIN_FUN_OPT
-	if(enable_winfunopt)
-		ExecClearTuple(winstate->opt_scantupslot);
-//#endif
+	if (!equal(perfuncstate->wfunc->args, sourcefunc->wfunc->args) ||
+		contain_volatile_functions((Node *) perfuncstate->wfunc) ||
+		contain_volatile_functions((Node *) sourcefunc->wfunc))
+		return false;
 
-	if (isDone == ExprEndResult)
+	if (!derive)
 	{
-		/* SRF in tlist returned no rows, so advance to next input tuple */
-		goto restart;
+		if (peraggstate->transfn_oid != source->transfn_oid ||
+			peraggstate->invtransfn_oid != source->invtransfn_oid ||
+			peraggstate->combinefn_oid != source->combinefn_oid ||
+			peraggstate->transtype != source->transtype ||
+			perfuncstate->winCollation != sourcefunc->winCollation ||
+			peraggstate->initValueIsNull != source->initValueIsNull)
+			return false;
+		if (!peraggstate->initValueIsNull &&
+			!datumIsEqual(peraggstate->initValue, source->initValue,
+						  peraggstate->transtypeByVal,
+						  peraggstate->transtypeLen))
+			return false;
+		*kind = WINSHARE_FINAL;
+		return true;
 	}
 
-	winstate->ss.ps.ps_TupFromTlist =
-		(isDone == ExprMultipleResult);
-	return result;
+	switch (peraggstate->transfn_oid)
+	{
+		case F_INT4_SUM:
+			*kind = WINSHARE_SUM_FROM_AVG;
+			return source->transfn_oid == F_INT4_AVG_ACCUM;
+		case F_INT2_SUM:
+			*kind = WINSHARE_SUM_FROM_AVG;
+			return source->transfn_oid == F_INT2_AVG_ACCUM;
+		case F_INT8INC_ANY:
+			*kind = WINSHARE_COUNT_FROM_AVG;
+			return (source->transfn_oid == F_INT4_AVG_ACCUM ||
+					source->transfn_oid == F_INT2_AVG_ACCUM);
+		default:
+			return false;
+	}
 }
 
-/* -----------------
- * ExecInitWindowAgg
+/*
+ * share_windowaggregates
  *
- *	Creates the run-time information for the WindowAgg node produced by the
- *	planner and initializes its outer subtree
- * -----------------
+ * Aggregates of a frame that can be finalized from another's
+ * transition value don't keep one of their own: they are moved out of
+ * winstate->peragg, frame by frame, into winstate->opt_shareagg, and only
+ * finalized.  frameaggs[] is reduced by the number moved, frameshares[].
  */
-WindowAggState *
-ExecInitWindowAgg(WindowAgg *node, EState *estate, int eflags)
+static void
+share_windowaggregates(WindowAggState *winstate, int numframes,
+					   int *frameaggs, int *frameshares)
 {
-	WindowAggState *winstate;
-	Plan	   *outerPlan;
-	ExprContext *econtext;
-	ExprContext *tmpcontext;
-	WindowStatePerFunc perfunc;
-	WindowStatePerAgg peragg;
-	int			numfuncs,
-				wfuncno,
-				numaggs,
-				aggno;
-	ListCell   *l;
-
-//#ifdef WIN_FUN_OPT
-	int			i;
-	List		*opt_targetList = NIL;	/* NOTE: to initial a List, just set to NIL, do not use makeNode() */
-	TupleDesc	opt_tupdesc;
-	//int			usefulNum;
-	int			opt_maxPos;
-//#endif
-
-	/* check for unsupported flags */
-	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
-
-	/*
-	 * create state structure
-	 */
-	winstate = makeNode(WindowAggState);
-	winstate->ss.ps.plan = (Plan *) node;
-	winstate->ss.ps.state = estate;
-
-	/*
-	 * Create expression contexts.	We need two, one for per-input-tuple
-	 * processing and one for per-output-tuple processing.	We cheat a little
-	 * by using ExecAssignExprContext() to build both.
-	 */
-	ExecAssignExprContext(estate, &winstate->ss.ps);
-	tmpcontext = winstate->ss.ps.ps_ExprContext;
-	winstate->tmpcontext = tmpcontext;
-	ExecAssignExprContext(estate, &winstate->ss.ps);
-
-	/* Create long-lived context for storage of partition-local memory etc */
-	winstate->partcontext =
-		AllocSetContextCreate(CurrentMemoryContext,
-							  "WindowAgg_Partition",
-							  ALLOCSET_DEFAULT_MINSIZE,
-							  ALLOCSET_DEFAULT_INITSIZE,
-							  ALLOCSET_DEFAULT_MAXSIZE);
-
-	/* Create mid-lived context for aggregate trans values etc */
-	winstate->aggcontext =
-		AllocSetContextCreate(CurrentMemoryContext,
-							  "WindowAgg_Aggregates",
-							  ALLOCSET_DEFAULT_MINSIZE,
-							  ALLOCSET_DEFAULT_INITSIZE,
-							  ALLOCSET_DEFAULT_MAXSIZE);
+	WindowStatePerAgg peragg = winstate->peragg;
+	WindowStatePerAgg newagg;
+	WindowStatePerAgg shareagg = NULL;
+	int			numaggs = 0;
+	int			numshares = 0;
+	int		   *source;
+	int		   *newno;
+	bool	   *hasdependents;
+	WindowShareKind *kind;
+	int			frameno;
+	int			first;
+	int			i,
+				j,
+				n,
+				m;
+
+	if (!enable_aggshare)
+		return;
 
-	/*
-	 * tuple table initialization
-	 */
-	ExecInitScanTupleSlot(estate, &winstate->ss);
-	ExecInitResultTupleSlot(estate, &winstate->ss.ps);
-	winstate->first_part_slot = ExecInitExtraTupleSlot(estate);
-	winstate->agg_row_slot = ExecInitExtraTupleSlot(estate);
-	winstate->temp_slot_1 = ExecInitExtraTupleSlot(estate);
-	winstate->temp_slot_2 = ExecInitExtraTupleSlot(estate);
+	for (frameno = 0; frameno < numframes; frameno++)
+		numaggs += frameaggs[frameno];
+	if (numaggs < 2)
+		return;
 
-	winstate->ss.ps.targetlist = (List *)
-		ExecInitExpr((Expr *) node->plan.targetlist,
-					 (PlanState *) winstate);
+	source = (int *) palloc(sizeof(int) * numaggs);
+	newno = (int *) palloc(sizeof(int) * numaggs);
+	hasdependents = (bool *) palloc0(sizeof(bool) * numaggs);
+	kind = (WindowShareKind *) palloc(sizeof(WindowShareKind) * numaggs);
 
+	first = 0;
+	for (frameno = 0; frameno < numframes; frameno++)
+	{
+		int			last = first + frameaggs[frameno];
 
+		/* the same transition: the first of them keeps it */
+		for (i = first; i < last; i++)
+		{
+			source[i] = -1;
+			for (j = first; j < i; j++)
+			{
+				if (source[j] < 0 &&
+					windowaggregate_shares(winstate, &peragg[i], &peragg[j],
+										   false, &kind[i]))
+				{
+					source[i] = j;
+					hasdependents[j] = true;
+					break;
+				}
+			}
+		}
 
-	/*
-	 * WindowAgg nodes never have quals, since they can only occur at the
-	 * logical top level of a query (ie, after any WHERE or HAVING filters)
-	 */
-	Assert(node->plan.qual == NIL);
-	winstate->ss.ps.qual = NIL;
+		/* sum and count(x) next to an avg of the same integers */
+		for (i = first; i < last; i++)
+		{
+			if (source[i] >= 0 || hasdependents[i])
+				continue;
+			for (j = first; j < last; j++)
+			{
+				if (j != i && source[j] < 0 &&
+					windowaggregate_shares(winstate, &peragg[i], &peragg[j],
+										   true, &kind[i]))
+				{
+					source[i] = j;
+					hasdependents[j] = true;
+					break;
+				}
+			}
+		}
 
-	/*
-	 * initialize child nodes
-	 */
-	outerPlan = outerPlan(node);
-	outerPlanState(winstate) = ExecInitNode(outerPlan, estate, eflags);
+		for (i = first; i < last; i++)
+		{
+			if (source[i] >= 0)
+				frameshares[frameno]++;
+		}
 
-	/*
-	 * initialize source tuple type (which is also the tuple type that we'll
-	 * store in the tuplestore and use in all our working slots).
-	 */
-	ExecAssignScanTypeFromOuterPlan(&winstate->ss);
+		numshares += frameshares[frameno];
+		first = last;
+	}
 
-	ExecSetSlotDescriptor(winstate->first_part_slot,
-						  winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
-	ExecSetSlotDescriptor(winstate->agg_row_slot,
-						  winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
-	ExecSetSlotDescriptor(winstate->temp_slot_1,
-						  winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
-	ExecSetSlotDescriptor(winstate->temp_slot_2,
-						  winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+	if (numshares == 0)
+	{
+		pfree(source);
+		pfree(newno);
+		pfree(hasdependents);
+		pfree(kind);
+		return;
+	}
 
-	/*
-	 * Initialize result tuple type and projection info.
-	 */
-	ExecAssignResultTypeFromTL(&winstate->ss.ps);
-	ExecAssignProjectionInfo(&winstate->ss.ps, NULL);
+	/* rebuild peragg without them, keeping both arrays in frame order */
+	newagg = (WindowStatePerAgg)
+		palloc0(sizeof(WindowStatePerAggData) * (numaggs - numshares));
+	shareagg = (WindowStatePerAgg)
+		palloc0(sizeof(WindowStatePerAggData) * numshares);
+	n = m = 0;
+	for (i = 0; i < numaggs; i++)
+	{
+		if (source[i] < 0)
+		{
+			newno[i] = n;
+			winstate->perfunc[peragg[i].wfuncno].aggno = n;
+			newagg[n++] = peragg[i];
+		}
+		else
+		{
+			/* no transition value of its own to index */
+			winstate->perfunc[peragg[i].wfuncno].aggno = -1;
+			shareagg[m++] = peragg[i];
+		}
+	}
+	m = 0;
+	for (i = 0; i < numaggs; i++)
+	{
+		if (source[i] < 0)
+			continue;
+		shareagg[m].opt_statesource = &newagg[newno[source[i]]];
+		shareagg[m].opt_sharekind = kind[i];
+		shareagg[m].resultValueIsNull = true;
+		m++;
+	}
 
-	winstate->ss.ps.ps_TupFromTlist = false;
+	for (frameno = 0; frameno < numframes; frameno++)
+		frameaggs[frameno] -= frameshares[frameno];
+	winstate->peragg = newagg;
+	winstate->opt_shareagg = shareagg;
 
-	/* Set up data for comparing tuples */
-	if (node->partNumCols > 0)
-		winstate->partEqfunctions = execTuplesMatchPrepare(node->partNumCols,
-														node->partOperators);
-	if (node->ordNumCols > 0)
-		winstate->ordEqfunctions = execTuplesMatchPrepare(node->ordNumCols,
-														  node->ordOperators);
+	pfree(peragg);
+	pfree(source);
+	pfree(newno);
+	pfree(hasdependents);
+	pfree(kind);
+}
+
+/*
+ * initialize_frame_aggregates
+ *
+ * Set up the WindowObject for the aggregates of a frame, and choose how
+ * they are evaluated as the frame moves.
+ */
+static void
+initialize_frame_aggregates(WindowAggState *winstate)
+{
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	int			i;
 
 	/* add by cywang */
 	/*
 	 * for recomputing
 	 *
-	 * NOTE: now is fixed to 2, need to be more automatical
+	 * the number of temporary transition values is chosen per partition by
+	 * opt_tune_recompute; until then there are none.
 	 */
-	if(enable_recompute)
-		winstate->opt_tempTransValue_num = recompute_num;
+	winstate->opt_use_recompute = enable_recompute;
+	winstate->opt_tempTransValue_num = 0;
+	winstate->opt_tempTransValue_max = 0;
+	winstate->opt_recompute_transcost = 0;
 
-//#ifdef WIN_FUN_OPT
-	if(enable_winfunopt){
-		/* first collect all the AttrNumber that are useful */
-		winstate->useful2init = (AttrNumber*)palloc(sizeof(AttrNumber)*MAX_USEFUL_ATT_NUM); /* start from 1, index 0 stores the number */
-		winstate->init2useful = (AttrNumber*)palloc(sizeof(AttrNumber)*(winstate->agg_row_slot->tts_tupleDescriptor->natts+1)); /* start from 1*/
-		memset(winstate->useful2init, -1, sizeof(AttrNumber)*MAX_USEFUL_ATT_NUM);
-		memset(winstate->init2useful, -1, sizeof(AttrNumber)*(winstate->agg_row_slot->tts_tupleDescriptor->natts+1));
+	/* Set up WindowObject for aggregates, if needed */
+	if (winstate->numaggs > 0)
+	{
+		WindowObject agg_winobj = makeNode(WindowObjectData);
+
+		agg_winobj->winstate = winstate;
+		agg_winobj->argstates = NIL;
+		agg_winobj->localmem = NULL;
+		/* make sure markptr = -1 to invalidate. It may not get used */
+		agg_winobj->markptr = -1;
+		agg_winobj->readptr = -1;
+		winstate->agg_winobj = agg_winobj;
 
-		winstate->useful2init[0] = 0;
+		/* by cywang */
+		if(enable_winfunopt)
+			agg_winobj->opt_argstates = NIL;
+		agg_winobj->opt_frameheadptr = -1;
+		agg_winobj->opt_tempTransEndPtr = -1;
+		agg_winobj->opt_tempTransEndPos = NULL;
+		agg_winobj->opt_tempStartPos = NULL;
+		agg_winobj->opt_invtransptr = -1;
 
 		/*
-		 * add order by clause first
-		 *
-		 * ordColIdx is also used to check if two tuple slot are peers,
-		 * so we need an alternative opt_ordColIdx
+		 * Rows leaving a moving frame can be removed from the aggregates,
+		 * instead of restarting them at the new frame head, if every
+		 * aggregate has an inverse transition function.  Volatile arguments
+		 * would not give the same value on the way out as on the way in.
+		 * enable_reusebuffer trims the buffer at the frame head itself, so
+		 * it is left on the restart path.
 		 */
-		if(node->ordNumCols >0)
-			node->opt_ordColIdx = (AttrNumber*)palloc(node->ordNumCols*sizeof(AttrNumber));
-		for(i=0; i<node->ordNumCols; i++){
-			//winstate->useful2init[++usefulNum] = node->ordColIdx[i];
-			//winstate->init2useful[node->ordColIdx[i]] = usefulNum;
-			AttrNumber pos = addNumber(winstate->useful2init, node->ordColIdx[i]);
-			winstate->init2useful[node->ordColIdx[i]] = pos;
-			node->opt_ordColIdx[i] = pos;
-		}
-
-		//add function parameters then TODO
-	}
-//#endif
-
-	/*
-	 * WindowAgg nodes use aggvalues and aggnulls as well as Agg nodes.
-	 */
-	numfuncs = winstate->numfuncs;
-	numaggs = winstate->numaggs;
-	econtext = winstate->ss.ps.ps_ExprContext;
-	econtext->ecxt_aggvalues = (Datum *) palloc0(sizeof(Datum) * numfuncs);
-	econtext->ecxt_aggnulls = (bool *) palloc0(sizeof(bool) * numfuncs);
+		winstate->opt_use_invtrans =
+			enable_inversetrans && !enable_reusebuffer &&
+			!(node->frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING);
+		for (i = 0; i < winstate->numaggs; i++)
+		{
+			WindowStatePerAgg peraggstate = &winstate->peragg[i];
 
-	/*
-	 * allocate per-wfunc/per-agg state information.
-	 */
-	perfunc = (WindowStatePerFunc) palloc0(sizeof(WindowStatePerFuncData) * numfuncs);
-	peragg = (WindowStatePerAgg) palloc0(sizeof(WindowStatePerAggData) * numaggs);
-	winstate->perfunc = perfunc;
-	winstate->peragg = peragg;
+			if (!OidIsValid(peraggstate->invtransfn_oid) ||
+				contain_volatile_functions((Node *) winstate->perfunc[peraggstate->wfuncno].wfunc))
+				winstate->opt_use_invtrans = false;
 
-	wfuncno = -1;
-	aggno = -1;
-	foreach(l, winstate->funcs)
-	{
-		WindowFuncExprState *wfuncstate = (WindowFuncExprState *) lfirst(l);
-		WindowFunc *wfunc = (WindowFunc *) wfuncstate->xprstate.expr;
-		WindowStatePerFunc perfuncstate;
-		AclResult	aclresult;
-		int			i;
+			/*
+			 * The temporary transition values copy transValue by datumCopy,
+			 * which only copies the pointer of an INTERNAL state; they would
+			 * share the state with transValue.
+			 */
+			if (peraggstate->transtype == INTERNALOID)
+				winstate->opt_use_recompute = false;
 
-//#ifdef WIN_FUN_OPT
-		ListCell *arg;
-//#endif
+			/* for opt_tune_recompute */
+			winstate->opt_recompute_transcost +=
+				get_func_cost(peraggstate->transfn_oid) * cpu_operator_cost;
+		}
 
-		if (wfunc->winref != node->winref)		/* planner screwed up? */
-			elog(ERROR, "WindowFunc with winref %u assigned to WindowAgg with winref %u",
-				 wfunc->winref, node->winref);
+		/*
+		 * Restarts are the exception when rows are removed, and the temporary
+		 * transition values don't keep transValueCount, so don't build them.
+		 */
+		if (winstate->opt_use_invtrans)
+			winstate->opt_use_recompute = false;
 
-		/* Look for a previous duplicate window function */
-		for (i = 0; i <= wfuncno; i++)
+		/*
+		 * Otherwise, a moving frame can be answered from a segment tree if
+		 * every aggregate has a combine function.  The tree nodes are copied
+		 * by datumCopy, so that rules out INTERNAL states, as does a
+		 * volatile argument, since the tree is built once per partition.
+		 */
+		winstate->opt_use_segtree =
+			enable_segtree && !winstate->opt_use_invtrans &&
+			!enable_reusebuffer &&
+			!(node->frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING);
+		for (i = 0; i < winstate->numaggs; i++)
 		{
-			if (equal(wfunc, perfunc[i].wfunc) &&
-				!contain_volatile_functions((Node *) wfunc))
-				break;
+			WindowStatePerAgg peraggstate = &winstate->peragg[i];
+
+			if (!OidIsValid(peraggstate->combinefn_oid) ||
+				peraggstate->transtype == INTERNALOID ||
+				contain_volatile_functions((Node *) winstate->perfunc[peraggstate->wfuncno].wfunc))
+				winstate->opt_use_segtree = false;
 		}
-		if (i <= wfuncno)
+
+		/*
+		 * Arguments evaluated once can be kept in a column buffer if they
+		 * are passed by value; volatile ones must be evaluated every time.
+		 */
+		winstate->opt_argpos = -1;
+		for (i = 0; i < winstate->numaggs; i++)
 		{
-			/* Found a match to an existing entry, so just mark it */
-			wfuncstate->wfuncno = i;
-			continue;
+			WindowStatePerAgg peraggstate = &winstate->peragg[i];
+			WindowStatePerFunc perfuncstate = &winstate->perfunc[peraggstate->wfuncno];
+			ListCell   *lc;
+
+			peraggstate->opt_columnar =
+				enable_columnbuffer && perfuncstate->numArguments > 0 &&
+				!contain_volatile_functions((Node *) perfuncstate->wfunc);
+			foreach(lc, perfuncstate->wfunc->args)
+			{
+				if (!get_typbyval(exprType((Node *) lfirst(lc))))
+					peraggstate->opt_columnar = false;
+			}
 		}
 
-		/* Nope, so assign a new PerAgg record */
-		perfuncstate = &perfunc[++wfuncno];
-
-		/* Mark WindowFunc state node with assigned index in the result array */
-		wfuncstate->wfuncno = wfuncno;
-
-		/* Check permission to call window function */
-		aclresult = pg_proc_aclcheck(wfunc->winfnoid, GetUserId(),
-									 ACL_EXECUTE);
-		if (aclresult != ACLCHECK_OK)
-			aclcheck_error(aclresult, ACL_KIND_PROC,
-						   get_func_name(wfunc->winfnoid));
-
-		/* Fill in the perfuncstate data */
-		perfuncstate->wfuncstate = wfuncstate;
-		perfuncstate->wfunc = wfunc;
-		perfuncstate->numArguments = list_length(wfuncstate->args);
-
-		fmgr_info_cxt(wfunc->winfnoid, &perfuncstate->flinfo,
-					  econtext->ecxt_per_query_memory);
-		fmgr_info_set_expr((Node *) wfunc, &perfuncstate->flinfo);
+		/*
+		 * Aggregates with the same arguments evaluate them once
+		 * per row: the first of them keeps the column buffer, and the last
+		 * row's arguments, for the others.
+		 */
+		for (i = 0; enable_aggshare && i < winstate->numaggs; i++)
+		{
+			WindowStatePerAgg peraggstate = &winstate->peragg[i];
+			WindowStatePerFunc perfuncstate = &winstate->perfunc[peraggstate->wfuncno];
+			int			j;
+
+			if (perfuncstate->numArguments == 0 ||
+				contain_volatile_functions((Node *) perfuncstate->wfunc))
+				continue;
+			for (j = 0; j < i; j++)
+			{
+				WindowStatePerAgg source = &winstate->peragg[j];
 
-		perfuncstate->winCollation = wfunc->inputcollid;
+				if (source->opt_argsource == NULL &&
+					equal(perfuncstate->wfunc->args,
+						  winstate->perfunc[source->wfuncno].wfunc->args))
+					break;
+			}
+			if (j == i)
+				continue;
 
-		get_typlenbyval(wfunc->wintype,
-						&perfuncstate->resulttypeLen,
-						&perfuncstate->resulttypeByVal);
+			peraggstate->opt_argsource = &winstate->peragg[j];
+			if (!winstate->peragg[j].opt_argshared)
+			{
+				WindowStatePerAgg source = &winstate->peragg[j];
+
+				source->opt_argshared = true;
+				source->opt_argepoch = -1;
+				source->opt_argvalues = (Datum *)
+					palloc(sizeof(Datum) * perfuncstate->numArguments);
+				source->opt_argnulls = (bool *)
+					palloc(sizeof(bool) * perfuncstate->numArguments);
+			}
+		}
 
 		/*
-		 * If it's really just a plain aggregate function, we'll emulate the
-		 * Agg environment for it.
+		 * Runs of rows already in the column buffers can be advanced without
+		 * fmgr if every aggregate's transfn is one we know.
 		 */
-		perfuncstate->plain_agg = wfunc->winagg;
-		if (wfunc->winagg)
+		winstate->opt_use_batch = true;
+		for (i = 0; i < winstate->numaggs; i++)
 		{
-			WindowStatePerAgg peraggstate;
+			WindowStatePerAgg peraggstate = &winstate->peragg[i];
 
-			perfuncstate->aggno = ++aggno;
-			peraggstate = &winstate->peragg[aggno];
-			initialize_peragg(winstate, wfunc, peraggstate);
-			peraggstate->wfuncno = wfuncno;
+			peraggstate->opt_batchkind =
+				windowaggregate_batchkind(&winstate->perfunc[peraggstate->wfuncno],
+										  peraggstate);
+			if (peraggstate->opt_batchkind == WINBATCH_NONE)
+				winstate->opt_use_batch = false;
 		}
-		else
+
+		if (winstate->opt_use_segtree)
 		{
-			WindowObject winobj = makeNode(WindowObjectData);
+			WindowObject segtree_winobj = makeNode(WindowObjectData);
 
-			winobj->winstate = winstate;
-			winobj->argstates = wfuncstate->args;
-			winobj->localmem = NULL;
-			perfuncstate->winobj = winobj;
+			segtree_winobj->winstate = winstate;
+			segtree_winobj->argstates = NIL;
+			segtree_winobj->localmem = NULL;
+			segtree_winobj->markptr = -1;
+			segtree_winobj->readptr = -1;
+			winstate->opt_segtree_winobj = segtree_winobj;
+
+			/* the tree replaces the temporary transition values */
+			winstate->opt_use_recompute = false;
 		}
+	}
+}
 
-		/* add by cywang */
-//#ifdef WIN_FUN_OPT
-		if(enable_winfunopt){
-			/*
-			 * initial the alternative arguments of a window function, WindowFuncExprState.opt_args
-			 * and add the attribute number to useful2init
-			 */
-			wfuncstate->opt_args = NIL;
-			foreach(arg, wfuncstate->args){
-				ExprState  *argstate = (ExprState *) lfirst(arg);
-				//currently, we only treat the T_Var type arguments as useful
-
-				if(argstate->expr->type == T_Var){
-					Var *var = (Var*)argstate->expr;
-					//need to make a node first, or the child pointer attribute will share the common pointer with the source struct
-					ExprState *opt_argstate = (ExprState*)makeNode(ExprState);
-					Var *opt_var = (Var*)makeNode(Var);
-					memcpy(opt_argstate, argstate, sizeof(ExprState));
-					opt_argstate->expr = (Expr*)opt_var;
-					memcpy((Var*)opt_argstate->expr, (Var*)var, sizeof(Var));
-					((Var*)opt_argstate->expr)->varattno = addNumber(winstate->useful2init, ((Var*)opt_argstate->expr)->varattno);
-					((Var*)opt_argstate->expr)->varoattno = ((Var*)opt_argstate->expr)->varattno;
-					wfuncstate->opt_args = lappend(wfuncstate->opt_args, opt_argstate);
-				}
+/*
+ * initialize_frame
+ *
+ * Create the state of the frameno'th of the further windows the node
+ * evaluates, whose aggregates are the numaggs ones at peragg.  The frame
+ * is a copy of winstate, sharing its buffer, scan slot, expression
+ * contexts and function states, with a frame definition, aggregate
+ * WindowObject, memory contexts and working slots of its own.  It gets a
+ * copy of the plan node too, with this window's frame options and number
+ * of ordering columns, so that the frame code needs no changes.
+ */
+static WindowAggState *
+initialize_frame(WindowAggState *winstate, int frameno,
+				 WindowStatePerAgg peragg, int numaggs)
+{
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	EState	   *estate = winstate->ss.ps.state;
+	TupleDesc	scandesc = winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+	WindowAgg  *framenode;
+	WindowAggState *frame;
+
+	framenode = makeNode(WindowAgg);
+	memcpy(framenode, node, sizeof(WindowAgg));
+	framenode->winref = list_nth_int(node->extraWinrefs, frameno);
+	framenode->ordNumCols = list_nth_int(node->extraOrdNumCols, frameno);
+	framenode->frameOptions = list_nth_int(node->extraFrameOptions, frameno);
+	framenode->startOffset = (Node *) list_nth(node->extraStartOffsets, frameno);
+	framenode->endOffset = (Node *) list_nth(node->extraEndOffsets, frameno);
+	framenode->extraWinrefs = NIL;
+	framenode->extraOrdNumCols = NIL;
+	framenode->extraFrameOptions = NIL;
+	framenode->extraStartOffsets = NIL;
+	framenode->extraEndOffsets = NIL;
+
+	frame = makeNode(WindowAggState);
+	memcpy(frame, winstate, sizeof(WindowAggState));
+	frame->ss.ps.plan = (Plan *) framenode;
+	frame->numframes = 0;
+	frame->frames = NULL;
+	frame->peragg = peragg;
+	frame->numaggs = numaggs;
+	frame->agg_winobj = NULL;
+	frame->opt_segtree_winobj = NULL;
+
+	frame->frameOptions = framenode->frameOptions;
+	frame->startOffset = ExecInitExpr((Expr *) framenode->startOffset,
+									  (PlanState *) winstate);
+	frame->endOffset = ExecInitExpr((Expr *) framenode->endOffset,
+									(PlanState *) winstate);
+
+	frame->partcontext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "WindowAgg_Partition",
+							  ALLOCSET_DEFAULT_MINSIZE,
+							  ALLOCSET_DEFAULT_INITSIZE,
+							  ALLOCSET_DEFAULT_MAXSIZE);
+	frame->aggcontext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "WindowAgg_Aggregates",
+							  ALLOCSET_DEFAULT_MINSIZE,
+							  ALLOCSET_DEFAULT_INITSIZE,
+							  ALLOCSET_DEFAULT_MAXSIZE);
 
+	frame->agg_row_slot = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(frame->agg_row_slot, scandesc);
+	frame->temp_slot_1 = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(frame->temp_slot_1, scandesc);
+	frame->temp_slot_2 = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(frame->temp_slot_2, scandesc);
+	if (enable_winfunopt)
+	{
+		frame->opt_agg_row_slot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(frame->opt_agg_row_slot, winstate->opt_tupdesc);
+		frame->opt_temp_slot_1 = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(frame->opt_temp_slot_1, winstate->opt_tupdesc);
+		frame->opt_temp_slot_2 = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(frame->opt_temp_slot_2, winstate->opt_tupdesc);
+	}
 
-			}
+	initialize_frame_aggregates(frame);
 
-			/* for window function */
-			if(!wfunc->winagg){
-				perfuncstate->winobj->opt_argstates = wfuncstate->opt_args;
-			}
-		}
-//#endif
+	return frame;
+}
 
+/*
+ * window_frameno
+ *
+ * Which frame of the node evaluates the functions of window winref: 0 for
+ * the node's own, k for the k'th of node->extraWinrefs, -1 for none.
+ */
+static int
+window_frameno(WindowAgg *node, Index winref)
+{
+	ListCell   *l;
+	int			frameno = 1;
+
+	if (winref == node->winref)
+		return 0;
+	foreach(l, node->extraWinrefs)
+	{
+		if ((Index) lfirst_int(l) == winref)
+			return frameno;
+		frameno++;
 	}
+	return -1;
+}
 
-	/* Update numfuncs, numaggs to match number of unique functions found */
-	winstate->numfuncs = wfuncno + 1;
-	winstate->numaggs = aggno + 1;
+/*
+ * initialize_argrings
+ *
+ * Give lead, lag, first_value, last_value and nth_value a ring of their
+ * first argument's values, if it is a plain column.  lag(x, 1) and
+ * lead(x, 7) then find their row in memory instead of repositioning their
+ * read pointer on every call, which means a seek once the buffer is on
+ * tape.  The ring covers the constant offsets looking back, plus however
+ * far ahead of the current row the rows get spooled, which is the largest
+ * constant lead offset or frame end offset of the node.
+ */
+static void
+initialize_argrings(WindowAggState *winstate)
+{
+	WindowAgg  *node = (WindowAgg *) winstate->ss.ps.plan;
+	int64		lookahead = 0;
+	ListCell   *lc1,
+			   *lc2;
+	int			i;
 
-	/* Set up WindowObject for aggregates, if needed */
-	if (winstate->numaggs > 0)
+	winstate->opt_use_argring = false;
+	if (!enable_argring)
+		return;
+
+	/* how far ahead the frames, and leads with a constant offset, spool */
+	if ((node->frameOptions & FRAMEOPTION_ROWS) &&
+		(node->frameOptions & FRAMEOPTION_END_VALUE_FOLLOWING) &&
+		IsA(node->endOffset, Const) &&
+		!((Const *) node->endOffset)->constisnull)
+		lookahead = DatumGetInt64(((Const *) node->endOffset)->constvalue);
+	forboth(lc1, node->extraFrameOptions, lc2, node->extraEndOffsets)
 	{
-		WindowObject agg_winobj = makeNode(WindowObjectData);
+		int			frameOptions = lfirst_int(lc1);
+		Node	   *endOffset = (Node *) lfirst(lc2);
+
+		if ((frameOptions & FRAMEOPTION_ROWS) &&
+			(frameOptions & FRAMEOPTION_END_VALUE_FOLLOWING) &&
+			IsA(endOffset, Const) &&
+			!((Const *) endOffset)->constisnull)
+			lookahead = Max(lookahead,
+							DatumGetInt64(((Const *) endOffset)->constvalue));
+	}
+	for (i = 0; i < winstate->numfuncs; i++)
+	{
+		WindowFunc *wfunc = winstate->perfunc[i].wfunc;
+
+		if (!winstate->perfunc[i].plain_agg &&
+			(wfunc->winfnoid == F_WINDOW_LEAD_WITH_OFFSET ||
+			 wfunc->winfnoid == F_WINDOW_LEAD_WITH_OFFSET_AND_DEFAULT) &&
+			IsA(lsecond(wfunc->args), Const) &&
+			!((Const *) lsecond(wfunc->args))->constisnull)
+			lookahead = Max(lookahead,
+							DatumGetInt32(((Const *) lsecond(wfunc->args))->constvalue));
+	}
 
-		agg_winobj->winstate = winstate;
-		agg_winobj->argstates = NIL;
-		agg_winobj->localmem = NULL;
-		/* make sure markptr = -1 to invalidate. It may not get used */
-		agg_winobj->markptr = -1;
-		agg_winobj->readptr = -1;
-		winstate->agg_winobj = agg_winobj;
+	for (i = 0; i < winstate->numfuncs; i++)
+	{
+		WindowStatePerFunc perfuncstate = &winstate->perfunc[i];
+		WindowFunc *wfunc = perfuncstate->wfunc;
+		WindowObject winobj = perfuncstate->winobj;
+		int			frameOptions;
+		Node	   *arg;
+		int64		lookback = 0;
+		int64		size;
+
+		if (perfuncstate->plain_agg || wfunc->args == NIL)
+			continue;
 
-		/* by cywang */
-		if(enable_winfunopt)
-			agg_winobj->opt_argstates = NIL;
-		agg_winobj->opt_frameheadptr = -1;
-		agg_winobj->opt_tempTransEndPtr[0] = -1;
+		switch (wfunc->winfnoid)
+		{
+			case F_WINDOW_LAG:
+				lookback = 1;
+				break;
+			case F_WINDOW_LAG_WITH_OFFSET:
+			case F_WINDOW_LAG_WITH_OFFSET_AND_DEFAULT:
+				arg = (Node *) lsecond(wfunc->args);
+				if (!IsA(arg, Const) || ((Const *) arg)->constisnull)
+					continue;
+				lookback = Max(DatumGetInt32(((Const *) arg)->constvalue), 0);
+				break;
+			case F_WINDOW_LEAD:
+			case F_WINDOW_LEAD_WITH_OFFSET:
+			case F_WINDOW_LEAD_WITH_OFFSET_AND_DEFAULT:
+			case F_WINDOW_LAST_VALUE:
+				break;
+			case F_WINDOW_FIRST_VALUE:
+			case F_WINDOW_NTH_VALUE:
+				/* the frame head, if it trails the current row by a constant */
+				frameOptions = winobj->winstate->frameOptions;
+				arg = (Node *) (winobj->winstate == winstate ? node->startOffset :
+								list_nth(node->extraStartOffsets,
+										 window_frameno(node, wfunc->winref) - 1));
+				if ((frameOptions & FRAMEOPTION_ROWS) &&
+					(frameOptions & FRAMEOPTION_START_VALUE_PRECEDING) &&
+					IsA(arg, Const) && !((Const *) arg)->constisnull)
+					lookback = DatumGetInt64(((Const *) arg)->constvalue);
+				break;
+			default:
+				continue;
+		}
+
+		/* only a column can be read off the spooled tuple without a doubt */
+		arg = (Node *) linitial(wfunc->args);
+		while (IsA(arg, RelabelType))
+			arg = (Node *) ((RelabelType *) arg)->arg;
+		if (!IsA(arg, Var) || ((Var *) arg)->varattno <= 0)
+			continue;
+
+		size = lookback + lookahead + 1 + WINDOW_ARGRING_SLACK;
+		if (size * (sizeof(int64) + sizeof(Datum) + sizeof(bool)) >
+			work_mem * 1024L / 4)
+			continue;
+
+		winobj->opt_ringsize = size;
+		winobj->opt_ringattno = ((Var *) arg)->varattno;
+		get_typlenbyval(exprType(arg), &winobj->opt_ringlen,
+						&winobj->opt_ringbyval);
+		winobj->opt_ringpos = (int64 *) palloc(size * sizeof(int64));
+		winobj->opt_ringvalues = (Datum *) palloc(size * sizeof(Datum));
+		winobj->opt_ringnulls = (bool *) palloc(size * sizeof(bool));
+		winstate->opt_use_argring = true;
 	}
 
-	/* copy frame options to state node for easy access */
-	winstate->frameOptions = node->frameOptions;
+	/* the frames spool rows too */
+	for (i = 0; i < winstate->numframes; i++)
+		winstate->frames[i]->opt_use_argring = winstate->opt_use_argring;
+}
 
-	/* initialize frame bound offset expressions */
-	winstate->startOffset = ExecInitExpr((Expr *) node->startOffset,
-										 (PlanState *) winstate);
-	winstate->endOffset = ExecInitExpr((Expr *) node->endOffset,
-									   (PlanState *) winstate);
+/*
+ * argring_note
+ * add the row just spooled at pos to the argument rings
+ */
+static void
+argring_note(WindowAggState *winstate, TupleTableSlot *slot, int64 pos)
+{
+	int			i;
 
-	winstate->all_first = true;
-	winstate->partition_spooled = false;
-	winstate->more_partitions = false;
+	for (i = 0; i < winstate->numfuncs; i++)
+	{
+		WindowObject winobj = winstate->perfunc[i].winobj;
+		Datum		value;
+		bool		isnull;
 
-//#ifdef WIN_FUN_OPT
-	if(enable_winfunopt){
-		opt_maxPos = 0;
-		for(i=1; i<=winstate->useful2init[0]; i++){
-			if(winstate->useful2init[i]>opt_maxPos)
-				opt_maxPos = winstate->useful2init[i];
-		}
-		winstate->opt_maxPos = opt_maxPos;
+		if (winstate->perfunc[i].plain_agg || winobj->opt_ringsize == 0)
+			continue;
+		value = slot_getattr(slot, winobj->opt_ringattno, &isnull);
+		argring_store(winobj, pos, value, isnull);
+	}
+}
 
-		//opt_targetList = (List*)makeNode(List); /* NOTE: to initial a List, just set to NIL */
+/*
+ * argring_store
+ * put the argument value of row pos in winobj's ring, in place of the row
+ * that had its slot
+ */
+static void
+argring_store(WindowObject winobj, int64 pos, Datum value, bool isnull)
+{
+	int64		i = pos % winobj->opt_ringsize;
+	MemoryContext oldcontext;
 
-		// make TargetEntry
-		for(i=1; i<=winstate->useful2init[0]; i++){
-			AttrNumber 	varattno = winstate->useful2init[i];
-			int temp = varattno-1;	/* attributes of a TupleDesc starts from 0, while varattno starts from 1 */
-			Index 	varno = winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->attrelid; /* to check */
-			Oid 	vartype = (Oid)winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->atttypid;
-			int32 	vartypmod = (int32)winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->atttypmod;
-			Oid 	varcollid = (Oid)winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->attcollation;
-			Index 	varlevelsup = 0;
-			Var *var = makeVar(varno, varattno, vartype, vartypmod, varcollid, varlevelsup); /* All the useful attributes will be Var */
-			TargetEntry *tle =
-					makeTargetEntry((Expr*) var, varattno,
-							winstate->agg_row_slot->tts_tupleDescriptor->attrs[temp]->attname, false ); /* to check */
-			opt_targetList = lappend(opt_targetList, tle);
-		}
-		//winstate->opt_targetList = opt_targetList; /* no need */
-		// make TupleDesc by targetList
-		opt_tupdesc = ExecTypeFromTL(opt_targetList, false); /* can't use ExecCleanTypeFromTL() */
-		winstate->opt_tupdesc = opt_tupdesc;
+	if (!winobj->opt_ringbyval && winobj->opt_ringpos[i] >= 0 &&
+		!winobj->opt_ringnulls[i])
+		pfree(DatumGetPointer(winobj->opt_ringvalues[i]));
 
-		// set tuple description
-		winstate->opt_agg_row_slot = ExecInitExtraTupleSlot(estate);
-		ExecSetSlotDescriptor(winstate->opt_agg_row_slot, winstate->opt_tupdesc);
-		winstate->buffer_slot = ExecInitExtraTupleSlot(estate); /* used to extract attributes from a initial MinimalTuple*/
-		ExecSetSlotDescriptor(winstate->buffer_slot, winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
-		winstate->opt_first_part_slot = ExecInitExtraTupleSlot(estate);
-		ExecSetSlotDescriptor(winstate->opt_first_part_slot, winstate->opt_tupdesc);
-		winstate->opt_temp_slot_1 = ExecInitExtraTupleSlot(estate);
-		ExecSetSlotDescriptor(winstate->opt_temp_slot_1, winstate->opt_tupdesc);
-		winstate->opt_temp_slot_2 = ExecInitExtraTupleSlot(estate);
-		ExecSetSlotDescriptor(winstate->opt_temp_slot_2, winstate->opt_tupdesc);
-		winstate->opt_scantupslot = ExecInitExtraTupleSlot(estate);
-		ExecSetSlotDescriptor(winstate->opt_scantupslot, winstate->opt_tupdesc);
-		// make ProjectionInfo by TupleTableSlot, TupleDesc and targetList
-		//ProjectionInfo *projInfo = ExecBuildProjectionInfo(winstate->opt_targetList, winstate->ss.ps->ps_ExprContext, winstate->opt_agg_row_slot, NULL); /* no need */
-		//winstate->opt_projInfo = projInfo; /* no need */
+	if (!winobj->opt_ringbyval && !isnull)
+	{
+		oldcontext = MemoryContextSwitchTo(winobj->winstate->partcontext);
+		value = datumCopy(value, false, winobj->opt_ringlen);
+		MemoryContextSwitchTo(oldcontext);
 	}
-//#endif
+	winobj->opt_ringpos[i] = pos;
+	winobj->opt_ringvalues[i] = value;
+	winobj->opt_ringnulls[i] = isnull;
+}
 
 /*
-	if(enable_recompute){
-		winstate->opt_tempStartSlot = ExecInitExtraTupleSlot(estate);
-		winstate->opt_tempEndSlot = ExecInitExtraTupleSlot(estate);
-		if(enable_winfunopt){
-			ExecSetSlotDescriptor(winstate->opt_tempStartSlot, winstate->opt_tupdesc);
-			ExecSetSlotDescriptor(winstate->opt_tempEndSlot, winstate->opt_tupdesc);
-		}else{
-			ExecSetSlotDescriptor(winstate->opt_tempStartSlot, winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
-			ExecSetSlotDescriptor(winstate->opt_tempEndSlot, winstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
-		}
-	}
-*/
+ * argring_get
+ * look up the argument value of row pos in winobj's ring
+ */
+static bool
+argring_get(WindowObject winobj, int64 pos, Datum *value, bool *isnull)
+{
+	int64		i;
 
-	/* init the instruments */
-	winstate->instr_total_part = InstrAlloc(1,1);
-	//winstate->instr_checkinframe_part = InstrAlloc(1,1);
-	winstate->instr_locateheadpos_part = InstrAlloc(1,1);
-	winstate->instr_recompute_part = InstrAlloc(1,1);
-	//winstate->instr_setmarkpos_part = InstrAlloc(1,1);
-	winstate->instr_cpu_afterspooled = InstrAlloc(1,1);
-	winstate->instr_recompute_cpu = InstrAlloc(1,1);
-	winstate->instr_io_afterspooled = InstrAlloc(1,1);
+	if (winobj->opt_ringsize == 0 || pos < 0)
+		return false;
+	i = pos % winobj->opt_ringsize;
+	if (winobj->opt_ringpos[i] != pos)
+		return false;
+	*value = winobj->opt_ringvalues[i];
+	*isnull = winobj->opt_ringnulls[i];
+	return true;
+}
 
-	if(enable_winfunopt)
-		printf("\n--------------------- with opt ------------------------\n");
-	else
-		printf("\n--------------------- without opt ---------------------\n");
-	if(enable_locate)
-		printf("--------------------- with locate ------------------------\n");
-	else
-		printf("--------------------- without locate ---------------------\n");
-	if(enable_recompute)
-		printf("--------------------- with recompute ------------------------\n");
-	else
-		printf("--------------------- without recompute ---------------------\n");
-	if(enable_reusebuffer)
-		printf("--------------------- with reusebuffer ------------------------\n");
-	else
-		printf("--------------------- without reusebuffer ------------------------\n");
+/*
+ * frame_check_by_pos
+ * tell whether row_is_in_frame can decide on row pos from its position
+ * alone, without comparing it to the current row
+ */
+static bool
+frame_check_by_pos(WindowAggState *winstate, int64 pos)
+{
+	int			frameOptions = winstate->frameOptions;
 
-	return winstate;
+	if (frameOptions & FRAMEOPTION_ROWS)
+		return true;
+	if (frameOptions & (FRAMEOPTION_START_VALUE | FRAMEOPTION_END_VALUE))
+		return false;
+	if ((frameOptions & FRAMEOPTION_START_CURRENT_ROW) &&
+		pos < winstate->currentpos)
+		return false;
+	if ((frameOptions & FRAMEOPTION_END_CURRENT_ROW) &&
+		pos > winstate->currentpos)
+		return false;
+	return true;
 }
 
 /* -----------------
@@ -2476,26 +5675,7 @@ void
 ExecEndWindowAgg(WindowAggState *node)
 {
 	PlanState  *outerPlan;
-
-
-	if(enable_reusebuffer)
-		printf("--------------------- with reusebuffer end ------------------------\n");
-	else
-		printf("--------------------- without reusebuffer end ------------------------\n");
-	if(enable_recompute)
-		printf("--------------------- with recompute end ------------------------\n");
-	else
-		printf("--------------------- without recompute end ---------------------\n");
-	if(enable_locate)
-		printf("--------------------- with locate end ------------------------\n");
-	else
-		printf("--------------------- without locate end ---------------------\n");
-	if(enable_winfunopt)
-		printf("--------------------- with opt end --------------------\n\n\n");
-	else
-		printf("--------------------- without opt end -----------------\n\n\n");
-
-
+	int			i;
 
 	/* add by cywang */
 //#ifdef WIN_FUN_OPT
@@ -2534,6 +5714,11 @@ ExecEndWindowAgg(WindowAggState *node)
 
 	MemoryContextDelete(node->partcontext);
 	MemoryContextDelete(node->aggcontext);
+	for (i = 0; i < node->numframes; i++)
+	{
+		MemoryContextDelete(node->frames[i]->partcontext);
+		MemoryContextDelete(node->frames[i]->aggcontext);
+	}
 
 	outerPlan = outerPlanState(node);
 	ExecEndNode(outerPlan);
@@ -2591,6 +5776,8 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	Oid			aggtranstype;
 	AclResult	aclresult;
 	Oid			transfn_oid,
+				invtransfn_oid,
+				combinefn_oid,
 				finalfn_oid;
 	Expr	   *transfnexpr,
 			   *finalfnexpr;
@@ -2618,6 +5805,8 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	 */
 
 	peraggstate->transfn_oid = transfn_oid = aggform->aggtransfn;
+	peraggstate->invtransfn_oid = invtransfn_oid = aggform->agginvtransfn;
+	peraggstate->combinefn_oid = combinefn_oid = aggform->aggcombinefn;
 	peraggstate->finalfn_oid = finalfn_oid = aggform->aggfinalfn;
 
 	/* Check that aggregate owner has permission to call component fns */
@@ -2638,6 +5827,22 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 		if (aclresult != ACLCHECK_OK)
 			aclcheck_error(aclresult, ACL_KIND_PROC,
 						   get_func_name(transfn_oid));
+		if (OidIsValid(invtransfn_oid))
+		{
+			aclresult = pg_proc_aclcheck(invtransfn_oid, aggOwner,
+										 ACL_EXECUTE);
+			if (aclresult != ACLCHECK_OK)
+				aclcheck_error(aclresult, ACL_KIND_PROC,
+							   get_func_name(invtransfn_oid));
+		}
+		if (OidIsValid(combinefn_oid))
+		{
+			aclresult = pg_proc_aclcheck(combinefn_oid, aggOwner,
+										 ACL_EXECUTE);
+			if (aclresult != ACLCHECK_OK)
+				aclcheck_error(aclresult, ACL_KIND_PROC,
+							   get_func_name(combinefn_oid));
+		}
 		if (OidIsValid(finalfn_oid))
 		{
 			aclresult = pg_proc_aclcheck(finalfn_oid, aggOwner,
@@ -2681,6 +5886,44 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	fmgr_info(transfn_oid, &peraggstate->transfn);
 	fmgr_info_set_expr((Node *) transfnexpr, &peraggstate->transfn);
 
+	/* the inverse takes the same arguments, so it can share transfnexpr */
+	if (OidIsValid(invtransfn_oid))
+	{
+		fmgr_info(invtransfn_oid, &peraggstate->invtransfn);
+		fmgr_info_set_expr((Node *) transfnexpr, &peraggstate->invtransfn);
+	}
+	peraggstate->skipNullRows = peraggstate->transfn.fn_strict ||
+		(OidIsValid(invtransfn_oid) && peraggstate->invtransfn.fn_strict);
+
+	/*
+	 * the combine function takes two transition values; give it an
+	 * expression of its own, so polymorphic ones can resolve their types.
+	 */
+	if (OidIsValid(combinefn_oid))
+	{
+		Param	   *argp = makeNode(Param);
+		FuncExpr   *combinefnexpr = makeNode(FuncExpr);
+
+		argp->paramkind = PARAM_EXEC;
+		argp->paramid = -1;
+		argp->paramtype = aggtranstype;
+		argp->paramtypmod = -1;
+		argp->paramcollid = wfunc->inputcollid;
+		argp->location = -1;
+
+		combinefnexpr->funcid = combinefn_oid;
+		combinefnexpr->funcresulttype = aggtranstype;
+		combinefnexpr->funcretset = false;
+		combinefnexpr->funcformat = COERCE_DONTCARE;
+		combinefnexpr->funccollid = InvalidOid;
+		combinefnexpr->inputcollid = wfunc->inputcollid;
+		combinefnexpr->args = list_make2(argp, argp);
+		combinefnexpr->location = -1;
+
+		fmgr_info(combinefn_oid, &peraggstate->combinefn);
+		fmgr_info_set_expr((Node *) combinefnexpr, &peraggstate->combinefn);
+	}
+
 	if (OidIsValid(finalfn_oid))
 	{
 		fmgr_info(finalfn_oid, &peraggstate->finalfn);
@@ -2693,6 +5936,7 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	get_typlenbyval(aggtranstype,
 					&peraggstate->transtypeLen,
 					&peraggstate->transtypeByVal);
+	peraggstate->transtype = aggtranstype;
 
 	/*
 	 * initval is potentially null, so don't try to access it as a struct
@@ -2811,6 +6055,11 @@ window_gettupleslot(WindowObject winobj, int64 pos, TupleTableSlot *slot)
 
 	tuplestore_select_read_pointer(winstate->buffer, winobj->readptr);
 
+	/* on tape, jump to just before pos by the row index if that is cheaper */
+	if (winobj->seekpos != pos - 1 &&
+		opt_tuplestore_seek_row(winstate->buffer, pos, winobj->seekpos + 1))
+		winobj->seekpos = pos - 1;
+
 	/*
 	 * There's no API to refetch the tuple at the current position. We have to
 	 * move one tuple forward, and then one backward.  (We don't do it the
@@ -3020,6 +6269,8 @@ WinGetFuncArgInPartition(WindowObject winobj, int argno,
 	TupleTableSlot *slot;
 	bool		gottuple;
 	int64		abs_pos;
+	bool		fromring = false;
+	Datum		value = (Datum) 0;
 
 //#ifdef WIN_FUN_OPT
 	TupleTableSlot *opt_slot = winobj->winstate->opt_temp_slot_1;
@@ -3048,8 +6299,21 @@ WinGetFuncArgInPartition(WindowObject winobj, int argno,
 			break;
 	}
 
+	/*
+	 * The row may be in the argument ring; spool it first, which
+	 * adds it to the ring, if it is ahead of the spooled rows
+	 */
+	if (argno == 0 && winobj->opt_ringsize > 0)
+	{
+		if (abs_pos >= winstate->spooled_rows)
+			spool_tuples(winstate, abs_pos);
+		fromring = argring_get(winobj, abs_pos, &value, isnull);
+	}
+
+	if (fromring)
+		gottuple = true;
 //#ifdef WIN_FUN_OPT
-	if(enable_winfunopt)
+	else if(enable_winfunopt)
 		gottuple = opt_window_gettupleslot(winobj, abs_pos, slot, opt_slot);
 //#else
 	else
@@ -3096,9 +6360,19 @@ WinGetFuncArgInPartition(WindowObject winobj, int argno,
 				if (mark_pos > winstate->frameheadpos)
 					mark_pos = winstate->frameheadpos;
 			}
-			WinSetMarkPosition(winobj, mark_pos);
+
+			/*
+			 * A row from the ring needn't move the pointers through a
+			 * spilled buffer, which can't be trimmed anyway; the mark then
+			 * stays behind, which allows more, not less.
+			 */
+			if (!fromring || tuplestore_in_memory(winstate->buffer))
+				WinSetMarkPosition(winobj, mark_pos);
 		}
 
+		if (fromring)
+			return value;
+
 //#ifdef WIN_FUN_OPT
 		if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
 			/*
@@ -3109,16 +6383,20 @@ WinGetFuncArgInPartition(WindowObject winobj, int argno,
 			 */
 			econtext->ecxt_outertuple = opt_slot;
 			//econtext->opt_exct_slot = opt_slot;
-			return ExecEvalExpr((ExprState *) list_nth(winobj->opt_argstates, argno),
-								econtext, isnull, NULL);
+			value = ExecEvalExpr((ExprState *) list_nth(winobj->opt_argstates, argno),
+								 econtext, isnull, NULL);
 		}else{
 //#endif
 			econtext->ecxt_outertuple = slot;
-			return ExecEvalExpr((ExprState *) list_nth(winobj->argstates, argno),
-								econtext, isnull, NULL);
+			value = ExecEvalExpr((ExprState *) list_nth(winobj->argstates, argno),
+								 econtext, isnull, NULL);
 //#ifdef WIN_FUN_OPT
 		}
 //#endif
+		/* keep the row in the ring, in case it is asked for again */
+		if (argno == 0 && winobj->opt_ringsize > 0)
+			argring_store(winobj, abs_pos, value, *isnull);
+		return value;
 	}
 }
 
@@ -3150,6 +6428,8 @@ WinGetFuncArgInFrame(WindowObject winobj, int argno,
 	TupleTableSlot *slot;
 	bool		gottuple;
 	int64		abs_pos;
+	bool		fromring = false;
+	Datum		value = (Datum) 0;
 
 	Assert(WindowObjectIsValid(winobj));
 	winstate = winobj->winstate;
@@ -3187,8 +6467,42 @@ WinGetFuncArgInFrame(WindowObject winobj, int argno,
 			break;
 	}
 
+	/*
+	 * In a RANGE frame with a value offset, row_is_in_frame
+	 * goes by the frame head and tail
+	 */
+	if ((winstate->frameOptions & FRAMEOPTION_RANGE) &&
+		(winstate->frameOptions & (FRAMEOPTION_START_VALUE |
+								   FRAMEOPTION_END_VALUE)))
+	{
+		if (enable_winfunopt)
+		{
+			opt_update_frameheadpos(winobj, slot, winstate->opt_temp_slot_1);
+			opt_update_frametailpos(winobj, slot, winstate->opt_temp_slot_1);
+		}
+		else
+		{
+			update_frameheadpos(winobj, slot);
+			update_frametailpos(winobj, slot);
+		}
+	}
+
+	/*
+	 * The row may be in the argument ring, if its position tells
+	 * whether it is in frame
+	 */
+	if (argno == 0 && winobj->opt_ringsize > 0 && abs_pos >= 0 &&
+		frame_check_by_pos(winstate, abs_pos))
+	{
+		if (abs_pos >= winstate->spooled_rows)
+			spool_tuples(winstate, abs_pos);
+		fromring = argring_get(winobj, abs_pos, &value, isnull);
+	}
+
+	if (fromring)
+		gottuple = row_is_in_frame(winstate, abs_pos, NULL);
 //#ifdef WIN_FUN_OPT
-	if(enable_winfunopt){
+	else if(enable_winfunopt){
 		gottuple = opt_window_gettupleslot(winobj, abs_pos, slot, winstate->opt_temp_slot_1);
 		if(gottuple){
 			if(tuplestore_in_memory(winstate->buffer))
@@ -3245,18 +6559,32 @@ WinGetFuncArgInFrame(WindowObject winobj, int argno,
 				if (mark_pos > winstate->frameheadpos)
 					mark_pos = winstate->frameheadpos;
 			}
-			WinSetMarkPosition(winobj, mark_pos);
+
+			/*
+			 * A row from the ring needn't move the pointers through a
+			 * spilled buffer, which can't be trimmed anyway; the mark then
+			 * stays behind, which allows more, not less.
+			 */
+			if (!fromring || tuplestore_in_memory(winstate->buffer))
+				WinSetMarkPosition(winobj, mark_pos);
 		}
 
+		if (fromring)
+			return value;
+
 		if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
 			econtext->ecxt_outertuple = winstate->opt_temp_slot_1;
-			return ExecEvalExpr((ExprState *) list_nth(winobj->opt_argstates, argno),
-								econtext, isnull, NULL);
+			value = ExecEvalExpr((ExprState *) list_nth(winobj->opt_argstates, argno),
+								 econtext, isnull, NULL);
 		}else{
 			econtext->ecxt_outertuple = slot;
-			return ExecEvalExpr((ExprState *) list_nth(winobj->argstates, argno),
-								econtext, isnull, NULL);
+			value = ExecEvalExpr((ExprState *) list_nth(winobj->argstates, argno),
+								 econtext, isnull, NULL);
 		}
+		/* keep the row in the ring, in case it is asked for again */
+		if (argno == 0 && winobj->opt_ringsize > 0)
+			argring_store(winobj, abs_pos, value, *isnull);
+		return value;
 	}
 }
 
@@ -3308,19 +6636,29 @@ WinGetFuncArgCurrent(WindowObject winobj, int argno, bool *isnull)
 
 //#ifdef WIN_FUN_OPT
 /*
- * add a attribute to useful2init
- * elements in useful2init are unique
- * return the init2useful[num]
+ * copy an argument expression of a window function so that its Vars
+ * refer to the useful attributes instead of the initial ones
  */
-static AttrNumber addNumber(AttrNumber *array, AttrNumber num){
-	AttrNumber i;
-	for(i=1; i<=array[0]; i++){
-		if(array[i] == num)
-			return i;
-	}
-	array[0]++;
-	array[array[0]] = num;
-	return array[0];
+static Node *
+opt_map_useful_vars(Node *node, AttrNumber *init2useful)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) copyObject(node);
+
+		if (var->varno != OUTER)
+			return (Node *) var;
+		if (var->varattno <= 0 || init2useful[var->varattno] <= 0)
+			elog(ERROR, "window function argument column %d is not kept for spilled partitions",
+				 var->varattno);
+		var->varattno = init2useful[var->varattno];
+		var->varoattno = var->varattno;
+		return (Node *) var;
+	}
+	return expression_tree_mutator(node, opt_map_useful_vars,
+								   (void *) init2useful);
 }
 /*
  * as the parameters of window_gettupleslot has one slot,
@@ -3361,6 +6699,15 @@ bool opt_window_gettupleslot(WindowObject winobj, int64 pos, TupleTableSlot *slo
 	}
 //#endif
 
+	/*
+	 * When the useful tuples on tape all have the same size, or else by the
+	 * row index, jump to just before pos and read it forward, instead of
+	 * stepping tuple by tuple.
+	 */
+	if (winobj->seekpos != pos - 1 &&
+		(opt_tuplestore_skip(winstate->buffer, pos - 1 - winobj->seekpos) ||
+		 opt_tuplestore_seek_row(winstate->buffer, pos, winobj->seekpos + 1)))
+		winobj->seekpos = pos - 1;
 
 	/*
 	 * There's no API to refetch the tuple at the current position. We have to
@@ -3527,8 +6874,15 @@ static void opt_update_frameheadpos(WindowObject winobj, TupleTableSlot *slot, T
 		}
 		else if (frameOptions & FRAMEOPTION_RANGE)
 		{
-			/* parser should have rejected this */
-			elog(ERROR, "window frame with value offset is not implemented");
+			/*
+			 * In RANGE mode, the first row whose value is not
+			 * before the current one plus or minus the offset; the frame
+			 * head can't go backwards
+			 */
+			winstate->frameheadpos =
+				range_frame_bound(winobj, true, winstate->frameheadpos,
+								  slot, opt_slot, false);
+			winstate->framehead_valid = true;
 		}
 		else
 			Assert(false);
@@ -3635,8 +6989,20 @@ static void opt_update_frametailpos(WindowObject winobj, TupleTableSlot *slot, T
 		}
 		else if (frameOptions & FRAMEOPTION_RANGE)
 		{
-			/* parser should have rejected this */
-			elog(ERROR, "window frame with value offset is not implemented");
+			int64		lo;
+
+			/*
+			 * In RANGE mode, the last row whose value is not past
+			 * the current one plus or minus the offset.  Neither the frame
+			 * tail nor the frame head go backwards, and a tail before the
+			 * head just means an empty frame, so the search starts at both.
+			 */
+			opt_update_frameheadpos(winobj, slot, opt_slot);
+			lo = Max(winstate->frametailpos + 1, winstate->frameheadpos);
+			winstate->frametailpos =
+				range_frame_bound(winobj, false, lo, slot, opt_slot,
+								  false) - 1;
+			winstate->frametail_valid = true;
 		}
 		else
 			Assert(false);
@@ -3728,6 +7094,11 @@ void opt_update_frameheadptr(WindowObject winobj, int64 frameheadpos){
 	 * NOTE: frameheadptr is not used to fetch tuple,
 	 * so we use frameheadpos-1 instead of frameheadpos here.
 	 */
+	if (frameheadpos-1 > winobj->opt_frameheadpos &&
+		(opt_tuplestore_skip(winstate->buffer, frameheadpos-1 - winobj->opt_frameheadpos) ||
+		 opt_tuplestore_seek_row(winstate->buffer, frameheadpos, winobj->opt_frameheadpos+1)))
+		winobj->opt_frameheadpos = frameheadpos-1;
+
 	while (frameheadpos-1 > winobj->opt_frameheadpos)
 	{
 		if(enable_winfunopt)
@@ -3773,38 +7144,17 @@ void opt_temp_advance_windowaggregate(WindowAggState *winstate,
 						WindowStatePerAgg peraggstate,
 						int target)
 {
-	WindowFuncExprState *wfuncstate = perfuncstate->wfuncstate;
 	int			numArguments = perfuncstate->numArguments;
 	FunctionCallInfoData fcinfodata;
 	FunctionCallInfo fcinfo = &fcinfodata;
 	Datum		newVal;
-	ListCell   *arg;
 	int			i;
 	MemoryContext oldContext;
 	ExprContext *econtext = winstate->tmpcontext;
 
 	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
 
-	/* We start from 1, since the 0th arg will be the transition value */
-	i = 1;
-	if(enable_winfunopt && !tuplestore_in_memory(winstate->buffer)){
-		foreach(arg, wfuncstate->opt_args){
-			ExprState  *argstate = (ExprState *) lfirst(arg);
-
-			fcinfo->arg[i] = ExecEvalExpr(argstate, econtext,
-										  &fcinfo->argnull[i], NULL);
-			i++;
-		}
-	}else{
-		foreach(arg, wfuncstate->args)
-		{
-			ExprState  *argstate = (ExprState *) lfirst(arg);
-
-			fcinfo->arg[i] = ExecEvalExpr(argstate, econtext,
-										  &fcinfo->argnull[i], NULL);
-			i++;
-		}
-	}
+	eval_windowaggregate_args(winstate, perfuncstate, peraggstate, fcinfo);
 
 	if (peraggstate->transfn.fn_strict)
 	{
@@ -4061,7 +7411,7 @@ void opt_copy_tempTransEndPtr(WindowObject winobj, int target){
 	else
 		tuplestore_select_read_pointer(winstate->buffer, winobj->readptr);
 	winobj->seekpos = winobj->opt_tempTransEndPos[target];
-	opt_tuplestore_copy_ptr(winstate->buffer, winobj->readptr, winobj->opt_tempTransEndPtr[target]);
+	opt_tuplestore_copy_ptr(winstate->buffer, winobj->readptr, winobj->opt_tempTransEndPtr);
 
 	/*
 	 * as we have called tuplestore_select_read_pointer,
@@ -4136,12 +7486,14 @@ static void opt_eval_tempTransEnd(WindowAggState *winstate){
 			}
 			/* Set tuple context for evaluation of aggregate arguments */
 			winstate->tmpcontext->ecxt_outertuple = opt_agg_row_slot;
+			WINAGG_SET_ARGPOS(winstate, winstate->aggregatedupto);
 		}else{
 			if (!row_is_in_frame(winstate, winstate->aggregatedupto, agg_row_slot)){
 				break;
 			}
 			/* Set tuple context for evaluation of aggregate arguments */
 			winstate->tmpcontext->ecxt_outertuple = agg_row_slot;
+			WINAGG_SET_ARGPOS(winstate, winstate->aggregatedupto);
 		}
 
 		/* for currentpos's use */
@@ -4167,20 +7519,22 @@ static void opt_eval_tempTransEnd(WindowAggState *winstate){
 										peraggstate,
 										target);
 			}
-			/*
-			 * save opt_tempTransEndPtr
-			 *
-			 * we can't do this out this loop,
-			 * because at that time the position is not the end position for temporary transition value.
-			 */
-			opt_tuplestore_copy_ptr(winstate->buffer, agg_winobj->opt_tempTransEndPtr[target], agg_winobj->readptr);
 			agg_winobj->opt_tempTransEndPos[target] = agg_winobj->seekpos; /* we must copy the seek position */
+		}
+		/*
+		 * save opt_tempTransEndPtr
+		 *
+		 * we can't do this out this loop,
+		 * because at that time the position is not the end position for temporary transition value.
+		 */
+		if(target > winstate->opt_active_tempTransValue){
+			opt_tuplestore_copy_ptr(winstate->buffer, agg_winobj->opt_tempTransEndPtr, agg_winobj->readptr);
 			/*
 			 * if not in memory, we need to set the bufFile's offset to opt_tempTransEndPtr.
 			 *
 			 * NOTE: not just for on tape, but also for memory, or the answer will contains error
 			 */
-			opt_tuplestore_tell_ptr(winstate->buffer, agg_winobj->opt_tempTransEndPtr[target]);
+			opt_tuplestore_tell_ptr(winstate->buffer, agg_winobj->opt_tempTransEndPtr);
 		}
 
 		/* Reset per-input-tuple context after each tuple */
@@ -4197,6 +7551,134 @@ static void opt_eval_tempTransEnd(WindowAggState *winstate){
 	}
 }
 
+/*
+ * opt_tune_recompute
+ * choose the number and spacing of the temporary transition values
+ *
+ * With m temporary values started s rows apart behind the frame head, the
+ * frame is aggregated from scratch once every m*s rows, at the cost of
+ * F row fetches and (1+m)*F transitions for a frame of F rows.  In between,
+ * every row jumps to a temporary value and first aggregates the s/2 rows,
+ * on average, from the frame head up to its start.  Per row that is
+ *
+ *		F*(fetch + (1+m)*trans) / (m*s) + s/2*(fetch + trans)
+ *
+ * which is least at s = sqrt(2*F*(fetch + (1+m)*trans) / (m*(fetch + trans))).
+ * We take the best m whose values all start inside the frame and fit in
+ * work_mem, or none if plain recomputing of every frame is cheaper.  Rows
+ * read back from a spilled buffer are charged a share of a page read.
+ */
+static void
+opt_tune_recompute(WindowAggState *winstate, int64 framesize)
+{
+	double		frows = (double) framesize;
+	double		fetch = cpu_tuple_cost;
+	double		trans = Max(winstate->opt_recompute_transcost, cpu_operator_cost);
+	Size		slotspace = estimate_transvalue_space(winstate);
+	double		bestcost;
+	int			bestnum = 0;
+	int64		bestspacing = 0;
+	int			num;
+
+	winstate->opt_recompute_framesize = framesize;
+	winstate->opt_recompute_spilled = !tuplestore_in_memory(winstate->buffer);
+	if (winstate->opt_recompute_spilled)
+		fetch += seq_page_cost * winstate->ss.ps.plan->plan_width / BLCKSZ;
+
+	/* recomputing every frame */
+	bestcost = frows * (fetch + trans);
+
+	for (num = 1; (Size) num * slotspace <= work_mem * 1024L; num++)
+	{
+		double		spacing;
+		double		cost;
+
+		spacing = sqrt(2.0 * frows * (fetch + (1 + num) * trans) /
+					   (num * (fetch + trans)));
+		spacing = Max(rint(spacing), 1.0);
+		if (num * spacing >= frows)
+			break;
+
+		cost = frows * (fetch + (1 + num) * trans) / (num * spacing) +
+			spacing / 2 * (fetch + trans);
+		if (cost >= bestcost && bestnum > 0)
+			break;				/* more values no longer pay off */
+		if (cost < bestcost)
+		{
+			bestcost = cost;
+			bestnum = num;
+			bestspacing = (int64) spacing;
+		}
+	}
+
+	if (bestnum > winstate->opt_tempTransValue_max)
+		opt_reserve_tempTransValues(winstate, bestnum);
+	winstate->opt_tempTransValue_num = bestnum;
+	winstate->opt_recompute_spacing = bestspacing;
+}
+
+/*
+ * opt_reserve_tempTransValues
+ * make room for at least num temporary transition values
+ *
+ * The arrays are grown to at least twice their size, and live in the query
+ * context so that they survive partitions.
+ */
+static void
+opt_reserve_tempTransValues(WindowAggState *winstate, int num)
+{
+	WindowObject agg_winobj = winstate->agg_winobj;
+	MemoryContext oldContext;
+	int			oldmax = winstate->opt_tempTransValue_max;
+	int			i;
+	int			j;
+
+	num = Max(num, 2 * oldmax);
+	oldContext = MemoryContextSwitchTo(winstate->ss.ps.state->es_query_cxt);
+
+	if (oldmax == 0)
+	{
+		agg_winobj->opt_tempTransEndPos = (int64 *) palloc(num * sizeof(int64));
+		agg_winobj->opt_tempStartPos = (int64 *) palloc(num * sizeof(int64));
+	}
+	else
+	{
+		agg_winobj->opt_tempTransEndPos = (int64 *)
+			repalloc(agg_winobj->opt_tempTransEndPos, num * sizeof(int64));
+		agg_winobj->opt_tempStartPos = (int64 *)
+			repalloc(agg_winobj->opt_tempStartPos, num * sizeof(int64));
+	}
+	for (i = oldmax; i < num; i++)
+	{
+		agg_winobj->opt_tempTransEndPos[i] = -1;
+		agg_winobj->opt_tempStartPos[i] = 0;
+	}
+
+	for (j = 0; j < winstate->numaggs; j++)
+	{
+		WindowStatePerAgg peraggstate = &winstate->peragg[j];
+
+		if (oldmax == 0)
+		{
+			peraggstate->opt_temp_transValue = (Datum *) palloc(num * sizeof(Datum));
+			peraggstate->opt_temp_transValueIsNull = (bool *) palloc(num * sizeof(bool));
+			peraggstate->opt_temp_noTransValue = (bool *) palloc(num * sizeof(bool));
+		}
+		else
+		{
+			peraggstate->opt_temp_transValue = (Datum *)
+				repalloc(peraggstate->opt_temp_transValue, num * sizeof(Datum));
+			peraggstate->opt_temp_transValueIsNull = (bool *)
+				repalloc(peraggstate->opt_temp_transValueIsNull, num * sizeof(bool));
+			peraggstate->opt_temp_noTransValue = (bool *)
+				repalloc(peraggstate->opt_temp_noTransValue, num * sizeof(bool));
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	winstate->opt_tempTransValue_max = num;
+}
+
 void opt_copy_transValue_from_tempTransValue(WindowAggState *winstate,
 		   WindowStatePerFunc perfuncstate,
 		   WindowStatePerAgg peraggstate,
@@ -4405,8 +7887,15 @@ reuse_update_frameheadpos(WindowObject winobj, TupleTableSlot *slot)
 		}
 		else if (frameOptions & FRAMEOPTION_RANGE)
 		{
-			/* parser should have rejected this */
-			elog(ERROR, "window frame with value offset is not implemented");
+			/*
+			 * In RANGE mode, the first row whose value is not
+			 * before the current one plus or minus the offset; the frame
+			 * head can't go backwards
+			 */
+			winstate->frameheadpos =
+				range_frame_bound(winobj, true, winstate->frameheadpos,
+								  slot, NULL, true);
+			winstate->framehead_valid = true;
 		}
 		else
 			Assert(false);
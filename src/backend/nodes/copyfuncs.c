@@ -729,6 +729,7 @@ _copySort(Sort *from)
 	COPY_POINTER_FIELD(sortOperators, from->numCols * sizeof(Oid));
 	COPY_POINTER_FIELD(collations, from->numCols * sizeof(Oid));
 	COPY_POINTER_FIELD(nullsFirst, from->numCols * sizeof(bool));
+	COPY_SCALAR_FIELD(numPresorted);
 
 	return newnode;
 }
@@ -799,6 +800,26 @@ _copyWindowAgg(WindowAgg *from)
 	COPY_SCALAR_FIELD(frameOptions);
 	COPY_NODE_FIELD(startOffset);
 	COPY_NODE_FIELD(endOffset);
+	COPY_NODE_FIELD(extraWinrefs);
+	COPY_NODE_FIELD(extraOrdNumCols);
+	COPY_NODE_FIELD(extraFrameOptions);
+	COPY_NODE_FIELD(extraStartOffsets);
+	COPY_NODE_FIELD(extraEndOffsets);
+	COPY_SCALAR_FIELD(runFnOid);
+	COPY_SCALAR_FIELD(runWinref);
+	COPY_SCALAR_FIELD(runLimit);
+	COPY_SCALAR_FIELD(startInRangeFunc);
+	COPY_SCALAR_FIELD(endInRangeFunc);
+	COPY_SCALAR_FIELD(startInRangeCmp);
+	COPY_SCALAR_FIELD(endInRangeCmp);
+	COPY_SCALAR_FIELD(inRangeColl);
+	COPY_SCALAR_FIELD(inRangeAsc);
+	COPY_SCALAR_FIELD(inRangeNullsFirst);
+	COPY_SCALAR_FIELD(spillNumCols);
+	if (from->spillNumCols > 0)
+		COPY_POINTER_FIELD(spillColIdx, from->spillNumCols * sizeof(AttrNumber));
+	if (from->ordNumCols > 0 && from->opt_ordColIdx)
+		COPY_POINTER_FIELD(opt_ordColIdx, from->ordNumCols * sizeof(AttrNumber));
 
 	return newnode;
 }
@@ -1998,6 +2019,15 @@ _copyWindowClause(WindowClause *from)
 	COPY_NODE_FIELD(endOffset);
 	COPY_SCALAR_FIELD(winref);
 	COPY_SCALAR_FIELD(copiedOrder);
+	COPY_SCALAR_FIELD(runFnOid);
+	COPY_SCALAR_FIELD(runLimit);
+	COPY_SCALAR_FIELD(startInRangeFunc);
+	COPY_SCALAR_FIELD(endInRangeFunc);
+	COPY_SCALAR_FIELD(startInRangeCmp);
+	COPY_SCALAR_FIELD(endInRangeCmp);
+	COPY_SCALAR_FIELD(inRangeColl);
+	COPY_SCALAR_FIELD(inRangeAsc);
+	COPY_SCALAR_FIELD(inRangeNullsFirst);
 
 	return newnode;
 }
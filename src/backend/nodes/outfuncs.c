@@ -677,6 +677,26 @@ _outWindowAgg(StringInfo str, WindowAgg *node)
 	WRITE_INT_FIELD(frameOptions);
 	WRITE_NODE_FIELD(startOffset);
 	WRITE_NODE_FIELD(endOffset);
+	WRITE_NODE_FIELD(extraWinrefs);
+	WRITE_NODE_FIELD(extraOrdNumCols);
+	WRITE_NODE_FIELD(extraFrameOptions);
+	WRITE_NODE_FIELD(extraStartOffsets);
+	WRITE_NODE_FIELD(extraEndOffsets);
+	WRITE_OID_FIELD(runFnOid);
+	WRITE_UINT_FIELD(runWinref);
+	WRITE_INT_FIELD(runLimit);
+	WRITE_OID_FIELD(startInRangeFunc);
+	WRITE_OID_FIELD(endInRangeFunc);
+	WRITE_OID_FIELD(startInRangeCmp);
+	WRITE_OID_FIELD(endInRangeCmp);
+	WRITE_OID_FIELD(inRangeColl);
+	WRITE_BOOL_FIELD(inRangeAsc);
+	WRITE_BOOL_FIELD(inRangeNullsFirst);
+	WRITE_INT_FIELD(spillNumCols);
+
+	appendStringInfo(str, " :spillColIdx");
+	for (i = 0; i < node->spillNumCols; i++)
+		appendStringInfo(str, " %d", node->spillColIdx[i]);
 }
 
 static void
@@ -733,6 +753,8 @@ _outSort(StringInfo str, Sort *node)
 	appendStringInfo(str, " :nullsFirst");
 	for (i = 0; i < node->numCols; i++)
 		appendStringInfo(str, " %s", booltostr(node->nullsFirst[i]));
+
+	WRITE_INT_FIELD(numPresorted);
 }
 
 static void
@@ -2239,6 +2261,15 @@ _outWindowClause(StringInfo str, WindowClause *node)
 	WRITE_NODE_FIELD(endOffset);
 	WRITE_UINT_FIELD(winref);
 	WRITE_BOOL_FIELD(copiedOrder);
+	WRITE_OID_FIELD(runFnOid);
+	WRITE_INT_FIELD(runLimit);
+	WRITE_OID_FIELD(startInRangeFunc);
+	WRITE_OID_FIELD(endInRangeFunc);
+	WRITE_OID_FIELD(startInRangeCmp);
+	WRITE_OID_FIELD(endInRangeCmp);
+	WRITE_OID_FIELD(inRangeColl);
+	WRITE_BOOL_FIELD(inRangeAsc);
+	WRITE_BOOL_FIELD(inRangeNullsFirst);
 }
 
 static void
@@ -287,6 +287,15 @@ _readWindowClause(void)
 	READ_NODE_FIELD(endOffset);
 	READ_UINT_FIELD(winref);
 	READ_BOOL_FIELD(copiedOrder);
+	READ_OID_FIELD(runFnOid);
+	READ_INT_FIELD(runLimit);
+	READ_OID_FIELD(startInRangeFunc);
+	READ_OID_FIELD(endInRangeFunc);
+	READ_OID_FIELD(startInRangeCmp);
+	READ_OID_FIELD(endInRangeCmp);
+	READ_OID_FIELD(inRangeColl);
+	READ_BOOL_FIELD(inRangeAsc);
+	READ_BOOL_FIELD(inRangeNullsFirst);
 
 	READ_DONE();
 }
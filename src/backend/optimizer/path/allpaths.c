@@ -17,7 +17,10 @@
 
 #include <math.h>
 
+#include "access/nbtree.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_opfamily.h"
+#include "catalog/pg_type.h"
 #include "nodes/nodeFuncs.h"
 #ifdef OPTIMIZER_DEBUG
 #include "nodes/print.h"
@@ -35,6 +38,7 @@
 #include "parser/parse_clause.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 
 
@@ -57,6 +61,8 @@ static List *accumulate_append_subpath(List *subpaths, Path *path);
 static void set_dummy_rel_pathlist(RelOptInfo *rel);
 static void set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					  Index rti, RangeTblEntry *rte);
+static void find_window_run_conditions(Query *subquery, Index rti,
+						   List *restrictinfo);
 static void set_function_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					  RangeTblEntry *rte);
 static void set_values_pathlist(PlannerInfo *root, RelOptInfo *rel,
@@ -770,6 +776,14 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 
 	pfree(differentTypes);
 
+	/*
+	 * Quals on window functions can't be pushed down, but those bounding a
+	 * row_number, rank or dense_rank column still let the WindowAgg stop
+	 * each partition early.
+	 */
+	if (rel->baserestrictinfo != NIL)
+		find_window_run_conditions(subquery, rti, rel->baserestrictinfo);
+
 	/*
 	 * We can safely pass the outer tuple_fraction down to the subquery if the
 	 * outer level has no joining, aggregation, or sorting to do. Otherwise
@@ -807,6 +821,137 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 	set_cheapest(rel);
 }
 
+/*
+ * find_window_run_conditions
+ *		Record quals of the form "rn <= const" on a subquery's row_number,
+ *		rank or dense_rank output as run conditions of its windows.
+ *
+ * Those functions never decrease within a partition, so once such a qual
+ * fails for a row, it fails for the rest of the partition too.  The limit
+ * goes into the function's WindowClause, for grouping_planner to hand to
+ * the topmost WindowAgg; the qual itself stays in the upper query, which
+ * still filters the rows computed before the limit was passed.
+ */
+static void
+find_window_run_conditions(Query *subquery, Index rti, List *restrictinfo)
+{
+	ListCell   *l;
+
+	if (!enable_runcondition || !subquery->hasWindowFuncs)
+		return;
+
+	/*
+	 * Nothing between the topmost WindowAgg and the qual may depend on the
+	 * rows skipped: not LIMIT/OFFSET or DISTINCT, and not side effects or
+	 * set-returning functions of the target list.
+	 */
+	if (subquery->limitOffset != NULL || subquery->limitCount != NULL ||
+		subquery->distinctClause != NIL || subquery->setOperations != NULL ||
+		expression_returns_set((Node *) subquery->targetList) ||
+		contain_volatile_functions((Node *) subquery->targetList))
+		return;
+
+	foreach(l, restrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(l);
+		OpExpr	   *opexpr = (OpExpr *) rinfo->clause;
+		Node	   *leftop;
+		Node	   *rightop;
+		Var		   *var;
+		Const	   *con;
+		bool		varonleft;
+		int			strategy;
+		int64		limit;
+		TargetEntry *tle;
+		WindowFunc *wfunc;
+		ListCell   *lc;
+
+		if (rinfo->pseudoconstant || !is_opclause(opexpr) ||
+			list_length(opexpr->args) != 2)
+			continue;
+		leftop = (Node *) linitial(opexpr->args);
+		rightop = (Node *) lsecond(opexpr->args);
+		if (IsA(leftop, Var) && IsA(rightop, Const))
+		{
+			var = (Var *) leftop;
+			con = (Const *) rightop;
+			varonleft = true;
+		}
+		else if (IsA(rightop, Var) && IsA(leftop, Const))
+		{
+			var = (Var *) rightop;
+			con = (Const *) leftop;
+			varonleft = false;
+		}
+		else
+			continue;
+		if (var->varno != rti || var->varlevelsup != 0 ||
+			var->varattno <= 0 || con->constisnull)
+			continue;
+
+		tle = get_tle_by_resno(subquery->targetList, var->varattno);
+		if (tle == NULL || !IsA(tle->expr, WindowFunc))
+			continue;
+		wfunc = (WindowFunc *) tle->expr;
+		if (wfunc->winfnoid != F_WINDOW_ROW_NUMBER &&
+			wfunc->winfnoid != F_WINDOW_RANK &&
+			wfunc->winfnoid != F_WINDOW_DENSE_RANK)
+			continue;
+
+		switch (con->consttype)
+		{
+			case INT2OID:
+				limit = DatumGetInt16(con->constvalue);
+				break;
+			case INT4OID:
+				limit = DatumGetInt32(con->constvalue);
+				break;
+			case INT8OID:
+				limit = DatumGetInt64(con->constvalue);
+				break;
+			default:
+				continue;
+		}
+
+		strategy = get_op_opfamily_strategy(opexpr->opno,
+											INTEGER_BTREE_FAM_OID);
+		if (!varonleft)
+			strategy = BTCommuteStrategyNumber(strategy);
+
+		/* the functions start at 1, so a limit below that skips everything */
+		limit = Max(limit, 0);
+		switch (strategy)
+		{
+			case BTLessStrategyNumber:
+				if (limit > 0)
+					limit--;
+				break;
+			case BTLessEqualStrategyNumber:
+			case BTEqualStrategyNumber:
+				break;
+			default:
+				continue;
+		}
+		if (limit > INT_MAX)
+			continue;
+
+		foreach(lc, subquery->windowClause)
+		{
+			WindowClause *wc = (WindowClause *) lfirst(lc);
+
+			if (wc->winref != wfunc->winref)
+				continue;
+			if (wc->runFnOid == InvalidOid ||
+				(wc->runFnOid == wfunc->winfnoid && limit < wc->runLimit))
+			{
+				wc->runFnOid = wfunc->winfnoid;
+				wc->runLimit = (int) limit;
+			}
+			break;
+		}
+	}
+}
+
 /*
  * set_function_pathlist
  *		Build the (single) access path for a function RTE
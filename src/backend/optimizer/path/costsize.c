@@ -68,7 +68,10 @@
 
 #include <math.h>
 
+#include "catalog/pg_aggregate.h"
+#include "catalog/pg_type.h"
 #include "executor/executor.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeHash.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -79,11 +82,14 @@
 #include "optimizer/plancat.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "optimizer/tlist.h"
 #include "parser/parsetree.h"
 #include "utils/lsyscache.h"
 #include "utils/selfuncs.h"
 #include "utils/spccache.h"
+#include "utils/syscache.h"
 #include "utils/tuplesort.h"
+#include "windowapi.h"
 
 
 #define LOG2(x)  (log(x) / 0.693147180559945)
@@ -113,11 +119,15 @@ bool		enable_indexscan = true;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
+bool		enable_incrementalsort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
+bool		enable_multiframe = true;
+bool		enable_runcondition = true;
+bool		enable_hashaggspill = true;
 
 typedef struct
 {
@@ -139,6 +149,13 @@ static bool adjust_semi_join(PlannerInfo *root, JoinPath *path,
 static double approx_tuple_count(PlannerInfo *root, JoinPath *path,
 				   List *quals);
 static void set_rel_width(PlannerInfo *root, RelOptInfo *rel);
+static WindowClause *find_window_clause(PlannerInfo *root, Index winref);
+static double window_partition_rows(PlannerInfo *root, WindowClause *wc,
+					  double input_tuples);
+static double window_frame_bound(Node *offset, double partrows);
+static Cost window_aggregate_cost(PlannerInfo *root, WindowFunc *wfunc,
+					  WindowClause *wc, double partrows, Cost argcost,
+					  double *fetches);
 static double relation_byte_size(double tuples, int width);
 static double page_size(double tuples, int width);
 
@@ -1222,6 +1239,77 @@ cost_sort(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_incremental_sort
+ *	  Determines and returns the cost of sorting an input that is already
+ *	  sorted by the first 'presorted_keys' of the sort keys.
+ *
+ * The executor sorts each group of input tuples sharing the presorted keys
+ * by the remaining keys alone, so we charge cost_sort for a group of average
+ * size once per group, plus comparing the presorted keys of every tuple to
+ * find the group boundaries and a little per-group setup.  Only the first
+ * group has to be read and sorted before the first tuple comes out.
+ *
+ * 'pathkeys' is the list of sort keys, of which 'presorted_keys' leading
+ * ones the input is sorted by
+ * 'input_startup_cost' and 'input_total_cost' are the costs of the input
+ * Other parameters are as for cost_sort.
+ */
+void
+cost_incremental_sort(Path *path, PlannerInfo *root,
+					  List *pathkeys, int presorted_keys,
+					  Cost input_startup_cost, Cost input_total_cost,
+					  double tuples, int width,
+					  Cost comparison_cost, int sort_mem)
+{
+	Path		group_path;		/* dummy for result of cost_sort */
+	List	   *presortedExprs = NIL;
+	ListCell   *lc;
+	double		groups;
+	double		group_tuples;
+	Cost		group_input_run_cost;
+	Cost		startup_cost;
+	Cost		run_cost;
+
+	Assert(presorted_keys > 0 && presorted_keys < list_length(pathkeys));
+
+	if (tuples < 2.0)
+		tuples = 2.0;
+
+	/* Estimate the number of groups from any member of each presorted key */
+	foreach(lc, pathkeys)
+	{
+		PathKey    *key = (PathKey *) lfirst(lc);
+		EquivalenceMember *member = (EquivalenceMember *)
+		linitial(key->pk_eclass->ec_members);
+
+		if (list_length(presortedExprs) == presorted_keys)
+			break;
+		presortedExprs = lappend(presortedExprs, member->em_expr);
+	}
+	groups = estimate_num_groups(root, presortedExprs, tuples);
+	groups = Max(groups, 1.0);
+	groups = Min(groups, tuples);
+	group_tuples = tuples / groups;
+
+	cost_sort(&group_path, root, NIL, 0.0, group_tuples, width,
+			  comparison_cost, sort_mem, -1.0);
+
+	group_input_run_cost = (input_total_cost - input_startup_cost) / groups;
+
+	startup_cost = input_startup_cost + group_input_run_cost +
+		group_path.startup_cost;
+	run_cost = (group_path.total_cost - group_path.startup_cost) +
+		(groups - 1.0) * (group_input_run_cost + group_path.total_cost);
+
+	/* Look for the group boundaries, and set up a sort per group */
+	run_cost += cpu_operator_cost * presorted_keys * tuples;
+	run_cost += 2.0 * cpu_tuple_cost * groups;
+
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_merge_append
  *	  Determines and returns the cost of a MergeAppend node.
@@ -1428,66 +1516,361 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * cost_hashagg_spill
+ *		adds to a hashed Agg path the cost of spilling the groups
+ *		that don't fit in work_mem to temp files.
+ *
+ * hashentrysize is the estimated memory per group.  Once the hash table is
+ * full, the input tuples of the groups not in it are written out in
+ * HASHAGG_SPILL_BATCHES partitions, each aggregated later the same way, so
+ * the spilled fraction of the input is written and read back once per level
+ * of partitioning needed to bring a partition's groups within work_mem.
+ * Page accesses are charged as in cost_sort, plus the forming and reading
+ * back of each spilled tuple per level, and an operator to rehash it.
+ */
+void
+cost_hashagg_spill(Path *path, double input_tuples, int input_width,
+				   double numGroups, double hashentrysize)
+{
+	double		groupsInMem;
+	double		spillFraction;
+	double		depth;
+	double		npages;
+	Cost		spill_cost;
+
+	groupsInMem = floor((work_mem * 1024.0) / Max(hashentrysize, 1.0));
+	groupsInMem = Max(groupsInMem, 1.0);
+	if (numGroups <= groupsInMem)
+		return;
+
+	spillFraction = 1.0 - groupsInMem / numGroups;
+	depth = ceil(log(numGroups / groupsInMem) /
+				 log((double) HASHAGG_SPILL_BATCHES));
+	depth = Max(depth, 1.0);
+
+	npages = page_size(input_tuples * spillFraction, input_width);
+	spill_cost = 2.0 * npages * depth *
+		(seq_page_cost * 0.75 + random_page_cost * 0.25);
+	spill_cost += (cpu_tuple_cost + cpu_operator_cost) *
+		input_tuples * spillFraction * depth;
+
+	/* the first groups are only returned after all of the input is read */
+	path->startup_cost += spill_cost;
+	path->total_cost += spill_cost;
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
  *		including the cost of its input.
  *
  * Input is assumed already properly sorted.
+ *
+ * Each window function is charged by the frame of its own window clause
+ * (a WindowAgg may evaluate several windows sharing a sort), with the rows
+ * of a partition estimated from the distinct values of the partitioning
+ * columns.  Aggregates are charged for the transitions the executor's
+ * strategy for the frame will run; other window functions are assumed to
+ * cost their stated execution cost, plus the cost of evaluating their input
+ * expressions, per tuple, which is a good estimate for all the built-in
+ * ones.  A partition that doesn't fit in work_mem goes to a temp file, and
+ * is charged for writing it and for every row read back.
  */
 void
 cost_windowagg(Path *path, PlannerInfo *root,
 			   List *windowFuncs, int numPartCols, int numOrderCols,
 			   Cost input_startup_cost, Cost input_total_cost,
-			   double input_tuples)
+			   double input_tuples, int input_width)
 {
 	Cost		startup_cost;
 	Cost		total_cost;
+	Cost		partition_cost = 0;
+	double		spill_pages = 0;
+	double		numPartitions = 1;
 	ListCell   *lc;
 
 	startup_cost = input_startup_cost;
 	total_cost = input_total_cost;
 
-	/*
-	 * Window functions are assumed to cost their stated execution cost, plus
-	 * the cost of evaluating their input expressions, per tuple.  Since they
-	 * may in fact evaluate their inputs at multiple rows during each cycle,
-	 * this could be a drastic underestimate; but without a way to know how
-	 * many rows the window function will fetch, it's hard to do better.  In
-	 * any case, it's a good estimate for all the built-in window functions,
-	 * so we'll just do this for now.
-	 */
+	if (input_tuples < 1.0)
+		input_tuples = 1.0;
+
 	foreach(lc, windowFuncs)
 	{
 		WindowFunc *wfunc = (WindowFunc *) lfirst(lc);
+		WindowClause *wc;
 		Cost		wfunccost;
 		QualCost	argcosts;
+		double		partrows;
+		double		fetches;
 
 		Assert(IsA(wfunc, WindowFunc));
 
-		wfunccost = get_func_cost(wfunc->winfnoid) * cpu_operator_cost;
+		wc = find_window_clause(root, wfunc->winref);
+		partrows = window_partition_rows(root, wc, input_tuples);
+		numPartitions = Max(numPartitions, input_tuples / partrows);
 
 		/* also add the input expressions' cost to per-input-row costs */
 		cost_qual_eval_node(&argcosts, (Node *) wfunc->args, root);
 		startup_cost += argcosts.startup;
-		wfunccost += argcosts.per_tuple;
 
+		if (wfunc->winagg)
+			wfunccost = window_aggregate_cost(root, wfunc, wc, partrows,
+											  argcosts.per_tuple, &fetches);
+		else
+		{
+			wfunccost = get_func_cost(wfunc->winfnoid) * cpu_operator_cost;
+			wfunccost += argcosts.per_tuple;
+			fetches = 0;
+		}
 		total_cost += wfunccost * input_tuples;
+
+		/*
+		 * A partition that overflows work_mem is written out once, and the
+		 * rows the aggregates fetch are read back.
+		 */
+		if (relation_byte_size(partrows, input_width) > work_mem * 1024L)
+		{
+			spill_pages = Max(spill_pages, page_size(input_tuples, input_width));
+			total_cost += seq_page_cost * fetches * input_tuples *
+				relation_byte_size(1, input_width) / BLCKSZ;
+		}
+
+		/* the first row waits for its whole partition if the frame does */
+		if (wc == NULL ||
+			(wc->frameOptions & FRAMEOPTION_END_UNBOUNDED_FOLLOWING))
+			partition_cost = Max(partition_cost, wfunccost * partrows);
 	}
+	total_cost += 2.0 * seq_page_cost * spill_pages;
 
 	/*
 	 * We also charge cpu_operator_cost per grouping column per tuple for
 	 * grouping comparisons, plus cpu_tuple_cost per tuple for general
 	 * overhead.
-	 *
-	 * XXX this neglects costs of spooling the data to disk when it overflows
-	 * work_mem.  Sooner or later that should get accounted for.
 	 */
 	total_cost += cpu_operator_cost * (numPartCols + numOrderCols) * input_tuples;
 	total_cost += cpu_tuple_cost * input_tuples;
 
+	/*
+	 * Rows come out as soon as their frames are complete.  When a frame runs
+	 * to the end of the partition, the first one has to wait for the first
+	 * partition to be read and aggregated.
+	 */
+	if (partition_cost > 0)
+		startup_cost += (input_total_cost - input_startup_cost) / numPartitions +
+			partition_cost;
+
 	path->startup_cost = startup_cost;
-	path->total_cost = total_cost;
+	path->total_cost = Max(total_cost, startup_cost);
+}
+
+/*
+ * find_window_clause
+ *		Find the window clause with the given winref, or NULL.
+ */
+static WindowClause *
+find_window_clause(PlannerInfo *root, Index winref)
+{
+	ListCell   *lc;
+
+	foreach(lc, root->parse->windowClause)
+	{
+		WindowClause *wc = (WindowClause *) lfirst(lc);
+
+		if (wc->winref == winref)
+			return wc;
+	}
+	return NULL;
+}
+
+/*
+ * window_partition_rows
+ *		Estimate the number of rows in a partition of the window.
+ */
+static double
+window_partition_rows(PlannerInfo *root, WindowClause *wc, double input_tuples)
+{
+	List	   *partExprs;
+	double		numPartitions;
+
+	if (wc == NULL || wc->partitionClause == NIL)
+		return input_tuples;
+
+	partExprs = get_sortgrouplist_exprs(wc->partitionClause,
+										root->parse->targetList);
+	numPartitions = estimate_num_groups(root, partExprs, input_tuples);
+	numPartitions = Max(numPartitions, 1.0);
+	numPartitions = Min(numPartitions, input_tuples);
+
+	return input_tuples / numPartitions;
+}
+
+/*
+ * window_frame_bound
+ *		Estimate the position of a ROWS frame bound relative to the current
+ *		row, for a bound given as an offset.
+ *
+ * An offset that isn't known until execution is guessed at half the
+ * partition.
+ */
+static double
+window_frame_bound(Node *offset, double partrows)
+{
+	if (offset && IsA(offset, Const) && !((Const *) offset)->constisnull)
+		return (double) DatumGetInt64(((Const *) offset)->constvalue);
+	return partrows / 2;
+}
+
+/*
+ * window_aggregate_cost
+ *		Estimate the per-row cost of a window aggregate over its frame.
+ *
+ * A frame starting at UNBOUNDED PRECEDING only grows, so each row is
+ * aggregated once.  A moving frame is aggregated the way the executor will
+ * do it (see initialize_frame_aggregates in nodeWindowAgg.c): by adding and
+ * removing rows if the aggregate has an inverse transition function, by
+ * combining nodes of a segment tree if it has a combine function, or else by
+ * restarting it at every new frame head, which temporary transition values
+ * make cheaper when enable_recompute is on.
+ *
+ * *fetches is set to the number of rows fetched from the buffer per row,
+ * for the I/O cost of a spilled partition.
+ */
+static Cost
+window_aggregate_cost(PlannerInfo *root, WindowFunc *wfunc, WindowClause *wc,
+					  double partrows, Cost argcost, double *fetches)
+{
+	HeapTuple	aggTuple;
+	Form_pg_aggregate aggform;
+	Cost		transcost;
+	Cost		invtranscost = 0;
+	Cost		combinecost = 0;
+	Cost		finalcost = 0;
+	bool		has_invtrans;
+	bool		internal;
+	bool		volatile_args;
+	int			frameOptions;
+	double		framerows;
+	Cost		cost;
+
+	aggTuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(wfunc->winfnoid));
+	if (!HeapTupleIsValid(aggTuple))
+		elog(ERROR, "cache lookup failed for aggregate %u",
+			 wfunc->winfnoid);
+	aggform = (Form_pg_aggregate) GETSTRUCT(aggTuple);
+	transcost = get_func_cost(aggform->aggtransfn) * cpu_operator_cost;
+	has_invtrans = OidIsValid(aggform->agginvtransfn);
+	if (has_invtrans)
+		invtranscost = get_func_cost(aggform->agginvtransfn) * cpu_operator_cost;
+	if (OidIsValid(aggform->aggcombinefn))
+		combinecost = get_func_cost(aggform->aggcombinefn) * cpu_operator_cost;
+	if (OidIsValid(aggform->aggfinalfn))
+		finalcost = get_func_cost(aggform->aggfinalfn) * cpu_operator_cost;
+	internal = (aggform->aggtranstype == INTERNALOID);
+	ReleaseSysCache(aggTuple);
+
+	/* the arguments are evaluated for every row aggregated */
+	transcost += argcost;
+	invtranscost += argcost;
+	volatile_args = contain_volatile_functions((Node *) wfunc);
+
+	frameOptions = wc ? wc->frameOptions : FRAMEOPTION_DEFAULTS;
+	if (frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING)
+	{
+		*fetches = 1;
+		return transcost + finalcost;
+	}
+
+	/* Estimate the rows in the frame, which runs from start to end */
+	if ((frameOptions & FRAMEOPTION_ROWS) &&
+		!(frameOptions & FRAMEOPTION_END_UNBOUNDED_FOLLOWING))
+	{
+		double		start = 0;
+		double		end = 0;
+
+		if (frameOptions & FRAMEOPTION_START_VALUE_PRECEDING)
+			start = -window_frame_bound(wc->startOffset, partrows);
+		else if (frameOptions & FRAMEOPTION_START_VALUE_FOLLOWING)
+			start = window_frame_bound(wc->startOffset, partrows);
+		if (frameOptions & FRAMEOPTION_END_VALUE_PRECEDING)
+			end = -window_frame_bound(wc->endOffset, partrows);
+		else if (frameOptions & FRAMEOPTION_END_VALUE_FOLLOWING)
+			end = window_frame_bound(wc->endOffset, partrows);
+		framerows = end - start + 1;
+	}
+	else
+	{
+		/*
+		 * up to the end of the partition, from the middle on average; the
+		 * offset of a RANGE frame is a value, not a number of rows, and is
+		 * not guessed at
+		 */
+		framerows = partrows / 2;
+		if ((frameOptions & FRAMEOPTION_ROWS) &&
+			(frameOptions & FRAMEOPTION_START_VALUE_PRECEDING))
+			framerows += window_frame_bound(wc->startOffset, partrows);
+	}
+	framerows = Max(framerows, 1.0);
+	framerows = Min(framerows, partrows);
+
+	if (enable_inversetrans && !enable_reusebuffer &&
+		has_invtrans && !volatile_args)
+	{
+		/* each row enters the frame once and leaves it once */
+		*fetches = 2;
+		cost = transcost + invtranscost;
+	}
+	else if (enable_segtree && !enable_reusebuffer &&
+			 combinecost > 0 && !internal && !volatile_args)
+	{
+		/*
+		 * The tree is built once per partition, aggregating every row and
+		 * combining about as many nodes; a frame combines about two nodes
+		 * per level.
+		 */
+		*fetches = 1;
+		cost = transcost + combinecost +
+			2.0 * LOG2(Max(framerows, 2.0)) * combinecost;
+	}
+	else
+	{
+		double		fetch = cpu_tuple_cost;
+
+		/* restarted at every row, with a fetch of every frame row */
+		*fetches = framerows;
+		cost = framerows * (fetch + transcost);
+
+		/*
+		 * With m temporary transition values started s rows apart, the frame
+		 * is aggregated from scratch once every m*s rows; opt_tune_recompute
+		 * picks m and s the same way at run time.
+		 */
+		if (enable_recompute && !internal)
+		{
+			int			num;
+
+			for (num = 1; num <= 64; num++)
+			{
+				double		spacing;
+				double		numcost;
+
+				spacing = sqrt(2.0 * framerows * (fetch + (1 + num) * transcost) /
+							   (num * (fetch + transcost)));
+				spacing = Max(rint(spacing), 1.0);
+				if (num * spacing >= framerows)
+					break;
+				numcost = framerows * (fetch + (1 + num) * transcost) /
+					(num * spacing) + spacing / 2 * (fetch + transcost);
+				if (numcost >= cost)
+					break;
+				cost = numcost;
+				*fetches = framerows / (num * spacing) + spacing / 2;
+			}
+		}
+	}
+
+	return cost + finalcost;
 }
 
 /*
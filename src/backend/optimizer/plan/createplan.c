@@ -4008,7 +4008,8 @@ make_windowagg(PlannerInfo *root, List *tlist,
 				   windowFuncs, partNumCols, ordNumCols,
 				   lefttree->startup_cost,
 				   lefttree->total_cost,
-				   lefttree->plan_rows);
+				   lefttree->plan_rows,
+				   lefttree->plan_width);
 	plan->startup_cost = windowagg_path.startup_cost;
 	plan->total_cost = windowagg_path.total_cost;
 
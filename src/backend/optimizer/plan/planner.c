@@ -51,6 +51,13 @@ double		cursor_tuple_fraction = DEFAULT_CURSOR_TUPLE_FRACTION;
 planner_hook_type planner_hook = NULL;
 
 
+/* An active window, and its position in the list of them */
+typedef struct
+{
+	WindowClause *wc;
+	int			position;
+} ActiveWindow;
+
 /* Expression kind codes for preprocess_expression */
 #define EXPRKIND_QUAL		0
 #define EXPRKIND_TARGET		1
@@ -90,6 +97,13 @@ static void locate_grouping_columns(PlannerInfo *root,
 						AttrNumber *groupColIdx);
 static List *postprocess_setop_tlist(List *new_tlist, List *orig_tlist);
 static List *select_active_windows(PlannerInfo *root, WindowFuncLists *wflists);
+static bool sort_clauses_match(SortGroupClause *sgc1, SortGroupClause *sgc2);
+static void order_window_partitions(List *actives);
+static int	common_prefix_cmp(const void *a, const void *b);
+static int	count_window_sorts(List *windows);
+static bool window_order_is_prefix(List *orderClause1, List *orderClause2);
+static void use_presorted_keys(PlannerInfo *root, Sort *sort_plan,
+				   List *pathkeys, List *input_pathkeys);
 static List *add_volatile_sort_exprs(List *window_tlist, List *tlist,
 						List *activeWindows);
 static List *make_pathkeys_for_window(PlannerInfo *root, WindowClause *wc,
@@ -1414,12 +1428,14 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		/*
 		 * Since each window function could require a different sort order, we
 		 * stack up a WindowAgg node for each window, with sort steps between
-		 * them as needed.
+		 * them as needed.  Windows that can share a sort are evaluated by a
+		 * single WindowAgg, if enable_multiframe is set.
 		 */
 		if (activeWindows)
 		{
 			List	   *window_tlist;
 			ListCell   *l;
+			ListCell   *lc;
 
 			/*
 			 * If the top-level plan node is one that cannot do expression
@@ -1467,16 +1483,59 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 												   activeWindows);
 			result_plan->targetlist = (List *) copyObject(window_tlist);
 
-			foreach(l, activeWindows)
+			l = list_head(activeWindows);
+			while (l != NULL)
 			{
 				WindowClause *wc = (WindowClause *) lfirst(l);
+				List	   *sharedWindows = NIL;
+				List	   *windowFuncs;
 				List	   *window_pathkeys;
+				AttrNumber *sortColIdx = NULL;
 				int			partNumCols;
 				AttrNumber *partColIdx;
 				Oid		   *partOperators;
 				int			ordNumCols;
 				AttrNumber *ordColIdx;
 				Oid		   *ordOperators;
+				WindowAgg  *wplan;
+
+				/*
+				 * Collect the following windows that have the same
+				 * partitioning as wc, and an ordering that is a prefix of
+				 * wc's or vice versa; select_active_windows has put windows
+				 * with identical ordering next to each other.  All of them
+				 * are evaluated over one sort by the longest ordering, which
+				 * becomes wc, and a window with a shorter ordering just
+				 * compares fewer columns for peers.  A RANGE frame with a
+				 * value offset keeps a node of its own, since the frames of
+				 * a node do not carry its bound functions.
+				 */
+				windowFuncs = list_copy(wflists->windowFuncs[wc->winref]);
+				for (l = lnext(l); l != NULL && enable_multiframe; l = lnext(l))
+				{
+					WindowClause *wc2 = (WindowClause *) lfirst(l);
+
+					if (!equal(wc->partitionClause, wc2->partitionClause))
+						break;
+					if (OidIsValid(wc->startInRangeFunc) ||
+						OidIsValid(wc->endInRangeFunc) ||
+						OidIsValid(wc2->startInRangeFunc) ||
+						OidIsValid(wc2->endInRangeFunc))
+						break;
+					if (window_order_is_prefix(wc2->orderClause,
+											   wc->orderClause))
+						sharedWindows = lappend(sharedWindows, wc2);
+					else if (window_order_is_prefix(wc->orderClause,
+													wc2->orderClause))
+					{
+						sharedWindows = lappend(sharedWindows, wc);
+						wc = wc2;
+					}
+					else
+						break;
+					windowFuncs = list_concat(windowFuncs,
+						   list_copy(wflists->windowFuncs[wc2->winref]));
+				}
 
 				window_pathkeys = make_pathkeys_for_window(root,
 														   wc,
@@ -1504,10 +1563,15 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 											   current_pathkeys))
 					{
 						/* we do indeed need to sort */
+						if (enable_incrementalsort)
+							use_presorted_keys(root, sort_plan,
+											   window_pathkeys,
+											   current_pathkeys);
 						result_plan = (Plan *) sort_plan;
 						current_pathkeys = window_pathkeys;
 					}
 					/* In either case, extract the per-column information */
+					sortColIdx = sort_plan->sortColIdx;
 					get_column_info_for_window(root, wc, tlist,
 											   sort_plan->numCols,
 											   sort_plan->sortColIdx,
@@ -1529,11 +1593,10 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 					ordOperators = NULL;
 				}
 
-				if (lnext(l))
+				if (l != NULL)
 				{
 					/* Add the current WindowFuncs to the running tlist */
-					window_tlist = add_to_flat_tlist(window_tlist,
-										   wflists->windowFuncs[wc->winref]);
+					window_tlist = add_to_flat_tlist(window_tlist, windowFuncs);
 				}
 				else
 				{
@@ -1542,21 +1605,95 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 				}
 
 				/* ... and make the WindowAgg plan node */
-				result_plan = (Plan *)
-					make_windowagg(root,
-								   (List *) copyObject(window_tlist),
-								   wflists->windowFuncs[wc->winref],
-								   wc->winref,
-								   partNumCols,
-								   partColIdx,
-								   partOperators,
-								   ordNumCols,
-								   ordColIdx,
-								   ordOperators,
-								   wc->frameOptions,
-								   wc->startOffset,
-								   wc->endOffset,
-								   result_plan);
+				wplan = make_windowagg(root,
+									   (List *) copyObject(window_tlist),
+									   windowFuncs,
+									   wc->winref,
+									   partNumCols,
+									   partColIdx,
+									   partOperators,
+									   ordNumCols,
+									   ordColIdx,
+									   ordOperators,
+									   wc->frameOptions,
+									   wc->startOffset,
+									   wc->endOffset,
+									   result_plan);
+				wplan->startInRangeFunc = wc->startInRangeFunc;
+				wplan->endInRangeFunc = wc->endInRangeFunc;
+				wplan->startInRangeCmp = wc->startInRangeCmp;
+				wplan->endInRangeCmp = wc->endInRangeCmp;
+				wplan->inRangeColl = wc->inRangeColl;
+				wplan->inRangeAsc = wc->inRangeAsc;
+				wplan->inRangeNullsFirst = wc->inRangeNullsFirst;
+
+				/* Add the frames of the windows sharing the node */
+				foreach(lc, sharedWindows)
+				{
+					WindowClause *wc2 = (WindowClause *) lfirst(lc);
+					List	   *pathkeys2;
+					int			partNumCols2;
+					AttrNumber *partColIdx2;
+					Oid		   *partOperators2;
+					int			ordNumCols2 = 0;
+					AttrNumber *ordColIdx2;
+					Oid		   *ordOperators2;
+
+					/* its pathkeys are a prefix of wc's */
+					pathkeys2 = make_pathkeys_for_window(root, wc2, tlist,
+														 true);
+					if (pathkeys2)
+						get_column_info_for_window(root, wc2, tlist,
+												   list_length(pathkeys2),
+												   sortColIdx,
+												   &partNumCols2,
+												   &partColIdx2,
+												   &partOperators2,
+												   &ordNumCols2,
+												   &ordColIdx2,
+												   &ordOperators2);
+
+					wplan->extraWinrefs = lappend_int(wplan->extraWinrefs,
+													  wc2->winref);
+					wplan->extraOrdNumCols = lappend_int(wplan->extraOrdNumCols,
+														 ordNumCols2);
+					wplan->extraFrameOptions =
+						lappend_int(wplan->extraFrameOptions,
+									wc2->frameOptions);
+					wplan->extraStartOffsets =
+						lappend(wplan->extraStartOffsets, wc2->startOffset);
+					wplan->extraEndOffsets =
+						lappend(wplan->extraEndOffsets, wc2->endOffset);
+				}
+
+				/*
+				 * Only the topmost WindowAgg may stop a partition early on a
+				 * run condition: below it, the rows it skipped would still
+				 * be input to the windows further up.  All windows of the
+				 * node order the partition consistently with wc, so the
+				 * function of any of them is monotone in the node's order.
+				 */
+				if (l == NULL)
+				{
+					WindowClause *runwc = NULL;
+
+					if (wc->runFnOid != InvalidOid)
+						runwc = wc;
+					foreach(lc, sharedWindows)
+					{
+						WindowClause *wc2 = (WindowClause *) lfirst(lc);
+
+						if (runwc == NULL && wc2->runFnOid != InvalidOid)
+							runwc = wc2;
+					}
+					if (runwc != NULL)
+					{
+						wplan->runFnOid = runwc->runFnOid;
+						wplan->runWinref = runwc->winref;
+						wplan->runLimit = runwc->runLimit;
+					}
+				}
+				result_plan = (Plan *) wplan;
 			}
 		}
 	}							/* end of if (setOperations) */
@@ -2241,7 +2378,8 @@ choose_hashed_grouping(PlannerInfo *root,
 
 	/*
 	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
+	 * work_mem, unless the executor may spill it to disk; the
+	 * spilling is then costed below.
 	 */
 
 	/* Estimate per-hash-entry space at tuple width... */
@@ -2251,7 +2389,7 @@ choose_hashed_grouping(PlannerInfo *root,
 	/* plus the per-hash-entry overhead */
 	hashentrysize += hash_agg_entry_size(agg_costs->numAggs);
 
-	if (hashentrysize * dNumGroups > work_mem * 1024L)
+	if (hashentrysize * dNumGroups > work_mem * 1024L && !enable_hashaggspill)
 		return false;
 
 	/*
@@ -2287,6 +2425,9 @@ choose_hashed_grouping(PlannerInfo *root,
 			 numGroupCols, dNumGroups,
 			 cheapest_path->startup_cost, cheapest_path->total_cost,
 			 path_rows);
+	if (enable_hashaggspill)
+		cost_hashagg_spill(&hashed_p, path_rows, path_width,
+						   dNumGroups, (double) hashentrysize);
 	/* Result of hashed agg is always unsorted */
 	if (target_pathkeys)
 		cost_sort(&hashed_p, root, target_pathkeys, hashed_p.total_cost,
@@ -2413,11 +2554,12 @@ choose_hashed_distinct(PlannerInfo *root,
 
 	/*
 	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
+	 * work_mem, unless the executor may spill it to disk.
 	 */
 	hashentrysize = MAXALIGN(path_width) + MAXALIGN(sizeof(MinimalTupleData));
 
-	if (hashentrysize * dNumDistinctRows > work_mem * 1024L)
+	if (hashentrysize * dNumDistinctRows > work_mem * 1024L &&
+		!enable_hashaggspill)
 		return false;
 
 	/*
@@ -2437,6 +2579,9 @@ choose_hashed_distinct(PlannerInfo *root,
 			 numDistinctCols, dNumDistinctRows,
 			 cheapest_startup_cost, cheapest_total_cost,
 			 path_rows);
+	if (enable_hashaggspill)
+		cost_hashagg_spill(&hashed_p, path_rows, path_width,
+						   dNumDistinctRows, (double) hashentrysize);
 
 	/*
 	 * Result of hashed agg is always unsorted, so if ORDER BY is present we
@@ -2727,17 +2872,19 @@ select_active_windows(PlannerInfo *root, WindowFuncLists *wflists)
 			actives = lappend(actives, wc);
 	}
 
+	/*
+	 * Partitioning columns can be compared in any order, so first pick their
+	 * order such that the sort keys of as many windows as possible start the
+	 * same way.
+	 */
+	if (list_length(actives) > 1)
+		order_window_partitions(actives);
+
 	/*
 	 * Now, ensure that windows with identical partitioning/ordering clauses
 	 * are adjacent in the list.  This is required by the SQL standard, which
 	 * says that only one sort is to be used for such windows, even if they
 	 * are otherwise distinct (eg, different names or framing clauses).
-	 *
-	 * There is room to be much smarter here, for example detecting whether
-	 * one window's sort keys are a prefix of another's (so that sorting for
-	 * the latter would do for the former), or putting windows first that
-	 * match a sort order available for the underlying query.  For the moment
-	 * we are content with meeting the spec.
 	 */
 	result = NIL;
 	while (actives != NIL)
@@ -2769,9 +2916,306 @@ select_active_windows(PlannerInfo *root, WindowFuncLists *wflists)
 		}
 	}
 
+	/*
+	 * A window whose sort keys are a prefix of the previous window's needs no
+	 * sort of its own.  Sorting the windows by their keys, longest first
+	 * among those sharing a prefix, puts every such window right after one
+	 * it can follow; we take that order if it saves sorts, and otherwise keep
+	 * the order the windows were written in.  (There is still room to put
+	 * first a window that matches a sort order the underlying query provides
+	 * anyway.)
+	 */
+	if (list_length(result) > 1)
+	{
+		int			numWindows = list_length(result);
+		ActiveWindow *windows;
+		List	   *sorted = NIL;
+		int			i;
+
+		windows = (ActiveWindow *) palloc(numWindows * sizeof(ActiveWindow));
+		i = 0;
+		foreach(lc, result)
+		{
+			windows[i].wc = (WindowClause *) lfirst(lc);
+			windows[i].position = i;
+			i++;
+		}
+		qsort(windows, numWindows, sizeof(ActiveWindow), common_prefix_cmp);
+		for (i = 0; i < numWindows; i++)
+			sorted = lappend(sorted, windows[i].wc);
+		pfree(windows);
+
+		if (count_window_sorts(sorted) < count_window_sorts(result))
+			result = sorted;
+	}
+
 	return result;
 }
 
+/*
+ * sort_clauses_match
+ *		Do two SortGroupClauses sort the same column the same way?
+ *
+ * A partitioning clause and an ordering clause can both stand for a column;
+ * they need not be equal() for that, eg the partitioning one also carries
+ * the equality operator.
+ */
+static bool
+sort_clauses_match(SortGroupClause *sgc1, SortGroupClause *sgc2)
+{
+	return sgc1->tleSortGroupRef == sgc2->tleSortGroupRef &&
+		sgc1->sortop == sgc2->sortop &&
+		sgc1->nulls_first == sgc2->nulls_first;
+}
+
+/*
+ * order_window_partitions
+ *		Choose the order of each active window's partitioning columns.
+ *
+ * Windows are taken in order of increasing number of partitioning columns.
+ * Each one looks for the window already taken whose sort keys (partitioning
+ * then ordering columns) have the longest prefix made of its own
+ * partitioning columns, and puts those columns first, in the same order.
+ * That way the windows' sorts share the prefix; if it is all of the other
+ * window's keys, one of the sorts goes away altogether.
+ */
+static void
+order_window_partitions(List *actives)
+{
+	List	   *done = NIL;
+	int			maxcols = 0;
+	int			ncols;
+	ListCell   *lc;
+
+	foreach(lc, actives)
+	{
+		WindowClause *wc = (WindowClause *) lfirst(lc);
+
+		maxcols = Max(maxcols, list_length(wc->partitionClause));
+	}
+
+	for (ncols = 0; ncols <= maxcols; ncols++)
+	{
+		foreach(lc, actives)
+		{
+			WindowClause *wc = (WindowClause *) lfirst(lc);
+			List	   *bestPrefix = NIL;
+			ListCell   *lc2;
+
+			if (list_length(wc->partitionClause) != ncols)
+				continue;
+
+			foreach(lc2, done)
+			{
+				WindowClause *wc2 = (WindowClause *) lfirst(lc2);
+				List	   *keys2;
+				List	   *prefix = NIL;
+				ListCell   *lc3;
+
+				keys2 = list_concat(list_copy(wc2->partitionClause),
+									list_copy(wc2->orderClause));
+				foreach(lc3, keys2)
+				{
+					SortGroupClause *sgc2 = (SortGroupClause *) lfirst(lc3);
+					SortGroupClause *match = NULL;
+					ListCell   *lc4;
+
+					foreach(lc4, wc->partitionClause)
+					{
+						SortGroupClause *sgc = (SortGroupClause *) lfirst(lc4);
+
+						if (sort_clauses_match(sgc, sgc2) &&
+							!list_member_ptr(prefix, sgc))
+						{
+							match = sgc;
+							break;
+						}
+					}
+					if (match == NULL)
+						break;
+					prefix = lappend(prefix, match);
+				}
+				list_free(keys2);
+
+				if (list_length(prefix) > list_length(bestPrefix))
+					bestPrefix = prefix;
+			}
+
+			if (bestPrefix != NIL)
+			{
+				foreach(lc2, wc->partitionClause)
+				{
+					if (!list_member_ptr(bestPrefix, lfirst(lc2)))
+						bestPrefix = lappend(bestPrefix, lfirst(lc2));
+				}
+				wc->partitionClause = bestPrefix;
+			}
+			done = lappend(done, wc);
+		}
+	}
+	list_free(done);
+}
+
+/*
+ * common_prefix_cmp
+ *		qsort comparator ordering ActiveWindows by their sort keys.
+ *
+ * Windows whose keys start the same way come out adjacent, and a window
+ * sorts ahead of the ones whose keys are a prefix of its own.  The order
+ * among the keys themselves is arbitrary.  Windows with identical keys keep
+ * their relative order.
+ */
+static int
+common_prefix_cmp(const void *a, const void *b)
+{
+	const ActiveWindow *wa = (const ActiveWindow *) a;
+	const ActiveWindow *wb = (const ActiveWindow *) b;
+	List	   *keysa;
+	List	   *keysb;
+	ListCell   *lca;
+	ListCell   *lcb;
+	int			result = 0;
+
+	keysa = list_concat(list_copy(wa->wc->partitionClause),
+						list_copy(wa->wc->orderClause));
+	keysb = list_concat(list_copy(wb->wc->partitionClause),
+						list_copy(wb->wc->orderClause));
+
+	forboth(lca, keysa, lcb, keysb)
+	{
+		SortGroupClause *sgca = (SortGroupClause *) lfirst(lca);
+		SortGroupClause *sgcb = (SortGroupClause *) lfirst(lcb);
+
+		if (sgca->tleSortGroupRef != sgcb->tleSortGroupRef)
+			result = (sgca->tleSortGroupRef > sgcb->tleSortGroupRef) ? -1 : 1;
+		else if (sgca->sortop != sgcb->sortop)
+			result = (sgca->sortop > sgcb->sortop) ? -1 : 1;
+		else if (sgca->nulls_first != sgcb->nulls_first)
+			result = sgca->nulls_first ? -1 : 1;
+		if (result != 0)
+			break;
+	}
+	if (result == 0 && list_length(keysa) != list_length(keysb))
+		result = (list_length(keysa) > list_length(keysb)) ? -1 : 1;
+	if (result == 0)
+		result = (wa->position < wb->position) ? -1 : 1;
+
+	list_free(keysa);
+	list_free(keysb);
+	return result;
+}
+
+/*
+ * count_window_sorts
+ *		Count the sorts needed to evaluate the windows in the given order.
+ *
+ * A window needs no sort if its sort keys are a prefix of the ones the rows
+ * were last sorted by.  We don't look at the ordering of the input here.
+ */
+static int
+count_window_sorts(List *windows)
+{
+	List	   *current = NIL;
+	int			nsorts = 0;
+	ListCell   *lc;
+
+	foreach(lc, windows)
+	{
+		WindowClause *wc = (WindowClause *) lfirst(lc);
+		List	   *keys;
+		ListCell   *lck;
+		ListCell   *lcc;
+		bool		sorted = true;
+
+		keys = list_concat(list_copy(wc->partitionClause),
+						   list_copy(wc->orderClause));
+		if (list_length(keys) > list_length(current))
+			sorted = false;
+		else
+		{
+			forboth(lck, keys, lcc, current)
+			{
+				if (!sort_clauses_match((SortGroupClause *) lfirst(lck),
+										(SortGroupClause *) lfirst(lcc)))
+				{
+					sorted = false;
+					break;
+				}
+			}
+		}
+
+		if (sorted)
+			list_free(keys);
+		else
+		{
+			list_free(current);
+			current = keys;
+			if (keys != NIL)
+				nsorts++;
+		}
+	}
+	list_free(current);
+
+	return nsorts;
+}
+
+/*
+ * window_order_is_prefix
+ *		Is orderClause1 a prefix of orderClause2?
+ */
+static bool
+window_order_is_prefix(List *orderClause1, List *orderClause2)
+{
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	if (list_length(orderClause1) > list_length(orderClause2))
+		return false;
+	forboth(lc1, orderClause1, lc2, orderClause2)
+	{
+		if (!equal(lfirst(lc1), lfirst(lc2)))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * use_presorted_keys
+ *		If the input of a window's sort is already sorted by some leading
+ *		keys, let the sort just finish it when that is estimated cheaper.
+ */
+static void
+use_presorted_keys(PlannerInfo *root, Sort *sort_plan,
+				   List *pathkeys, List *input_pathkeys)
+{
+	Plan	   *lefttree = sort_plan->plan.lefttree;
+	Path		sort_path;		/* dummy for result of cost_incremental_sort */
+	int			presorted_keys = 0;
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	/* pathkeys are canonical, so pointer comparison is enough */
+	forboth(lc1, pathkeys, lc2, input_pathkeys)
+	{
+		if (lfirst(lc1) != lfirst(lc2))
+			break;
+		presorted_keys++;
+	}
+	if (presorted_keys == 0 || presorted_keys >= sort_plan->numCols)
+		return;
+
+	cost_incremental_sort(&sort_path, root, pathkeys, presorted_keys,
+						  lefttree->startup_cost, lefttree->total_cost,
+						  lefttree->plan_rows, lefttree->plan_width,
+						  0.0, work_mem);
+	if (sort_path.total_cost < sort_plan->plan.total_cost)
+	{
+		sort_plan->numPresorted = presorted_keys;
+		sort_plan->plan.startup_cost = sort_path.startup_cost;
+		sort_plan->plan.total_cost = sort_path.total_cost;
+	}
+}
+
 /*
  * add_volatile_sort_exprs
  *		Identify any volatile sort/group expressions used by the active
@@ -66,6 +66,13 @@ typedef struct
 	int			rtoffset;
 } fix_upper_expr_context;
 
+typedef struct
+{
+	List	   *winrefs;		/* IDs of the node's windows */
+	bool		in_wfunc;		/* walking a window function's arguments */
+	List	   *attnos;			/* input columns found so far */
+} spill_columns_context;
+
 /*
  * Check if a Const node is a regclass value.  We accept plain OID too,
  * since a regclass Const will get folded to that type if it's an argument
@@ -91,6 +98,8 @@ static bool fix_scan_expr_walker(Node *node, fix_scan_expr_context *context);
 static void set_join_references(PlannerGlobal *glob, Join *join, int rtoffset);
 static void set_upper_references(PlannerGlobal *glob, Plan *plan, int rtoffset);
 static void set_dummy_tlist_references(Plan *plan, int rtoffset);
+static void set_windowagg_spill_columns(WindowAgg *wplan);
+static bool spill_columns_walker(Node *node, spill_columns_context *context);
 static indexed_tlist *build_tlist_index(List *tlist);
 static Var *search_indexed_tlist_for_var(Var *var,
 							 indexed_tlist *itlist,
@@ -497,6 +506,7 @@ set_plan_refs(PlannerGlobal *glob, Plan *plan, int rtoffset)
 				WindowAgg  *wplan = (WindowAgg *) plan;
 
 				set_upper_references(glob, plan, rtoffset);
+				set_windowagg_spill_columns(wplan);
 
 				/*
 				 * Like Limit node limit/offset expressions, WindowAgg has
@@ -507,6 +517,10 @@ set_plan_refs(PlannerGlobal *glob, Plan *plan, int rtoffset)
 					fix_scan_expr(glob, wplan->startOffset, rtoffset);
 				wplan->endOffset =
 					fix_scan_expr(glob, wplan->endOffset, rtoffset);
+				wplan->extraStartOffsets =
+					fix_scan_list(glob, wplan->extraStartOffsets, rtoffset);
+				wplan->extraEndOffsets =
+					fix_scan_list(glob, wplan->extraEndOffsets, rtoffset);
 			}
 			break;
 		case T_Result:
@@ -1162,6 +1176,94 @@ set_upper_references(PlannerGlobal *glob, Plan *plan, int rtoffset)
 	pfree(subplan_itlist);
 }
 
+/*
+ * set_windowagg_spill_columns
+ *	  Choose the input columns a WindowAgg keeps for a spilled partition.
+ *
+ * When a partition no longer fits in memory and enable_winfunopt is set,
+ * the executor writes a second, narrow copy of each row holding only what
+ * frame evaluation reads: the ordering columns, for the peer tests, and
+ * the columns used by the arguments of the window functions of each of
+ * the node's windows, which lead/lag/nth_value and the aggregates evaluate
+ * on rows other than the current one.  The current row is still projected
+ * from the full input tuple.  The ordering columns come first, and
+ * opt_ordColIdx gives their positions in the narrow row.
+ *
+ * This must run after set_upper_references, so that the arguments refer
+ * to the subplan's tlist through OUTER Vars.
+ */
+static void
+set_windowagg_spill_columns(WindowAgg *wplan)
+{
+	spill_columns_context context;
+	List	   *attnos = NIL;
+	ListCell   *l;
+	int			i;
+
+	for (i = 0; i < wplan->ordNumCols; i++)
+		attnos = list_append_unique_int(attnos, wplan->ordColIdx[i]);
+
+	context.winrefs = lcons_int(wplan->winref,
+								list_copy(wplan->extraWinrefs));
+	context.in_wfunc = false;
+	context.attnos = attnos;
+	(void) spill_columns_walker((Node *) wplan->plan.targetlist, &context);
+	attnos = context.attnos;
+	list_free(context.winrefs);
+
+	wplan->spillNumCols = list_length(attnos);
+	wplan->spillColIdx = (AttrNumber *)
+		palloc(Max(wplan->spillNumCols, 1) * sizeof(AttrNumber));
+	i = 0;
+	foreach(l, attnos)
+		wplan->spillColIdx[i++] = (AttrNumber) lfirst_int(l);
+
+	/* list_append_unique_int kept the ordering columns in front */
+	wplan->opt_ordColIdx = (AttrNumber *)
+		palloc(Max(wplan->ordNumCols, 1) * sizeof(AttrNumber));
+	for (i = 0; i < wplan->ordNumCols; i++)
+	{
+		int			j;
+
+		for (j = 0; wplan->spillColIdx[j] != wplan->ordColIdx[i]; j++)
+			;
+		wplan->opt_ordColIdx[i] = j + 1;
+	}
+
+	list_free(attnos);
+}
+
+static bool
+spill_columns_walker(Node *node, spill_columns_context *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		if (context->in_wfunc && var->varno == OUTER)
+			context->attnos = list_append_unique_int(context->attnos,
+													 var->varattno);
+		return false;
+	}
+	if (IsA(node, WindowFunc) &&
+		list_member_int(context->winrefs, ((WindowFunc *) node)->winref) &&
+		!context->in_wfunc)
+	{
+		bool		result;
+
+		context->in_wfunc = true;
+		result = expression_tree_walker((Node *) ((WindowFunc *) node)->args,
+										spill_columns_walker,
+										(void *) context);
+		context->in_wfunc = false;
+		return result;
+	}
+	return expression_tree_walker(node, spill_columns_walker,
+								  (void *) context);
+}
+
 /*
  * set_dummy_tlist_references
  *	  Replace the targetlist of an upper-level plan node with a simple
@@ -2349,6 +2349,10 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 							  &context);
 			finalize_primnode(((WindowAgg *) plan)->endOffset,
 							  &context);
+			finalize_primnode((Node *) ((WindowAgg *) plan)->extraStartOffsets,
+							  &context);
+			finalize_primnode((Node *) ((WindowAgg *) plan)->extraEndOffsets,
+							  &context);
 			break;
 
 		case T_Hash:
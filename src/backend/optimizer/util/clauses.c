@@ -461,6 +461,7 @@ count_agg_clauses_walker(Node *node, count_agg_clauses_context *context)
 		Oid			aggtransfn;
 		Oid			aggfinalfn;
 		Oid			aggtranstype;
+		int32		aggtransspace;
 		QualCost	argcosts;
 		Oid		   *inputTypes;
 		int			numArguments;
@@ -478,6 +479,7 @@ count_agg_clauses_walker(Node *node, count_agg_clauses_context *context)
 		aggtransfn = aggform->aggtransfn;
 		aggfinalfn = aggform->aggfinalfn;
 		aggtranstype = aggform->aggtranstype;
+		aggtransspace = aggform->aggtransspace;
 		ReleaseSysCache(aggTuple);
 
 		/* count it */
@@ -530,7 +532,12 @@ count_agg_clauses_walker(Node *node, count_agg_clauses_context *context)
 		 * pass-by-reference then we have to add the estimated size of the
 		 * value itself, plus palloc overhead.
 		 */
-		if (!get_typbyval(aggtranstype))
+		if (aggtransspace > 0)
+		{
+			/* the aggregate has told us how much space its state takes */
+			costs->transitionSpace += aggtransspace;
+		}
+		else if (!get_typbyval(aggtranstype))
 		{
 			int32		aggtranstypmod;
 			int32		avgwidth;
@@ -558,7 +565,8 @@ count_agg_clauses_walker(Node *node, count_agg_clauses_context *context)
 			 * to some large data structure.  We assume usage of
 			 * ALLOCSET_DEFAULT_INITSIZE, which is a good guess if the data is
 			 * being kept in a private memory context, as is done by
-			 * array_agg() for instance.
+			 * array_agg() for instance.  Aggregates that keep a small struct
+			 * instead should declare its size in aggtransspace.
 			 */
 			costs->transitionSpace += ALLOCSET_DEFAULT_INITSIZE;
 		}
@@ -16,7 +16,9 @@
 #include "postgres.h"
 
 #include "access/heapam.h"
+#include "access/nbtree.h"
 #include "catalog/heap.h"
+#include "catalog/pg_operator.h"
 #include "catalog/pg_type.h"
 #include "commands/defrem.h"
 #include "nodes/makefuncs.h"
@@ -34,9 +36,11 @@
 #include "parser/parse_relation.h"
 #include "parser/parse_target.h"
 #include "rewrite/rewriteManip.h"
+#include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/syscache.h"
 
 
 /* clause types for findTargetlistEntrySQL92 */
@@ -90,6 +94,7 @@ static List *addTargetToGroupList(ParseState *pstate, TargetEntry *tle,
 					 bool resolveUnknown);
 static WindowClause *findWindowClause(List *wclist, const char *name);
 static Node *transformFrameOffset(ParseState *pstate, int frameOptions,
+					 WindowClause *wc, List *targetlist, bool isStart,
 					 Node *clause);
 
 
@@ -1716,8 +1721,10 @@ transformWindowDefinitions(ParseState *pstate,
 		wc->frameOptions = windef->frameOptions;
 		/* Process frame offset expressions */
 		wc->startOffset = transformFrameOffset(pstate, wc->frameOptions,
+											   wc, *targetlist, true,
 											   windef->startOffset);
 		wc->endOffset = transformFrameOffset(pstate, wc->frameOptions,
+											 wc, *targetlist, false,
 											 windef->endOffset);
 		wc->winref = winref;
 
@@ -2238,12 +2245,32 @@ findWindowClause(List *wclist, const char *name)
 /*
  * transformFrameOffset
  *		Process a window frame offset expression
+ *
+ * In RANGE mode the offset is added to or subtracted from the value of the
+ * single ORDER BY column, by its type's own + and - operators, and the
+ * result compared with the column by the btree comparison function of the
+ * ordering's operator family.  Those are looked up here and saved in wc.
  */
 static Node *
-transformFrameOffset(ParseState *pstate, int frameOptions, Node *clause)
+transformFrameOffset(ParseState *pstate, int frameOptions,
+					 WindowClause *wc, List *targetlist, bool isStart,
+					 Node *clause)
 {
 	const char *constructName = NULL;
 	Node	   *node;
+	SortGroupClause *sortcl;
+	Node	   *sortexpr;
+	Oid			sorttype;
+	Oid			opfamily;
+	Oid			opcintype;
+	int16		strategy;
+	bool		sub;
+	Operator	optup;
+	Form_pg_operator opform;
+	Oid			offsettype;
+	Oid			func;
+	Oid			cmp;
+	int			location;
 
 	/* Quick exit if no offset expression */
 	if (clause == NULL)
@@ -2262,13 +2289,81 @@ transformFrameOffset(ParseState *pstate, int frameOptions, Node *clause)
 	}
 	else if (frameOptions & FRAMEOPTION_RANGE)
 	{
-		/*
-		 * this needs a lot of thought to decide how to support in the context
-		 * of Postgres' extensible datatype framework
-		 */
 		constructName = "RANGE";
-		/* error was already thrown by gram.y, this is just a backstop */
-		elog(ERROR, "window frame with value offset is not implemented");
+		location = exprLocation(node);
+
+		if (list_length(wc->orderClause) != 1)
+			ereport(ERROR,
+					(errcode(ERRCODE_WINDOWING_ERROR),
+					 errmsg("RANGE with offset PRECEDING/FOLLOWING requires exactly one ORDER BY column"),
+					 parser_errposition(pstate, location)));
+		sortcl = (SortGroupClause *) linitial(wc->orderClause);
+		sortexpr = get_sortgroupclause_expr(sortcl, targetlist);
+		sorttype = exprType(sortexpr);
+		if (!get_ordering_op_properties(sortcl->sortop,
+										&opfamily, &opcintype, &strategy))
+			elog(ERROR, "operator %u is not a valid ordering operator",
+				 sortcl->sortop);
+		wc->inRangeColl = exprCollation(sortexpr);
+		wc->inRangeAsc = (strategy == BTLessStrategyNumber);
+		wc->inRangeNullsFirst = sortcl->nulls_first;
+
+		/* the offset's type is the one the column's + operator takes */
+		optup = oper(pstate, list_make1(makeString("+")),
+					 sorttype, exprType(node), true, location);
+		if (optup == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("RANGE with offset PRECEDING/FOLLOWING is not supported for column type %s and offset type %s",
+							format_type_be(sorttype),
+							format_type_be(exprType(node))),
+					 parser_errposition(pstate, location)));
+		offsettype = ((Form_pg_operator) GETSTRUCT(optup))->oprright;
+		ReleaseSysCache(optup);
+		node = coerce_to_specific_type(pstate, node, offsettype, constructName);
+
+		/* a bound before the current value in the ordering subtracts */
+		if (isStart)
+			sub = (frameOptions & FRAMEOPTION_START_VALUE_PRECEDING) != 0;
+		else
+			sub = (frameOptions & FRAMEOPTION_END_VALUE_PRECEDING) != 0;
+		if (!wc->inRangeAsc)
+			sub = !sub;
+
+		optup = oper(pstate, list_make1(makeString(sub ? "-" : "+")),
+					 sorttype, offsettype, true, location);
+		func = InvalidOid;
+		cmp = InvalidOid;
+		if (optup != NULL)
+		{
+			opform = (Form_pg_operator) GETSTRUCT(optup);
+			if (opform->oprright == offsettype &&
+				IsBinaryCoercible(sorttype, opform->oprleft))
+			{
+				func = opform->oprcode;
+				cmp = get_opfamily_proc(opfamily, opcintype,
+										opform->oprresult, BTORDER_PROC);
+			}
+			ReleaseSysCache(optup);
+		}
+		if (!OidIsValid(func) || !OidIsValid(cmp))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("RANGE with offset PRECEDING/FOLLOWING is not supported for column type %s and offset type %s",
+							format_type_be(sorttype),
+							format_type_be(offsettype)),
+					 parser_errposition(pstate, location)));
+
+		if (isStart)
+		{
+			wc->startInRangeFunc = func;
+			wc->startInRangeCmp = cmp;
+		}
+		else
+		{
+			wc->endInRangeFunc = func;
+			wc->endInRangeCmp = cmp;
+		}
 	}
 	else
 		Assert(false);
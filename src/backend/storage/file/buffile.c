@@ -29,6 +29,15 @@
  * BufFile also supports temporary files that exceed the OS file size limit
  * (by opening multiple fd.c temporary files).	This is an essential feature
  * for sorts and hashjoins on large amounts of data.
+ *
+ * A temp file can also be asked to compress what it writes.
+ * The logical file is then cut into BLCKSZ blocks, each stored with
+ * pg_lzcompress in a slot of its own somewhere in the physical files; an
+ * in-memory block map says where.  Only whole blocks are read and written,
+ * so seeks work as before, at the price of a decompression when one lands
+ * in a block that is not in the buffer.  Writers that dump whole aligned
+ * blocks (the append tail, logtape.c) cost one compression per block;
+ * anything else is handled by reading, patching and rewriting the block.
  *-------------------------------------------------------------------------
  */
 
@@ -38,6 +47,10 @@
 #include "storage/fd.h"
 #include "storage/buffile.h"
 #include "storage/buf_internals.h"
+#include "utils/pg_lzcompress.h"
+
+/* GUC variable */
+bool		enable_tempcompress = false;
 
 /*
  * We break BufFiles into gigabyte-sized segments, regardless of RELSEG_SIZE.
@@ -47,6 +60,20 @@
 #define MAX_PHYSICAL_FILESIZE	0x40000000
 #define BUFFILE_SEG_SIZE		(MAX_PHYSICAL_FILESIZE / BLCKSZ)
 
+/*
+ * Where a logical block of a compressed BufFile is stored.  The block is
+ * compressed iff len < rawlen; rawlen is 0 for a block never written.  A
+ * slot can take a rewrite of up to cap bytes in place.
+ */
+typedef struct BufFileBlock
+{
+	int			file;			/* physical file index of the slot */
+	off_t		offset;			/* offset of the slot in that file */
+	int32		len;			/* bytes stored in the slot */
+	int32		cap;			/* size of the slot */
+	int32		rawlen;			/* valid bytes of the logical block */
+} BufFileBlock;
+
 /*
  * This data structure represents a buffered file that consists of one or
  * more physical files (each accessed through a virtual file descriptor
@@ -79,18 +106,44 @@ struct BufFile
 	char		buffer[BLCKSZ];
 
 	/* add by cywang */
-	int64		fileLoadNum;			/* to record the number of calling function BufFileLoadBuffer() */
-	Instrumentation	*instr_fileload;	/* to record the time of BufFileLoadBuffer() during a partition */
+	int64		bytesRead;		/* bytes read from the files, for EXPLAIN */
+	int64		bytesWritten;	/* bytes written to them */
+
+	/*
+	 * Append-only tail used by BufFileAppend.  Appended data collects here
+	 * instead of in the buffer above, so a caller can interleave reads and
+	 * appends without either one flushing the other's buffer.  The tail
+	 * always starts at the physical end of the file; reads that reach it
+	 * are served from it.  tailOffset is always a multiple of BLCKSZ.
+	 */
+	char	   *tail;			/* BLCKSZ bytes, or NULL if never appended */
+	int			tailFile;		/* file index (0..n) of start of tail */
+	off_t		tailOffset;		/* offset of start of tail */
+	int			tailbytes;		/* # of valid bytes in tail */
 
-	int64		fileDumpNum;			/* real disk write */
-	Instrumentation	*instr_filedump;
+	/*
+	 * Block compression (see top of file).  blocks is NULL if
+	 * the file is not compressed.  physFile/physOffset is where the next new
+	 * slot goes; zbuf holds a compressed block, scratch a decompressed one.
+	 */
+	BufFileBlock *blocks;		/* block map, by logical block number */
+	long		nblocks;		/* allocated length of blocks */
+	int			physFile;
+	off_t		physOffset;
+	char	   *zbuf;			/* PGLZ_MAX_OUTPUT(BLCKSZ) bytes */
+	char	   *scratch;		/* BLCKSZ bytes */
 };
 
 static BufFile *makeBufFile(File firstfile);
 static void extendBufFile(BufFile *file);
 static void BufFileLoadBuffer(BufFile *file);
 static void BufFileDumpBuffer(BufFile *file);
+static void BufFileDumpTail(BufFile *file);
 static int	BufFileFlush(BufFile *file);
+static int	BufFileReadBlock(BufFile *file, long blknum, char *dest);
+static bool BufFileWriteBlock(BufFile *file, long blknum, char *src,
+				  int rawlen);
+static bool BufFileDumpCompressed(BufFile *file);
 
 
 /*
@@ -114,6 +167,16 @@ makeBufFile(File firstfile)
 	file->curOffset = 0L;
 	file->pos = 0;
 	file->nbytes = 0;
+	file->tail = NULL;
+	file->tailFile = 0;
+	file->tailOffset = 0L;
+	file->tailbytes = 0;
+	file->blocks = NULL;
+	file->nblocks = 0;
+	file->physFile = 0;
+	file->physOffset = 0L;
+	file->zbuf = NULL;
+	file->scratch = NULL;
 
 	return file;
 }
@@ -163,19 +226,29 @@ BufFileCreateTemp(bool interXact)
 	file->isTemp = true;
 	file->isInterXact = interXact;
 
-	/*
-	 * add by cywang
-	 *
-	 * to record the time of read data from disk
-	 */
-	file->instr_fileload = InstrAlloc(1,1);
-	file->fileLoadNum = 0;
-	file->instr_filedump = InstrAlloc(1,1);
-	file->fileDumpNum = 0;
+	file->bytesRead = 0;
+	file->bytesWritten = 0;
 
 	return file;
 }
 
+/*
+ * Make a new temp file compress the blocks it writes.  Must be called
+ * before anything is written to it.
+ */
+void
+opt_BufFileCompress(BufFile *file)
+{
+	Assert(file->isTemp);
+	Assert(file->curFile == 0 && file->curOffset == 0 && file->nbytes == 0);
+	Assert(file->tail == NULL);
+
+	file->nblocks = 64;
+	file->blocks = (BufFileBlock *) palloc0(file->nblocks * sizeof(BufFileBlock));
+	file->zbuf = (char *) palloc(PGLZ_MAX_OUTPUT(BLCKSZ));
+	file->scratch = (char *) palloc(BLCKSZ);
+}
+
 #ifdef NOT_USED
 /*
  * Create a BufFile and attach it to an already-opened virtual File.
@@ -209,15 +282,158 @@ BufFileClose(BufFile *file)
 	/* release the buffer space */
 	pfree(file->files);
 	pfree(file->offsets);
+	if (file->tail)
+		pfree(file->tail);
+	if (file->blocks)
+	{
+		pfree(file->blocks);
+		pfree(file->zbuf);
+		pfree(file->scratch);
+	}
 	pfree(file);
 }
 
+/*
+ * BufFileReadBlock
+ *
+ * Read logical block blknum of a compressed file into dest, which must
+ * have room for BLCKSZ bytes.  Returns the number of valid bytes, 0 if
+ * the block was never written or could not be read.
+ */
+static int
+BufFileReadBlock(BufFile *file, long blknum, char *dest)
+{
+	BufFileBlock *blk;
+	File		thisfile;
+
+	if (blknum >= file->nblocks || file->blocks[blknum].rawlen == 0)
+		return 0;
+	blk = &file->blocks[blknum];
+
+	thisfile = file->files[blk->file];
+	if (blk->offset != file->offsets[blk->file])
+	{
+		if (FileSeek(thisfile, blk->offset, SEEK_SET) != blk->offset)
+			return 0;			/* seek failed, read nothing */
+		file->offsets[blk->file] = blk->offset;
+	}
+
+	if (blk->len < blk->rawlen)
+	{
+		if (FileRead(thisfile, file->zbuf, blk->len) != blk->len)
+		{
+			file->offsets[blk->file] = -1;
+			return 0;
+		}
+		pglz_decompress((PGLZ_Header *) file->zbuf, dest);
+	}
+	else if (FileRead(thisfile, dest, blk->len) != blk->len)
+	{
+		file->offsets[blk->file] = -1;
+		return 0;
+	}
+	file->offsets[blk->file] += blk->len;
+	file->bytesRead += blk->len;
+
+	pgBufferUsage.temp_blks_read++;
+
+	return blk->rawlen;
+}
+
+/*
+ * BufFileWriteBlock
+ *
+ * Store rawlen bytes at src as logical block blknum of a compressed file,
+ * compressed if that saves enough.  The block keeps its slot if the new
+ * image fits there, else it gets a new one at the physical end; a block
+ * that is not full gets a slot of BLCKSZ, since it is likely to grow.
+ * Returns false on a write failure.
+ */
+static bool
+BufFileWriteBlock(BufFile *file, long blknum, char *src, int rawlen)
+{
+	BufFileBlock *blk;
+	char	   *data;
+	int32		len;
+	File		thisfile;
+
+	if (blknum >= file->nblocks)
+	{
+		long		newsize = file->nblocks;
+
+		while (blknum >= newsize)
+			newsize *= 2;
+		file->blocks = (BufFileBlock *)
+			repalloc(file->blocks, newsize * sizeof(BufFileBlock));
+		MemSet(file->blocks + file->nblocks, 0,
+			   (newsize - file->nblocks) * sizeof(BufFileBlock));
+		file->nblocks = newsize;
+	}
+	blk = &file->blocks[blknum];
+
+	if (pglz_compress(src, rawlen, (PGLZ_Header *) file->zbuf,
+					  PGLZ_strategy_default) &&
+		VARSIZE(file->zbuf) < rawlen)
+	{
+		data = file->zbuf;
+		len = VARSIZE(file->zbuf);
+	}
+	else
+	{
+		data = src;
+		len = rawlen;
+	}
+
+	if (blk->rawlen == 0 || len > blk->cap)
+	{
+		int32		cap = (rawlen < BLCKSZ) ? BLCKSZ : len;
+
+		/* slots never cross a component file boundary */
+		if (file->physOffset + cap > MAX_PHYSICAL_FILESIZE)
+		{
+			if (file->physFile + 1 >= file->numFiles)
+				extendBufFile(file);
+			file->physFile++;
+			file->physOffset = 0L;
+		}
+		blk->file = file->physFile;
+		blk->offset = file->physOffset;
+		blk->cap = cap;
+		file->physOffset += cap;
+	}
+
+	thisfile = file->files[blk->file];
+	if (blk->offset != file->offsets[blk->file])
+	{
+		if (FileSeek(thisfile, blk->offset, SEEK_SET) != blk->offset)
+			return false;		/* seek failed, give up */
+		file->offsets[blk->file] = blk->offset;
+	}
+	if (FileWrite(thisfile, data, len) != len)
+	{
+		/* position unknown after a short write; force a seek next time */
+		file->offsets[blk->file] = -1;
+		return false;
+	}
+	file->offsets[blk->file] += len;
+	file->bytesWritten += len;
+	blk->len = len;
+	blk->rawlen = rawlen;
+
+	pgBufferUsage.temp_blks_written++;
+
+	return true;
+}
+
 /*
  * BufFileLoadBuffer
  *
  * Load some data into buffer, if possible, starting from curOffset.
  * At call, must have dirty = false, pos and nbytes = 0.
  * On exit, nbytes is number of bytes loaded.
+ *
+ * Data not yet flushed out of the append tail is copied in after whatever
+ * the physical file holds, so readers see the whole logical file.
  */
 static void
 BufFileLoadBuffer(BufFile *file)
@@ -239,33 +455,77 @@ BufFileLoadBuffer(BufFile *file)
 	}
 
 	/*
-	 * May need to reposition physical file.
+	 * Nothing on disk at or past the start of the append tail.
 	 */
-	thisfile = file->files[file->curFile];
-	if (file->curOffset != file->offsets[file->curFile])
+	if (file->tail == NULL || file->curFile != file->tailFile ||
+		file->curOffset < file->tailOffset)
 	{
-		if (FileSeek(thisfile, file->curOffset, SEEK_SET) != file->curOffset)
-			return;				/* seek failed, read nothing */
-		file->offsets[file->curFile] = file->curOffset;
-	}
+		if (file->blocks)
+		{
+			/*
+			 * Compressed: load the rest of the block holding curOffset.
+			 */
+			long		blknum = file->curFile * BUFFILE_SEG_SIZE +
+				file->curOffset / BLCKSZ;
+			int			skip = (int) (file->curOffset % BLCKSZ);
+			int			rawlen;
 
-	/* add by cywang */
-	InstrStartNode(file->instr_fileload);
+			if (skip == 0)
+				rawlen = BufFileReadBlock(file, blknum, file->buffer);
+			else
+			{
+				rawlen = BufFileReadBlock(file, blknum, file->scratch);
+				if (rawlen > skip)
+					memcpy(file->buffer, file->scratch + skip, rawlen - skip);
+			}
+			file->nbytes = (rawlen > skip) ? rawlen - skip : 0;
+		}
+		else
+		{
+			/*
+			 * May need to reposition physical file.
+			 */
+			thisfile = file->files[file->curFile];
+			if (file->curOffset != file->offsets[file->curFile])
+			{
+				if (FileSeek(thisfile, file->curOffset, SEEK_SET) != file->curOffset)
+					return;		/* seek failed, read nothing */
+				file->offsets[file->curFile] = file->curOffset;
+			}
 
-	/*
-	 * Read whatever we can get, up to a full bufferload.
-	 */
-	file->nbytes = FileRead(thisfile, file->buffer, sizeof(file->buffer));
+			/*
+			 * Read whatever we can get, up to a full bufferload.
+			 */
+			file->nbytes = FileRead(thisfile, file->buffer, sizeof(file->buffer));
+			if (file->nbytes < 0)
+				file->nbytes = 0;
+			file->bytesRead += file->nbytes;
+			file->offsets[file->curFile] += file->nbytes;
+			/* we choose not to advance curOffset here */
 
-	InstrStopNode(file->instr_fileload, 0);
-	file->fileLoadNum++;
+			pgBufferUsage.temp_blks_read++;
+		}
+	}
 
-	if (file->nbytes < 0)
-		file->nbytes = 0;
-	file->offsets[file->curFile] += file->nbytes;
-	/* we choose not to advance curOffset here */
+	/*
+	 * Fill the rest of the buffer from the append tail, if the data read so
+	 * far runs up to it.
+	 */
+	if (file->tailbytes > 0 && file->curFile == file->tailFile)
+	{
+		off_t		start = file->curOffset + file->nbytes;
+		off_t		avail = file->tailOffset + file->tailbytes - start;
+		int			ncopy = BLCKSZ - file->nbytes;
 
-	pgBufferUsage.temp_blks_read++;
+		if (start >= file->tailOffset && avail > 0)
+		{
+			if ((off_t) ncopy > avail)
+				ncopy = (int) avail;
+			memcpy(file->buffer + file->nbytes,
+				   file->tail + (start - file->tailOffset), ncopy);
+			file->nbytes += ncopy;
+		}
+	}
 }
 
 /*
@@ -282,6 +542,13 @@ BufFileDumpBuffer(BufFile *file)
 	int			bytestowrite;
 	File		thisfile;
 
+	if (file->blocks)
+	{
+		if (!BufFileDumpCompressed(file))
+			return;				/* failed to write */
+		wpos = file->nbytes;
+	}
+
 	/*
 	 * Unlike BufFileLoadBuffer, we must dump the whole buffer even if it
 	 * crosses a component-file boundary; so we need a loop.
@@ -328,6 +595,7 @@ BufFileDumpBuffer(BufFile *file)
 		file->offsets[file->curFile] += bytestowrite;
 		file->curOffset += bytestowrite;
 		wpos += bytestowrite;
+		file->bytesWritten += bytestowrite;
 
 		pgBufferUsage.temp_blks_written++;
 	}
@@ -354,6 +622,119 @@ BufFileDumpBuffer(BufFile *file)
 	file->nbytes = 0;
 }
 
+/*
+ * BufFileDumpCompressed
+ *
+ * BufFileDumpBuffer for a compressed file: store the blocks the buffer
+ * covers, patching the ones it covers only partly, and advance curOffset
+ * to the end of the buffer.  Returns false on a write failure.
+ */
+static bool
+BufFileDumpCompressed(BufFile *file)
+{
+	int			wpos = 0;
+
+	while (wpos < file->nbytes)
+	{
+		long		blknum;
+		int			skip;
+		int			nthistime;
+		bool		ok;
+
+		/*
+		 * Advance to next component file if necessary, as BufFileDumpBuffer
+		 * does, so that the logical position stays valid for BufFileSeek.
+		 */
+		if (file->curOffset >= MAX_PHYSICAL_FILESIZE)
+		{
+			while (file->curFile + 1 >= file->numFiles)
+				extendBufFile(file);
+			file->curFile++;
+			file->curOffset = 0L;
+		}
+
+		blknum = file->curFile * BUFFILE_SEG_SIZE + file->curOffset / BLCKSZ;
+		skip = (int) (file->curOffset % BLCKSZ);
+		nthistime = Min(BLCKSZ - skip, file->nbytes - wpos);
+
+		if (skip == 0 && nthistime == BLCKSZ)
+			ok = BufFileWriteBlock(file, blknum, file->buffer + wpos, BLCKSZ);
+		else
+		{
+			int			rawlen = BufFileReadBlock(file, blknum, file->scratch);
+
+			if (rawlen < skip)
+				MemSet(file->scratch + rawlen, 0, skip - rawlen);
+			memcpy(file->scratch + skip, file->buffer + wpos, nthistime);
+			ok = BufFileWriteBlock(file, blknum, file->scratch,
+								   Max(rawlen, skip + nthistime));
+		}
+		if (!ok)
+			return false;
+
+		file->curOffset += nthistime;
+		wpos += nthistime;
+	}
+
+	return true;
+}
+
+/*
+ * BufFileDumpTail
+ *
+ * Write out a full append tail at the physical end of the file, and start
+ * a new, empty tail after it.  On failure the tail is left full.
+ */
+static void
+BufFileDumpTail(BufFile *file)
+{
+	File		thisfile = file->files[file->tailFile];
+
+	Assert(file->tailbytes == BLCKSZ);
+
+	if (file->blocks)
+	{
+		if (!BufFileWriteBlock(file,
+							   file->tailFile * BUFFILE_SEG_SIZE +
+							   file->tailOffset / BLCKSZ,
+							   file->tail, BLCKSZ))
+			return;				/* failed to write */
+	}
+	else
+	{
+		if (file->tailOffset != file->offsets[file->tailFile])
+		{
+			if (FileSeek(thisfile, file->tailOffset, SEEK_SET) != file->tailOffset)
+				return;			/* seek failed, give up */
+			file->offsets[file->tailFile] = file->tailOffset;
+		}
+		if (FileWrite(thisfile, file->tail, BLCKSZ) != BLCKSZ)
+		{
+			/* position unknown after a short write; force a seek next time */
+			file->offsets[file->tailFile] = -1;
+			return;
+		}
+		file->offsets[file->tailFile] += BLCKSZ;
+		file->bytesWritten += BLCKSZ;
+		pgBufferUsage.temp_blks_written++;
+	}
+
+	file->tailOffset += BLCKSZ;
+	file->tailbytes = 0;
+
+	/*
+	 * Start the next component file as soon as this one is full, so that
+	 * the tail's position always names an existing file.
+	 */
+	if (file->tailOffset >= MAX_PHYSICAL_FILESIZE)
+	{
+		if (file->tailFile + 1 >= file->numFiles)
+			extendBufFile(file);
+		file->tailFile++;
+		file->tailOffset = 0L;
+	}
+}
+
 /*
  * BufFileRead
  *
@@ -412,6 +793,9 @@ BufFileWrite(BufFile *file, void *ptr, size_t size)
 	size_t		nwritten = 0;
 	size_t		nthistime;
 
+	/* files written with BufFileAppend must only be appended to */
+	Assert(file->tail == NULL);
+
 	while (size > 0)
 	{
 		if (file->pos >= BLCKSZ)
@@ -419,14 +803,7 @@ BufFileWrite(BufFile *file, void *ptr, size_t size)
 			/* Buffer full, dump it out */
 			if (file->dirty)
 			{
-				/* by cywang */
-				InstrStartNode(file->instr_filedump);
-
 				BufFileDumpBuffer(file);
-
-				InstrStopNode(file->instr_filedump, 0);
-				file->fileDumpNum++;
-
 				if (file->dirty)
 					break;		/* I/O error */
 			}
@@ -458,6 +835,67 @@ BufFileWrite(BufFile *file, void *ptr, size_t size)
 	return nwritten;
 }
 
+/*
+ * BufFileAppend
+ *
+ * Append data at the end of the file, without moving the current read
+ * position or disturbing its buffer.  This lets a reader trail closely
+ * behind a writer: switching between the two costs no I/O, and data still
+ * in the tail is visible to BufFileRead.
+ *
+ * Only temp files can be appended to, and a file that is appended to must
+ * not also be written with BufFileWrite.
+ */
+size_t
+BufFileAppend(BufFile *file, void *ptr, size_t size)
+{
+	size_t		nwritten = 0;
+	size_t		nthistime;
+
+	Assert(file->isTemp);
+	Assert(!file->dirty);
+
+	if (file->tail == NULL)
+		file->tail = (char *) palloc(BLCKSZ);
+
+	while (size > 0)
+	{
+		if (file->tailbytes >= BLCKSZ)
+		{
+			BufFileDumpTail(file);
+			if (file->tailbytes >= BLCKSZ)
+				break;			/* I/O error */
+		}
+
+		nthistime = BLCKSZ - file->tailbytes;
+		if (nthistime > size)
+			nthistime = size;
+		Assert(nthistime > 0);
+
+		memcpy(file->tail + file->tailbytes, ptr, nthistime);
+
+		file->tailbytes += nthistime;
+		ptr = (void *) ((char *) ptr + nthistime);
+		size -= nthistime;
+		nwritten += nthistime;
+	}
+
+	return nwritten;
+}
+
+/*
+ * BufFileTellEnd
+ *
+ * Like BufFileTell, but reports the end of a file written by BufFileAppend,
+ * which is where the next append will go.
+ */
+void
+BufFileTellEnd(BufFile *file, int *fileno, off_t *offset)
+{
+	*fileno = file->tailFile;
+	*offset = file->tailOffset + file->tailbytes;
+}
+
 /*
  * BufFileFlush
  *
@@ -468,14 +906,7 @@ BufFileFlush(BufFile *file)
 {
 	if (file->dirty)
 	{
-		/* by cywang */
-		InstrStartNode(file->instr_filedump);
-
 		BufFileDumpBuffer(file);
-
-		InstrStopNode(file->instr_filedump, 0);
-		file->fileDumpNum++;
-
 		if (file->dirty)
 			return EOF;
 	}
@@ -631,14 +1062,32 @@ int opt_BufFileGetFile(BufFile *file){
 off_t opt_BufFileGetOffset(BufFile *file){
 	return file->curOffset+file->pos;
 }
-void opt_BufFileInstr(BufFile *file){
-	printf("BufFile, number of load file: %ld times \n", file->fileLoadNum);
-	file->fileLoadNum = 0;
-	printf("BufFile, load file: %f seconds \n", INSTR_TIME_GET_DOUBLE(file->instr_fileload->counter));
-	INSTR_TIME_SET_ZERO(file->instr_fileload->counter);
-	printf("BufFile, number of dump file: %ld times \n", file->fileDumpNum);
-	file->fileDumpNum = 0;
-	printf("BufFile, dump file: %f seconds \n", INSTR_TIME_GET_DOUBLE(file->instr_filedump->counter));
-	INSTR_TIME_SET_ZERO(file->instr_filedump->counter);
+/*
+ * Hint the kernel that logical block blknum will be read soon, so that the
+ * read can proceed in the background.  Does not move the seek position.
+ */
+void opt_BufFilePrefetchBlock(BufFile *file, long blknum){
+	int			fileno;
+
+	if (file->blocks != NULL)
+	{
+		BufFileBlock *blk;
+
+		if (blknum >= file->nblocks || file->blocks[blknum].rawlen == 0)
+			return;
+		blk = &file->blocks[blknum];
+		(void) FilePrefetch(file->files[blk->file], blk->offset, blk->len);
+		return;
+	}
+	fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+	if (fileno >= file->numFiles)
+		return;
+	(void) FilePrefetch(file->files[fileno],
+						(off_t) (blknum % BUFFILE_SEG_SIZE) * BLCKSZ, BLCKSZ);
+}
+/* add the bytes read from and written to the file so far */
+void opt_BufFileGetStats(BufFile *file, int64 *bytesRead, int64 *bytesWritten){
+	*bytesRead += file->bytesRead;
+	*bytesWritten += file->bytesWritten;
 }
 //#endif
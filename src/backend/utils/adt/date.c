@@ -400,27 +400,41 @@ date2timestamp(DateADT dateVal)
 {
 	Timestamp	result;
 
+	if (!date2timestamp_opt_overflow(dateVal, &result))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				 errmsg("date out of range for timestamp")));
+
+	return result;
+}
+
+/*
+ * date2timestamp_opt_overflow
+ * as date2timestamp, but returns false instead of raising the error if
+ * the date is out of range for a timestamp.
+ */
+bool
+date2timestamp_opt_overflow(DateADT dateVal, Timestamp *result)
+{
 	if (DATE_IS_NOBEGIN(dateVal))
-		TIMESTAMP_NOBEGIN(result);
+		TIMESTAMP_NOBEGIN(*result);
 	else if (DATE_IS_NOEND(dateVal))
-		TIMESTAMP_NOEND(result);
+		TIMESTAMP_NOEND(*result);
 	else
 	{
 #ifdef HAVE_INT64_TIMESTAMP
 		/* date is days since 2000, timestamp is microseconds since same... */
-		result = dateVal * USECS_PER_DAY;
+		*result = dateVal * USECS_PER_DAY;
 		/* Date's range is wider than timestamp's, so check for overflow */
-		if (result / USECS_PER_DAY != dateVal)
-			ereport(ERROR,
-					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-					 errmsg("date out of range for timestamp")));
+		if (*result / USECS_PER_DAY != dateVal)
+			return false;
 #else
 		/* date is days since 2000, timestamp is seconds since same... */
-		result = dateVal * (double) SECS_PER_DAY;
+		*result = dateVal * (double) SECS_PER_DAY;
 #endif
 	}
 
-	return result;
+	return true;
 }
 
 static TimestampTz
@@ -1713,6 +1713,7 @@ setseed(PG_FUNCTION_ARGS)
  *
  *		float8_accum		- accumulate for AVG(), variance aggregates, etc.
  *		float4_accum		- same, but input data is float4
+ *		float8_combine		- combine two float8_accum states
  *		float8_avg			- produce final result for float AVG()
  *		float8_var_samp		- produce final result for float VAR_SAMP()
  *		float8_var_pop		- produce final result for float VAR_POP()
@@ -1848,6 +1849,57 @@ float4_accum(PG_FUNCTION_ARGS)
 	}
 }
 
+/*
+ * Combine two float8_accum states into the first, for WindowAgg's segment
+ * tree.  The caller never hands us a state it still needs in place.
+ */
+Datum
+float8_combine(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray1 = PG_GETARG_ARRAYTYPE_P(0);
+	ArrayType  *transarray2 = PG_GETARG_ARRAYTYPE_P(1);
+	float8	   *transvalues1;
+	float8	   *transvalues2;
+	float8		N,
+				sumX,
+				sumX2;
+
+	transvalues1 = check_float8_array(transarray1, "float8_combine", 3);
+	transvalues2 = check_float8_array(transarray2, "float8_combine", 3);
+
+	N = transvalues1[0] + transvalues2[0];
+	sumX = transvalues1[1] + transvalues2[1];
+	CHECKFLOATVAL(sumX, isinf(transvalues1[1]) || isinf(transvalues2[1]),
+				  true);
+	sumX2 = transvalues1[2] + transvalues2[2];
+	CHECKFLOATVAL(sumX2, isinf(transvalues1[2]) || isinf(transvalues2[2]),
+				  true);
+
+	if (AggCheckCallContext(fcinfo, NULL))
+	{
+		transvalues1[0] = N;
+		transvalues1[1] = sumX;
+		transvalues1[2] = sumX2;
+
+		PG_RETURN_ARRAYTYPE_P(transarray1);
+	}
+	else
+	{
+		Datum		transdatums[3];
+		ArrayType  *result;
+
+		transdatums[0] = Float8GetDatumFast(N);
+		transdatums[1] = Float8GetDatumFast(sumX);
+		transdatums[2] = Float8GetDatumFast(sumX2);
+
+		result = construct_array(transdatums, 3,
+								 FLOAT8OID,
+								 sizeof(float8), FLOAT8PASSBYVAL, 'd');
+
+		PG_RETURN_ARRAYTYPE_P(result);
+	}
+}
+
 Datum
 float8_avg(PG_FUNCTION_ARGS)
 {
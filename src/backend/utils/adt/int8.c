@@ -720,6 +720,54 @@ int8inc_float8_float8(PG_FUNCTION_ARGS)
 	return int8inc(fcinfo);
 }
 
+/*
+ * int8dec and int8dec_any are the inverse transition functions of COUNT(*)
+ * and COUNT(x), used by WindowAgg to remove rows leaving a moving frame.
+ * The same in-place trick as int8inc applies.
+ */
+Datum
+int8dec(PG_FUNCTION_ARGS)
+{
+#ifndef USE_FLOAT8_BYVAL		/* controls int8 too */
+	if (AggCheckCallContext(fcinfo, NULL))
+	{
+		int64	   *arg = (int64 *) PG_GETARG_POINTER(0);
+		int64		result;
+
+		result = *arg - 1;
+		/* Overflow check */
+		if (result > 0 && *arg < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+					 errmsg("bigint out of range")));
+
+		*arg = result;
+		PG_RETURN_POINTER(arg);
+	}
+	else
+#endif
+	{
+		/* Not called as an aggregate, so just do it the dumb way */
+		int64		arg = PG_GETARG_INT64(0);
+		int64		result;
+
+		result = arg - 1;
+		/* Overflow check */
+		if (result > 0 && arg < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+					 errmsg("bigint out of range")));
+
+		PG_RETURN_INT64(result);
+	}
+}
+
+Datum
+int8dec_any(PG_FUNCTION_ARGS)
+{
+	return int8dec(fcinfo);
+}
+
 
 Datum
 int8larger(PG_FUNCTION_ARGS)
@@ -371,6 +371,7 @@ static char *get_str_from_var(NumericVar *var, int dscale);
 static char *get_str_from_var_sci(NumericVar *var, int rscale);
 
 static Numeric make_result(NumericVar *var);
+static Numeric make_result_opt_error(NumericVar *var, bool *have_error);
 
 static void apply_typmod(NumericVar *var, int32 typmod);
 
@@ -1294,6 +1295,75 @@ numeric_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(result);
 }
 
+/*
+ * Abbreviated sort key for numeric.  Unsigned comparison of two
+ * keys never contradicts cmp_numerics; equal keys just mean the full values
+ * must be compared.
+ *
+ * A positive value is encoded as a set top bit, then its weight biased into
+ * 15 bits, then its first three NBASE digits; a negative value is the bitwise
+ * complement of its absolute value's key, zero sits between the two, and NaN
+ * is above everything.  Weights beyond the 15 bits all share the smallest or
+ * largest key of their sign.
+ */
+Datum
+numeric_abbrev(Datum original)
+{
+	Numeric		num = DatumGetNumeric(original);
+	NumericDigit *digits;
+	int			ndigits;
+	int			weight;
+	uint64		key;
+
+	if (NUMERIC_IS_NAN(num))
+		key = ~((uint64) 0);
+	else
+	{
+		digits = NUMERIC_DIGITS(num);
+		ndigits = NUMERIC_NDIGITS(num);
+		weight = NUMERIC_WEIGHT(num);
+		while (ndigits > 0 && digits[0] == 0)
+		{
+			digits++;
+			ndigits--;
+			weight--;
+		}
+
+		if (ndigits == 0)
+			key = UINT64CONST(1) << 63;
+		else
+		{
+			int			biased = weight + 0x4000;
+
+			if (biased < 0)
+				key = UINT64CONST(1) << 63;
+			else if (biased > 0x7FFF)
+				key = ~((uint64) 0) - 1;
+			else
+			{
+				uint64		mantissa = 0;
+				int			i;
+
+				for (i = 0; i < 3; i++)
+					mantissa = mantissa * NBASE + (i < ndigits ? digits[i] : 0);
+				key = (UINT64CONST(1) << 63) |
+					((uint64) biased << 48) | mantissa;
+			}
+			if (NUMERIC_SIGN(num) == NUMERIC_NEG)
+				key = ~key;
+		}
+	}
+
+	if ((Pointer) num != DatumGetPointer(original))
+		pfree(num);
+
+#if SIZEOF_DATUM == 8
+	return (Datum) key;
+#else
+	return (Datum) (key >> 32);
+#endif
+}
+
 
 Datum
 numeric_eq(PG_FUNCTION_ARGS)
@@ -1512,6 +1582,20 @@ numeric_add(PG_FUNCTION_ARGS)
 {
 	Numeric		num1 = PG_GETARG_NUMERIC(0);
 	Numeric		num2 = PG_GETARG_NUMERIC(1);
+
+	PG_RETURN_NUMERIC(numeric_add_opt_error(num1, num2, NULL));
+}
+
+
+/*
+ * numeric_add_opt_error() -
+ *
+ *	As numeric_add, but if have_error isn't NULL an overflow sets
+ *	*have_error and returns NULL instead of raising the error.
+ */
+Numeric
+numeric_add_opt_error(Numeric num1, Numeric num2, bool *have_error)
+{
 	NumericVar	arg1;
 	NumericVar	arg2;
 	NumericVar	result;
@@ -1521,7 +1605,7 @@ numeric_add(PG_FUNCTION_ARGS)
 	 * Handle NaN
 	 */
 	if (NUMERIC_IS_NAN(num1) || NUMERIC_IS_NAN(num2))
-		PG_RETURN_NUMERIC(make_result(&const_nan));
+		return make_result(&const_nan);
 
 	/*
 	 * Unpack the values, let add_var() compute the result and return it.
@@ -1535,13 +1619,13 @@ numeric_add(PG_FUNCTION_ARGS)
 
 	add_var(&arg1, &arg2, &result);
 
-	res = make_result(&result);
+	res = make_result_opt_error(&result, have_error);
 
 	free_var(&arg1);
 	free_var(&arg2);
 	free_var(&result);
 
-	PG_RETURN_NUMERIC(res);
+	return res;
 }
 
 
@@ -1555,6 +1639,20 @@ numeric_sub(PG_FUNCTION_ARGS)
 {
 	Numeric		num1 = PG_GETARG_NUMERIC(0);
 	Numeric		num2 = PG_GETARG_NUMERIC(1);
+
+	PG_RETURN_NUMERIC(numeric_sub_opt_error(num1, num2, NULL));
+}
+
+
+/*
+ * numeric_sub_opt_error() -
+ *
+ *	As numeric_sub, but if have_error isn't NULL an overflow sets
+ *	*have_error and returns NULL instead of raising the error.
+ */
+Numeric
+numeric_sub_opt_error(Numeric num1, Numeric num2, bool *have_error)
+{
 	NumericVar	arg1;
 	NumericVar	arg2;
 	NumericVar	result;
@@ -1564,7 +1662,7 @@ numeric_sub(PG_FUNCTION_ARGS)
 	 * Handle NaN
 	 */
 	if (NUMERIC_IS_NAN(num1) || NUMERIC_IS_NAN(num2))
-		PG_RETURN_NUMERIC(make_result(&const_nan));
+		return make_result(&const_nan);
 
 	/*
 	 * Unpack the values, let sub_var() compute the result and return it.
@@ -1578,13 +1676,13 @@ numeric_sub(PG_FUNCTION_ARGS)
 
 	sub_var(&arg1, &arg2, &result);
 
-	res = make_result(&result);
+	res = make_result_opt_error(&result, have_error);
 
 	free_var(&arg1);
 	free_var(&arg2);
 	free_var(&result);
 
-	PG_RETURN_NUMERIC(res);
+	return res;
 }
 
 
@@ -2672,6 +2770,209 @@ numeric_avg(PG_FUNCTION_ARGS)
 										NumericGetDatum(N)));
 }
 
+/*
+ * Inverse transition function for avg(int8): remove a value from the
+ * {N, sum(X)} state built by int8_avg_accum.  Since int8 inputs all have
+ * display scale zero, subtracting gives exactly what a fresh aggregation
+ * of the remaining values would.
+ */
+Datum
+int8_avg_accum_inv(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray = PG_GETARG_ARRAYTYPE_P(0);
+	Datum		newval8 = PG_GETARG_DATUM(1);
+	Datum	   *transdatums;
+	int			ndatums;
+	Datum		N,
+				sumX;
+
+	deconstruct_array(transarray,
+					  NUMERICOID, -1, false, 'i',
+					  &transdatums, NULL, &ndatums);
+	if (ndatums != 2)
+		elog(ERROR, "expected 2-element numeric array");
+
+	N = DirectFunctionCall2(numeric_sub, transdatums[0],
+							NumericGetDatum(make_result(&const_one)));
+	sumX = DirectFunctionCall2(numeric_sub, transdatums[1],
+							   DirectFunctionCall1(int8_numeric, newval8));
+
+	transdatums[0] = N;
+	transdatums[1] = sumX;
+
+	PG_RETURN_ARRAYTYPE_P(construct_array(transdatums, 2,
+										  NUMERICOID, -1, false, 'i'));
+}
+
+/*
+ * SUM and AVG of numeric.
+ *
+ * These keep their transition state in a private struct rather than in a
+ * numeric array, which avoids building a new array datum for every input
+ * row, and which lets us support an inverse transition function.  Removing
+ * a value has to leave the sum with the display scale a fresh aggregation
+ * would have produced, i.e. the largest dscale among the remaining inputs,
+ * so we track how many inputs carry the current maximum.  If the last of
+ * those leaves we cannot know the new maximum, and the inverse function
+ * returns NULL to ask for the state to be rebuilt.  NaN inputs are counted
+ * separately, so that they can be removed again too.
+ */
+typedef struct NumericSumState
+{
+	int64		N;				/* count of non-NaN inputs */
+	int64		NaNcount;		/* count of NaN inputs */
+	int			maxScale;		/* largest dscale among non-NaN inputs */
+	int64		maxScaleCount;	/* number of inputs having that dscale */
+	NumericVar	sumX;			/* sum of non-NaN inputs */
+} NumericSumState;
+
+Datum
+numeric_sum_accum(PG_FUNCTION_ARGS)
+{
+	MemoryContext agg_context;
+	MemoryContext old_context;
+	NumericSumState *state;
+
+	if (!AggCheckCallContext(fcinfo, &agg_context))
+		elog(ERROR, "numeric_sum_accum called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (NumericSumState *) PG_GETARG_POINTER(0);
+
+	if (state == NULL)
+	{
+		/* first call: create the state in the aggregate's context */
+		state = (NumericSumState *) MemoryContextAllocZero(agg_context,
+													sizeof(NumericSumState));
+		init_var(&state->sumX);
+		state->sumX.sign = NUMERIC_POS;
+	}
+
+	if (!PG_ARGISNULL(1))
+	{
+		Numeric		newval = PG_GETARG_NUMERIC(1);
+
+		if (NUMERIC_IS_NAN(newval))
+			state->NaNcount++;
+		else
+		{
+			NumericVar	X;
+			int			dscale = NUMERIC_DSCALE(newval);
+
+			init_var(&X);
+			set_var_from_num(newval, &X);
+
+			/* the sum's digit buffer must live as long as the state */
+			old_context = MemoryContextSwitchTo(agg_context);
+			add_var(&X, &state->sumX, &state->sumX);
+			MemoryContextSwitchTo(old_context);
+			free_var(&X);
+
+			if (state->N == 0 || dscale > state->maxScale)
+			{
+				state->maxScale = dscale;
+				state->maxScaleCount = 1;
+			}
+			else if (dscale == state->maxScale)
+				state->maxScaleCount++;
+			state->N++;
+		}
+	}
+
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+numeric_sum_accum_inv(PG_FUNCTION_ARGS)
+{
+	MemoryContext agg_context;
+	MemoryContext old_context;
+	NumericSumState *state = (NumericSumState *) PG_GETARG_POINTER(0);
+	Numeric		newval = PG_GETARG_NUMERIC(1);
+	NumericVar	X;
+	int			dscale;
+
+	if (!AggCheckCallContext(fcinfo, &agg_context))
+		elog(ERROR, "numeric_sum_accum_inv called in non-aggregate context");
+
+	if (NUMERIC_IS_NAN(newval))
+	{
+		state->NaNcount--;
+		PG_RETURN_POINTER(state);
+	}
+
+	dscale = NUMERIC_DSCALE(newval);
+	if (dscale == state->maxScale && state->maxScaleCount == 1 &&
+		state->N > 1)
+		PG_RETURN_NULL();		/* new maximum scale unknown, start over */
+
+	init_var(&X);
+	set_var_from_num(newval, &X);
+
+	old_context = MemoryContextSwitchTo(agg_context);
+	sub_var(&state->sumX, &X, &state->sumX);
+	MemoryContextSwitchTo(old_context);
+	free_var(&X);
+
+	if (dscale == state->maxScale)
+		state->maxScaleCount--;
+	state->N--;
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Return the state's sum as a numeric with the inputs' maximum display
+ * scale.  The caller has checked that there is at least one input.
+ */
+static Numeric
+numeric_sum_state_result(NumericSumState *state)
+{
+	NumericVar	sumX;
+
+	if (state->NaNcount > 0)
+		return make_result(&const_nan);
+
+	/* sumX may carry a larger dscale left behind by removed inputs */
+	memcpy(&sumX, &state->sumX, sizeof(NumericVar));
+	sumX.dscale = state->maxScale;
+
+	return make_result(&sumX);
+}
+
+Datum
+numeric_sum_final(PG_FUNCTION_ARGS)
+{
+	NumericSumState *state = (NumericSumState *) PG_GETARG_POINTER(0);
+
+	/* SQL92 defines SUM of no values to be NULL */
+	if (state->N == 0 && state->NaNcount == 0)
+		PG_RETURN_NULL();
+
+	PG_RETURN_NUMERIC(numeric_sum_state_result(state));
+}
+
+Datum
+numeric_avg_final(PG_FUNCTION_ARGS)
+{
+	NumericSumState *state = (NumericSumState *) PG_GETARG_POINTER(0);
+	Numeric		sumX;
+	Datum		N;
+
+	/* SQL92 defines AVG of no values to be NULL */
+	if (state->N == 0 && state->NaNcount == 0)
+		PG_RETURN_NULL();
+
+	sumX = numeric_sum_state_result(state);
+	if (NUMERIC_IS_NAN(sumX))
+		PG_RETURN_NUMERIC(sumX);
+
+	N = DirectFunctionCall1(int8_numeric, Int64GetDatumFast(state->N));
+
+	/* same computation as numeric_avg, so the results are identical */
+	PG_RETURN_DATUM(DirectFunctionCall2(numeric_div,
+										NumericGetDatum(sumX), N));
+}
+
 /*
  * Workhorse routine for the standard deviance and variance
  * aggregates. 'transarray' is the aggregate's transition
@@ -2988,6 +3289,37 @@ int8_sum(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Inverse transition functions for the integer SUM aggregates, used by
+ * WindowAgg to remove rows leaving a moving frame.  These are strict:
+ * WindowAgg never passes them a null input, and resets the aggregate itself
+ * once no non-null inputs remain, so the state is never null here either.
+ */
+
+Datum
+int2_sum_inv(PG_FUNCTION_ARGS)
+{
+	/* int8 is small enough that we don't bother with the in-place trick */
+	PG_RETURN_INT64(PG_GETARG_INT64(0) - (int64) PG_GETARG_INT16(1));
+}
+
+Datum
+int4_sum_inv(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT64(PG_GETARG_INT64(0) - (int64) PG_GETARG_INT32(1));
+}
+
+Datum
+int8_sum_inv(PG_FUNCTION_ARGS)
+{
+	Datum		newval;
+
+	newval = DirectFunctionCall1(int8_numeric, PG_GETARG_DATUM(1));
+
+	PG_RETURN_DATUM(DirectFunctionCall2(numeric_sub,
+										PG_GETARG_DATUM(0), newval));
+}
+
 /*
  * Routines for avg(int2) and avg(int4).  The transition datatype
  * is a two-element int8 array, holding count and sum.
@@ -3055,6 +3387,77 @@ int4_avg_accum(PG_FUNCTION_ARGS)
 	PG_RETURN_ARRAYTYPE_P(transarray);
 }
 
+/*
+ * Inverse transition functions for avg(int2) and avg(int4).
+ */
+static ArrayType *
+do_int8_avg_accum_inv(FunctionCallInfo fcinfo, int64 newval)
+{
+	ArrayType  *transarray;
+	Int8TransTypeData *transdata;
+
+	/* Same in-place rule as the forward transition functions */
+	if (AggCheckCallContext(fcinfo, NULL))
+		transarray = PG_GETARG_ARRAYTYPE_P(0);
+	else
+		transarray = PG_GETARG_ARRAYTYPE_P_COPY(0);
+
+	if (ARR_HASNULL(transarray) ||
+		ARR_SIZE(transarray) != ARR_OVERHEAD_NONULLS(1) + sizeof(Int8TransTypeData))
+		elog(ERROR, "expected 2-element int8 array");
+
+	transdata = (Int8TransTypeData *) ARR_DATA_PTR(transarray);
+	transdata->count--;
+	transdata->sum -= newval;
+
+	return transarray;
+}
+
+Datum
+int2_avg_accum_inv(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_ARRAYTYPE_P(do_int8_avg_accum_inv(fcinfo,
+												(int64) PG_GETARG_INT16(1)));
+}
+
+Datum
+int4_avg_accum_inv(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_ARRAYTYPE_P(do_int8_avg_accum_inv(fcinfo,
+												(int64) PG_GETARG_INT32(1)));
+}
+
+/*
+ * Combine two avg(int2)/avg(int4) states into the first, for WindowAgg's
+ * segment tree.
+ */
+Datum
+int4_avg_combine(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray1;
+	ArrayType  *transarray2 = PG_GETARG_ARRAYTYPE_P(1);
+	Int8TransTypeData *state1;
+	Int8TransTypeData *state2;
+
+	if (AggCheckCallContext(fcinfo, NULL))
+		transarray1 = PG_GETARG_ARRAYTYPE_P(0);
+	else
+		transarray1 = PG_GETARG_ARRAYTYPE_P_COPY(0);
+
+	if (ARR_HASNULL(transarray1) ||
+		ARR_SIZE(transarray1) != ARR_OVERHEAD_NONULLS(1) + sizeof(Int8TransTypeData) ||
+		ARR_HASNULL(transarray2) ||
+		ARR_SIZE(transarray2) != ARR_OVERHEAD_NONULLS(1) + sizeof(Int8TransTypeData))
+		elog(ERROR, "expected 2-element int8 array");
+
+	state1 = (Int8TransTypeData *) ARR_DATA_PTR(transarray1);
+	state2 = (Int8TransTypeData *) ARR_DATA_PTR(transarray2);
+	state1->count += state2->count;
+	state1->sum += state2->sum;
+
+	PG_RETURN_ARRAYTYPE_P(transarray1);
+}
+
 Datum
 int8_avg(PG_FUNCTION_ARGS)
 {
@@ -3673,13 +4076,14 @@ get_str_from_var_sci(NumericVar *var, int rscale)
 
 
 /*
- * make_result() -
+ * make_result_opt_error() -
  *
  *	Create the packed db numeric format in palloc()'d memory from
- *	a variable.
+ *	a variable.  If have_error isn't NULL, an overflow sets *have_error
+ *	and returns NULL instead of raising the error.
  */
 static Numeric
-make_result(NumericVar *var)
+make_result_opt_error(NumericVar *var, bool *have_error)
 {
 	Numeric		result;
 	NumericDigit *digits = var->digits;
@@ -3749,15 +4153,35 @@ make_result(NumericVar *var)
 	/* Check for overflow of int16 fields */
 	if (NUMERIC_WEIGHT(result) != weight ||
 		NUMERIC_DSCALE(result) != var->dscale)
+	{
+		if (have_error != NULL)
+		{
+			pfree(result);
+			*have_error = true;
+			return NULL;
+		}
 		ereport(ERROR,
 				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
 				 errmsg("value overflows numeric format")));
+	}
 
 	dump_numeric("make_result()", result);
 	return result;
 }
 
 
+/*
+ * make_result() -
+ *
+ *	As make_result_opt_error, raising the error on overflow.
+ */
+static Numeric
+make_result(NumericVar *var)
+{
+	return make_result_opt_error(var, NULL);
+}
+
+
 /*
  * apply_typmod() -
  *
@@ -2514,8 +2514,24 @@ timestamp_pl_interval(PG_FUNCTION_ARGS)
 	Interval   *span = PG_GETARG_INTERVAL_P(1);
 	Timestamp	result;
 
+	if (!timestamp_add_interval(timestamp, span, &result))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				 errmsg("timestamp out of range")));
+
+	PG_RETURN_TIMESTAMP(result);
+}
+
+/*
+ * timestamp_add_interval
+ * the work of timestamp_pl_interval, returning false instead of
+ * raising the error if the result is out of range.
+ */
+bool
+timestamp_add_interval(Timestamp timestamp, Interval *span, Timestamp *result)
+{
 	if (TIMESTAMP_NOT_FINITE(timestamp))
-		result = timestamp;
+		*result = timestamp;
 	else
 	{
 		if (span->month != 0)
@@ -2525,9 +2541,7 @@ timestamp_pl_interval(PG_FUNCTION_ARGS)
 			fsec_t		fsec;
 
 			if (timestamp2tm(timestamp, NULL, tm, &fsec, NULL, NULL) != 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-						 errmsg("timestamp out of range")));
+				return false;
 
 			tm->tm_mon += span->month;
 			if (tm->tm_mon > MONTHS_PER_YEAR)
@@ -2546,9 +2560,7 @@ timestamp_pl_interval(PG_FUNCTION_ARGS)
 				tm->tm_mday = (day_tab[isleap(tm->tm_year)][tm->tm_mon - 1]);
 
 			if (tm2timestamp(tm, fsec, NULL, &timestamp) != 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-						 errmsg("timestamp out of range")));
+				return false;
 		}
 
 		if (span->day != 0)
@@ -2559,25 +2571,21 @@ timestamp_pl_interval(PG_FUNCTION_ARGS)
 			int			julian;
 
 			if (timestamp2tm(timestamp, NULL, tm, &fsec, NULL, NULL) != 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-						 errmsg("timestamp out of range")));
+				return false;
 
 			/* Add days by converting to and from julian */
 			julian = date2j(tm->tm_year, tm->tm_mon, tm->tm_mday) + span->day;
 			j2date(julian, &tm->tm_year, &tm->tm_mon, &tm->tm_mday);
 
 			if (tm2timestamp(tm, fsec, NULL, &timestamp) != 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-						 errmsg("timestamp out of range")));
+				return false;
 		}
 
 		timestamp += span->time;
-		result = timestamp;
+		*result = timestamp;
 	}
 
-	PG_RETURN_TIMESTAMP(result);
+	return true;
 }
 
 Datum
@@ -2612,11 +2620,29 @@ timestamptz_pl_interval(PG_FUNCTION_ARGS)
 	TimestampTz timestamp = PG_GETARG_TIMESTAMPTZ(0);
 	Interval   *span = PG_GETARG_INTERVAL_P(1);
 	TimestampTz result;
+
+	if (!timestamptz_add_interval(timestamp, span, &result))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				 errmsg("timestamp out of range")));
+
+	PG_RETURN_TIMESTAMP(result);
+}
+
+/*
+ * timestamptz_add_interval
+ * the work of timestamptz_pl_interval, returning false instead of
+ * raising the error if the result is out of range.
+ */
+bool
+timestamptz_add_interval(TimestampTz timestamp, Interval *span,
+						 TimestampTz *result)
+{
 	int			tz;
 	char	   *tzn;
 
 	if (TIMESTAMP_NOT_FINITE(timestamp))
-		result = timestamp;
+		*result = timestamp;
 	else
 	{
 		if (span->month != 0)
@@ -2626,9 +2652,7 @@ timestamptz_pl_interval(PG_FUNCTION_ARGS)
 			fsec_t		fsec;
 
 			if (timestamp2tm(timestamp, &tz, tm, &fsec, &tzn, NULL) != 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-						 errmsg("timestamp out of range")));
+				return false;
 
 			tm->tm_mon += span->month;
 			if (tm->tm_mon > MONTHS_PER_YEAR)
@@ -2649,9 +2673,7 @@ timestamptz_pl_interval(PG_FUNCTION_ARGS)
 			tz = DetermineTimeZoneOffset(tm, session_timezone);
 
 			if (tm2timestamp(tm, fsec, &tz, &timestamp) != 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-						 errmsg("timestamp out of range")));
+				return false;
 		}
 
 		if (span->day != 0)
@@ -2662,9 +2684,7 @@ timestamptz_pl_interval(PG_FUNCTION_ARGS)
 			int			julian;
 
 			if (timestamp2tm(timestamp, &tz, tm, &fsec, &tzn, NULL) != 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-						 errmsg("timestamp out of range")));
+				return false;
 
 			/* Add days by converting to and from julian */
 			julian = date2j(tm->tm_year, tm->tm_mon, tm->tm_mday) + span->day;
@@ -2673,16 +2693,14 @@ timestamptz_pl_interval(PG_FUNCTION_ARGS)
 			tz = DetermineTimeZoneOffset(tm, session_timezone);
 
 			if (tm2timestamp(tm, fsec, &tz, &timestamp) != 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
-						 errmsg("timestamp out of range")));
+				return false;
 		}
 
 		timestamp += span->time;
-		result = timestamp;
+		*result = timestamp;
 	}
 
-	PG_RETURN_TIMESTAMP(result);
+	return true;
 }
 
 Datum
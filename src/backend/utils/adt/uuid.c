@@ -222,6 +222,20 @@ uuid_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(uuid_internal_cmp(arg1, arg2));
 }
 
+/* abbreviated sort key: the leading bytes, most significant first */
+Datum
+uuid_abbrev(Datum original)
+{
+	pg_uuid_t  *uuid = DatumGetUUIDP(original);
+	Datum		key = 0;
+	int			i;
+
+	for (i = 0; i < SIZEOF_DATUM; i++)
+		key = (key << 8) | uuid->data[i];
+
+	return key;
+}
+
 /* hash index support */
 Datum
 uuid_hash(PG_FUNCTION_ARGS)
@@ -1615,6 +1615,35 @@ bttextcmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(result);
 }
 
+/*
+ * Abbreviated sort key for text: the leading bytes of the string,
+ * most significant first and zero padded, so that unsigned comparison of two
+ * keys agrees with bttextcmp wherever the keys differ.  That only holds for
+ * the C collation, where varstr_cmp is memcmp; callers must not use this for
+ * any other.
+ */
+Datum
+bttext_abbrev(Datum original)
+{
+	text	   *arg = DatumGetTextPP(original);
+	unsigned char *p = (unsigned char *) VARDATA_ANY(arg);
+	int			len = VARSIZE_ANY_EXHDR(arg);
+	Datum		key = 0;
+	int			i;
+
+	for (i = 0; i < SIZEOF_DATUM; i++)
+	{
+		key <<= 8;
+		if (i < len)
+			key |= p[i];
+	}
+
+	if ((Pointer) arg != DatumGetPointer(original))
+		pfree(arg);
+
+	return key;
+}
+
 
 Datum
 text_larger(PG_FUNCTION_ARGS)
@@ -58,6 +58,7 @@
 #include "replication/syncrep.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "storage/standby.h"
 #include "storage/fd.h"
@@ -72,6 +73,7 @@
 #include "utils/plancache.h"
 #include "utils/portal.h"
 #include "utils/ps_status.h"
+#include "utils/tuplesort.h"
 #include "utils/tzparser.h"
 #include "utils/xml.h"
 
@@ -706,6 +708,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_incrementalsort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of sort steps that finish an input already sorted on leading keys."),
+			NULL
+		},
+		&enable_incrementalsort,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of hashed aggregation plans."),
@@ -724,6 +735,33 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_multiframe", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's evaluation of windows that share partitioning and ordering in a single window aggregate."),
+			NULL
+		},
+		&enable_multiframe,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_runcondition", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of row_number, rank and dense_rank quals to stop window partitions early."),
+			NULL
+		},
+		&enable_runcondition,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_hashaggspill", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables hashed aggregation to spill groups that do not fit in work_mem to disk."),
+			NULL
+		},
+		&enable_hashaggspill,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_nestloop", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of nested-loop join plans."),
@@ -787,6 +825,96 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_inversetrans", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the executor's use of inverse transition functions for moving-frame window aggregates."),
+			NULL
+		},
+		&enable_inversetrans,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_segtree", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the executor's use of segment trees of combined transition states for moving-frame window aggregates."),
+			NULL
+		},
+		&enable_segtree,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_columnbuffer", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the executor's use of a column buffer of window aggregate arguments, so each row's arguments are evaluated once per partition."),
+			NULL
+		},
+		&enable_columnbuffer,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_batchadvance", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the executor's advancing of built-in window aggregates over runs of the column buffer without calling the transition function."),
+			NULL
+		},
+		&enable_batchadvance,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_argring", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the executor's ring of recent argument values for lead, lag and the frame value window functions."),
+			NULL
+		},
+		&enable_argring,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_aggshare", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables window aggregates to share argument evaluation and transition values."),
+			NULL
+		},
+		&enable_aggshare,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_abbrevkeys", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables sorts to compare abbreviated keys for text, numeric and uuid leading columns."),
+			NULL
+		},
+		&enable_abbrevkeys,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_inlinesort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables quicksorts specialized for the type of the leading sort key."),
+			NULL
+		},
+		&enable_inlinesort,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_quicksortruns", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables building external sort runs by quicksort, merged with a higher fan-in and read-ahead."),
+			NULL
+		},
+		&enable_quicksortruns,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_tempcompress", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Compresses the temporary files written by sorts and tuplestores."),
+			NULL
+		},
+		&enable_tempcompress,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Enables genetic query optimization."),
@@ -1480,24 +1608,6 @@ static struct config_bool ConfigureNamesBool[] =
 
 static struct config_int ConfigureNamesInt[] =
 {
-	{
-		{"recompute_k", PGC_USERSET, QUERY_TUNING_METHOD,
-			gettext_noop("Set the parameter k of recompute. "),
-			NULL
-		},
-		&recompute_k,
-		100, 5, 5000,
-		NULL, NULL, NULL
-	},
-	{
-		{"recompute_num", PGC_USERSET, QUERY_TUNING_METHOD,
-			gettext_noop("Set the number of temporary transition value for recompute. "),
-			NULL
-		},
-		&recompute_num,
-		1, 0, 16,
-		NULL, NULL, NULL
-	},
 	{
 		{"archive_timeout", PGC_SIGHUP, WAL_ARCHIVING,
 			gettext_noop("Forces a switch to the next xlog file if a "
@@ -422,6 +422,7 @@ AllocSetContextCreate(MemoryContext parent,
 		block->endptr = ((char *) block) + blksize;
 		block->next = context->blocks;
 		context->blocks = block;
+		context->header.mem_allocated += blksize;
 		/* Mark block as not to be released at reset time */
 		context->keeper = block;
 	}
@@ -501,6 +502,7 @@ AllocSetReset(MemoryContext context)
 		else
 		{
 			/* Normal case, release the block */
+			set->header.mem_allocated -= block->endptr - ((char *) block);
 #ifdef CLOBBER_FREED_MEMORY
 			/* Wipe freed memory for debugging purposes */
 			memset(block, 0x7F, block->freeptr - ((char *) block));
@@ -539,6 +541,7 @@ AllocSetDelete(MemoryContext context)
 	MemSetAligned(set->freelist, 0, sizeof(set->freelist));
 	set->blocks = NULL;
 	set->keeper = NULL;
+	set->header.mem_allocated = 0;
 
 	while (block != NULL)
 	{
@@ -590,6 +593,7 @@ AllocSetAlloc(MemoryContext context, Size size)
 		}
 		block->aset = set;
 		block->freeptr = block->endptr = ((char *) block) + blksize;
+		set->header.mem_allocated += blksize;
 
 		chunk = (AllocChunk) (((char *) block) + ALLOC_BLOCKHDRSZ);
 		chunk->aset = set;
@@ -770,6 +774,7 @@ AllocSetAlloc(MemoryContext context, Size size)
 		block->aset = set;
 		block->freeptr = ((char *) block) + ALLOC_BLOCKHDRSZ;
 		block->endptr = ((char *) block) + blksize;
+		set->header.mem_allocated += blksize;
 
 		/*
 		 * If this is the first block of the set, make it the "keeper" block.
@@ -859,6 +864,7 @@ AllocSetFree(MemoryContext context, void *pointer)
 			set->blocks = block->next;
 		else
 			prevblock->next = block->next;
+		set->header.mem_allocated -= block->endptr - ((char *) block);
 #ifdef CLOBBER_FREED_MEMORY
 		/* Wipe freed memory for debugging purposes */
 		memset(block, 0x7F, block->freeptr - ((char *) block));
@@ -940,6 +946,7 @@ AllocSetRealloc(MemoryContext context, void *pointer, Size size)
 		AllocBlock	prevblock = NULL;
 		Size		chksize;
 		Size		blksize;
+		Size		oldblksize;
 
 		while (block != NULL)
 		{
@@ -957,6 +964,7 @@ AllocSetRealloc(MemoryContext context, void *pointer, Size size)
 		/* Do the realloc */
 		chksize = MAXALIGN(size);
 		blksize = chksize + ALLOC_BLOCKHDRSZ + ALLOC_CHUNKHDRSZ;
+		oldblksize = block->endptr - ((char *) block);
 		block = (AllocBlock) realloc(block, blksize);
 		if (block == NULL)
 		{
@@ -968,6 +976,7 @@ AllocSetRealloc(MemoryContext context, void *pointer, Size size)
 							   (unsigned long) size)));
 		}
 		block->freeptr = block->endptr = ((char *) block) + blksize;
+		set->header.mem_allocated += blksize - oldblksize;
 
 		/* Update pointers since block has likely been moved */
 		chunk = (AllocChunk) (((char *) block) + ALLOC_BLOCKHDRSZ);
@@ -318,6 +318,34 @@ MemoryContextIsEmpty(MemoryContext context)
 	return (*context->methods->is_empty) (context);
 }
 
+/*
+ * MemoryContextMemAllocated
+ *		total space a context has obtained from malloc, including
+ *		its descendants' if recurse is true.
+ *
+ * This counts whole blocks, free space in them included, so it tells how
+ * much memory the context really ties up rather than how much is in use.
+ */
+Size
+MemoryContextMemAllocated(MemoryContext context, bool recurse)
+{
+	Size		total;
+
+	AssertArg(MemoryContextIsValid(context));
+
+	total = context->mem_allocated;
+	if (recurse)
+	{
+		MemoryContext child;
+
+		for (child = context->firstchild;
+			 child != NULL;
+			 child = child->nextchild)
+			total += MemoryContextMemAllocated(child, true);
+	}
+	return total;
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
@@ -482,6 +510,7 @@ MemoryContextCreate(NodeTag tag, Size size,
 	node->firstchild = NULL;
 	node->nextchild = NULL;
 	node->isReset = true;
+	node->mem_allocated = 0;
 	node->name = ((char *) node) + size;
 	strcpy(node->name, name);
 
@@ -529,6 +529,8 @@ LogicalTapeSetCreate(int ntapes)
 	lts = (LogicalTapeSet *) palloc(sizeof(LogicalTapeSet) +
 									(ntapes - 1) *sizeof(LogicalTape));
 	lts->pfile = BufFileCreateTemp(false);
+	if (enable_tempcompress)
+		opt_BufFileCompress(lts->pfile);
 	lts->nFileBlocks = 0L;
 	lts->forgetFreeSpace = false;
 	lts->blocksSorted = true;	/* a zero-length array is sorted ... */
@@ -1013,6 +1015,32 @@ LogicalTapeTell(LogicalTapeSet *lts, int tapenum,
 	*offset = lt->pos;
 }
 
+/*
+ * Hint the kernel to start reading the next data blocks of a
+ * tape that is being read forward, up to nblocks of them.  Only blocks
+ * listed in the tape's current bottom-level indirect block are hinted;
+ * the next indirect block is not read ahead of time just for this.
+ */
+void
+LogicalTapePrefetch(LogicalTapeSet *lts, int tapenum, int nblocks)
+{
+	LogicalTape *lt;
+	IndirectBlock *indirect;
+	int			slot;
+
+	Assert(tapenum >= 0 && tapenum < lts->nTapes);
+	lt = &lts->tapes[tapenum];
+	indirect = lt->indirect;
+	if (lt->writing || indirect == NULL)
+		return;
+
+	for (slot = indirect->nextSlot;
+		 nblocks > 0 && slot < BLOCKS_PER_INDIR_BLOCK &&
+		 indirect->ptrs[slot] != -1L;
+		 slot++, nblocks--)
+		opt_BufFilePrefetchBlock(lts->pfile, indirect->ptrs[slot]);
+}
+
 /*
  * Obtain total disk space currently used by a LogicalTapeSet, in blocks.
  */
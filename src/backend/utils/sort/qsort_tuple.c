@@ -0,0 +1,168 @@
+/*-------------------------------------------------------------------------
+ *
+ * qsort_tuple.c
+ *	  Quicksort of a SortTuple array with an inlined comparator.
+ *
+ * This file is a template, not a translation unit of its own:
+ * tuplesort.c includes it once per comparator, after defining
+ *
+ *	QS_SUFFIX		suffix of the generated qsort_tuple_<suffix>() function
+ *	QS_COMPARE(a, b, state)
+ *					three-way comparison of two SortTuple pointers
+ *
+ * The algorithm is qsort_arg()'s (Bentley & McIlroy, with the check for
+ * presorted input), but it moves whole SortTuple structs and calls the
+ * comparator directly, so that a comparator the compiler can see is
+ * expanded in place instead of going through a function pointer.
+ *
+ * Portions Copyright (c) 1996-2011, PostgreSQL Global Development Group
+ *
+ * src/backend/utils/sort/qsort_tuple.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef QS_SUFFIX
+#error "QS_SUFFIX must be defined before including qsort_tuple.c"
+#endif
+
+#ifndef QSORT_TUPLE_COMMON
+#define QSORT_TUPLE_COMMON
+
+static void
+swapfunc_tuple(SortTuple *a, SortTuple *b, size_t n)
+{
+	do
+	{
+		SortTuple	t = *a;
+
+		*a++ = *b;
+		*b++ = t;
+	} while (--n > 0);
+}
+
+#define swap_tuple(a, b) \
+	do { \
+		SortTuple	t_ = *(a); \
+		*(a) = *(b); \
+		*(b) = t_; \
+	} while (0)
+
+#define vecswap_tuple(a, b, n) \
+	if ((n) > 0) swapfunc_tuple((a), (b), (size_t) (n))
+
+#define QS_MAKE_NAME_(prefix, suffix) prefix##_##suffix
+#define QS_MAKE_NAME(prefix, suffix) QS_MAKE_NAME_(prefix, suffix)
+#endif   /* QSORT_TUPLE_COMMON */
+
+#define QS_QSORT	QS_MAKE_NAME(qsort_tuple, QS_SUFFIX)
+#define QS_MED3		QS_MAKE_NAME(med3_tuple, QS_SUFFIX)
+
+static SortTuple *
+QS_MED3(SortTuple *a, SortTuple *b, SortTuple *c, Tuplesortstate *state)
+{
+	return QS_COMPARE(a, b, state) < 0 ?
+		(QS_COMPARE(b, c, state) < 0 ? b :
+		 (QS_COMPARE(a, c, state) < 0 ? c : a))
+		: (QS_COMPARE(b, c, state) > 0 ? b :
+		   (QS_COMPARE(a, c, state) < 0 ? a : c));
+}
+
+static void
+QS_QSORT(SortTuple *a, size_t n, Tuplesortstate *state)
+{
+	SortTuple  *pa,
+			   *pb,
+			   *pc,
+			   *pd,
+			   *pl,
+			   *pm,
+			   *pn;
+	size_t		d;
+	int			r,
+				presorted;
+
+loop:
+	/* the comparators need not check for interrupts themselves */
+	CHECK_FOR_INTERRUPTS();
+	if (n < 7)
+	{
+		for (pm = a + 1; pm < a + n; pm++)
+			for (pl = pm; pl > a && QS_COMPARE(pl - 1, pl, state) > 0; pl--)
+				swap_tuple(pl, pl - 1);
+		return;
+	}
+	presorted = 1;
+	for (pm = a + 1; pm < a + n; pm++)
+	{
+		if (QS_COMPARE(pm - 1, pm, state) > 0)
+		{
+			presorted = 0;
+			break;
+		}
+	}
+	if (presorted)
+		return;
+	pm = a + (n / 2);
+	if (n > 7)
+	{
+		pl = a;
+		pn = a + (n - 1);
+		if (n > 40)
+		{
+			d = n / 8;
+			pl = QS_MED3(pl, pl + d, pl + 2 * d, state);
+			pm = QS_MED3(pm - d, pm, pm + d, state);
+			pn = QS_MED3(pn - 2 * d, pn - d, pn, state);
+		}
+		pm = QS_MED3(pl, pm, pn, state);
+	}
+	swap_tuple(a, pm);
+	pa = pb = a + 1;
+	pc = pd = a + (n - 1);
+	for (;;)
+	{
+		while (pb <= pc && (r = QS_COMPARE(pb, a, state)) <= 0)
+		{
+			if (r == 0)
+			{
+				swap_tuple(pa, pb);
+				pa++;
+			}
+			pb++;
+		}
+		while (pb <= pc && (r = QS_COMPARE(pc, a, state)) >= 0)
+		{
+			if (r == 0)
+			{
+				swap_tuple(pc, pd);
+				pd--;
+			}
+			pc--;
+		}
+		if (pb > pc)
+			break;
+		swap_tuple(pb, pc);
+		pb++;
+		pc--;
+	}
+	pn = a + n;
+	d = Min(pa - a, pb - pa);
+	vecswap_tuple(a, pb - d, d);
+	d = Min(pd - pc, pn - pd - 1);
+	vecswap_tuple(pb, pn - d, d);
+	if ((d = pb - pa) > 1)
+		QS_QSORT(a, d, state);
+	if ((d = pd - pc) > 1)
+	{
+		/* Iterate rather than recurse to save stack space */
+		a = pn - d;
+		n = d;
+		goto loop;
+	}
+}
+
+#undef QS_QSORT
+#undef QS_MED3
+#undef QS_SUFFIX
+#undef QS_COMPARE
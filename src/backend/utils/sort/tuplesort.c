@@ -86,6 +86,18 @@
  * we preread from a tape, so as to maintain the locality of access described
  * above.  Nonetheless, with large workMem we can have many tapes.
  *
+ * With enable_quicksortruns the runs are not formed by
+ * replacement selection.  Instead each time workMem fills up, the whole
+ * memory load is quicksorted and written out as one run, so that run
+ * building does sequential passes over memory rather than a heap's
+ * cache-missing siftups.  The runs are only about workMem long instead of
+ * about twice that, so to keep the merge down to one pass or few, we also
+ * plan for a smaller preread per tape (PREFETCH_MERGE_BUFFER_SIZE), which
+ * gives a proportionally higher merge order; to keep reads from stalling
+ * on the smaller prereads, whenever a tape has been read from we ask the
+ * kernel to start reading its next blocks in the background
+ * (LogicalTapePrefetch).
+ *
  *
  * Portions Copyright (c) 1996-2011, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -99,6 +111,7 @@
 #include "postgres.h"
 
 #include <limits.h>
+#include <math.h>
 
 #include "access/genam.h"
 #include "access/nbtree.h"
@@ -109,14 +122,21 @@
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "utils/builtins.h"
+#include "utils/date.h"
 #include "utils/datum.h"
+#include "utils/fmgroids.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/numeric.h"
+#include "utils/pg_locale.h"
 #include "utils/pg_rusage.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
+#include "utils/timestamp.h"
 #include "utils/tuplesort.h"
+#include "utils/uuid.h"
 
 
 /* sort-type codes for sort__start probes */
@@ -134,6 +154,10 @@ bool		trace_sort = false;
 bool		optimize_bounded_sort = true;
 #endif
 
+bool		enable_abbrevkeys = true;
+bool		enable_inlinesort = true;
+bool		enable_quicksortruns = true;
+
 
 /*
  * The objects we actually sort are SortTuple structs.	These contain
@@ -149,6 +173,11 @@ bool		optimize_bounded_sort = true;
  * case where the first key determines the comparison result.  Note that
  * for a pass-by-reference datatype, datum1 points into the "tuple" storage.
  *
+ * When a heap sort's first key has an abbreviated form (see
+ * abbrevfunc), datum1 holds that fixed-size key instead, compared as an
+ * unsigned integer; only tuples whose abbreviated keys are equal go on to
+ * compare the first column itself, fetched from the tuple.
+ *
  * When sorting single Datums, the data value is represented directly by
  * datum1/isnull1.	If the datatype is pass-by-reference and isnull1 is false,
  * then datum1 points to a separately palloc'd data value that is also pointed
@@ -198,6 +227,13 @@ typedef enum
 #define TAPE_BUFFER_OVERHEAD		(BLCKSZ * 3)
 #define MERGE_BUFFER_SIZE			(BLCKSZ * 32)
 
+/*
+ * With enable_quicksortruns: the preread per input tape we plan
+ * for, and how many blocks ahead of its read position we prefetch.
+ */
+#define PREFETCH_MERGE_BUFFER_SIZE	(BLCKSZ * 8)
+#define MERGE_PREFETCH_BLOCKS		(PREFETCH_MERGE_BUFFER_SIZE / BLCKSZ)
+
 /*
  * Private state of a Tuplesort operation.
  */
@@ -237,6 +273,12 @@ struct Tuplesortstate
 	 */
 	void		(*copytup) (Tuplesortstate *state, SortTuple *stup, void *tup);
 
+	/*
+	 * Quicksort of the memtuples array with comparetup inlined, or
+	 * NULL to use qsort_arg with comparetup.
+	 */
+	void		(*qsorttup) (SortTuple *a, size_t n, Tuplesortstate *state);
+
 	/*
 	 * Function to write a stored tuple onto tape.	The representation of the
 	 * tuple on tape need not be the same as it is in memory; requirements on
@@ -283,6 +325,13 @@ struct Tuplesortstate
 	 */
 	int			currentRun;
 
+	/*
+	 * True if initial runs are built by quicksorting whole memory
+	 * loads rather than by replacement selection; set by inittapes().  In
+	 * state BUILDRUNS memtuples[] is then an unsorted array, not a heap.
+	 */
+	bool		quicksortRuns;
+
 	/*
 	 * Unless otherwise noted, all pointer variables below are pointers to
 	 * arrays of length maxTapes, holding per-tape data.
@@ -344,6 +393,8 @@ struct Tuplesortstate
 	 */
 	TupleDesc	tupDesc;
 	ScanKey		scanKeys;		/* array of length nKeys */
+	/* makes datum1's abbreviated key, or NULL if not abbreviated */
+	Datum		(*abbrevfunc) (Datum original);
 
 	/*
 	 * These variables are specific to the CLUSTER case; they are set by
@@ -454,6 +505,7 @@ static void beginmerge(Tuplesortstate *state);
 static void mergepreread(Tuplesortstate *state);
 static void mergeprereadone(Tuplesortstate *state, int srcTape);
 static void dumptuples(Tuplesortstate *state, bool alltuples);
+static void dumpsortedrun(Tuplesortstate *state);
 static void make_bounded_heap(Tuplesortstate *state);
 static void sort_bounded_heap(Tuplesortstate *state);
 static void tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple,
@@ -469,6 +521,19 @@ static void writetup_heap(Tuplesortstate *state, int tapenum,
 static void readtup_heap(Tuplesortstate *state, SortTuple *stup,
 			 int tapenum, unsigned int len);
 static void reversedirection_heap(Tuplesortstate *state);
+static Datum (*select_abbrev_function(ScanKey scanKey)) (Datum);
+static int comparetup_heap_rest(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state);
+static void specialize_heap_sort(Tuplesortstate *state);
+static void qsort_tuple_generic(SortTuple *a, size_t n, Tuplesortstate *state);
+static void qsort_tuple_heap_int4(SortTuple *a, size_t n,
+					  Tuplesortstate *state);
+static void qsort_tuple_heap_int8(SortTuple *a, size_t n,
+					  Tuplesortstate *state);
+static void qsort_tuple_heap_float8(SortTuple *a, size_t n,
+						Tuplesortstate *state);
+static void qsort_tuple_heap_abbrev(SortTuple *a, size_t n,
+						Tuplesortstate *state);
 static int comparetup_cluster(const SortTuple *a, const SortTuple *b,
 				   Tuplesortstate *state);
 static void copytup_cluster(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -654,6 +719,11 @@ tuplesort_begin_heap(TupleDesc tupDesc,
 							   (Datum) 0);
 	}
 
+	if (enable_abbrevkeys)
+		state->abbrevfunc = select_abbrev_function(&state->scanKeys[0]);
+	if (enable_inlinesort)
+		specialize_heap_sort(state);
+
 	MemoryContextSwitchTo(oldcontext);
 
 	return state;
@@ -1197,6 +1267,19 @@ puttuple_common(Tuplesortstate *state, SortTuple *tuple)
 
 		case TSS_BUILDRUNS:
 
+			if (state->quicksortRuns)
+			{
+				/*
+				 * Just append the tuple to the current memory load.  There is
+				 * always a free slot here, since dumptuples writes out the
+				 * load as soon as the array or memory fills up.
+				 */
+				Assert(state->memtupcount < state->memtupsize);
+				state->memtuples[state->memtupcount++] = *tuple;
+				dumptuples(state, false);
+				break;
+			}
+
 			/*
 			 * Insert the tuple into the heap, with run number currentRun if
 			 * it can go into the current run, else run number currentRun+1.
@@ -1251,11 +1334,17 @@ tuplesort_performsort(Tuplesortstate *state)
 			 * amount of memory.  Just qsort 'em and we're done.
 			 */
 			if (state->memtupcount > 1)
-				qsort_arg((void *) state->memtuples,
-						  state->memtupcount,
-						  sizeof(SortTuple),
-						  (qsort_arg_comparator) state->comparetup,
-						  (void *) state);
+			{
+				if (state->qsorttup != NULL)
+					state->qsorttup(state->memtuples, state->memtupcount,
+									state);
+				else
+					qsort_arg((void *) state->memtuples,
+							  state->memtupcount,
+							  sizeof(SortTuple),
+							  (qsort_arg_comparator) state->comparetup,
+							  (void *) state);
+			}
 			state->current = 0;
 			state->eof_reached = false;
 			state->markpos_offset = 0;
@@ -1647,7 +1736,8 @@ tuplesort_merge_order(long allowedMem)
 	 * MERGE_BUFFER_SIZE workspace.
 	 */
 	mOrder = (allowedMem - TAPE_BUFFER_OVERHEAD) /
-		(MERGE_BUFFER_SIZE + TAPE_BUFFER_OVERHEAD);
+		((enable_quicksortruns ? PREFETCH_MERGE_BUFFER_SIZE : MERGE_BUFFER_SIZE) +
+		 TAPE_BUFFER_OVERHEAD);
 
 	/* Even in minimum memory, use at least a MINORDER merge */
 	mOrder = Max(mOrder, MINORDER);
@@ -1723,22 +1813,27 @@ inittapes(Tuplesortstate *state)
 
 	/*
 	 * Convert the unsorted contents of memtuples[] into a heap. Each tuple is
-	 * marked as belonging to run number zero.
+	 * marked as belonging to run number zero.  (Not when building
+	 * runs by quicksort; the array is then sorted as it is dumped.)
 	 *
 	 * NOTE: we pass false for checkIndex since there's no point in comparing
 	 * indexes in this step, even though we do intend the indexes to be part
 	 * of the sort key...
 	 */
-	ntuples = state->memtupcount;
-	state->memtupcount = 0;		/* make the heap empty */
-	for (j = 0; j < ntuples; j++)
+	state->quicksortRuns = enable_quicksortruns;
+	if (!state->quicksortRuns)
 	{
-		/* Must copy source tuple to avoid possible overwrite */
-		SortTuple	stup = state->memtuples[j];
+		ntuples = state->memtupcount;
+		state->memtupcount = 0;		/* make the heap empty */
+		for (j = 0; j < ntuples; j++)
+		{
+			/* Must copy source tuple to avoid possible overwrite */
+			SortTuple	stup = state->memtuples[j];
 
-		tuplesort_heap_insert(state, &stup, 0, false);
+			tuplesort_heap_insert(state, &stup, 0, false);
+		}
+		Assert(state->memtupcount == ntuples);
 	}
-	Assert(state->memtupcount == ntuples);
 
 	state->currentRun = 0;
 
@@ -2066,6 +2161,17 @@ beginmerge(Tuplesortstate *state)
 		}
 	}
 
+	/* let the kernel fetch the first blocks of all the runs */
+	if (state->quicksortRuns)
+	{
+		for (srcTape = 0; srcTape < state->maxTapes; srcTape++)
+		{
+			if (state->mergeactive[srcTape])
+				LogicalTapePrefetch(state->tapeset, srcTape,
+									MERGE_PREFETCH_BLOCKS);
+		}
+	}
+
 	/*
 	 * Preread as many tuples as possible (and at least one) from each active
 	 * tape
@@ -2174,6 +2280,12 @@ mergeprereadone(Tuplesortstate *state, int srcTape)
 			state->mergenext[srcTape] = tupIndex;
 		state->mergelast[srcTape] = tupIndex;
 	}
+	/*
+	 * The next preread from this tape will want the blocks that
+	 * follow; have the kernel start reading them meanwhile.
+	 */
+	if (state->quicksortRuns && state->mergeactive[srcTape])
+		LogicalTapePrefetch(state->tapeset, srcTape, MERGE_PREFETCH_BLOCKS);
 	/* update per-tape and global availmem counts */
 	spaceUsed = state->mergeavailmem[srcTape] - state->availMem;
 	state->mergeavailmem[srcTape] = state->availMem;
@@ -2196,10 +2308,23 @@ mergeprereadone(Tuplesortstate *state, int srcTape)
  * If we empty the heap, close out the current run and return (this should
  * only happen at end of input data).  If we see that the tuple run number
  * at the top of the heap has changed, start a new run.
+ *
+ * When building runs by quicksort, the memtuples[] array is
+ * instead written out all at once as a run of its own, once it is full or
+ * we are out of memory (see dumpsortedrun).
  */
 static void
 dumptuples(Tuplesortstate *state, bool alltuples)
 {
+	if (state->quicksortRuns)
+	{
+		if (alltuples ||
+			LACKMEM(state) ||
+			state->memtupcount >= state->memtupsize)
+			dumpsortedrun(state);
+		return;
+	}
+
 	while (alltuples ||
 		   (LACKMEM(state) && state->memtupcount > 1) ||
 		   state->memtupcount >= state->memtupsize)
@@ -2244,6 +2369,59 @@ dumptuples(Tuplesortstate *state, bool alltuples)
 	}
 }
 
+/*
+ * dumpsortedrun - sort the tuples in memory and write them out as a run
+ *
+ * This is dumptuples for quicksorted runs.  The next tape is
+ * selected here, when the run is about to be written, rather than when the
+ * previous one is closed, so that if input ends just as memory fills up we
+ * neither write an empty run nor leave destTape pointing past the last one.
+ */
+static void
+dumpsortedrun(Tuplesortstate *state)
+{
+	int			destTape;
+	int			i;
+
+	if (state->memtupcount == 0)
+		return;
+
+	if (state->currentRun > 0)
+		selectnewtape(state);
+	destTape = state->tp_tapenum[state->destTape];
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "starting quicksort of run %d: %s",
+			 state->currentRun, pg_rusage_show(&state->ru_start));
+#endif
+
+	if (state->qsorttup != NULL)
+		state->qsorttup(state->memtuples, state->memtupcount, state);
+	else
+		qsort_arg((void *) state->memtuples,
+				  state->memtupcount,
+				  sizeof(SortTuple),
+				  (qsort_arg_comparator) state->comparetup,
+				  (void *) state);
+
+	for (i = 0; i < state->memtupcount; i++)
+		WRITETUP(state, destTape, &state->memtuples[i]);
+	state->memtupcount = 0;
+
+	markrunend(state, destTape);
+	state->currentRun++;
+	state->tp_runs[state->destTape]++;
+	state->tp_dummy[state->destTape]--; /* per Alg D step D2 */
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "finished writing run %d to tape %d: %s",
+			 state->currentRun, state->destTape,
+			 pg_rusage_show(&state->ru_start));
+#endif
+}
+
 /*
  * tuplesort_rescan		- rewind and replay the scan
  */
@@ -2697,6 +2875,73 @@ inlineApplySortFunction(FmgrInfo *sortFunction, int sk_flags, Oid collation,
 	return compare;
 }
 
+/*
+ * Three-way comparison of two abbreviated keys, with the same
+ * handling of NULLs and DESC as inlineApplySortFunction.  Zero means the
+ * full values must decide.
+ */
+static inline int32
+inlineApplyAbbrevCompare(int sk_flags,
+						 Datum datum1, bool isNull1,
+						 Datum datum2, bool isNull2)
+{
+	int32		compare;
+
+	if (isNull1)
+	{
+		if (isNull2)
+			compare = 0;		/* NULL "=" NULL */
+		else if (sk_flags & SK_BT_NULLS_FIRST)
+			compare = -1;		/* NULL "<" NOT_NULL */
+		else
+			compare = 1;		/* NULL ">" NOT_NULL */
+	}
+	else if (isNull2)
+	{
+		if (sk_flags & SK_BT_NULLS_FIRST)
+			compare = 1;		/* NOT_NULL ">" NULL */
+		else
+			compare = -1;		/* NOT_NULL "<" NULL */
+	}
+	else
+	{
+		if (datum1 < datum2)
+			compare = -1;
+		else if (datum1 > datum2)
+			compare = 1;
+		else
+			compare = 0;
+
+		if (sk_flags & SK_BT_DESC)
+			compare = -compare;
+	}
+
+	return compare;
+}
+
+/*
+ * Pick the abbreviated key for a sort key, by its comparison
+ * function.  Text is only abbreviated under the C collation, where bytewise
+ * order is the collation's order; strxfrm() prefixes are not trusted to
+ * agree with strcoll() on every platform.
+ */
+static Datum (*select_abbrev_function(ScanKey scanKey)) (Datum)
+{
+	switch (scanKey->sk_func.fn_oid)
+	{
+		case F_BTTEXTCMP:
+			if (OidIsValid(scanKey->sk_collation) &&
+				lc_collate_is_c(scanKey->sk_collation))
+				return bttext_abbrev;
+			break;
+		case F_NUMERIC_CMP:
+			return numeric_abbrev;
+		case F_UUID_CMP:
+			return uuid_abbrev;
+	}
+	return NULL;
+}
+
 /*
  * Non-inline ApplySortFunction() --- this is needed only to conform to
  * C99's brain-dead notions about how to implement inline functions...
@@ -2720,29 +2965,69 @@ static int
 comparetup_heap(const SortTuple *a, const SortTuple *b, Tuplesortstate *state)
 {
 	ScanKey		scanKey = state->scanKeys;
-	HeapTupleData ltup;
-	HeapTupleData rtup;
-	TupleDesc	tupDesc;
-	int			nkey;
 	int32		compare;
 
 	/* Allow interrupting long sorts */
 	CHECK_FOR_INTERRUPTS();
 
 	/* Compare the leading sort key */
-	compare = inlineApplySortFunction(&scanKey->sk_func, scanKey->sk_flags,
-									  scanKey->sk_collation,
-									  a->datum1, a->isnull1,
-									  b->datum1, b->isnull1);
+	if (state->abbrevfunc != NULL)
+		compare = inlineApplyAbbrevCompare(scanKey->sk_flags,
+										   a->datum1, a->isnull1,
+										   b->datum1, b->isnull1);
+	else
+		compare = inlineApplySortFunction(&scanKey->sk_func, scanKey->sk_flags,
+										  scanKey->sk_collation,
+										  a->datum1, a->isnull1,
+										  b->datum1, b->isnull1);
 	if (compare != 0)
 		return compare;
 
+	return comparetup_heap_rest(a, b, state);
+}
+
+/*
+ * The rest of comparetup_heap, for two tuples whose datum1 values
+ * compared equal
+ */
+static int
+comparetup_heap_rest(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state)
+{
+	ScanKey		scanKey = state->scanKeys;
+	HeapTupleData ltup;
+	HeapTupleData rtup;
+	TupleDesc	tupDesc;
+	int			nkey;
+	int32		compare;
+
 	/* Compare additional sort keys */
 	ltup.t_len = ((MinimalTuple) a->tuple)->t_len + MINIMAL_TUPLE_OFFSET;
 	ltup.t_data = (HeapTupleHeader) ((char *) a->tuple - MINIMAL_TUPLE_OFFSET);
 	rtup.t_len = ((MinimalTuple) b->tuple)->t_len + MINIMAL_TUPLE_OFFSET;
 	rtup.t_data = (HeapTupleHeader) ((char *) b->tuple - MINIMAL_TUPLE_OFFSET);
 	tupDesc = state->tupDesc;
+
+	/* equal abbreviated keys leave the first column undecided */
+	if (state->abbrevfunc != NULL && !a->isnull1)
+	{
+		AttrNumber	attno = scanKey->sk_attno;
+		Datum		datum1,
+					datum2;
+		bool		isnull1,
+					isnull2;
+
+		datum1 = heap_getattr(&ltup, attno, tupDesc, &isnull1);
+		datum2 = heap_getattr(&rtup, attno, tupDesc, &isnull2);
+
+		compare = inlineApplySortFunction(&scanKey->sk_func, scanKey->sk_flags,
+										  scanKey->sk_collation,
+										  datum1, isnull1,
+										  datum2, isnull2);
+		if (compare != 0)
+			return compare;
+	}
+
 	scanKey++;
 	for (nkey = 1; nkey < state->nKeys; nkey++, scanKey++)
 	{
@@ -2788,6 +3073,8 @@ copytup_heap(Tuplesortstate *state, SortTuple *stup, void *tup)
 								state->scanKeys[0].sk_attno,
 								state->tupDesc,
 								&stup->isnull1);
+	if (state->abbrevfunc != NULL && !stup->isnull1)
+		stup->datum1 = state->abbrevfunc(stup->datum1);
 }
 
 static void
@@ -2840,6 +3127,8 @@ readtup_heap(Tuplesortstate *state, SortTuple *stup,
 								state->scanKeys[0].sk_attno,
 								state->tupDesc,
 								&stup->isnull1);
+	if (state->abbrevfunc != NULL && !stup->isnull1)
+		stup->datum1 = state->abbrevfunc(stup->datum1);
 }
 
 static void
@@ -2854,6 +3143,228 @@ reversedirection_heap(Tuplesortstate *state)
 	}
 }
 
+/*
+ * Heap comparisons specialized for the type of the leading key.
+ *
+ * When the leading key is a by-value integer or float8 (or a date or
+ * timestamp, which compare as one), or an abbreviated key, its comparison
+ * needs no fmgr call, and is written out here so that the quicksorts
+ * instantiated from qsort_tuple.c below can inline it.  Only ties go on to
+ * comparetup_heap_rest.  Each agrees with the btree comparison function of
+ * its type, including the NULL and DESC handling of inlineApplySortFunction.
+ */
+static inline int32
+compare_leading_nulls(const SortTuple *a, const SortTuple *b, int sk_flags)
+{
+	if (a->isnull1)
+	{
+		if (b->isnull1)
+			return 0;			/* NULL "=" NULL */
+		return (sk_flags & SK_BT_NULLS_FIRST) ? -1 : 1;
+	}
+	return (sk_flags & SK_BT_NULLS_FIRST) ? 1 : -1;
+}
+
+static inline int32
+compare_leading_int4(const SortTuple *a, const SortTuple *b, int sk_flags)
+{
+	int32		x,
+				y,
+				compare;
+
+	if (a->isnull1 || b->isnull1)
+		return compare_leading_nulls(a, b, sk_flags);
+	x = DatumGetInt32(a->datum1);
+	y = DatumGetInt32(b->datum1);
+	compare = (x < y) ? -1 : ((x > y) ? 1 : 0);
+	return (sk_flags & SK_BT_DESC) ? -compare : compare;
+}
+
+static inline int32
+compare_leading_int8(const SortTuple *a, const SortTuple *b, int sk_flags)
+{
+	int64		x,
+				y;
+	int32		compare;
+
+	if (a->isnull1 || b->isnull1)
+		return compare_leading_nulls(a, b, sk_flags);
+	x = DatumGetInt64(a->datum1);
+	y = DatumGetInt64(b->datum1);
+	compare = (x < y) ? -1 : ((x > y) ? 1 : 0);
+	return (sk_flags & SK_BT_DESC) ? -compare : compare;
+}
+
+static inline int32
+compare_leading_float8(const SortTuple *a, const SortTuple *b, int sk_flags)
+{
+	float8		x,
+				y;
+	int32		compare;
+
+	if (a->isnull1 || b->isnull1)
+		return compare_leading_nulls(a, b, sk_flags);
+	x = DatumGetFloat8(a->datum1);
+	y = DatumGetFloat8(b->datum1);
+	/* as in float8_cmp_internal, NaNs are equal and larger than non-NaNs */
+	if (isnan(x))
+		compare = isnan(y) ? 0 : 1;
+	else if (isnan(y))
+		compare = -1;
+	else
+		compare = (x < y) ? -1 : ((x > y) ? 1 : 0);
+	return (sk_flags & SK_BT_DESC) ? -compare : compare;
+}
+
+static inline int
+cmp_heap_int4(const SortTuple *a, const SortTuple *b, Tuplesortstate *state)
+{
+	int32		compare;
+
+	compare = compare_leading_int4(a, b, state->scanKeys[0].sk_flags);
+	if (compare != 0 || state->nKeys == 1)
+		return compare;
+	return comparetup_heap_rest(a, b, state);
+}
+
+static inline int
+cmp_heap_int8(const SortTuple *a, const SortTuple *b, Tuplesortstate *state)
+{
+	int32		compare;
+
+	compare = compare_leading_int8(a, b, state->scanKeys[0].sk_flags);
+	if (compare != 0 || state->nKeys == 1)
+		return compare;
+	return comparetup_heap_rest(a, b, state);
+}
+
+static inline int
+cmp_heap_float8(const SortTuple *a, const SortTuple *b, Tuplesortstate *state)
+{
+	int32		compare;
+
+	compare = compare_leading_float8(a, b, state->scanKeys[0].sk_flags);
+	if (compare != 0 || state->nKeys == 1)
+		return compare;
+	return comparetup_heap_rest(a, b, state);
+}
+
+static inline int
+cmp_heap_abbrev(const SortTuple *a, const SortTuple *b, Tuplesortstate *state)
+{
+	int32		compare;
+
+	compare = inlineApplyAbbrevCompare(state->scanKeys[0].sk_flags,
+									   a->datum1, a->isnull1,
+									   b->datum1, b->isnull1);
+	if (compare != 0)
+		return compare;
+	/* equal abbreviated keys still need the first column compared */
+	return comparetup_heap_rest(a, b, state);
+}
+
+/* the same, as comparetup routines for the heap and merge code */
+static int
+comparetup_heap_int4(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state)
+{
+	CHECK_FOR_INTERRUPTS();
+	return cmp_heap_int4(a, b, state);
+}
+
+static int
+comparetup_heap_int8(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state)
+{
+	CHECK_FOR_INTERRUPTS();
+	return cmp_heap_int8(a, b, state);
+}
+
+static int
+comparetup_heap_float8(const SortTuple *a, const SortTuple *b,
+					   Tuplesortstate *state)
+{
+	CHECK_FOR_INTERRUPTS();
+	return cmp_heap_float8(a, b, state);
+}
+
+static int
+comparetup_heap_abbrev(const SortTuple *a, const SortTuple *b,
+					   Tuplesortstate *state)
+{
+	CHECK_FOR_INTERRUPTS();
+	return cmp_heap_abbrev(a, b, state);
+}
+
+/*
+ * Pick the specialized comparetup and quicksort for a heap sort,
+ * by the leading key's comparison function.  Keys of other types keep
+ * comparetup_heap, but still get the quicksort that calls it directly.
+ */
+static void
+specialize_heap_sort(Tuplesortstate *state)
+{
+	PGFunction	sortfn;
+
+	state->qsorttup = qsort_tuple_generic;
+
+	if (state->abbrevfunc != NULL)
+	{
+		state->comparetup = comparetup_heap_abbrev;
+		state->qsorttup = qsort_tuple_heap_abbrev;
+		return;
+	}
+
+	/*
+	 * Go by the C function rather than the pg_proc OID, which differs
+	 * between timestamp_cmp and timestamptz_cmp although the code is shared.
+	 */
+	sortfn = state->scanKeys[0].sk_func.fn_addr;
+	if (sortfn == btint4cmp || sortfn == date_cmp)
+	{
+		state->comparetup = comparetup_heap_int4;
+		state->qsorttup = qsort_tuple_heap_int4;
+	}
+#ifdef HAVE_INT64_TIMESTAMP
+	else if (sortfn == btint8cmp || sortfn == timestamp_cmp)
+#else
+	else if (sortfn == btint8cmp)
+#endif
+	{
+		state->comparetup = comparetup_heap_int8;
+		state->qsorttup = qsort_tuple_heap_int8;
+	}
+#ifdef HAVE_INT64_TIMESTAMP
+	else if (sortfn == btfloat8cmp)
+#else
+	else if (sortfn == btfloat8cmp || sortfn == timestamp_cmp)
+#endif
+	{
+		state->comparetup = comparetup_heap_float8;
+		state->qsorttup = qsort_tuple_heap_float8;
+	}
+}
+
+#define QS_SUFFIX	generic
+#define QS_COMPARE(a, b, state)	COMPARETUP(state, a, b)
+#include "qsort_tuple.c"
+
+#define QS_SUFFIX	heap_int4
+#define QS_COMPARE(a, b, state)	cmp_heap_int4(a, b, state)
+#include "qsort_tuple.c"
+
+#define QS_SUFFIX	heap_int8
+#define QS_COMPARE(a, b, state)	cmp_heap_int8(a, b, state)
+#include "qsort_tuple.c"
+
+#define QS_SUFFIX	heap_float8
+#define QS_COMPARE(a, b, state)	cmp_heap_float8(a, b, state)
+#include "qsort_tuple.c"
+
+#define QS_SUFFIX	heap_abbrev
+#define QS_COMPARE(a, b, state)	cmp_heap_abbrev(a, b, state)
+#include "qsort_tuple.c"
+
 
 /*
  * Routines specialized for the CLUSTER case (HeapTuple data, with
@@ -35,12 +35,15 @@
  * for minimal memory usage.  (The caller must explicitly call tuplestore_trim
  * at appropriate times for truncation to actually happen.)
  *
- * Note: in TSS_WRITEFILE state, the temp file's seek position is the
- * current write position, and the write-position variables in the tuplestore
- * aren't kept up to date.  Similarly, in TSS_READFILE state the temp file's
- * seek position is the active read pointer's position, and that read pointer
- * isn't kept up to date.  We update the appropriate variables using ftell()
- * before switching to the other state or activating a different read pointer.
+ * Tuples are written to the temp file with BufFileAppend, which keeps a
+ * separate buffer for the end of the file, so the temp file's seek position
+ * only ever serves reads and switching between reading and writing costs no
+ * I/O.  In TSS_READFILE state the temp file's seek position is the active
+ * read pointer's position, and that read pointer isn't kept up to date; in
+ * TSS_WRITEFILE state all read pointers' variables are valid.  We update the
+ * read pointer using ftell() before switching to TSS_WRITEFILE or activating
+ * a different read pointer, and remember the write position (the EOF) in
+ * writepos_xxx on switching to TSS_READFILE.
  *
  *
  * Portions Copyright (c) 1996-2011, PostgreSQL Global Development Group
@@ -97,6 +100,18 @@ typedef struct
 	off_t		offset;			/* byte offset in file */
 } TSReadPointer;
 
+/*
+ * An entry of the sparse row index over the data file: where the
+ * TS_ROWINDEX_INTERVAL * n'th tuple written to it starts.
+ */
+typedef struct
+{
+	int			file;			/* file# of the tuple */
+	off_t		offset;			/* byte offset of its length word */
+} TSRowIndexEntry;
+
+#define TS_ROWINDEX_INTERVAL	64
+
 /*
  * Private state of a Tuplestore operation.
  */
@@ -163,10 +178,10 @@ struct Tuplestorestate
 	/*
 	 * These variables are used to keep track of the current positions.
 	 *
-	 * In state WRITEFILE, the current file seek position is the write point;
-	 * in state READFILE, the write position is remembered in writepos_xxx.
-	 * (The write position is the same as EOF, but since BufFileSeek doesn't
-	 * currently implement SEEK_END, we have to remember it explicitly.)
+	 * In state WRITEFILE, the write point is the end of the temp file;
+	 * in state READFILE, it is remembered in writepos_xxx.  (The write
+	 * position is the same as EOF, but since BufFileSeek doesn't currently
+	 * implement SEEK_END, we have to remember it explicitly.)
 	 */
 	TSReadPointer *readptrs;	/* array of read pointers */
 	int			activeptr;		/* index of the active read pointer */
@@ -176,12 +191,13 @@ struct Tuplestorestate
 	int			writepos_file;	/* file# (valid if READFILE state) */
 	off_t		writepos_offset;	/* offset (valid if READFILE state) */
 
-	/* add by cywang */
-	Instrumentation	*instr_buffer_read;		/* the time cost of buffer read */
-	Instrumentation	*instr_buffer_write;	/* the time cost of buffer write */
+	/*
+	 * Timers for temp file traffic, owned by the caller (see
+	 * opt_tuplestore_set_instrument).  NULL unless EXPLAIN ANALYZE asked.
+	 */
 	Instrumentation	*instr_disk_read;		/* the time cost of disk read */
 	Instrumentation	*instr_disk_write;		/* the time cost of disk write */
-	Instrumentation	*instr_locateheadpos_io;
+	Instrumentation	*instr_locateheadpos_io;	/* disk read while locating frame head */
 	bool			in_locateheadpos;		/* flags whether we are locate the head position */
 
 //#ifdef WIN_FUN_OPT
@@ -193,12 +209,26 @@ struct Tuplestorestate
 	TupleDesc	opt_tupdesc;	/* for heap_form_minimal_tuple(desc, values, isnulls) */
 	TupleTableSlot	*init_slot;	/* used to extract attributes from a initial MinimalTuple*/
 	int			opt_maxPos;
+	Datum		*opt_values;	/* workspace to form a useful tuple, opt_tupdesc->natts entries */
+	bool		*opt_isnull;
 	TSReadPointer	*opt_readptrs;		/* read pointers for opt_file */
 	int			opt_activeptr;
 	int			opt_readptrcount;
 	int			opt_readptrsize;
 	int			opt_writepos_file;
 	off_t		opt_writepos_offset;
+	int			opt_stride;		/* on-disk size of every useful tuple so far, 0 if none yet, -1 if they differ */
+
+	/*
+	 * The optional sparse row index over the data file (opt_file
+	 * under enable_winfunopt, else myfile), see opt_tuplestore_seek_row.
+	 * Positions count the tuples put into the store, from 0.
+	 */
+	int64		tuples_put;		/* tuples put into the store so far */
+	TSRowIndexEntry *rowindex;	/* NULL if not maintained */
+	int			rowindexsize;	/* allocated length of rowindex */
+	int64		rowindex_firstrow;	/* position of the first tuple on file */
+	int64		rowindex_rows;	/* tuples written to the data file */
 
 	/* following is for initial tuple, only needed for current row, so only need forward read */
 	BufFile		*init_file;
@@ -228,6 +258,30 @@ struct Tuplestorestate
 #define USEMEM(state,amt)	((state)->availMem -= (amt))
 #define FREEMEM(state,amt)	((state)->availMem += (amt))
 
+/* timing of temp file reads and writes, skipped when not wanted */
+#define TS_INSTR_START(instr) \
+	do { if ((instr) != NULL) InstrStartNode(instr); } while (0)
+#define TS_INSTR_STOP(instr) \
+	do { if ((instr) != NULL) InstrStopNode((instr), 0); } while (0)
+#define TS_INSTR_READ_START(state) \
+	do { \
+		if ((state)->instr_disk_read != NULL && !tuplestore_in_memory(state)) \
+		{ \
+			InstrStartNode((state)->instr_disk_read); \
+			if ((state)->in_locateheadpos) \
+				TS_INSTR_START((state)->instr_locateheadpos_io); \
+		} \
+	} while (0)
+#define TS_INSTR_READ_STOP(state) \
+	do { \
+		if ((state)->instr_disk_read != NULL && !tuplestore_in_memory(state)) \
+		{ \
+			if ((state)->in_locateheadpos) \
+				TS_INSTR_STOP((state)->instr_locateheadpos_io); \
+			InstrStopNode((state)->instr_disk_read, 0); \
+		} \
+	} while (0)
+
 /*--------------------
  *
  * NOTES about on-tape representation of tuples:
@@ -299,6 +353,7 @@ static unsigned int init_getlen(Tuplestorestate *state, bool eofOK);
 static void *init_readtup_heap(Tuplestorestate *state, unsigned int len);
 static void reuse_dumptubles(Tuplestorestate *state);
 static void reuse_writetup_heap(Tuplestorestate *state, void *tup);
+static void rowindex_note(Tuplestorestate *state, BufFile *file);
 //#endif
 
 /*
@@ -382,14 +437,13 @@ tuplestore_begin_heap(bool randomAccess, bool interXact, int maxKBytes)
 	state->readtup = readtup_heap;
 
 	/* by cywang, to record the time cost */
-	state->instr_buffer_read = InstrAlloc(1,1);
-	state->instr_buffer_write = InstrAlloc(1,1);
-	state->instr_disk_read = InstrAlloc(1,1);
-	state->instr_disk_write = InstrAlloc(1,1);
-	state->instr_locateheadpos_io = InstrAlloc(1,1);
+	state->instr_disk_read = NULL;
+	state->instr_disk_write = NULL;
+	state->instr_locateheadpos_io = NULL;
 	state->in_locateheadpos = false;
 	/* for reusing buffer */
 	state->startPos = 0;
+	state->opt_stride = 0;
 
 	return state;
 }
@@ -511,6 +565,8 @@ tuplestore_clear(Tuplestorestate *state)
 	state->truncated = false;
 	state->memtupdeleted = 0;
 	state->memtupcount = 0;
+	state->tuples_put = 0;
+	state->rowindex_rows = 0;
 	readptr = state->readptrs;
 	for (i = 0; i < state->readptrcount; readptr++, i++)
 	{
@@ -537,6 +593,8 @@ tuplestore_end(Tuplestorestate *state)
 			pfree(state->memtuples[i]);
 		pfree(state->memtuples);
 	}
+	if (state->rowindex)
+		pfree(state->rowindex);
 	pfree(state->readptrs);
 	pfree(state);
 }
@@ -698,14 +756,11 @@ tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 	int			i;
 	ResourceOwner oldowner;
 
-	/* by cywang, to record the time of dumping the buffer from memory to tape */
-	Instrumentation *instr=InstrAlloc(1,1);
+	state->tuples_put++;
 
 	switch (state->status)
 	{
 		case TSS_INMEM:
-			InstrStartNode(state->instr_buffer_write);	/* to record time of buffer write*/
-
 			/*
 			 * Update read pointers as needed; see API spec above.
 			 */
@@ -746,8 +801,6 @@ tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 			/* Stash the tuple in the in-memory array */
 			state->memtuples[state->memtupcount++] = tuple;
 
-			InstrStopNode(state->instr_buffer_write, 0);
-
 			/*
 			 * Done if we still fit in available memory and have array slots.
 			 */
@@ -765,6 +818,8 @@ tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 			CurrentResourceOwner = state->resowner;
 
 			state->myfile = BufFileCreateTemp(state->interXact);
+			if (enable_tempcompress)
+				opt_BufFileCompress(state->myfile);
 
 			CurrentResourceOwner = oldowner;
 
@@ -775,24 +830,20 @@ tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 			 */
 			state->backward = (state->eflags & EXEC_FLAG_BACKWARD) != 0;
 			state->status = TSS_WRITEFILE;
-
-			InstrStartNode(instr);
-
+			state->rowindex_firstrow = state->tuples_put -
+				(state->memtupcount - state->memtupdeleted);
 
 			if(enable_reusebuffer)
 				reuse_dumptubles(state);
 			else
 				dumptuples(state);
 
-			InstrStopNode(instr, 0);
-			printf("dump memory: %f\n", INSTR_TIME_GET_DOUBLE(instr->counter));
-
 			break;
 		case TSS_WRITEFILE:
 
 			/*
 			 * Update read pointers as needed; see API spec above. Note:
-			 * BufFileTell is quite cheap, so not worth trying to avoid
+			 * BufFileTellEnd is quite cheap, so not worth trying to avoid
 			 * multiple calls.
 			 */
 			readptr = state->readptrs;
@@ -801,9 +852,9 @@ tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 				if (readptr->eof_reached && i != state->activeptr)
 				{
 					readptr->eof_reached = false;
-					BufFileTell(state->myfile,
-								&readptr->file,
-								&readptr->offset);
+					BufFileTellEnd(state->myfile,
+								   &readptr->file,
+								   &readptr->offset);
 				}
 			}
 
@@ -812,16 +863,13 @@ tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 		case TSS_READFILE:
 
 			/*
-			 * Switch from reading to writing.
+			 * Switch from reading to writing.  Appends don't move the seek
+			 * position, so only the active read pointer needs saving.
 			 */
 			if (!state->readptrs[state->activeptr].eof_reached)
 				BufFileTell(state->myfile,
 							&state->readptrs[state->activeptr].file,
 							&state->readptrs[state->activeptr].offset);
-			if (BufFileSeek(state->myfile,
-							state->writepos_file, state->writepos_offset,
-							SEEK_SET) != 0)
-				elog(ERROR, "tuplestore seek to EOF failed");
 			state->status = TSS_WRITEFILE;
 
 			/*
@@ -917,15 +965,26 @@ tuplestore_gettuple(Tuplestorestate *state, bool forward,
 				return NULL;
 
 			/*
-			 * Switch from writing to reading.
+			 * Switch from writing to reading.  The seek is free when the
+			 * read pointer is still within the file's read buffer, which is
+			 * the usual case when reading trails closely behind writing.
 			 */
-			BufFileTell(state->myfile,
-						&state->writepos_file, &state->writepos_offset);
-			if (!readptr->eof_reached)
+			BufFileTellEnd(state->myfile,
+						   &state->writepos_file, &state->writepos_offset);
+			if (readptr->eof_reached)
+			{
+				if (BufFileSeek(state->myfile,
+								state->writepos_file, state->writepos_offset,
+								SEEK_SET) != 0)
+					elog(ERROR, "tuplestore seek failed");
+			}
+			else
+			{
 				if (BufFileSeek(state->myfile,
 								readptr->file, readptr->offset,
 								SEEK_SET) != 0)
 					elog(ERROR, "tuplestore seek failed");
+			}
 
 			state->status = TSS_READFILE;
 			/* FALL THRU into READFILE case */
@@ -1034,23 +1093,11 @@ tuplestore_gettupleslot(Tuplestorestate *state, bool forward,
 	bool		should_free;
 
 	/* by cywang */
-	if(tuplestore_in_memory(state)){
-		InstrStartNode(state->instr_buffer_read);
-	}else{
-		InstrStartNode(state->instr_disk_read);
-		if(state->in_locateheadpos)
-			InstrStartNode(state->instr_locateheadpos_io);
-	}
+	TS_INSTR_READ_START(state);
 
 	tuple = (MinimalTuple) tuplestore_gettuple(state, forward, &should_free);
 
-	if(tuplestore_in_memory(state)){
-		InstrStopNode(state->instr_buffer_read, 0);
-	}else{
-		InstrStopNode(state->instr_disk_read, 0);
-		if(state->in_locateheadpos)
-			InstrStopNode(state->instr_locateheadpos_io, 0);
-	}
+	TS_INSTR_READ_STOP(state);
 
 	if (tuple)
 	{
@@ -1116,8 +1163,8 @@ dumptuples(Tuplestorestate *state)
 		for (j = 0; j < state->readptrcount; readptr++, j++)
 		{
 			if (i == readptr->current && !readptr->eof_reached)
-				BufFileTell(state->myfile,
-							&readptr->file, &readptr->offset);
+				BufFileTellEnd(state->myfile,
+							   &readptr->file, &readptr->offset);
 		}
 		if (i >= state->memtupcount)
 			break;
@@ -1408,23 +1455,25 @@ writetup_heap(Tuplestorestate *state, void *tup)
 	/* total on-disk footprint: */
 	unsigned int tuplen = tupbodylen + sizeof(int);
 
-	InstrStartNode(state->instr_disk_write);
+	TS_INSTR_START(state->instr_disk_write);
 
-	if (BufFileWrite(state->myfile, (void *) &tuplen,
-					 sizeof(tuplen)) != sizeof(tuplen))
+	rowindex_note(state, state->myfile);
+
+	if (BufFileAppend(state->myfile, (void *) &tuplen,
+					  sizeof(tuplen)) != sizeof(tuplen))
 		elog(ERROR, "write failed");
-	if (BufFileWrite(state->myfile, (void *) tupbody,
-					 tupbodylen) != (size_t) tupbodylen)
+	if (BufFileAppend(state->myfile, (void *) tupbody,
+					  tupbodylen) != (size_t) tupbodylen)
 		elog(ERROR, "write failed");
 	if (state->backward)		/* need trailing length word? */
-		if (BufFileWrite(state->myfile, (void *) &tuplen,
-						 sizeof(tuplen)) != sizeof(tuplen))
+		if (BufFileAppend(state->myfile, (void *) &tuplen,
+						  sizeof(tuplen)) != sizeof(tuplen))
 			elog(ERROR, "write failed");
 
 	FREEMEM(state, GetMemoryChunkSpace(tuple));
 	heap_free_minimal_tuple(tuple);
 
-	InstrStopNode(state->instr_disk_write, 0);
+	TS_INSTR_STOP(state->instr_disk_write);
 }
 
 static void *
@@ -1462,19 +1511,17 @@ opt_writetup_heap(Tuplestorestate *state, void *tup)
 	/* total on-disk footprint: */
 	unsigned int tuplen;
 
-	Datum		values[MAX_USEFUL_ATT_NUM];
-	bool		isnull[MAX_USEFUL_ATT_NUM];
+	Datum		*values = state->opt_values;
+	bool		*isnull = state->opt_isnull;
 	MinimalTuple	opt_tuple;
 	int			i;
 
-	InstrStartNode(state->instr_disk_write);
+	TS_INSTR_START(state->instr_disk_write);
 
 	ExecStoreMinimalTuple(tuple, slot, false);
 
 	slot_getsomeattrs(slot, state->opt_maxPos);
 
-	memset(values, 0, sizeof(values));
-	memset(isnull, 0, sizeof(isnull));
 	for(i=1; i<=state->useful2init[0]; i++){
 		values[i-1] = slot->tts_values[state->useful2init[i]-1];	/* note: elements of useful2init starts 1, while that of values starts 0 */
 		isnull[i-1] = slot->tts_isnull[state->useful2init[i]-1];
@@ -1484,14 +1531,26 @@ opt_writetup_heap(Tuplestorestate *state, void *tup)
 	tupbodylen = opt_tuple->t_len - MINIMAL_TUPLE_DATA_OFFSET;
 	tuplen = tupbodylen + sizeof(int);
 
-	if(BufFileWrite(state->opt_file, (void *)&tuplen, sizeof(tuplen)) != sizeof(tuplen))
+	rowindex_note(state, state->opt_file);
+
+	if(BufFileAppend(state->opt_file, (void *)&tuplen, sizeof(tuplen)) != sizeof(tuplen))
 		elog(ERROR, "write failed");
-	if(BufFileWrite(state->opt_file, (void *)tupbody, tupbodylen) != (size_t)tupbodylen)
+	if(BufFileAppend(state->opt_file, (void *)tupbody, tupbodylen) != (size_t)tupbodylen)
 		elog(ERROR, "write failed");
 	if(state->backward)
-		if(BufFileWrite(state->opt_file, (void *)&tuplen, sizeof(tuplen)) != sizeof(tuplen))
+		if(BufFileAppend(state->opt_file, (void *)&tuplen, sizeof(tuplen)) != sizeof(tuplen))
 			elog(ERROR, "write failed");
 
+	/* as long as all useful tuples have the same size, opt_file can be indexed by position */
+	if(state->opt_stride >= 0){
+		int		disklen = tuplen + (state->backward ? sizeof(tuplen) : 0);
+
+		if(state->opt_stride == 0)
+			state->opt_stride = disklen;
+		else if(state->opt_stride != disklen)
+			state->opt_stride = -1;
+	}
+
 	/*
 	 * for some reasons, we set here
 	 *
@@ -1502,7 +1561,7 @@ opt_writetup_heap(Tuplestorestate *state, void *tup)
 	//FREEMEM(state, GetMemoryChunkSpace(tuple));
 	heap_free_minimal_tuple(opt_tuple);
 
-	InstrStopNode(state->instr_disk_write, 0);
+	TS_INSTR_STOP(state->instr_disk_write);
 }
 
 /*
@@ -1547,8 +1606,8 @@ opt_dumptuples(Tuplestorestate *state)
 		for (j = 0; j < state->opt_readptrcount; opt_readptr++, j++)
 		{
 			if (i == opt_readptr->current && !opt_readptr->eof_reached)
-				BufFileTell(state->opt_file,
-							&opt_readptr->file, &opt_readptr->offset);
+				BufFileTellEnd(state->opt_file,
+							   &opt_readptr->file, &opt_readptr->offset);
 		}
 		if (i >= state->memtupcount)
 			break;
@@ -1562,10 +1621,14 @@ opt_dumptuples(Tuplestorestate *state)
  * set the required attributes of the buffer
  */
 void tuplestore_init_opt(Tuplestorestate *state, TupleDesc opt_tupdesc, AttrNumber *useful2init, int opt_maxPos, TupleTableSlot *slot){
+	int			natts = Max(opt_tupdesc->natts, 1);
+
 	state->opt_tupdesc = opt_tupdesc;
 	state->useful2init = useful2init;
 	state->opt_maxPos = opt_maxPos;
 	state->init_slot = slot;
+	state->opt_values = (Datum *) palloc(natts * sizeof(Datum));
+	state->opt_isnull = (bool *) palloc(natts * sizeof(bool));
 }
 
 /*
@@ -1582,7 +1645,7 @@ void init_dumptuples(Tuplestorestate *state){
 		 * before this, the init_readptr need to be set to current_ptr before it is converted in opt_dumples
 		 */
 		if(i == state->init_readptr.current && !state->init_readptr.eof_reached)
-			BufFileTell(state->init_file, &state->init_readptr.file, &state->init_readptr.offset);
+			BufFileTellEnd(state->init_file, &state->init_readptr.file, &state->init_readptr.offset);
 
 		if (i >= state->memtupcount)
 			break;
@@ -1611,13 +1674,13 @@ void init_writetup_heap(Tuplestorestate *state, void *tup){
 	/* total on-disk footprint: */
 	unsigned int tuplen = tupbodylen + sizeof(int);
 
-	InstrStartNode(state->instr_disk_write);
+	TS_INSTR_START(state->instr_disk_write);
 
-	if (BufFileWrite(state->init_file, (void *) &tuplen,
-					 sizeof(tuplen)) != sizeof(tuplen))
+	if (BufFileAppend(state->init_file, (void *) &tuplen,
+					  sizeof(tuplen)) != sizeof(tuplen))
 		elog(ERROR, "write failed");
-	if (BufFileWrite(state->init_file, (void *) tupbody,
-					 tupbodylen) != (size_t) tupbodylen)
+	if (BufFileAppend(state->init_file, (void *) tupbody,
+					  tupbodylen) != (size_t) tupbodylen)
 		elog(ERROR, "write failed");
 
 	/*
@@ -1632,7 +1695,7 @@ void init_writetup_heap(Tuplestorestate *state, void *tup){
 	FREEMEM(state, GetMemoryChunkSpace(tuple));
 	heap_free_minimal_tuple(tuple);
 
-	InstrStopNode(state->instr_disk_write, 0);
+	TS_INSTR_STOP(state->instr_disk_write);
 }
 /*
  * When in TSS_READFILE, switch to the alternative method
@@ -1706,18 +1769,16 @@ void opt_tuplestore_select_read_pointer(Tuplestorestate *state, int ptr){
  * NOTE: the opt_slot can't be null for some reasons
  */
 void tuplestore_convert_to_opt(Tuplestorestate *state, TupleTableSlot *slot, TupleTableSlot *opt_slot){
-	Datum			values[MAX_USEFUL_ATT_NUM];
-	bool			isnull[MAX_USEFUL_ATT_NUM];
+	Datum			*values = state->opt_values;
+	bool			*isnull = state->opt_isnull;
 	MinimalTuple	opt_tuple;
 	int				i;
 
 	slot_getsomeattrs(slot, state->opt_maxPos);
 
-	memset(values, 0, sizeof(values));
-	memset(isnull, 0, sizeof(isnull));
-	for(i=0; i<state->useful2init[0]; i++){
-		values[i] = slot->tts_values[state->useful2init[i]-1];	/* note: elements of useful2init starts 1, while that of values starts 0 */
-		isnull[i] = slot->tts_isnull[state->useful2init[i]-1];
+	for(i=1; i<=state->useful2init[0]; i++){
+		values[i-1] = slot->tts_values[state->useful2init[i]-1];	/* note: elements of useful2init starts 1, while that of values starts 0 */
+		isnull[i-1] = slot->tts_isnull[state->useful2init[i]-1];
 	}
 	opt_tuple = heap_form_minimal_tuple(state->opt_tupdesc, values, isnull);
 	ExecStoreMinimalTuple(opt_tuple, opt_slot, false);
@@ -1732,13 +1793,7 @@ bool opt_tuplestore_gettupleslot(Tuplestorestate *state, bool forward, bool copy
 	bool		should_free;
 
 	/* by cywang */
-	if(tuplestore_in_memory(state)){
-		InstrStartNode(state->instr_buffer_read);
-	}else{
-		InstrStartNode(state->instr_disk_read);
-		if(state->in_locateheadpos)
-			InstrStartNode(state->instr_locateheadpos_io);
-	}
+	TS_INSTR_READ_START(state);
 
 	/*
 	 * NOTE: the type of the parameter slot need to be set outside
@@ -1759,14 +1814,7 @@ bool opt_tuplestore_gettupleslot(Tuplestorestate *state, bool forward, bool copy
 	}
 	*/
 
-	if(tuplestore_in_memory(state)){
-		InstrStopNode(state->instr_buffer_read, 0);
-	}else{
-		if(state->in_locateheadpos){
-			InstrStopNode(state->instr_locateheadpos_io, 0);
-		}
-		InstrStopNode(state->instr_disk_read, 0);
-	}
+	TS_INSTR_READ_STOP(state);
 
 	if (tuple)
 	{
@@ -1823,10 +1871,14 @@ opt_tuplestore_gettuple(Tuplestorestate *state, bool forward, bool *should_free)
 			 *
 			 * NOTE: keep as close as to the original one
 			 */
-			BufFileTell(state->opt_file, &state->opt_writepos_file, &state->opt_writepos_offset);
-			if(!opt_readptr->eof_reached)
+			BufFileTellEnd(state->opt_file, &state->opt_writepos_file, &state->opt_writepos_offset);
+			if(opt_readptr->eof_reached){
+				if(BufFileSeek(state->opt_file, state->opt_writepos_file, state->opt_writepos_offset, SEEK_SET) != 0)
+					elog(ERROR, "tuplestore seek failed");
+			}else{
 				if(BufFileSeek(state->opt_file, opt_readptr->file, opt_readptr->offset, SEEK_SET) != 0)
 					elog(ERROR, "tuplestore seek failed");
+			}
 
 			state->status = TSS_READFILE;
 			/* FALL THRU into READFILE case */
@@ -1956,6 +2008,176 @@ opt_readtup_heap(Tuplestorestate *state, unsigned int len)
 	return (void *) tuple;
 }
 
+/*
+ * Move the active opt read pointer over ntuples useful tuples, backward if
+ * ntuples is negative, without reading them.
+ *
+ * This only works while every tuple in opt_file has the same size, which is
+ * what we get when the useful attributes are all fixed-width and not null;
+ * then the target is plain arithmetic on the file offset instead of a walk
+ * over the length words.  Returns false if the caller has to step instead.
+ */
+bool
+opt_tuplestore_skip(Tuplestorestate *state, int64 ntuples)
+{
+	TSReadPointer *opt_readptr;
+
+	if(!enable_winfunopt || tuplestore_in_memory(state) || state->opt_stride <= 0)
+		return false;
+
+	opt_readptr = &state->opt_readptrs[state->opt_activeptr];
+	if(opt_readptr->eof_reached)
+		return false;
+
+	switch (state->status)
+	{
+		case TSS_WRITEFILE:
+			/* switch from writing to reading, as in opt_tuplestore_gettuple */
+			BufFileTellEnd(state->opt_file, &state->opt_writepos_file, &state->opt_writepos_offset);
+			if(BufFileSeek(state->opt_file, opt_readptr->file, opt_readptr->offset, SEEK_SET) != 0)
+				elog(ERROR, "tuplestore seek failed");
+			state->status = TSS_READFILE;
+			/* FALL THRU into READFILE case */
+
+		case TSS_READFILE:
+			if(BufFileSeek(state->opt_file, 0, (off_t) (ntuples * state->opt_stride), SEEK_CUR) != 0)
+				elog(ERROR, "tuplestore seek failed");
+			break;
+
+		default:
+			elog(ERROR, "invalid tuplestore state");
+			break;
+	}
+
+	return true;
+}
+
+/*
+ * Ask the store to keep a sparse row index over its data file while
+ * writing, so that opt_tuplestore_seek_row can be used.  Must be called
+ * before any data is put.
+ */
+void
+opt_tuplestore_enable_rowindex(Tuplestorestate *state)
+{
+	Assert(state->tuples_put == 0);
+
+	state->rowindexsize = 64;
+	state->rowindex = (TSRowIndexEntry *)
+		MemoryContextAlloc(state->context,
+						   state->rowindexsize * sizeof(TSRowIndexEntry));
+	state->rowindex_rows = 0;
+}
+
+/*
+ * remember where every TS_ROWINDEX_INTERVAL'th tuple of the data file
+ * starts; called just before a tuple is appended to it
+ */
+static void
+rowindex_note(Tuplestorestate *state, BufFile *file)
+{
+	if (state->rowindex == NULL)
+		return;
+
+	if (state->rowindex_rows % TS_ROWINDEX_INTERVAL == 0)
+	{
+		int			n = (int) (state->rowindex_rows / TS_ROWINDEX_INTERVAL);
+
+		if (n >= state->rowindexsize)
+		{
+			if ((Size) (state->rowindexsize * 2) >= MaxAllocSize / sizeof(TSRowIndexEntry))
+			{
+				/* absurdly large, just stop indexing */
+				pfree(state->rowindex);
+				state->rowindex = NULL;
+				return;
+			}
+			state->rowindexsize *= 2;
+			state->rowindex = (TSRowIndexEntry *)
+				repalloc(state->rowindex,
+						 state->rowindexsize * sizeof(TSRowIndexEntry));
+		}
+		BufFileTellEnd(file, &state->rowindex[n].file, &state->rowindex[n].offset);
+	}
+	state->rowindex_rows++;
+}
+
+/*
+ * Position the active read pointer so that the next forward fetch returns
+ * the tuple at position pos, using the row index: one seek to the nearest
+ * indexed tuple at or before pos, then hops over the length words of at
+ * most TS_ROWINDEX_INTERVAL-1 tuples without reading them.
+ *
+ * nextpos is the position the next forward fetch would return now; if
+ * stepping there from nextpos is no dearer, or the store is in memory or
+ * not indexed, nothing is done and false is returned.
+ */
+bool
+opt_tuplestore_seek_row(Tuplestorestate *state, int64 pos, int64 nextpos)
+{
+	BufFile    *file;
+	TSReadPointer *readptr;
+	TSRowIndexEntry *entry;
+	int64		n;
+	int64		hops;
+
+	if (state->rowindex == NULL || state->status == TSS_INMEM)
+		return false;
+	if (pos < state->rowindex_firstrow ||
+		pos >= state->rowindex_firstrow + state->rowindex_rows)
+		return false;
+
+	n = pos - state->rowindex_firstrow;
+	hops = n % TS_ROWINDEX_INTERVAL;
+
+	/* a backward step reads two length words and a tuple */
+	if ((pos >= nextpos ? pos - nextpos : 2 * (nextpos - pos)) <= hops)
+		return false;
+
+	if (enable_winfunopt)
+	{
+		file = state->opt_file;
+		readptr = &state->opt_readptrs[state->opt_activeptr];
+	}
+	else
+	{
+		file = state->myfile;
+		readptr = &state->readptrs[state->activeptr];
+	}
+	if (file == NULL)
+		return false;
+
+	if (state->status == TSS_WRITEFILE)
+	{
+		/* switch from writing to reading, remembering where to append */
+		if (enable_winfunopt)
+			BufFileTellEnd(file, &state->opt_writepos_file, &state->opt_writepos_offset);
+		else
+			BufFileTellEnd(file, &state->writepos_file, &state->writepos_offset);
+		state->status = TSS_READFILE;
+	}
+
+	entry = &state->rowindex[n / TS_ROWINDEX_INTERVAL];
+	if (BufFileSeek(file, entry->file, entry->offset, SEEK_SET) != 0)
+		elog(ERROR, "tuplestore seek failed");
+
+	while (hops-- > 0)
+	{
+		unsigned int tuplen;
+		off_t		skip;
+
+		tuplen = enable_winfunopt ? opt_getlen(state, false) : getlen(state, false);
+		skip = tuplen - sizeof(unsigned int);
+		if (state->backward)
+			skip += sizeof(unsigned int);
+		if (BufFileSeek(file, 0, skip, SEEK_CUR) != 0)
+			elog(ERROR, "tuplestore seek failed");
+	}
+
+	readptr->eof_reached = false;
+	return true;
+}
+
 bool
 opt_tuplestore_advance(Tuplestorestate *state, bool forward)
 {
@@ -1994,15 +2216,14 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 
 //#ifdef WIN_FUN_OPT
 	TSReadPointer *opt_readptr;
-	Instrumentation *instr=InstrAlloc(1,1);
 //#endif
 
+	state->tuples_put++;
+
 	switch (state->status)
 	{
 		case TSS_INMEM:
 
-			InstrStartNode(state->instr_buffer_write);
-
 			/*
 			 * Update read pointers as needed; see API spec above.
 			 */
@@ -2043,8 +2264,6 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 			/* Stash the tuple in the in-memory array */
 			state->memtuples[state->memtupcount++] = tuple;
 
-			InstrStopNode(state->instr_buffer_write, 0);
-
 			/*
 			 * Done if we still fit in available memory and have array slots.
 			 */
@@ -2065,9 +2284,16 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 			if(enable_winfunopt){
 				state->opt_file = BufFileCreateTemp(state->interXact);
 				state->init_file = BufFileCreateTemp(state->interXact);
+				if (enable_tempcompress)
+				{
+					opt_BufFileCompress(state->opt_file);
+					opt_BufFileCompress(state->init_file);
+				}
 			}else{
 //#else
 				state->myfile = BufFileCreateTemp(state->interXact);
+				if (enable_tempcompress)
+					opt_BufFileCompress(state->myfile);
 			}
 //#endif
 
@@ -2080,9 +2306,9 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 			 */
 			state->backward = (state->eflags & EXEC_FLAG_BACKWARD) != 0;
 			state->status = TSS_WRITEFILE;
+			state->rowindex_firstrow = state->tuples_put -
+				(state->memtupcount - state->memtupdeleted);
 
-			/* add by cywang */
-			InstrStartNode(instr);
 //#ifdef WIN_FUN_OPT
 			/* we need to dump tuples to two files.
 			 * one for tuple fetch, which means we only need to keep on read pointer, and no need to fetch backward.
@@ -2096,8 +2322,6 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 				dumptuples(state);
 			}
 //#endif
-			InstrStopNode(instr, 0);
-			printf("dump memory: %f\n", INSTR_TIME_GET_DOUBLE(instr->counter));
 
 			break;
 		case TSS_WRITEFILE:
@@ -2109,7 +2333,7 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 				for(i=0; i<state->opt_readptrcount; opt_readptr++, i++){
 					if(opt_readptr->eof_reached && i!=state->opt_activeptr){
 						opt_readptr->eof_reached = false;
-						BufFileTell(state->opt_file, &opt_readptr->file, &opt_readptr->offset);
+						BufFileTellEnd(state->opt_file, &opt_readptr->file, &opt_readptr->offset);
 					}
 				}
 				opt_writetup_heap(state, tuple);
@@ -2122,16 +2346,8 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 				 */
 				if(state->init_readptr.eof_reached){
 					state->init_readptr.eof_reached = false;
-					BufFileTell(state->init_file, &state->init_readptr.file, &state->init_readptr.offset);
+					BufFileTellEnd(state->init_file, &state->init_readptr.file, &state->init_readptr.offset);
 				}
-				/*
-				 * as there is no switch of status for init_readptr,
-				 * we need to check or set before and after every read and write operation.
-				 *
-				 * commented, currently, don't cause bugs.
-				 */
-				//if(BufFileSeek(state->init_file, state->init_writepos_file, state->init_writepos_offset, SEEK_SET) != 0)
-				//	elog(ERROR, "tuplestore seek to EOF failed");
 
 				init_writetup_heap(state, tuple);
 			}else{
@@ -2147,9 +2363,9 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 					if (readptr->eof_reached && i != state->activeptr)
 					{
 						readptr->eof_reached = false;
-						BufFileTell(state->myfile,
-									&readptr->file,
-									&readptr->offset);
+						BufFileTellEnd(state->myfile,
+									   &readptr->file,
+									   &readptr->offset);
 					}
 				}
 
@@ -2163,15 +2379,12 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 			if(enable_winfunopt){
 				/*
 				 * to switch from read status to write statue,
-				 * first we need to save the active pointer that is reading,
-				 * then we need to change the BufFile's pos to the EOF,
-				 * so the appending write can happen.
+				 * we only need to save the active pointer that is reading,
+				 * appends go to the end of the files without moving their pos.
 				 */
 				//switch from reading to writing of opt_file
 				if(!state->opt_readptrs[state->opt_activeptr].eof_reached)
 					BufFileTell(state->opt_file, &state->opt_readptrs[state->opt_activeptr].file, &state->opt_readptrs[state->opt_activeptr].offset);
-				if(BufFileSeek(state->opt_file, state->opt_writepos_file, state->opt_writepos_offset, SEEK_SET) != 0)
-					elog(ERROR, "OPT: tuplestore seek to EOF failed");
 				opt_readptr = state->opt_readptrs;
 				//update opt read pointers
 				for(i=0; i<state->opt_readptrcount; opt_readptr++, i++){
@@ -2185,12 +2398,8 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 
 				if(state->init_readptr.eof_reached){
 					state->init_readptr.eof_reached = false;
-					BufFileTell(state->init_file, &state->init_readptr.file, &state->init_readptr.offset);
+					BufFileTellEnd(state->init_file, &state->init_readptr.file, &state->init_readptr.offset);
 				}
-				//TODO: to check
-				if(BufFileSeek(state->init_file, state->init_writepos_file, state->init_writepos_offset, SEEK_SET) != 0)
-					elog(ERROR, "tuplestore seek to EOF failed");
-				//init_writetup_heap(state, tuple);
 
 				state->status = TSS_WRITEFILE;
 
@@ -2203,16 +2412,13 @@ opt_tuplestore_puttuple_common(Tuplestorestate *state, void *tuple)
 			}else{
 //#else
 				/*
-				 * Switch from reading to writing.
+				 * Switch from reading to writing.  Appends don't move the
+				 * seek position, so only the active read pointer needs saving.
 				 */
 				if (!state->readptrs[state->activeptr].eof_reached)
 					BufFileTell(state->myfile,
 								&state->readptrs[state->activeptr].file,
 								&state->readptrs[state->activeptr].offset);
-				if (BufFileSeek(state->myfile,
-								state->writepos_file, state->writepos_offset,
-								SEEK_SET) != 0)
-					elog(ERROR, "tuplestore seek to EOF failed");
 
 				/*
 				 * Update read pointers as needed; see API spec above.
@@ -2283,6 +2489,10 @@ opt_tuplestore_end(Tuplestorestate *state)
 			BufFileClose(state->init_file);
 		if(state->opt_readptrs)
 			pfree(state->opt_readptrs);
+		if(state->opt_values){
+			pfree(state->opt_values);
+			pfree(state->opt_isnull);
+		}
 	}
 //#endif
 
@@ -2294,6 +2504,8 @@ opt_tuplestore_end(Tuplestorestate *state)
 			pfree(state->memtuples[i]);
 		pfree(state->memtuples);
 	}
+	if (state->rowindex)
+		pfree(state->rowindex);
 	pfree(state->readptrs);
 	pfree(state);
 }
@@ -2370,7 +2582,7 @@ init_tuplestore_gettuple(Tuplestorestate *state, bool forward,
 		return NULL;
 
 	/* eof */
-	if(readptr->file == state->writepos_file && readptr->offset==state->writepos_offset){
+	if(readptr->file == state->init_writepos_file && readptr->offset==state->init_writepos_offset){
 		readptr->eof_reached = true;
 		return NULL;
 	}
@@ -2486,27 +2698,32 @@ void init_tuplestore_select_read_pointer(Tuplestorestate *state, int ptr){
 }
 
 /*
- * output the time of loading file blocks
+ * report the temp file traffic of the store, for EXPLAIN ANALYZE
  *
  * WindowAggState can't access the attributes of Tuplestorestate directly,
  * and Tuplestorestate can't access the attributes of BufFile directly,
- * we have to give the interface here.
+ * we have to give the interface here.  The byte counts are added to
+ * *bytesRead and *bytesWritten; returns true if the store went to disk.
  */
-void opt_tuplestore_instr_BufFile(Tuplestorestate *state){
+bool opt_tuplestore_get_stats(Tuplestorestate *state, int64 *bytesRead, int64 *bytesWritten){
+	bool		spilled = false;
+
 	if(state->myfile){
-		printf("for myfile: \n");
-		opt_BufFileInstr(state->myfile);
+		opt_BufFileGetStats(state->myfile, bytesRead, bytesWritten);
+		spilled = true;
 	}
 
 	if(state->init_file){
-		printf("for init_file: \n");
-		opt_BufFileInstr(state->init_file);
+		opt_BufFileGetStats(state->init_file, bytesRead, bytesWritten);
+		spilled = true;
 	}
 
 	if(state->opt_file){
-		printf("for opt_file: \n");
-		opt_BufFileInstr(state->opt_file);
+		opt_BufFileGetStats(state->opt_file, bytesRead, bytesWritten);
+		spilled = true;
 	}
+
+	return spilled;
 }
 
 /*
@@ -2514,29 +2731,18 @@ void opt_tuplestore_instr_BufFile(Tuplestorestate *state){
  */
 void opt_tuplestore_updatewritepos(Tuplestorestate *state){
 	//BufFileTell(state->opt_file, &state->opt_writepos_file, &state->opt_writepos_offset);
-	BufFileTell(state->init_file, &state->init_writepos_file, &state->init_writepos_offset);
+	BufFileTellEnd(state->init_file, &state->init_writepos_file, &state->init_writepos_offset);
 }
 
-void opt_tuplestore_instr_TupleStore(Tuplestorestate *state){
-	/*
-	 * by cywang
-	 *
-	 * output the time cost, and reset the time's counter
-	 */
-	printf("TupleStore, buffer read: %f seconds \n", INSTR_TIME_GET_DOUBLE(state->instr_buffer_read->counter));
-	INSTR_TIME_SET_ZERO(state->instr_buffer_read->counter);
-
-	printf("TupleStore, buffer write: %f seconds \n", INSTR_TIME_GET_DOUBLE(state->instr_buffer_write->counter));
-	INSTR_TIME_SET_ZERO(state->instr_buffer_write->counter);
-
-	printf("TupleStore, disk read: %f seconds \n", INSTR_TIME_GET_DOUBLE(state->instr_disk_read->counter));
-	INSTR_TIME_SET_ZERO(state->instr_disk_read->counter);
-
-	printf("TupleStore, disk write: %f seconds \n\n", INSTR_TIME_GET_DOUBLE(state->instr_disk_write->counter));
-	INSTR_TIME_SET_ZERO(state->instr_disk_write->counter);
-
-	printf("TupleStore, IO cost in locating the frame head position: %f seconds \n", INSTR_TIME_GET_DOUBLE(state->instr_locateheadpos_io->counter));
-	INSTR_TIME_SET_ZERO(state->instr_locateheadpos_io->counter);
+/*
+ * Let the caller collect the time spent on temp file reads and writes.
+ * Any of the instruments may be NULL, in which case that part is not timed.
+ */
+void opt_tuplestore_set_instrument(Tuplestorestate *state, Instrumentation *disk_read,
+								   Instrumentation *disk_write, Instrumentation *locateheadpos_io){
+	state->instr_disk_read = disk_read;
+	state->instr_disk_write = disk_write;
+	state->instr_locateheadpos_io = locateheadpos_io;
 }
 
 /*
@@ -2708,8 +2914,8 @@ reuse_dumptubles(Tuplestorestate *state)
 		for (j = 0; j < state->readptrcount; readptr++, j++)
 		{
 			if (i == readptr->current && !readptr->eof_reached)
-				BufFileTell(state->myfile,
-							&readptr->file, &readptr->offset);
+				BufFileTellEnd(state->myfile,
+							   &readptr->file, &readptr->offset);
 		}
 
 		/* by cywang, for reusing buffer */
@@ -2718,7 +2924,7 @@ reuse_dumptubles(Tuplestorestate *state)
 			state->reuse_ptr = tuplestore_alloc_read_pointer(state, 0);
 			temp_ptr += state->reuse_ptr;
 			temp_ptr->eof_reached = false;
-			BufFileTell(state->myfile, &temp_ptr->file, &temp_ptr->offset);
+			BufFileTellEnd(state->myfile, &temp_ptr->file, &temp_ptr->offset);
 		}
 
 		if (i >= state->memtupcount)
@@ -2749,23 +2955,23 @@ reuse_writetup_heap(Tuplestorestate *state, void *tup)
 	/* total on-disk footprint: */
 	unsigned int tuplen = tupbodylen + sizeof(int);
 
-	InstrStartNode(state->instr_disk_write);
+	TS_INSTR_START(state->instr_disk_write);
 
-	if (BufFileWrite(state->myfile, (void *) &tuplen,
-					 sizeof(tuplen)) != sizeof(tuplen))
+	if (BufFileAppend(state->myfile, (void *) &tuplen,
+					  sizeof(tuplen)) != sizeof(tuplen))
 		elog(ERROR, "write failed");
-	if (BufFileWrite(state->myfile, (void *) tupbody,
-					 tupbodylen) != (size_t) tupbodylen)
+	if (BufFileAppend(state->myfile, (void *) tupbody,
+					  tupbodylen) != (size_t) tupbodylen)
 		elog(ERROR, "write failed");
 	if (state->backward)		/* need trailing length word? */
-		if (BufFileWrite(state->myfile, (void *) &tuplen,
-						 sizeof(tuplen)) != sizeof(tuplen))
+		if (BufFileAppend(state->myfile, (void *) &tuplen,
+						  sizeof(tuplen)) != sizeof(tuplen))
 			elog(ERROR, "write failed");
 
 	//FREEMEM(state, GetMemoryChunkSpace(tuple));
 	//heap_free_minimal_tuple(tuple);
 
-	InstrStopNode(state->instr_disk_write, 0);
+	TS_INSTR_STOP(state->instr_disk_write);
 }
 /*
  * concat a tuple to the buffer for reusing
@@ -2847,23 +3053,11 @@ reuse_tuplestore_gettupleslot(Tuplestorestate *state, bool forward,
 	bool		should_free;
 
 	/* by cywang */
-	if(tuplestore_in_memory(state)){
-		InstrStartNode(state->instr_buffer_read);
-	}else{
-		InstrStartNode(state->instr_disk_read);
-		if(state->in_locateheadpos)
-			InstrStartNode(state->instr_locateheadpos_io);
-	}
+	TS_INSTR_READ_START(state);
 
 	tuple = (MinimalTuple) tuplestore_gettuple(state, forward, &should_free);
 
-	if(tuplestore_in_memory(state)){
-		InstrStopNode(state->instr_buffer_read, 0);
-	}else{
-		InstrStopNode(state->instr_disk_read, 0);
-		if(state->in_locateheadpos)
-			InstrStopNode(state->instr_locateheadpos_io, 0);
-	}
+	TS_INSTR_READ_STOP(state);
 
 	if (tuple)
 	{
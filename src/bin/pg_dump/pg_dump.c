@@ -216,6 +216,9 @@ static const char *convertRegProcReference(const char *proc);
 static const char *convertOperatorReference(const char *opr);
 static const char *convertTSFunction(Oid funcOid);
 static Oid	findLastBuiltinOid_V71(const char *);
+static bool serverHasAggColumn(const char *attname);
+static bool serverHasAggInvTransfn(void);
+static bool serverHasAggCombinefn(void);
 static Oid	findLastBuiltinOid_V70(void);
 static void selectSourceSchema(const char *schemaName);
 static char *getFormattedTypeName(Oid oid, OidOptions opts);
@@ -10641,14 +10644,20 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 	int			ntups;
 	int			i_aggtransfn;
 	int			i_aggfinalfn;
+	int			i_agginvtransfn;
+	int			i_aggcombinefn;
 	int			i_aggsortop;
 	int			i_aggtranstype;
+	int			i_aggtransspace;
 	int			i_agginitval;
 	int			i_convertok;
 	const char *aggtransfn;
 	const char *aggfinalfn;
+	const char *agginvtransfn;
+	const char *aggcombinefn;
 	const char *aggsortop;
 	const char *aggtranstype;
+	const char *aggtransspace;
 	const char *agginitval;
 	bool		convertok;
 
@@ -10666,10 +10675,27 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 	selectSourceSchema(agginfo->aggfn.dobj.namespace->dobj.name);
 
 	/* Get aggregate-specific details */
-	if (g_fout->remoteVersion >= 80100)
+	if (serverHasAggInvTransfn())
 	{
 		appendPQExpBuffer(query, "SELECT aggtransfn, "
 						  "aggfinalfn, aggtranstype::pg_catalog.regtype, "
+						  "agginvtransfn, %s, aggtransspace, "
+						  "aggsortop::pg_catalog.regoperator, "
+						  "agginitval, "
+						  "'t'::boolean AS convertok "
+					  "FROM pg_catalog.pg_aggregate a, pg_catalog.pg_proc p "
+						  "WHERE a.aggfnoid = p.oid "
+						  "AND p.oid = '%u'::pg_catalog.oid",
+						  serverHasAggCombinefn() ?
+						  "aggcombinefn" : "'-' AS aggcombinefn",
+						  agginfo->aggfn.dobj.catId.oid);
+	}
+	else if (g_fout->remoteVersion >= 80100)
+	{
+		appendPQExpBuffer(query, "SELECT aggtransfn, "
+						  "aggfinalfn, aggtranstype::pg_catalog.regtype, "
+						  "'-' AS agginvtransfn, '-' AS aggcombinefn, "
+						  "0 AS aggtransspace, "
 						  "aggsortop::pg_catalog.regoperator, "
 						  "agginitval, "
 						  "'t'::boolean AS convertok "
@@ -10682,6 +10708,8 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 	{
 		appendPQExpBuffer(query, "SELECT aggtransfn, "
 						  "aggfinalfn, aggtranstype::pg_catalog.regtype, "
+						  "'-' AS agginvtransfn, '-' AS aggcombinefn, "
+						  "0 AS aggtransspace, "
 						  "0 AS aggsortop, "
 						  "agginitval, "
 						  "'t'::boolean AS convertok "
@@ -10694,6 +10722,8 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 	{
 		appendPQExpBuffer(query, "SELECT aggtransfn, aggfinalfn, "
 						  "format_type(aggtranstype, NULL) AS aggtranstype, "
+						  "'-' AS agginvtransfn, '-' AS aggcombinefn, "
+						  "0 AS aggtransspace, "
 						  "0 AS aggsortop, "
 						  "agginitval, "
 						  "'t'::boolean AS convertok "
@@ -10706,6 +10736,8 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 		appendPQExpBuffer(query, "SELECT aggtransfn1 AS aggtransfn, "
 						  "aggfinalfn, "
 						  "(SELECT typname FROM pg_type WHERE oid = aggtranstype1) AS aggtranstype, "
+						  "'-' AS agginvtransfn, '-' AS aggcombinefn, "
+						  "0 AS aggtransspace, "
 						  "0 AS aggsortop, "
 						  "agginitval1 AS agginitval, "
 						  "(aggtransfn2 = 0 and aggtranstype2 = 0 and agginitval2 is null) AS convertok "
@@ -10730,15 +10762,21 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 
 	i_aggtransfn = PQfnumber(res, "aggtransfn");
 	i_aggfinalfn = PQfnumber(res, "aggfinalfn");
+	i_agginvtransfn = PQfnumber(res, "agginvtransfn");
+	i_aggcombinefn = PQfnumber(res, "aggcombinefn");
 	i_aggsortop = PQfnumber(res, "aggsortop");
 	i_aggtranstype = PQfnumber(res, "aggtranstype");
+	i_aggtransspace = PQfnumber(res, "aggtransspace");
 	i_agginitval = PQfnumber(res, "agginitval");
 	i_convertok = PQfnumber(res, "convertok");
 
 	aggtransfn = PQgetvalue(res, 0, i_aggtransfn);
 	aggfinalfn = PQgetvalue(res, 0, i_aggfinalfn);
+	agginvtransfn = PQgetvalue(res, 0, i_agginvtransfn);
+	aggcombinefn = PQgetvalue(res, 0, i_aggcombinefn);
 	aggsortop = PQgetvalue(res, 0, i_aggsortop);
 	aggtranstype = PQgetvalue(res, 0, i_aggtranstype);
+	aggtransspace = PQgetvalue(res, 0, i_aggtransspace);
 	agginitval = PQgetvalue(res, 0, i_agginitval);
 	convertok = (PQgetvalue(res, 0, i_convertok)[0] == 't');
 
@@ -10775,6 +10813,12 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 						  fmtId(aggtranstype));
 	}
 
+	if (strcmp(aggtransspace, "0") != 0)
+	{
+		appendPQExpBuffer(details, ",\n    SSPACE = %s",
+						  aggtransspace);
+	}
+
 	if (!PQgetisnull(res, 0, i_agginitval))
 	{
 		appendPQExpBuffer(details, ",\n    INITCOND = ");
@@ -10787,6 +10831,18 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 						  aggfinalfn);
 	}
 
+	if (strcmp(agginvtransfn, "-") != 0)
+	{
+		appendPQExpBuffer(details, ",\n    INVFUNC = %s",
+						  agginvtransfn);
+	}
+
+	if (strcmp(aggcombinefn, "-") != 0)
+	{
+		appendPQExpBuffer(details, ",\n    COMBINEFUNC = %s",
+						  aggcombinefn);
+	}
+
 	aggsortop = convertOperatorReference(aggsortop);
 	if (aggsortop)
 	{
@@ -13022,6 +13078,69 @@ dumpTableConstraintComment(Archive *fout, ConstraintInfo *coninfo)
 	destroyPQExpBuffer(labelq);
 }
 
+/*
+ * serverHasAggColumn -
+ * does the source server's pg_aggregate have the named column?
+ *
+ * The window-aggregate support columns were added without a change of
+ * server version, so we have to look at the catalog itself.
+ */
+static bool
+serverHasAggColumn(const char *attname)
+{
+	PQExpBuffer query;
+	PGresult   *res;
+	bool		result;
+
+	if (g_fout->remoteVersion < 90100)
+		return false;
+
+	query = createPQExpBuffer();
+	appendPQExpBuffer(query, "SELECT 1 FROM pg_catalog.pg_attribute "
+		"WHERE attrelid = 'pg_catalog.pg_aggregate'::pg_catalog.regclass "
+					  "AND attname = '%s'", attname);
+
+	res = PQexec(g_conn, query->data);
+	check_sql_result(res, g_conn, query->data, PGRES_TUPLES_OK);
+	result = (PQntuples(res) > 0);
+	PQclear(res);
+	destroyPQExpBuffer(query);
+
+	return result;
+}
+
+/*
+ * serverHasAggInvTransfn -
+ * does the source server's pg_aggregate have agginvtransfn/aggtransspace?
+ * The answer is cached for the run.
+ */
+static bool
+serverHasAggInvTransfn(void)
+{
+	static int	hasInvTransfn = -1;
+
+	if (hasInvTransfn < 0)
+		hasInvTransfn = serverHasAggColumn("agginvtransfn") ? 1 : 0;
+
+	return hasInvTransfn != 0;
+}
+
+/*
+ * serverHasAggCombinefn -
+ * does the source server's pg_aggregate have aggcombinefn?
+ * The answer is cached for the run.
+ */
+static bool
+serverHasAggCombinefn(void)
+{
+	static int	hasCombinefn = -1;
+
+	if (hasCombinefn < 0)
+		hasCombinefn = serverHasAggColumn("aggcombinefn") ? 1 : 0;
+
+	return hasCombinefn != 0;
+}
+
 /*
  * findLastBuiltInOid -
  * find the last built in oid
@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	201105231
+#define CATALOG_VERSION_NO	201210172
 
 #endif
@@ -1250,6 +1250,10 @@ DATA(insert OID = 1219 (  int8inc		   PGNSP PGUID 12 1 0 0 f f f t f i 1 0 20 "2
 DESCR("increment");
 DATA(insert OID = 2804 (  int8inc_any	   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 20 "20 2276" _null_ _null_ _null_ _null_ int8inc_any _null_ _null_ _null_ ));
 DESCR("increment, ignores second argument");
+DATA(insert OID = 3122 (  int8dec		   PGNSP PGUID 12 1 0 0 f f f t f i 1 0 20 "20" _null_ _null_ _null_ _null_ int8dec _null_ _null_ _null_ ));
+DESCR("decrement");
+DATA(insert OID = 3123 (  int8dec_any	   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 20 "20 2276" _null_ _null_ _null_ _null_ int8dec_any _null_ _null_ _null_ ));
+DESCR("decrement, ignores second argument");
 DATA(insert OID = 1230 (  int8abs		   PGNSP PGUID 12 1 0 0 f f f t f i 1 0 20 "20" _null_ _null_ _null_ _null_ int8abs _null_ _null_ _null_ ));
 
 DATA(insert OID = 1236 (  int8larger	   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 20 "20 20" _null_ _null_ _null_ _null_ int8larger _null_ _null_ _null_ ));
@@ -2355,6 +2359,30 @@ DATA(insert OID = 1963 (  int4_avg_accum   PGNSP PGUID 12 1 0 0 f f f t f i 2 0
 DESCR("aggregate transition function");
 DATA(insert OID = 1964 (  int8_avg		   PGNSP PGUID 12 1 0 0 f f f t f i 1 0 1700 "1016" _null_ _null_ _null_ _null_ int8_avg _null_ _null_ _null_ ));
 DESCR("aggregate final function");
+DATA(insert OID = 3124 (  int2_sum_inv	   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 20 "20 21" _null_ _null_ _null_ _null_ int2_sum_inv _null_ _null_ _null_ ));
+DESCR("aggregate inverse transition function");
+DATA(insert OID = 3125 (  int4_sum_inv	   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 20 "20 23" _null_ _null_ _null_ _null_ int4_sum_inv _null_ _null_ _null_ ));
+DESCR("aggregate inverse transition function");
+DATA(insert OID = 3126 (  int8_sum_inv	   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 1700 "1700 20" _null_ _null_ _null_ _null_ int8_sum_inv _null_ _null_ _null_ ));
+DESCR("aggregate inverse transition function");
+DATA(insert OID = 3127 (  int2_avg_accum_inv   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 1016 "1016 21" _null_ _null_ _null_ _null_ int2_avg_accum_inv _null_ _null_ _null_ ));
+DESCR("aggregate inverse transition function");
+DATA(insert OID = 3128 (  int4_avg_accum_inv   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 1016 "1016 23" _null_ _null_ _null_ _null_ int4_avg_accum_inv _null_ _null_ _null_ ));
+DESCR("aggregate inverse transition function");
+DATA(insert OID = 3129 (  int8_avg_accum_inv   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 1231 "1231 20" _null_ _null_ _null_ _null_ int8_avg_accum_inv _null_ _null_ _null_ ));
+DESCR("aggregate inverse transition function");
+DATA(insert OID = 3134 (  numeric_sum_accum	   PGNSP PGUID 12 1 0 0 f f f f f i 2 0 2281 "2281 1700" _null_ _null_ _null_ _null_ numeric_sum_accum _null_ _null_ _null_ ));
+DESCR("aggregate transition function");
+DATA(insert OID = 3135 (  numeric_sum_accum_inv    PGNSP PGUID 12 1 0 0 f f f t f i 2 0 2281 "2281 1700" _null_ _null_ _null_ _null_ numeric_sum_accum_inv _null_ _null_ _null_ ));
+DESCR("aggregate inverse transition function");
+DATA(insert OID = 3136 (  numeric_sum_final    PGNSP PGUID 12 1 0 0 f f f t f i 1 0 1700 "2281" _null_ _null_ _null_ _null_ numeric_sum_final _null_ _null_ _null_ ));
+DESCR("aggregate final function");
+DATA(insert OID = 3137 (  numeric_avg_final    PGNSP PGUID 12 1 0 0 f f f t f i 1 0 1700 "2281" _null_ _null_ _null_ _null_ numeric_avg_final _null_ _null_ _null_ ));
+DESCR("aggregate final function");
+DATA(insert OID = 3138 (  int4_avg_combine	   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 1016 "1016 1016" _null_ _null_ _null_ _null_ int4_avg_combine _null_ _null_ _null_ ));
+DESCR("aggregate combine function");
+DATA(insert OID = 3139 (  float8_combine	   PGNSP PGUID 12 1 0 0 f f f t f i 2 0 1022 "1022 1022" _null_ _null_ _null_ _null_ float8_combine _null_ _null_ _null_ ));
+DESCR("aggregate combine function");
 DATA(insert OID = 2805 (  int8inc_float8_float8		PGNSP PGUID 12 1 0 0 f f f t f i 3 0 20 "20 701 701" _null_ _null_ _null_ _null_ int8inc_float8_float8 _null_ _null_ _null_ ));
 DESCR("aggregate transition function");
 DATA(insert OID = 2806 (  float8_regr_accum			PGNSP PGUID 12 1 0 0 f f f t f i 3 0 1022 "1022 701 701" _null_ _null_ _null_ _null_ float8_regr_accum _null_ _null_ _null_ ));
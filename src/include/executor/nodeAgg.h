@@ -23,6 +23,14 @@ extern void ExecReScanAgg(AggState *node);
 
 extern Size hash_agg_entry_size(int numAggs);
 
+/*
+ * A hashed Agg that runs out of work_mem writes the input of the
+ * groups it has no room for to 2^HASHAGG_SPILL_BITS temp files by hash value
+ * (see nodeAgg.c); also used by the planner's cost_hashagg_spill.
+ */
+#define HASHAGG_SPILL_BITS		5
+#define HASHAGG_SPILL_BATCHES	(1 << HASHAGG_SPILL_BITS)
+
 extern Datum aggregate_dummy(PG_FUNCTION_ARGS);
 
 #endif   /* NODEAGG_H */
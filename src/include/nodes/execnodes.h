@@ -1611,6 +1611,17 @@ typedef struct SortState
 	bool		bounded_Done;	/* value of bounded we did the sort with */
 	int64		bound_Done;		/* value of bound we did the sort with */
 	void	   *tuplesortstate; /* private state of tuplesort.c */
+	/* these are used only if the input is already sorted on leading keys */
+	bool		incremental;	/* sorting one group of the input at a time? */
+	FmgrInfo   *presortedEqfunctions;	/* equality fns for presorted keys */
+	MemoryContext tempContext;	/* short-term context for comparisons */
+	TupleTableSlot *group_pivot;	/* first tuple of the next group */
+	bool		outer_Done;		/* outer plan exhausted? */
+	bool		group_Split;	/* current sort stopped in the pivot's group? */
+	long		numGroups;		/* number of sorts of groups done so far */
+	const char *groupSortMethod;	/* stats of the sort that took most */
+	const char *groupSpaceType;		/* space, for EXPLAIN ANALYZE */
+	long		groupSpaceUsed;
 } SortState;
 
 /* ---------------------
@@ -1639,6 +1650,7 @@ typedef struct GroupState
 /* these structs are private in nodeAgg.c: */
 typedef struct AggStatePerAggData *AggStatePerAgg;
 typedef struct AggStatePerGroupData *AggStatePerGroup;
+typedef struct AggSpillStateData *AggSpillState;
 
 typedef struct AggState
 {
@@ -1660,6 +1672,14 @@ typedef struct AggState
 	List	   *hash_needed;	/* list of columns needed in hash table */
 	bool		table_filled;	/* hash table filled yet? */
 	TupleHashIterator hashiter; /* for iterating through hash table */
+	/* spilling of the hash table to temp files: */
+	AggSpillState hash_spill;	/* NULL if the table may not spill */
+	/* instrumentation of the spilling, for EXPLAIN ANALYZE */
+	long		instr_spill_batches;	/* batches written to temp files */
+	int			instr_spill_depth;	/* deepest level of repartitioning */
+	Size		instr_peak_mem;	/* peak memory of the hash table */
+	int64		instr_temp_read;	/* bytes read from the temp files */
+	int64		instr_temp_written; /* bytes written to them */
 } AggState;
 
 /* ----------------
@@ -1701,6 +1721,23 @@ typedef struct WindowAggState
 	Datum		startOffsetValue;		/* result of startOffset evaluation */
 	Datum		endOffsetValue; /* result of endOffset evaluation */
 
+	/* for RANGE with a value offset, see WindowAgg */
+	FmgrInfo	startInRangeFunc;	/* column +/- startOffsetValue */
+	FmgrInfo	endInRangeFunc; /* column +/- endOffsetValue */
+	FmgrInfo	startInRangeCmp;	/* column vs. starting bound */
+	FmgrInfo	endInRangeCmp;	/* column vs. ending bound */
+	Oid			inRangeColl;
+	bool		inRangeAsc;
+	bool		inRangeNullsFirst;
+
+	/*
+	 * Frames of the further windows the node evaluates over the same buffer
+	 * (see WindowAgg.extraWinrefs).  Each is a copy of this state with its
+	 * own frame, aggregates and working slots.
+	 */
+	int			numframes;
+	struct WindowAggState **frames;
+
 	MemoryContext partcontext;	/* context for partition-lifespan data */
 	MemoryContext aggcontext;	/* context for each aggregate data */
 	ExprContext *tmpcontext;	/* short-term evaluation context */
@@ -1726,15 +1763,21 @@ typedef struct WindowAggState
 	TupleTableSlot *temp_slot_2;
 
 
-	/* add by cywang, for timing */
-	Instrumentation	*instr_total_part;			/* the time cost during a partition */
+	/*
+	 * For EXPLAIN ANALYZE.  The timers are NULL unless the
+	 * node is instrumented; the counters are always kept.
+	 */
 	Instrumentation	*instr_locateheadpos_part;		/* the time cost in locating to a position during a partition*/
 	Instrumentation	*instr_recompute_part;	/* the time cost in recomputing for the previous tuples before current position during a partition */
-	//Instrumentation	*instr_checkinframe_part;	/* the time cost in checking whether a tuple in the frame during a partition*/
-	//Instrumentation	*instr_setmarkpos_part;		/* the time cost in WinSetMarkPosition() during a partition */
-	Instrumentation	*instr_cpu_afterspooled;				/* the time of compute except instr_locateheadpos_part */
-	Instrumentation	*instr_recompute_cpu;
-	Instrumentation	*instr_io_afterspooled;
+	Instrumentation	*instr_disk_read;		/* the time cost of temp file reads */
+	Instrumentation	*instr_disk_write;		/* the time cost of temp file writes */
+	Instrumentation	*instr_locateheadpos_io;	/* temp file reads while locating the head position */
+	long			instr_partitions;		/* number of partitions processed */
+	long			instr_spilled_partitions;	/* partitions that went to disk */
+	int64			instr_rows_recomputed;	/* rows aggregated again after the frame head moved */
+	int64			instr_temp_read;		/* bytes read from temp files */
+	int64			instr_temp_written;		/* bytes written to temp files */
+	int64			instr_rows_skipped;		/* input rows dropped by the run condition */
 
 //#ifdef WIN_FUN_OPT
 	int				opt_current_ptr;		/* the read pointer for partition read, like the current_ptr in WindowAggState*/
@@ -1758,8 +1801,53 @@ typedef struct WindowAggState
 //#endif
 
 	/* add by cywang, for reducing recompute */
-	int			opt_tempTransValue_num;
+	bool		opt_use_recompute;	/* keep temporary transition values */
+	int			opt_tempTransValue_num;	/* in use for current partition */
+	int			opt_tempTransValue_max;	/* allocated */
 	int			opt_active_tempTransValue;
+	int64		opt_recompute_spacing;	/* rows between their start rows */
+	int64		opt_recompute_framesize;	/* frame size tuned for, 0 if none */
+	bool		opt_recompute_spilled;	/* buffer was on disk when tuned */
+	double		opt_recompute_transcost;	/* cost of one row's transitions */
+
+	/* true if rows leaving the frame are removed by inverse transition */
+	bool		opt_use_invtrans;
+
+	/*
+	 * segment tree of combined transition states, for moving frames whose
+	 * aggregates have a combine function but no inverse
+	 */
+	bool		opt_use_segtree;
+	bool		opt_segtree_built;	/* tree is built for current partition */
+	int64		opt_segtree_blocksize;	/* rows per leaf */
+	int64		opt_segtree_nleaves;	/* leaves holding partition rows */
+	int64		opt_segtree_size;	/* leaves incl. padding, a power of 2 */
+	bool		opt_segtree_ring;	/* leaves are reused as the frame moves */
+	int64		opt_segtree_ringupto;	/* rows before this are in the ring */
+	bool	   *opt_segtree_empty;	/* nodes covering only padding */
+	struct WindowObjectData *opt_segtree_winobj;	/* reads the frame tail */
+
+	/*
+	 * the row in tmpcontext->ecxt_outertuple when aggregate arguments are
+	 * evaluated, -1 if unknown, and the space the aggregates' column buffers
+	 * take in this partition
+	 */
+	int64		opt_argpos;
+	int64		opt_argepoch;	/* bumped with each new row there */
+	Size		opt_colspace;
+	bool		opt_use_batch;	/* all aggregates can advance in runs */
+	bool		opt_use_argring;	/* some function has an argument ring */
+
+	/*
+	 * aggregates of the frame that keep no transition value of their own,
+	 * but are finalized from one in peragg
+	 */
+	WindowStatePerAgg opt_shareagg;
+	int			opt_numshareaggs;
+
+	/* the function of the run condition, or NULL, and its largest value */
+	WindowStatePerFunc opt_runfunc;
+	int64		opt_runlimit;
 } WindowAggState;
 
 /* ----------------
@@ -856,6 +856,18 @@ typedef struct WindowClause
 	Node	   *endOffset;		/* expression for ending bound, if any */
 	Index		winref;			/* ID referenced by window functions */
 	bool		copiedOrder;	/* did we copy orderClause from refname? */
+	Oid			runFnOid;		/* row_number/rank/dense_rank bounded by an
+								 * upper qual, or InvalidOid */
+	int			runLimit;		/* its largest value that can pass the qual */
+	/* for RANGE with a value offset: */
+	Oid			startInRangeFunc;	/* + or - of the column and startOffset */
+	Oid			endInRangeFunc; /* + or - of the column and endOffset */
+	Oid			startInRangeCmp;	/* btree comparison of the column with
+									 * the starting bound */
+	Oid			endInRangeCmp;	/* ... and with the ending bound */
+	Oid			inRangeColl;	/* collation of the ordering column */
+	bool		inRangeAsc;		/* is the ordering ascending? */
+	bool		inRangeNullsFirst;	/* do nulls sort first? */
 } WindowClause;
 
 /*
@@ -559,6 +559,8 @@ typedef struct Sort
 	Oid		   *sortOperators;	/* OIDs of operators to sort them by */
 	Oid		   *collations;		/* OIDs of collations */
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
+	int			numPresorted;	/* number of leading sort-key columns the
+								 * input is already sorted by */
 } Sort;
 
 /* ---------------
@@ -624,8 +626,39 @@ typedef struct WindowAgg
 	Node	   *startOffset;	/* expression for starting bound, if any */
 	Node	   *endOffset;		/* expression for ending bound, if any */
 
+	/*
+	 * Further windows with the same partitioning, evaluated over the same
+	 * buffer.  Each one's ordering is the first extraOrdNumCols of the
+	 * ordering columns above.  The lists run in parallel.
+	 */
+	List	   *extraWinrefs;	/* IDs referenced by their window functions */
+	List	   *extraOrdNumCols;	/* their numbers of ordering columns */
+	List	   *extraFrameOptions;	/* their frame_clause options */
+	List	   *extraStartOffsets;	/* their starting bound expressions */
+	List	   *extraEndOffsets;	/* their ending bound expressions */
+
+	/*
+	 * Run condition: once the runFnOid function of window runWinref exceeds
+	 * runLimit, the rest of the partition is skipped.  Only the topmost
+	 * WindowAgg below the qual that bounds the function gets one.
+	 */
+	Oid			runFnOid;		/* row_number/rank/dense_rank, or InvalidOid */
+	Index		runWinref;		/* ID of its window */
+	int			runLimit;		/* its largest value passing the qual */
+
+	/* for RANGE with a value offset, as in WindowClause */
+	Oid			startInRangeFunc;
+	Oid			endInRangeFunc;
+	Oid			startInRangeCmp;
+	Oid			endInRangeCmp;
+	Oid			inRangeColl;
+	bool		inRangeAsc;
+	bool		inRangeNullsFirst;
+
 	/* add by cywang */
 //#ifdef WIN_FUN_OPT
+	int			spillNumCols;	/* number of columns kept in a spilled partition */
+	AttrNumber *spillColIdx;	/* their indexes in the input tuple, set by setrefs.c */
 	AttrNumber *opt_ordColIdx;	/* order by indexes in the useful attributes */
 //#endif
 } WindowAgg;
@@ -30,6 +30,9 @@
 
 typedef struct BufFile BufFile;
 
+/* GUC variable */
+extern bool enable_tempcompress;
+
 /*
  * prototypes for functions in buffile.c
  */
@@ -38,14 +41,19 @@ extern BufFile *BufFileCreateTemp(bool interXact);
 extern void BufFileClose(BufFile *file);
 extern size_t BufFileRead(BufFile *file, void *ptr, size_t size);
 extern size_t BufFileWrite(BufFile *file, void *ptr, size_t size);
+extern size_t BufFileAppend(BufFile *file, void *ptr, size_t size);
 extern int	BufFileSeek(BufFile *file, int fileno, off_t offset, int whence);
 extern void BufFileTell(BufFile *file, int *fileno, off_t *offset);
+extern void BufFileTellEnd(BufFile *file, int *fileno, off_t *offset);
 extern int	BufFileSeekBlock(BufFile *file, long blknum);
 
 
 //#ifdef WIN_FUN_OPT
 extern int opt_BufFileGetFile(BufFile *file);
 extern off_t opt_BufFileGetOffset(BufFile *file);
-extern void	opt_BufFileInstr(BufFile *file);
+extern void	opt_BufFileGetStats(BufFile *file, int64 *bytesRead,
+					int64 *bytesWritten);
+extern void opt_BufFileCompress(BufFile *file);
+extern void opt_BufFilePrefetchBlock(BufFile *file, long blknum);
 //#endif
 #endif   /* BUFFILE_H */
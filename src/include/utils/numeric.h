@@ -58,5 +58,10 @@ typedef struct NumericData *Numeric;
 extern bool numeric_is_nan(Numeric num);
 int32		numeric_maximum_size(int32 typmod);
 extern char *numeric_out_sci(Numeric num, int scale);
+extern Datum numeric_abbrev(Datum original);
+extern Numeric numeric_add_opt_error(Numeric num1, Numeric num2,
+					  bool *have_error);
+extern Numeric numeric_sub_opt_error(Numeric num1, Numeric num2,
+					  bool *have_error);
 
 #endif   /* _PG_NUMERIC_H_ */
@@ -348,6 +348,11 @@ extern void GetEpochTime(struct pg_tm * tm);
 
 extern int	timestamp_cmp_internal(Timestamp dt1, Timestamp dt2);
 
+extern bool timestamp_add_interval(Timestamp timestamp, Interval *span,
+					   Timestamp *result);
+extern bool timestamptz_add_interval(TimestampTz timestamp, Interval *span,
+						 TimestampTz *result);
+
 /* timestamp comparison works for timestamptz also */
 #define timestamptz_cmp_internal(dt1,dt2)	timestamp_cmp_internal(dt1, dt2)
 
@@ -31,6 +31,12 @@
  */
 typedef struct Tuplesortstate Tuplesortstate;
 
+/* sort on abbreviated keys where the leading key allows it */
+extern bool enable_abbrevkeys;
+/* quicksort heap tuples with comparators specialized by key type */
+extern bool enable_inlinesort;
+extern bool enable_quicksortruns;
+
 /*
  * We provide multiple interfaces to what is essentially the same code,
  * since different callers have different data to be sorted and want to
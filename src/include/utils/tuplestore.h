@@ -31,6 +31,7 @@
 #ifndef TUPLESTORE_H
 #define TUPLESTORE_H
 
+#include "executor/instrument.h"
 #include "executor/tuptable.h"
 
 //#ifdef WIN_FUN_OPT
@@ -50,12 +51,16 @@ extern void opt_tuplestore_select_read_pointer(Tuplestorestate *state, int ptr);
 extern void tuplestore_convert_to_opt(Tuplestorestate *state, TupleTableSlot *slot, TupleTableSlot *opt_slot);
 extern bool opt_tuplestore_gettupleslot(Tuplestorestate *state, bool forward, bool copy, TupleTableSlot *slot);
 extern bool opt_tuplestore_advance(Tuplestorestate *state, bool forward);
+extern bool opt_tuplestore_skip(Tuplestorestate *state, int64 ntuples);
+extern void opt_tuplestore_enable_rowindex(Tuplestorestate *state);
+extern bool opt_tuplestore_seek_row(Tuplestorestate *state, int64 pos, int64 nextpos);
 extern void opt_tuplestore_puttupleslot(Tuplestorestate *state, TupleTableSlot *slot);
 extern void opt_tuplestore_end(Tuplestorestate *state);
 extern bool init_tuplestore_gettupleslot(Tuplestorestate *state, bool forward, bool copy, TupleTableSlot *slot);
 extern void init_tuplestore_select_read_pointer(Tuplestorestate *state, int ptr);
-extern void opt_tuplestore_instr_BufFile(Tuplestorestate *state);
-extern void opt_tuplestore_instr_TupleStore(Tuplestorestate *state);
+extern bool opt_tuplestore_get_stats(Tuplestorestate *state, int64 *bytesRead, int64 *bytesWritten);
+extern void opt_tuplestore_set_instrument(Tuplestorestate *state, Instrumentation *disk_read,
+								   Instrumentation *disk_write, Instrumentation *locateheadpos_io);
 extern void opt_tuplestore_updatewritepos(Tuplestorestate *state);
 extern void opt_tuplestore_set_locateheadpos(Tuplestorestate *state, bool flag);
 extern void opt_tuplestore_copy_frameheadptr(Tuplestorestate *state);
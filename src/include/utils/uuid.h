@@ -26,4 +26,7 @@ typedef struct pg_uuid_t pg_uuid_t;
 #define DatumGetUUIDP(X)		((pg_uuid_t *) DatumGetPointer(X))
 #define PG_GETARG_UUID_P(X)		DatumGetUUIDP(PG_GETARG_DATUM(X))
 
+/* abbreviated sort key */
+extern Datum uuid_abbrev(Datum original);
+
 #endif   /* UUID_H */
@@ -74,7 +74,11 @@ extern bool enable_winfunopt;
 extern bool enable_locate;
 extern bool	enable_recompute;
 extern bool enable_reusebuffer;
-extern int	recompute_k;
-extern int	recompute_num;
+extern bool enable_inversetrans;
+extern bool enable_segtree;
+extern bool enable_columnbuffer;
+extern bool enable_batchadvance;
+extern bool enable_argring;
+extern bool enable_aggshare;
 
 #endif   /* WINDOWAPI_H */
@@ -416,3 +416,36 @@ select string_agg(distinct f1, ',' order by f1) from varchar_tbl;  -- ok
 select string_agg(distinct f1::text, ',' order by f1) from varchar_tbl;  -- not ok
 select string_agg(distinct f1, ',' order by f1::text) from varchar_tbl;  -- not ok
 select string_agg(distinct f1::text, ',' order by f1::text) from varchar_tbl;  -- ok
+
+-- hashed aggregation spills the groups that don't fit in work_mem
+set work_mem = 64;
+explain (costs off)
+select case when unique1 < 3000 then unique1 else unique1 % 1000 end as g,
+       count(*), sum(unique2), max(stringu1)
+  from tenk1 group by 1;
+create temp table hagg_small as
+select case when unique1 < 3000 then unique1 else unique1 % 1000 end as g,
+       count(*) as c, sum(unique2) as s, max(stringu1) as m
+  from tenk1 group by 1;
+explain (costs off)
+select distinct unique1 % 3000, unique2 % 2 from tenk1;
+create temp table hdist_small as
+select distinct unique1 % 3000 as a, unique2 % 2 as b from tenk1;
+reset work_mem;
+create temp table hagg_default as
+select case when unique1 < 3000 then unique1 else unique1 % 1000 end as g,
+       count(*) as c, sum(unique2) as s, max(stringu1) as m
+  from tenk1 group by 1;
+select c, count(*) from hagg_small group by c order by c;
+select * from hagg_small where g in (0, 999, 1000, 2999) order by g;
+select count(*) as groups,
+       sum(case when (a.c, a.s, a.m) is distinct from (b.c, b.s, b.m)
+           then 1 else 0 end) as mismatched
+  from hagg_small a full join hagg_default b using (g);
+select count(*) as pairs, count(distinct a) as firsts,
+       (select count(*) from (select * from hdist_small
+                              intersect
+                              select distinct unique1 % 3000, unique2 % 2
+                                from tenk1) ss) as matched
+  from hdist_small;
+drop table hagg_small, hagg_default, hdist_small;
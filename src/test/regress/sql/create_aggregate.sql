@@ -71,3 +71,84 @@ create aggregate aggfns(integer,integer,text) (
    sfunc = aggfns_trans, stype = aggtype[],
    initcond = '{}'
 );
+
+-- aggregates with an inverse transition function, for moving window frames;
+-- a non-strict transfn sees the null inputs, so its inverse must see them too
+create function cntnull_trans(int8, int4) returns int8 as
+'select $1 + case when $2 is null then 1 else 0 end' language sql immutable;
+
+create function cntnull_inv(int8, int4) returns int8 as
+'select $1 - case when $2 is null then 1 else 0 end' language sql immutable;
+
+create aggregate cntnull(int4) (
+   sfunc = cntnull_trans, invfunc = cntnull_inv, stype = int8,
+   initcond = '0'
+);
+
+select i, x, cntnull(x) over w, count(*) over w
+from (values (1, 1), (2, null), (3, null), (4, 5), (5, 6)) v(i, x)
+window w as (order by i rows 1 preceding);
+
+-- a non-strict transfn that ignores the null inputs may have a strict
+-- inverse, which skips them on the way out
+create function msum_trans(int8, int4) returns int8 as
+'select case when $2 is null then $1 else coalesce($1, 0) + $2 end'
+language sql immutable;
+
+create function msum_inv(int8, int4) returns int8 as
+'select $1 - $2' language sql strict immutable;
+
+create aggregate msum(int4) (
+   sfunc = msum_trans, invfunc = msum_inv, stype = int8
+);
+
+select i, x, msum(x) over w, sum(x) over w
+from (values (1, null), (2, 1), (3, null), (4, 5), (5, null), (6, null)) v(i, x)
+window w as (order by i rows 1 preceding);
+
+-- fail: the inverse of a strict transfn must be strict too
+create aggregate cntnull_bad(int4) (
+   sfunc = int84pl, invfunc = cntnull_inv, stype = int8,
+   initcond = '0'
+);
+
+select aggfnoid, agginvtransfn, aggcombinefn from pg_aggregate
+where aggfnoid = 'cntnull'::regproc;
+
+-- the inverse can't be dropped out from under the aggregate
+drop function cntnull_inv(int8, int4);
+
+-- fail: no such inverse
+create aggregate cntnull_bad(int4) (
+   sfunc = cntnull_trans, invfunc = nosuchfunc, stype = int8,
+   initcond = '0'
+);
+
+-- fail: the inverse must return the transition type
+create aggregate cntnull_bad(int4) (
+   sfunc = cntnull_trans, invfunc = int84lt, stype = int8,
+   initcond = '0'
+);
+
+-- aggregates with a combine function, which merges two transition states
+create aggregate isum(int4) (
+   sfunc = int4pl, combinefunc = int4pl, stype = int4
+);
+
+select aggfnoid, agginvtransfn, aggcombinefn from pg_aggregate
+where aggfnoid = 'isum'::regproc;
+
+-- moving frames are answered from partial sums, which must skip the nulls
+select i, x, isum(x) over w, count(x) over w
+from (values (1, 1), (2, null), (3, 3), (4, null), (5, null), (6, 6)) v(i, x)
+window w as (order by i rows between 1 preceding and 1 following);
+
+-- fail: no combine function taking (int4, int4)
+create aggregate isum_bad(int4) (
+   sfunc = int4pl, combinefunc = int84pl, stype = int4
+);
+
+-- fail: the combine function must return the transition type
+create aggregate isum_bad(int8) (
+   sfunc = int8pl, combinefunc = int8lt, stype = int8
+);
@@ -608,6 +608,30 @@ WHERE a.aggfnoid = p.oid AND
      OR pfn.pronargs != 1
      OR NOT binary_coercible(a.aggtranstype, pfn.proargtypes[0]));
 
+-- Cross-check invtransfn (if present) against its entry in pg_proc.
+-- It must take the same arguments as transfn and return the transtype.
+
+SELECT a.aggfnoid::oid, ptr.proname, pinv.oid, pinv.proname
+FROM pg_aggregate AS a, pg_proc AS ptr, pg_proc AS pinv
+WHERE a.aggtransfn = ptr.oid AND
+    a.agginvtransfn = pinv.oid AND
+    (pinv.proretset
+     OR pinv.proargtypes != ptr.proargtypes
+     OR NOT physically_coercible(pinv.prorettype, a.aggtranstype)
+     OR a.aggtransspace < 0);
+
+-- Cross-check combinefn (if present) against its entry in pg_proc.
+-- It must take two transtype arguments and return the transtype.
+
+SELECT a.aggfnoid::oid, pc.oid, pc.proname
+FROM pg_aggregate AS a, pg_proc AS pc
+WHERE a.aggcombinefn = pc.oid AND
+    (pc.proretset
+     OR pc.pronargs != 2
+     OR NOT physically_coercible(pc.prorettype, a.aggtranstype)
+     OR NOT physically_coercible(a.aggtranstype, pc.proargtypes[0])
+     OR NOT physically_coercible(a.aggtranstype, pc.proargtypes[1]));
+
 -- If transfn is strict then either initval should be non-NULL, or
 -- input type should match transtype so that the first non-null input
 -- can be assigned as the state value.
@@ -0,0 +1,156 @@
+--
+-- TUPLESORT
+--
+
+-- sorts and tuplestores spilled to compressed temp files read back the same
+-- rows
+SET work_mem = 64;
+SET enable_tempcompress = on;
+SELECT rn, stringu1, unique1 FROM
+	(SELECT stringu1, unique1,
+		row_number() over (order by stringu1 DESC, unique1) AS rn
+	 FROM tenk1) ss
+WHERE rn IN (1, 2, 3, 5000, 5001, 9999, 10000)
+ORDER BY rn;
+BEGIN;
+DECLARE c SCROLL CURSOR FOR
+	SELECT stringu1, unique1 FROM tenk1 ORDER BY stringu1 DESC, unique1;
+FETCH LAST FROM c;
+FETCH BACKWARD 2 FROM c;
+FETCH ABSOLUTE 5000 FROM c;
+FETCH FIRST FROM c;
+COMMIT;
+SELECT * FROM
+	(SELECT unique1, sum(length(pad)) over w AS padlen,
+		first_value(unique1) over w, lag(unique2, 150) over w
+	 FROM (SELECT *, repeat('x', unique1 % 37) AS pad FROM tenk1) t
+	 WINDOW w AS (partition by four order by unique2
+				  rows between 300 preceding and 300 following)) ss
+WHERE unique1 % 1000 = 0
+ORDER BY unique1;
+RESET enable_tempcompress;
+RESET work_mem;
+
+-- sorts on text, numeric and uuid compare abbreviated keys first; values
+-- with equal abbreviated keys are still ordered by the full comparison
+SELECT i, n FROM
+	(VALUES (1, 1.0), (2, 'NaN'), (3, 1), (4, NULL), (5, 1.00), (6, -0.000),
+		(7, 0), (8, 12345678901234.5), (9, 12345678901234.4),
+		(10, -12345678901234.5), (11, -12345678901234.4), (12, 'NaN'),
+		(13, NULL), (14, 1e-20), (15, -1e-20), (16, 0.000000000000000000010)) v(i, n)
+ORDER BY n, i;
+SELECT i, n FROM
+	(VALUES (1, 1.0), (2, 'NaN'), (3, 1), (4, NULL), (5, 1.00), (6, -0.000),
+		(7, 0), (8, 12345678901234.5), (9, 12345678901234.4),
+		(10, -12345678901234.5), (11, -12345678901234.4), (12, 'NaN'),
+		(13, NULL), (14, 1e-20), (15, -1e-20), (16, 0.000000000000000000010)) v(i, n)
+ORDER BY n DESC NULLS LAST, i DESC;
+-- weights too large for the key all share one
+SELECT i, length(n::text) AS len, left(n::text, 3) AS lead, right(n::text, 3) AS tail FROM
+	(SELECT i, (d || repeat('0', z) || e)::numeric AS n FROM
+		(VALUES (1, '2', 70000, ''), (2, '1', 70000, ''), (3, '-1', 70000, ''),
+			(4, '1', 69999, '1'), (5, '-2', 70000, ''), (6, '1', 70000, ''),
+			(7, '-1', 69999, '1')) v(i, d, z, e)) ss
+ORDER BY n, i;
+SELECT i, t FROM
+	(VALUES (1, 'abcdefgh'), (2, 'abcdefghb'), (3, 'abcdefgha'), (4, 'abcdefgh'),
+		(5, NULL), (6, 'abcdefg'), (7, ''), (8, 'ABCDEFGHIJ'), (9, 'abcdefgi'),
+		(10, 'abcdefgh'), (11, NULL), (12, 'abcdefg ')) v(i, t)
+ORDER BY t COLLATE "C" NULLS FIRST, i;
+SELECT i, t FROM
+	(VALUES (1, 'abcdefgh'), (2, 'abcdefghb'), (3, 'abcdefgha'), (4, 'abcdefgh'),
+		(5, NULL), (6, 'abcdefg'), (7, ''), (8, 'ABCDEFGHIJ'), (9, 'abcdefgi'),
+		(10, 'abcdefgh'), (11, NULL), (12, 'abcdefg ')) v(i, t)
+ORDER BY t COLLATE "POSIX" DESC NULLS LAST, i;
+SELECT i, u FROM
+	(VALUES (1, 'a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a12'::uuid),
+		(2, 'a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11'), (3, NULL),
+		(4, 'a0eebc99-9c0b-4ef8-0000-000000000000'),
+		(5, 'a0eebc99-9c0b-4ef7-ffff-ffffffffffff'),
+		(6, 'a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a12'),
+		(7, '00000000-0000-0000-0000-000000000000')) v(i, u)
+ORDER BY u, i;
+-- abbreviated keys are made again as a spilled sort reads its runs back
+SET work_mem = 64;
+SELECT rn, t, unique1 FROM
+	(SELECT t, unique1, row_number() over (order by t COLLATE "C", unique1 DESC) AS rn
+	 FROM (SELECT unique1, CASE WHEN ten < 5 THEN 'prefix__' ELSE '' END
+			|| stringu1 AS t FROM tenk1) t) ss
+WHERE rn IN (1, 2, 3, 4999, 5000, 5001, 5002, 9999, 10000)
+ORDER BY rn;
+RESET work_mem;
+
+-- quicksorts specialized for int4, int8, float8, date and timestamp leading
+-- keys order as the generic one does, and pass ties to the other keys
+SELECT i, a FROM
+	(VALUES (1, 0), (2, -2147483648), (3, 2147483647), (4, NULL), (5, -1),
+		(6, 0), (7, 2147483647), (8, NULL), (9, 1), (10, -2147483648)) v(i, a)
+ORDER BY a, i DESC;
+SELECT a FROM
+	(VALUES (0), (-2147483648), (2147483647), (NULL), (-1), (1), (NULL)) v(a)
+ORDER BY a DESC NULLS LAST;
+SELECT i, b FROM
+	(VALUES (1, 0::int8), (2, -9223372036854775808), (3, 9223372036854775807),
+		(4, NULL), (5, -1), (6, 4294967296), (7, 9223372036854775807),
+		(8, -4294967296), (9, 0)) v(i, b)
+ORDER BY b NULLS FIRST, i;
+SELECT i, f FROM
+	(VALUES (1, 0::float8), (2, 'NaN'), (3, '-0'), (4, 'Infinity'), (5, NULL),
+		(6, '-Infinity'), (7, 'NaN'), (8, 1e-300), (9, -1e300), (10, 0),
+		(11, 'Infinity')) v(i, f)
+ORDER BY f, i;
+SELECT i, f FROM
+	(VALUES (1, 0::float8), (2, 'NaN'), (3, '-0'), (4, 'Infinity'), (5, NULL),
+		(6, '-Infinity'), (7, 'NaN'), (8, 1e-300), (9, -1e300), (10, 0),
+		(11, 'Infinity')) v(i, f)
+ORDER BY f DESC NULLS LAST, i;
+SELECT i, d, ts FROM
+	(VALUES (1, '2000-01-01'::date, '2000-01-01 00:00'::timestamp),
+		(2, 'infinity', 'infinity'), (3, '-infinity', '-infinity'),
+		(4, NULL, NULL), (5, '1999-12-31', '1999-12-31 23:59:59.999999'),
+		(6, '2000-01-01', '2000-01-01 00:00:00.000001'),
+		(7, '4713-01-01 BC', '4713-01-01 00:00 BC'),
+		(8, '2000-01-01', '2000-01-01 00:00')) v(i, d, ts)
+ORDER BY d, ts DESC, i;
+SELECT i, d, ts FROM
+	(VALUES (1, '2000-01-01'::date, '2000-01-01 00:00'::timestamp),
+		(2, 'infinity', 'infinity'), (3, '-infinity', '-infinity'),
+		(4, NULL, NULL), (5, '1999-12-31', '1999-12-31 23:59:59.999999'),
+		(6, '2000-01-01', '2000-01-01 00:00:00.000001'),
+		(7, '4713-01-01 BC', '4713-01-01 00:00 BC'),
+		(8, '2000-01-01', '2000-01-01 00:00')) v(i, d, ts)
+ORDER BY ts NULLS FIRST, i DESC;
+
+-- external sorts whose runs are built by quicksort and by replacement
+-- selection give the same order
+SET work_mem = 64;
+SELECT rn, h, unique2 FROM
+	(SELECT nullif(hundred, 7) AS h, unique2,
+		row_number() over (order by nullif(hundred, 7) nulls first, unique2 desc) AS rn
+	 FROM tenk1) ss
+WHERE rn IN (1, 2, 100, 101, 102, 5000, 9999, 10000)
+ORDER BY rn;
+SELECT rn, k, i FROM
+	(SELECT k, i, row_number() over (order by k desc, i) AS rn
+	 FROM (SELECT i, (i * 7919) % 1009 AS k FROM generate_series(1, 50000) i) t) ss
+WHERE rn IN (1, 2, 49, 50, 25000, 49999, 50000)
+ORDER BY rn;
+SELECT count(*) AS rows,
+	sum(CASE WHEN pk < k OR (pk = k AND pi > i) THEN 1 ELSE 0 END) AS out_of_order
+FROM (SELECT k, i, lag(k) over w AS pk, lag(i) over w AS pi
+	  FROM (SELECT i, (i * 7919) % 1009 AS k FROM generate_series(1, 50000) i) t
+	  WINDOW w AS (order by k desc, i)) ss;
+SET enable_quicksortruns = off;
+SELECT rn, h, unique2 FROM
+	(SELECT nullif(hundred, 7) AS h, unique2,
+		row_number() over (order by nullif(hundred, 7) nulls first, unique2 desc) AS rn
+	 FROM tenk1) ss
+WHERE rn IN (1, 2, 100, 101, 102, 5000, 9999, 10000)
+ORDER BY rn;
+SELECT count(*) AS rows,
+	sum(CASE WHEN pk < k OR (pk = k AND pi > i) THEN 1 ELSE 0 END) AS out_of_order
+FROM (SELECT k, i, lag(k) over w AS pk, lag(i) over w AS pi
+	  FROM (SELECT i, (i * 7919) % 1009 AS k FROM generate_series(1, 50000) i) t
+	  WINDOW w AS (order by k desc, i)) ss;
+RESET enable_quicksortruns;
+RESET work_mem;
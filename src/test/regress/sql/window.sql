@@ -199,11 +199,117 @@ SELECT sum(unique1) over (w range between current row and unbounded following),
 	unique1, four
 FROM tenk1 WHERE unique1 < 10 WINDOW w AS (order by four);
 
--- fail: not implemented yet
+-- RANGE with value offsets
 SELECT sum(unique1) over (order by four range between 2::int8 preceding and 1::int2 preceding),
 	unique1, four
 FROM tenk1 WHERE unique1 < 10;
 
+SELECT sum(unique1) over (order by four desc range between 2::int8 preceding and 1::int2 preceding),
+	unique1, four
+FROM tenk1 WHERE unique1 < 10;
+
+SELECT sum(unique1) over (partition by four order by unique1 range between 5 preceding and 6 following),
+	unique1, four
+FROM tenk1 WHERE unique1 < 10;
+
+SELECT first_value(unique1) over w, last_value(unique1) over w, count(*) over w,
+	unique1, four
+FROM tenk1 WHERE unique1 < 10
+WINDOW w AS (order by unique1 % 3 range between current row and 1 following);
+
+SELECT x, sum(x) over (order by x range between 2 preceding and 1 following),
+	count(*) over (order by x range between 1 following and 3 following),
+	first_value(x) over w, last_value(x) over w
+FROM (VALUES (1), (2), (2), (4), (5), (9), (NULL), (10)) v(x)
+WINDOW w AS (order by x desc nulls first range between 3 preceding and current row);
+
+SELECT x, sum(x) over (order by x range between 1.5 preceding and 0.5 following)
+FROM (VALUES (1.0), (2.0), (2.5), (4.0)) v(x);
+
+SELECT ts, count(*) over (order by ts range between '5 minutes' preceding and current row)
+FROM generate_series(timestamp '2012-01-01 00:02', timestamp '2012-01-01 00:16',
+	interval '2 minutes') ts;
+
+SELECT d, count(*) over (order by d range between 1 preceding and 1 following)
+FROM (SELECT t::date FROM generate_series(timestamp '2012-02-27', timestamp '2012-03-02',
+	interval '1 day') t) s(d);
+
+-- a bound past the range of the type leaves the frame unbounded on its side
+SELECT x, count(*) over (order by x range between 2147483647 preceding and 2147483647 following),
+	sum(x::int8) over (order by x desc range between 1 preceding and 2147483647 following)
+FROM (VALUES (-2147483647), (-1), (0), (NULL), (2147483647)) v(x);
+SELECT x, count(*) over (order by x range between 1 preceding and 1 following)
+FROM (VALUES (int2 '-32768'), (int2 '0'), (int2 '32767')) v(x);
+SELECT x, count(*) over (order by x range between 1 preceding and 1 following)
+FROM (VALUES (int8 '-9223372036854775808'), (int8 '0'), (int8 '9223372036854775807')) v(x);
+SELECT x, count(*) over (order by x range between 1e308 preceding and 1e308 following)
+FROM (VALUES (float8 '-1e308'), (float8 '0'), (float8 '1e308')) v(x);
+SELECT x, count(*) over (order by x range between 1 preceding and 1 following)
+FROM (VALUES (date '4714-11-24 BC'), (date '2000-01-01'), (date '5874897-12-31')) v(x);
+SELECT x, count(*) over (order by x range between interval '1 day' preceding and interval '1 day' following)
+FROM (VALUES (date '4714-11-24 BC'), (date '2000-01-01'), (date '294276-12-31')) v(x);
+SELECT x, count(*) over (order by x range between interval '1000 years' preceding
+	and interval '1000 years' following)
+FROM (VALUES (timestamp '4714-11-24 BC'), (timestamp '2000-01-01'), (timestamp '294276-12-31')) v(x);
+
+-- a view depends on the functions that locate its RANGE bounds
+CREATE SCHEMA window_range;
+SET search_path = window_range, public;
+CREATE FUNCTION int4_plus_numeric(int4, numeric) RETURNS int4
+	AS 'SELECT trunc($1::numeric + $2)::int4' LANGUAGE sql IMMUTABLE STRICT;
+CREATE OPERATOR + (procedure = int4_plus_numeric, leftarg = int4, rightarg = numeric);
+CREATE VIEW v_range AS
+	SELECT i, count(*) over (order by i range between current row and 1.5 following)
+	FROM generate_series(1, 4) i;
+SELECT * FROM v_range;
+-- an error from a user-defined offset function is raised, not taken for
+-- a bound past the range of the type
+CREATE FUNCTION int4_minus_numeric(int4, numeric) RETURNS int4 AS $$
+BEGIN
+	IF $1::numeric - $2 < 0 THEN
+		RAISE numeric_value_out_of_range USING MESSAGE = 'negative bound';
+	END IF;
+	RETURN trunc($1::numeric - $2);
+END
+$$ LANGUAGE plpgsql IMMUTABLE STRICT;
+CREATE OPERATOR - (procedure = int4_minus_numeric, leftarg = int4, rightarg = numeric);
+SELECT i, count(*) over (order by i range between 1.5 preceding and current row)
+FROM generate_series(1, 4) i;
+SELECT i, count(*) over (order by i range between 1.5 preceding and current row)
+FROM generate_series(2, 5) i;
+DROP OPERATOR - (int4, numeric);
+DROP FUNCTION int4_minus_numeric(int4, numeric);
+DROP OPERATOR + (int4, numeric);
+DROP FUNCTION int4_plus_numeric(int4, numeric);
+RESET search_path;
+DROP SCHEMA window_range CASCADE;
+
+-- a partition spilled to disk gives the same frames
+SET work_mem = 64;
+SELECT * FROM
+	(SELECT unique1, unique2, sum(ten) over w, count(*) over w,
+		first_value(unique1) over w, last_value(unique1) over w,
+		nth_value(unique1, 3) over w
+	FROM tenk1 WINDOW w AS (partition by four order by unique2 desc
+		range between 20 preceding and 13 following)) s
+WHERE unique1 IN (0, 1, 2, 3, 4321, 5057, 8009, 9999)
+ORDER BY unique1;
+RESET work_mem;
+SELECT * FROM
+	(SELECT unique1, unique2, sum(ten) over w, count(*) over w,
+		first_value(unique1) over w, last_value(unique1) over w,
+		nth_value(unique1, 3) over w
+	FROM tenk1 WINDOW w AS (partition by four order by unique2 desc
+		range between 20 preceding and 13 following)) s
+WHERE unique1 IN (0, 1, 2, 3, 4321, 5057, 8009, 9999)
+ORDER BY unique1;
+
+-- fail: a RANGE offset needs a single sort column of a type that has +/-
+SELECT sum(unique1) over (order by four, ten range 1 preceding) FROM tenk1;
+SELECT sum(unique1) over (range 1 preceding) FROM tenk1;
+SELECT sum(unique1) over (order by stringu1 range 1 preceding) FROM tenk1;
+SELECT sum(unique1) over (order by four range between -1 preceding and current row) FROM tenk1;
+
 SELECT first_value(unique1) over w,
 	nth_value(unique1, 2) over w AS nth_2,
 	last_value(unique1) over w, unique1, four
@@ -223,6 +329,664 @@ SELECT * FROM v_window;
 
 SELECT pg_get_viewdef('v_window');
 
+-- moving frames, with rows removed by inverse transition functions
+CREATE TEMP TABLE invtrans (i int4, v int4, f float8, n numeric);
+INSERT INTO invtrans VALUES
+	(1, 1, 1.5, 1.1), (2, 2, 2.5, 2.25), (3, NULL, NULL, NULL),
+	(4, NULL, 4, 4), (5, 5, 'NaN', 'NaN'), (6, 6, 6, 6.000),
+	(7, NULL, 7, 7), (8, 8, 8.25, 8.5), (9, 9, 9, 9), (10, 10, 10, 10);
+
+SELECT i, sum(v) over w, count(v) over w, count(*) over w, avg(v) over w,
+	sum(v::int2) over w AS sum2, avg(v::int8) over w AS avg8,
+	sum(v::int8) over w AS sum8
+FROM invtrans WINDOW w AS (order by i rows between 1 preceding and current row);
+
+SELECT i, sum(f) over w, avg(f) over w, sum(n) over w, avg(n) over w
+FROM invtrans WINDOW w AS (order by i rows between 2 preceding and current row);
+
+SELECT i, sum(n) over w, count(n) over w
+FROM invtrans WINDOW w AS (order by i rows between 1 following and 3 following);
+
+-- float sums have no inverse: subtracting a large value back out would lose
+-- the small ones added after it
+SELECT x, sum(x) over w, avg(x) over w, sum(x::float4) over w
+FROM (VALUES (1, 1e20::float8), (2, 1), (3, 1), (4, 1)) v(i, x)
+WINDOW w AS (order by i rows 1 preceding);
+
+-- the results must not depend on whether rows are removed or re-aggregated
+CREATE TEMP TABLE invtrans_on AS
+SELECT i, sum(v) over w AS sv, count(v) over w AS cv, count(*) over w AS c,
+	avg(v) over w AS av, sum(f) over w AS sf, avg(f) over w AS af,
+	sum(n) over w AS sn, avg(n) over w AS an
+FROM invtrans WINDOW w AS (order by i rows between 2 preceding and 1 following);
+
+SET enable_inversetrans = off;
+
+CREATE TEMP TABLE invtrans_off AS
+SELECT i, sum(v) over w AS sv, count(v) over w AS cv, count(*) over w AS c,
+	avg(v) over w AS av, sum(f) over w AS sf, avg(f) over w AS af,
+	sum(n) over w AS sn, avg(n) over w AS an
+FROM invtrans WINDOW w AS (order by i rows between 2 preceding and 1 following);
+
+SELECT * FROM invtrans_on EXCEPT SELECT * FROM invtrans_off;
+SELECT * FROM invtrans_off EXCEPT SELECT * FROM invtrans_on;
+
+-- also with the partition spilled to disk
+SET work_mem = 64;
+
+SELECT sum(s), sum(c), sum(a) FROM
+	(SELECT sum(unique1) over w AS s, count(*) over w AS c,
+		avg(unique2::numeric) over w AS a
+	 FROM tenk1
+	 WINDOW w AS (order by unique1 rows between 7 preceding and 3 following)) ss;
+
+RESET enable_inversetrans;
+
+SELECT sum(s), sum(c), sum(a) FROM
+	(SELECT sum(unique1) over w AS s, count(*) over w AS c,
+		avg(unique2::numeric) over w AS a
+	 FROM tenk1
+	 WINDOW w AS (order by unique1 rows between 7 preceding and 3 following)) ss;
+
+RESET work_mem;
+
+-- moving frames of aggregates without an inverse use the segment tree
+SELECT i, min(v) over w, max(f) over w, max(n) over w,
+	bool_and(v > 4) over w, bit_or(v) over w, avg(v) over w
+FROM invtrans WINDOW w AS (order by i rows between 2 preceding and 1 following);
+
+SELECT i, max(v::text) over w, min(f) over w, count(v) over w
+FROM invtrans WINDOW w AS (order by i rows between 1 following and 3 following);
+
+SELECT i, v, max(i) over w, min(i) over w, avg(f) over w
+FROM invtrans WINDOW w AS (order by v range between current row and unbounded following);
+
+CREATE TEMP TABLE segtree_on AS
+SELECT i, min(v) over w AS mv, max(f) over w AS xf, max(n) over w AS xn,
+	sum(v) over w AS sv, avg(f) over w AS af, count(*) over w AS c
+FROM invtrans WINDOW w AS (order by i rows between 3 preceding and 2 following);
+
+SET enable_segtree = off;
+
+CREATE TEMP TABLE segtree_off AS
+SELECT i, min(v) over w AS mv, max(f) over w AS xf, max(n) over w AS xn,
+	sum(v) over w AS sv, avg(f) over w AS af, count(*) over w AS c
+FROM invtrans WINDOW w AS (order by i rows between 3 preceding and 2 following);
+
+SELECT * FROM segtree_on EXCEPT SELECT * FROM segtree_off;
+SELECT * FROM segtree_off EXCEPT SELECT * FROM segtree_on;
+
+-- also with a tree of several rows per leaf
+SET work_mem = 64;
+
+SELECT sum(mn), sum(mx), sum(c) FROM
+	(SELECT min(unique2) over w AS mn, max(unique2) over w AS mx,
+		count(*) over w AS c
+	 FROM tenk1
+	 WINDOW w AS (order by unique1 rows between 20 preceding and 5 following)) ss;
+
+RESET enable_segtree;
+
+SELECT sum(mn), sum(mx), sum(c) FROM
+	(SELECT min(unique2) over w AS mn, max(unique2) over w AS mx,
+		count(*) over w AS c
+	 FROM tenk1
+	 WINDOW w AS (order by unique1 rows between 20 preceding and 5 following)) ss;
+
+RESET work_mem;
+
+-- bounded ROWS frames keep only the frame's leaves, reused as a ring
+CREATE TEMP TABLE segring_on AS
+SELECT i, max(v) over w1 AS a, min(f) over w2 AS b, max(v::text) over w3 AS c,
+	max(n) over w4 AS d
+FROM invtrans
+WINDOW w1 AS (order by i rows between 2 following and 5 following),
+	w2 AS (order by i rows between 5 preceding and 1 preceding),
+	w3 AS (order by i rows between 3 following and 1 following),
+	w4 AS (order by i rows between 6 preceding and current row);
+
+SET enable_segtree = off;
+
+CREATE TEMP TABLE segring_off AS
+SELECT i, max(v) over w1 AS a, min(f) over w2 AS b, max(v::text) over w3 AS c,
+	max(n) over w4 AS d
+FROM invtrans
+WINDOW w1 AS (order by i rows between 2 following and 5 following),
+	w2 AS (order by i rows between 5 preceding and 1 preceding),
+	w3 AS (order by i rows between 3 following and 1 following),
+	w4 AS (order by i rows between 6 preceding and current row);
+
+SELECT * FROM segring_on EXCEPT SELECT * FROM segring_off;
+SELECT * FROM segring_off EXCEPT SELECT * FROM segring_on;
+
+RESET enable_segtree;
+
+SET work_mem = 64;
+
+SELECT * FROM
+	(SELECT unique1, min(unique2) over w AS mn, max(stringu1) over w AS mx
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1
+				  rows between 5 preceding and 2 following)) ss
+WHERE unique1 IN (0, 4, 16, 20, 24, 5001, 9987, 9991, 9995, 9999)
+ORDER BY unique1;
+
+SET enable_segtree = off;
+
+SELECT * FROM
+	(SELECT unique1, min(unique2) over w AS mn, max(stringu1) over w AS mx
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1
+				  rows between 5 preceding and 2 following)) ss
+WHERE unique1 IN (0, 4, 16, 20, 24, 5001, 9987, 9991, 9995, 9999)
+ORDER BY unique1;
+
+RESET enable_segtree;
+RESET work_mem;
+
+-- temporary transition values, when neither an inverse nor a combine
+-- function can be used
+SET enable_inversetrans = off;
+SET enable_segtree = off;
+
+SELECT four, sum(s), sum(c), sum(m) FROM
+	(SELECT four, sum(unique2) over w AS s, count(*) over w AS c,
+		max(unique2) over w AS m
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1
+				  rows between 150 preceding and 3 following)) ss
+GROUP BY four ORDER BY four;
+
+SET enable_recompute = off;
+
+SELECT four, sum(s), sum(c), sum(m) FROM
+	(SELECT four, sum(unique2) over w AS s, count(*) over w AS c,
+		max(unique2) over w AS m
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1
+				  rows between 150 preceding and 3 following)) ss
+GROUP BY four ORDER BY four;
+
+RESET enable_recompute;
+RESET enable_segtree;
+RESET enable_inversetrans;
+
+-- spilled partitions keep only the ordering columns and the columns used
+-- by window function arguments; the current row is still projected whole
+SET work_mem = 64;
+SET enable_winfunopt = on;
+
+SELECT * FROM
+	(SELECT unique1, stringu1, string4, lag(string4, 3) over w AS lag,
+		max(stringu2) over w AS max, nth_value(ten * two, 2) over w AS nth,
+		lead(unique2 + 1, 2) over w AS lead, sum(unique2 % 7) over w AS sum,
+		rank() over w AS rank
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by ten, unique1
+				  rows between 7 preceding and 2 following)) ss
+WHERE unique1 IN (0, 20, 40, 60, 5011, 9959, 9979, 9999)
+ORDER BY unique1;
+
+RESET enable_winfunopt;
+
+SELECT * FROM
+	(SELECT unique1, stringu1, string4, lag(string4, 3) over w AS lag,
+		max(stringu2) over w AS max, nth_value(ten * two, 2) over w AS nth,
+		lead(unique2 + 1, 2) over w AS lead, sum(unique2 % 7) over w AS sum,
+		rank() over w AS rank
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by ten, unique1
+				  rows between 7 preceding and 2 following)) ss
+WHERE unique1 IN (0, 20, 40, 60, 5011, 9959, 9979, 9999)
+ORDER BY unique1;
+
+RESET work_mem;
+
+-- spilled partitions are spooled only as far as needed, so reads of the
+-- temp file interleave with appends to it
+SET work_mem = 64;
+
+SELECT count(*) FROM
+	(SELECT unique1, lag(unique1, 5) over w AS lg, lead(unique1, 5) over w AS ld,
+		row_number() over w AS rn
+	 FROM tenk1 WINDOW w AS (order by unique1)) ss
+WHERE lg IS DISTINCT FROM (CASE WHEN rn > 5 THEN unique1 - 5 END)
+	OR ld IS DISTINCT FROM (CASE WHEN rn <= 9995 THEN unique1 + 5 END);
+
+SET enable_winfunopt = on;
+
+SELECT count(*) FROM
+	(SELECT unique1, lag(unique1, 5) over w AS lg, lead(unique1, 5) over w AS ld,
+		row_number() over w AS rn
+	 FROM tenk1 WINDOW w AS (order by unique1)) ss
+WHERE lg IS DISTINCT FROM (CASE WHEN rn > 5 THEN unique1 - 5 END)
+	OR ld IS DISTINCT FROM (CASE WHEN rn <= 9995 THEN unique1 + 5 END);
+
+RESET enable_winfunopt;
+
+-- and a scrollable cursor reads its spilled store backwards
+BEGIN;
+DECLARE c SCROLL CURSOR FOR
+	SELECT unique1, lead(unique1) over (order by unique1) FROM tenk1;
+MOVE FORWARD 6000 IN c;
+FETCH BACKWARD 2 FROM c;
+MOVE FORWARD 3000 IN c;
+FETCH 2 FROM c;
+FETCH BACKWARD 1 FROM c;
+COMMIT;
+
+RESET work_mem;
+
+-- useful tuples of the same size are located by offset rather than read
+-- one by one
+SET work_mem = 64;
+SET enable_segtree = off;
+SET enable_inversetrans = off;
+SET enable_winfunopt = on;
+
+SELECT * FROM
+	(SELECT unique1, max(unique2) over w, min(ten) over w,
+		nth_value(unique2, 250) over w, lag(unique2, 400) over w
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1
+				  rows between 300 preceding and 300 following)) ss
+WHERE unique1 IN (0, 1596, 1600, 5000, 9796, 9799, 9996, 9999)
+ORDER BY unique1;
+
+RESET enable_winfunopt;
+
+SELECT * FROM
+	(SELECT unique1, max(unique2) over w, min(ten) over w,
+		nth_value(unique2, 250) over w, lag(unique2, 400) over w
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1
+				  rows between 300 preceding and 300 following)) ss
+WHERE unique1 IN (0, 1596, 1600, 5000, 9796, 9799, 9996, 9999)
+ORDER BY unique1;
+
+-- tuples of varying size are found through the row index
+SET enable_locate = off;
+SELECT * FROM
+	(SELECT unique1, sum(length(pad)) over w AS padlen,
+		length(first_value(pad) over w) AS firstlen, lag(unique2, 150) over w
+	 FROM (SELECT *, repeat('x', unique1 % 37) AS pad FROM tenk1) t
+	 WINDOW w AS (partition by four order by unique2
+				  rows between 300 preceding and 300 following)) ss
+WHERE unique1 IN (0, 1, 2, 3, 5000, 9997, 9998, 9999)
+ORDER BY unique1;
+SET enable_winfunopt = on;
+SELECT * FROM
+	(SELECT unique1, sum(length(pad)) over w AS padlen,
+		length(first_value(pad) over w) AS firstlen, lag(unique2, 150) over w
+	 FROM (SELECT *, repeat('x', unique1 % 37) AS pad FROM tenk1) t
+	 WINDOW w AS (partition by four order by unique2
+				  rows between 300 preceding and 300 following)) ss
+WHERE unique1 IN (0, 1, 2, 3, 5000, 9997, 9998, 9999)
+ORDER BY unique1;
+RESET enable_winfunopt;
+RESET work_mem;
+SELECT * FROM
+	(SELECT unique1, sum(length(pad)) over w AS padlen,
+		length(first_value(pad) over w) AS firstlen, lag(unique2, 150) over w
+	 FROM (SELECT *, repeat('x', unique1 % 37) AS pad FROM tenk1) t
+	 WINDOW w AS (partition by four order by unique2
+				  rows between 300 preceding and 300 following)) ss
+WHERE unique1 IN (0, 1, 2, 3, 5000, 9997, 9998, 9999)
+ORDER BY unique1;
+RESET enable_locate;
+
+-- aggregate arguments are kept in a column buffer for rows aggregated again
+SET work_mem = 64;
+SET enable_recompute = off;
+SELECT * FROM
+	(SELECT unique1, sum(unique2) over w, max(nullif(ten, 3)) over w,
+		count(nullif(four, 1)) over w
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique2
+				  rows between 100 preceding and 50 following)) ss
+WHERE unique1 IN (0, 1, 2, 3, 4321, 9996, 9997, 9998, 9999)
+ORDER BY unique1;
+SET enable_columnbuffer = off;
+SELECT * FROM
+	(SELECT unique1, sum(unique2) over w, max(nullif(ten, 3)) over w,
+		count(nullif(four, 1)) over w
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique2
+				  rows between 100 preceding and 50 following)) ss
+WHERE unique1 IN (0, 1, 2, 3, 4321, 9996, 9997, 9998, 9999)
+ORDER BY unique1;
+RESET enable_columnbuffer;
+
+-- built-in aggregates advance over runs of the column buffer without fmgr
+SELECT * FROM
+	(SELECT unique1, count(*) over w, sum(nullif(ten, 3)::int2) over w,
+		min(nullif(unique1, 5)::int8) over w, sum(unique1::float8) over w AS fsum,
+		max(nullif(ten, 2)::float8) over w, round(avg(unique1) over w, 4) AS avg,
+		round((stddev(unique2::float8) over w)::numeric, 4) AS stddev
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique2
+				  rows between 100 preceding and 50 following)) ss
+WHERE unique1 IN (0, 1, 2, 3, 5, 4321, 8009, 9999)
+ORDER BY unique1;
+SET enable_batchadvance = off;
+SELECT * FROM
+	(SELECT unique1, count(*) over w, sum(nullif(ten, 3)::int2) over w,
+		min(nullif(unique1, 5)::int8) over w, sum(unique1::float8) over w AS fsum,
+		max(nullif(ten, 2)::float8) over w, round(avg(unique1) over w, 4) AS avg,
+		round((stddev(unique2::float8) over w)::numeric, 4) AS stddev
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique2
+				  rows between 100 preceding and 50 following)) ss
+WHERE unique1 IN (0, 1, 2, 3, 5, 4321, 8009, 9999)
+ORDER BY unique1;
+RESET enable_batchadvance;
+RESET enable_recompute;
+
+RESET enable_inversetrans;
+RESET enable_segtree;
+RESET work_mem;
+
+-- lead, lag and the frame value functions read plain columns from a ring
+SET work_mem = 64;
+SELECT * FROM
+	(SELECT unique1, lag(pad) over w, lead(unique2, 7) over w,
+		lag(unique1, 150, -1) over w, lead(pad, 150, 'none') over w,
+		first_value(pad) over w2, nth_value(unique2, 3) over w2,
+		last_value(pad) over w2
+	 FROM (SELECT *, repeat('x', unique1 % 7 + 1) AS pad FROM tenk1) t
+	 WINDOW w AS (partition by four order by unique2),
+		w2 AS (w rows between 20 preceding and 10 following)) ss
+WHERE unique1 IN (0, 1, 2, 3, 4321, 5057, 8009, 9999)
+ORDER BY unique1;
+SET enable_argring = off;
+SELECT * FROM
+	(SELECT unique1, lag(pad) over w, lead(unique2, 7) over w,
+		lag(unique1, 150, -1) over w, lead(pad, 150, 'none') over w,
+		first_value(pad) over w2, nth_value(unique2, 3) over w2,
+		last_value(pad) over w2
+	 FROM (SELECT *, repeat('x', unique1 % 7 + 1) AS pad FROM tenk1) t
+	 WINDOW w AS (partition by four order by unique2),
+		w2 AS (w rows between 20 preceding and 10 following)) ss
+WHERE unique1 IN (0, 1, 2, 3, 4321, 5057, 8009, 9999)
+ORDER BY unique1;
+RESET enable_argring;
+RESET work_mem;
+
+-- aggregates of the same arguments share their evaluation, and sum and
+-- count are finalized from the transition value of avg
+SELECT * FROM
+	(SELECT unique1, sum(four) over w, avg(four) over w, count(four) over w,
+		min(four) over w, sum(unique2 * 2) over w AS sum2,
+		round(avg(unique2 * 2) over w, 2) AS avg2,
+		round((stddev(ten::float8) over w)::numeric, 4) AS stddev,
+		round((variance(ten::float8) over w)::numeric, 4) AS variance
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1)) ss
+WHERE unique1 IN (0, 3, 43, 83, 5001, 9963, 9999)
+ORDER BY unique1;
+SELECT * FROM
+	(SELECT unique1, sum(nullif(ten, 3)::int2) over w,
+		round(avg(nullif(ten, 3)::int2) over w, 4) AS avg,
+		count(nullif(ten, 3)::int2) over w,
+		round(avg(ten::numeric) over w, 4) AS avgn, sum(ten::numeric) over w AS sumn
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1
+				  rows between 20 preceding and 10 following)) ss
+WHERE unique1 IN (0, 3, 43, 83, 5001, 9963, 9999)
+ORDER BY unique1;
+SET enable_aggshare = off;
+SELECT * FROM
+	(SELECT unique1, sum(four) over w, avg(four) over w, count(four) over w,
+		min(four) over w, sum(unique2 * 2) over w AS sum2,
+		round(avg(unique2 * 2) over w, 2) AS avg2,
+		round((stddev(ten::float8) over w)::numeric, 4) AS stddev,
+		round((variance(ten::float8) over w)::numeric, 4) AS variance
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1)) ss
+WHERE unique1 IN (0, 3, 43, 83, 5001, 9963, 9999)
+ORDER BY unique1;
+SELECT * FROM
+	(SELECT unique1, sum(nullif(ten, 3)::int2) over w,
+		round(avg(nullif(ten, 3)::int2) over w, 4) AS avg,
+		count(nullif(ten, 3)::int2) over w,
+		round(avg(ten::numeric) over w, 4) AS avgn, sum(ten::numeric) over w AS sumn
+	 FROM tenk1
+	 WINDOW w AS (partition by four order by unique1
+				  rows between 20 preceding and 10 following)) ss
+WHERE unique1 IN (0, 3, 43, 83, 5001, 9963, 9999)
+ORDER BY unique1;
+RESET enable_aggshare;
+
+-- windows with the same partitioning, whose orderings are prefixes of
+-- each other, are evaluated by one WindowAgg over one sort
+EXPLAIN (COSTS OFF)
+SELECT sum(unique2) over (partition by four order by ten, unique1),
+	max(unique2) over (partition by four order by ten, unique1 rows 3 preceding),
+	rank() over (partition by four order by ten),
+	count(*) over (partition by four),
+	sum(unique2) over (order by ten)
+FROM tenk1;
+
+SELECT * FROM
+	(SELECT unique1, sum(unique2) over w1 AS sum1, lag(unique2, 2) over w1,
+		max(unique2) over w2, first_value(unique1) over w2,
+		rank() over w3, sum(unique2) over w3 AS sum3,
+		count(*) over w4, min(unique1) over w4
+	 FROM tenk1
+	 WINDOW w1 AS (partition by four order by ten, unique1),
+		w2 AS (partition by four order by ten, unique1
+			   rows between 3 preceding and 2 following),
+		w3 AS (partition by four order by ten),
+		w4 AS (partition by four)) ss
+WHERE unique1 IN (0, 12, 20, 40, 4321, 9980, 9999)
+ORDER BY unique1;
+
+SET work_mem = 64;
+
+SELECT * FROM
+	(SELECT unique1, sum(unique2) over w1 AS sum1, lag(unique2, 2) over w1,
+		max(unique2) over w2, first_value(unique1) over w2,
+		rank() over w3, sum(unique2) over w3 AS sum3,
+		count(*) over w4, min(unique1) over w4
+	 FROM tenk1
+	 WINDOW w1 AS (partition by four order by ten, unique1),
+		w2 AS (partition by four order by ten, unique1
+			   rows between 3 preceding and 2 following),
+		w3 AS (partition by four order by ten),
+		w4 AS (partition by four)) ss
+WHERE unique1 IN (0, 12, 20, 40, 4321, 9980, 9999)
+ORDER BY unique1;
+
+SET enable_winfunopt = on;
+
+SELECT * FROM
+	(SELECT unique1, sum(unique2) over w1 AS sum1, lag(unique2, 2) over w1,
+		max(unique2) over w2, first_value(unique1) over w2,
+		rank() over w3, sum(unique2) over w3 AS sum3,
+		count(*) over w4, min(unique1) over w4
+	 FROM tenk1
+	 WINDOW w1 AS (partition by four order by ten, unique1),
+		w2 AS (partition by four order by ten, unique1
+			   rows between 3 preceding and 2 following),
+		w3 AS (partition by four order by ten),
+		w4 AS (partition by four)) ss
+WHERE unique1 IN (0, 12, 20, 40, 4321, 9980, 9999)
+ORDER BY unique1;
+
+RESET enable_winfunopt;
+SET enable_multiframe = off;
+
+SELECT * FROM
+	(SELECT unique1, sum(unique2) over w1 AS sum1, lag(unique2, 2) over w1,
+		max(unique2) over w2, first_value(unique1) over w2,
+		rank() over w3, sum(unique2) over w3 AS sum3,
+		count(*) over w4, min(unique1) over w4
+	 FROM tenk1
+	 WINDOW w1 AS (partition by four order by ten, unique1),
+		w2 AS (partition by four order by ten, unique1
+			   rows between 3 preceding and 2 following),
+		w3 AS (partition by four order by ten),
+		w4 AS (partition by four)) ss
+WHERE unique1 IN (0, 12, 20, 40, 4321, 9980, 9999)
+ORDER BY unique1;
+
+RESET enable_multiframe;
+RESET work_mem;
+
+-- partitioning columns are ordered, and windows put in an order, so that
+-- windows can share sorts
+EXPLAIN (COSTS OFF)
+SELECT sum(unique2) over (partition by four, ten),
+	count(*) over (partition by ten),
+	min(unique1) over (partition by ten order by four)
+FROM tenk1;
+
+EXPLAIN (COSTS OFF)
+SELECT sum(unique2) over (partition by ten order by unique1),
+	count(*) over (partition by four),
+	min(unique1) over (partition by four order by ten)
+FROM tenk1;
+
+-- a sort whose input is sorted by leading keys sorts one group at a time
+EXPLAIN (COSTS OFF)
+SELECT sum(unique2) over (partition by four order by ten),
+	max(unique2) over (partition by four order by unique1)
+FROM tenk1;
+
+SET work_mem = 64;
+SELECT * FROM
+	(SELECT unique1, sum(unique2) over (partition by four order by ten),
+		max(unique2) over (partition by four order by unique1),
+		lag(unique1) over (partition by four, ten order by unique2 desc),
+		rank() over (partition by ten order by four)
+	 FROM tenk1) ss
+WHERE unique1 IN (0, 1, 12, 20, 4321, 9990, 9999)
+ORDER BY unique1;
+SET enable_incrementalsort = off;
+SELECT * FROM
+	(SELECT unique1, sum(unique2) over (partition by four order by ten),
+		max(unique2) over (partition by four order by unique1),
+		lag(unique1) over (partition by four, ten order by unique2 desc),
+		rank() over (partition by ten order by four)
+	 FROM tenk1) ss
+WHERE unique1 IN (0, 1, 12, 20, 4321, 9990, 9999)
+ORDER BY unique1;
+RESET enable_incrementalsort;
+RESET work_mem;
+
+-- groups of fewer than 32 tuples are sorted together, larger ones alone
+CREATE TEMP TABLE isort AS
+	SELECT i, CASE WHEN i <= 100 THEN 0 ELSE i / 3 END AS g, (i * 7) % 11 AS v
+	FROM generate_series(1, 300) i;
+EXPLAIN (COSTS OFF)
+SELECT v, i, lag(v) over w, lag(i) over w, row_number() over w
+FROM (SELECT * FROM isort ORDER BY g) s
+WINDOW w AS (partition by g order by v, i);
+SELECT count(*) AS rows, sum(CASE WHEN rn = 1 THEN 1 ELSE 0 END) AS partitions,
+	sum(CASE WHEN (pv, pi) > (v, i) THEN 1 ELSE 0 END) AS out_of_order
+FROM (SELECT v, i, lag(v) over w AS pv, lag(i) over w AS pi, row_number() over w AS rn
+	FROM (SELECT * FROM isort ORDER BY g) s
+	WINDOW w AS (partition by g order by v, i)) ss;
+DROP TABLE isort;
+
+-- a qual bounding row_number, rank or dense_rank lets the topmost WindowAgg
+-- skip the rest of each partition
+EXPLAIN (COSTS OFF)
+SELECT * FROM (SELECT four, unique1,
+	row_number() over (partition by four order by unique1) rn FROM tenk1) s
+WHERE rn <= 3;
+SELECT * FROM (SELECT four, unique1,
+	row_number() over (partition by four order by unique1) rn FROM tenk1) s
+WHERE rn <= 3;
+EXPLAIN (COSTS OFF)
+SELECT * FROM (SELECT ten, unique1,
+	row_number() over (partition by four order by unique1) rn,
+	rank() over (partition by ten order by four) r FROM tenk1) s
+WHERE rn < 3 AND 2 > r;
+SET work_mem = 64;
+SELECT ten, count(*), max(r) AS r, sum(sum) AS sum, min(unique1),
+	max(unique1), count(lag) AS lag FROM
+	(SELECT ten, unique1, rank() over (partition by ten order by hundred) r,
+		sum(unique2) over (partition by ten order by hundred, unique1),
+		lag(unique1, 2) over (partition by ten order by hundred, unique1)
+	 FROM tenk1) s
+WHERE 150 >= r
+GROUP BY ten ORDER BY ten;
+SET enable_runcondition = off;
+SELECT ten, count(*), max(r) AS r, sum(sum) AS sum, min(unique1),
+	max(unique1), count(lag) AS lag FROM
+	(SELECT ten, unique1, rank() over (partition by ten order by hundred) r,
+		sum(unique2) over (partition by ten order by hundred, unique1),
+		lag(unique1, 2) over (partition by ten order by hundred, unique1)
+	 FROM tenk1) s
+WHERE 150 >= r
+GROUP BY ten ORDER BY ten;
+RESET enable_runcondition;
+-- the other frames of the node start over after a skipped partition
+CREATE TEMP TABLE rt AS
+	SELECT i, i % 4 AS k, i / 8 AS x FROM generate_series(0, 3999) i;
+SET enable_winfunopt = on;
+SELECT * FROM (SELECT i, k, x,
+	row_number() over (partition by k order by x, i) rn,
+	count(*) over (partition by k) c,
+	sum(x) over (partition by k order by x, i rows 3 preceding) a FROM rt) s
+WHERE rn <= 3;
+RESET enable_winfunopt;
+DROP TABLE rt;
+RESET work_mem;
+
+-- the cost of a window aggregate follows its frame and how it is aggregated
+CREATE FUNCTION window_total_cost(query text) RETURNS float8 AS $$
+DECLARE
+	line text;
+BEGIN
+	FOR line IN EXECUTE 'EXPLAIN ' || query LOOP
+		RETURN substring(line from '\.\.([0-9.]+) ')::float8;
+	END LOOP;
+END;
+$$ LANGUAGE plpgsql;
+
+SELECT window_total_cost('SELECT sum(unique2) over (order by unique1 rows between 100 preceding and 100 following) FROM tenk1') <
+	window_total_cost('SELECT string_agg(unique2::text, '','') over (order by unique1 rows between 100 preceding and 100 following) FROM tenk1')
+	AS inverse_cheaper_than_restart;
+SET enable_inversetrans = off;
+SET enable_segtree = off;
+SELECT window_total_cost('SELECT sum(unique2) over (order by unique1 rows between 100 preceding and 100 following) FROM tenk1') <
+	window_total_cost('SELECT sum(unique2) over (order by unique1 rows between 200 preceding and 200 following) FROM tenk1')
+	AS smaller_frame_cheaper;
+SET enable_recompute = off;
+SELECT window_total_cost('SELECT sum(unique2) over (order by unique1 rows between 100 preceding and 100 following) FROM tenk1') >
+	window_total_cost('SELECT sum(unique2) over (order by unique1) FROM tenk1') * 10
+	AS restart_costs_more;
+RESET enable_recompute;
+RESET enable_segtree;
+RESET enable_inversetrans;
+DROP FUNCTION window_total_cost(text);
+
+-- EXPLAIN ANALYZE reports what the window aggregate did; timings are left out
+CREATE FUNCTION window_analyze(query text) RETURNS SETOF text AS $$
+DECLARE
+	line text;
+BEGIN
+	FOR line IN EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF) ' || query LOOP
+		IF line ~ 'Partitions:' THEN
+			RETURN NEXT btrim(line);
+		ELSIF line ~ 'Temp Read:' THEN
+			RETURN NEXT 'Temp Read: yes';
+		ELSIF line ~ 'Rows Skipped:' THEN
+			RETURN NEXT btrim(line);
+		END IF;
+	END LOOP;
+END;
+$$ LANGUAGE plpgsql;
+
+SELECT window_analyze('SELECT sum(unique2) over (partition by ten order by unique1 rows between 1 preceding and current row) FROM tenk1');
+SET work_mem = 64;
+SELECT window_analyze('SELECT sum(unique2) over (partition by four order by unique1 rows between 1 preceding and unbounded following) FROM tenk1');
+RESET work_mem;
+SELECT window_analyze('SELECT * FROM (SELECT dense_rank() over (partition by four order by ten) dr FROM tenk1) s WHERE dr = 2');
+DROP FUNCTION window_analyze(text);
+
 -- with UNION
 SELECT count(*) OVER (PARTITION BY four) FROM (SELECT * FROM tenk1 UNION ALL SELECT * FROM tenk2)s LIMIT 0;
 